@@ -15,6 +15,19 @@ IF (WITH_TESTS)
   MESSAGE(STATUS "Test programs are enabled")
 ENDIF (WITH_TESTS)
 
+# Enables benchmark programs which print their measurements as JSON.
+OPTION(WITH_BENCHMARKS "Turns benchmarks on if enabled." OFF)
+IF (WITH_BENCHMARKS)
+  MESSAGE(STATUS "Benchmark programs are enabled")
+ENDIF (WITH_BENCHMARKS)
+
+# Enables minstopwatch instrumentation of library functions.
+OPTION(WITH_TIMING "Measures library functions with minstopwatch." OFF)
+IF (WITH_TIMING)
+  MESSAGE(STATUS "Function timing is enabled")
+  ADD_DEFINITIONS(-DMINSTOPWATCH_ENABLED)
+ENDIF (WITH_TIMING)
+
 OPTION(WITH_DEMOS "Turns demos on if enabled." OFF)
 IF (WITH_DEMOS)
   MESSAGE(STATUS "Demo programs are enabled")
@@ -55,6 +68,18 @@ IF (WITH_SIMD)
   ENDIF()
 ENDIF()
 
+# Enables multithreading of image processing functions with OpenMP,
+# if the compiler supports it.
+OPTION(WITH_OPENMP "Use OpenMP for multithreading." ON)
+IF (WITH_OPENMP)
+  FIND_PACKAGE(OpenMP)
+  IF (OPENMP_FOUND)
+    MESSAGE(STATUS "OpenMP multithreading is enabled.")
+    SET(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} ${OpenMP_C_FLAGS}")
+    SET(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} ${OpenMP_CXX_FLAGS}")
+  ENDIF()
+ENDIF()
+
 # --- debug info in release build ---
 if(WIN32)
   set(RELEASE_WITH_DEBUG_INFO_DEFAULT OFF)
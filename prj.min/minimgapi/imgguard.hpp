@@ -38,6 +38,7 @@ either expressed or implied, of copyright holders.
 #ifndef IMGGUARD_INCLUDED
 #define IMGGUARD_INCLUDED
 
+#include <minutils/minerr.h>
 #include <minimgapi/minimgapi.h>
 
 /**
@@ -77,6 +78,78 @@ private:
   MinImg &image; ///< The reference to the image to be freed.
 };
 
+/**
+ * @brief   Specifies a reference-counted owner of an image with copy-on-write.
+ * @ingroup MinImgAPI_Utility
+ *
+ * Copies of the object share the image data (see @c RetainMinImage()), so
+ * handing an image to several consumers costs no pixel copies. The first call
+ * of @c Mutable() on an object whose data is shared copies the data (see
+ * @c UnshareMinImage()); the data is deallocated with its last owner.
+ * Distinct objects sharing the data may be used from different threads.
+ *
+ * Copying and assignment cannot report errors directly: if sharing fails
+ * (@c NO_MEMORY), the copy is left empty or the assigned object keeps its
+ * previous data, and @c GetStatus() returns the error until the next copy or
+ * assignment succeeds.
+ */
+class SharedMinImage {
+public:
+  /// Constructor. Makes an empty object.
+  SharedMinImage() : image(), status(NO_ERRORS) {
+  }
+  /// Constructor. Takes the ownership of the image and clears the header of
+  /// @c p_image. The image must be allocated with @c AllocMinImage() as a
+  /// whole (not be a region or another view of it), since the data is
+  /// counted by the address of its allocated block.
+  explicit SharedMinImage(MinImg *p_image)
+      : image(*p_image), status(NO_ERRORS) {
+    *p_image = MinImg();
+  }
+  /// Copy constructor. Shares the data of @c other.
+  SharedMinImage(const SharedMinImage &other) : image(), status(NO_ERRORS) {
+    status = RetainMinImage(&image, &other.image);
+  }
+  virtual ~SharedMinImage() { ///< Destructor. Releases the data.
+    FreeMinImage(&image);
+  }
+
+  /// Assignment operator. Releases the data and shares the data of @c other.
+  SharedMinImage &operator =(const SharedMinImage &other) {
+    MinImg reference = MinImg();
+    status = RetainMinImage(&reference, &other.image);
+    if (status == NO_ERRORS) {
+      FreeMinImage(&image);
+      image = reference;
+    }
+    return *this;
+  }
+
+  /// Returns the result of the construction, the last copy or assignment, or
+  /// the last call of @c Mutable() (see @c #MinErr).
+  int GetStatus() const {
+    return status;
+  }
+  /// Returns the image for reading.
+  const MinImg *Get() const {
+    return &image;
+  }
+  /// Returns the image for writing, having copied the data if it is shared,
+  /// or @c NULL if the copy could not be made (see @c GetStatus()).
+  MinImg *Mutable() {
+    status = UnshareMinImage(&image);
+    return status == NO_ERRORS ? &image : NULL;
+  }
+  /// Returns @c true if no other object shares the data.
+  bool IsUnique() const {
+    return GetMinImageReferenceCount(&image) <= 1;
+  }
+
+private:
+  MinImg image;  ///< The image header.
+  int    status; ///< The result of the last sharing or unsharing.
+};
+
 /**
  * @brief   Declares a new @MinImg called <name> and the @c MinImgGuard
  *          called <name>_MinImgGuard.
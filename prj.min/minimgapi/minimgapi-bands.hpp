@@ -0,0 +1,161 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   minimgapi-bands.hpp
+ * @brief  MinImgAPI row band operators interface.
+ */
+
+#pragma once
+#ifndef MINIMGAPI_BANDS_HPP_INCLUDED
+#define MINIMGAPI_BANDS_HPP_INCLUDED
+
+#include <vector>
+#include <minutils/minerr.h>
+#include <minutils/crossplat.h>
+#include <minutils/bandstream.h>
+#include <minimgapi/minimgapi.h>
+
+/**
+ * @brief   Specifies a band source reading an image in memory.
+ * @ingroup MinImgAPI_Utility
+ */
+class MINIMGAPI_API ImageBandSource : public MinImgBandSource {
+public:
+  /// Constructor. The image must stay valid while rows are read.
+  explicit ImageBandSource(const MinImg &image);
+
+  int GetPrototype(MinImg *p_prototype);
+  int ReadRows(const MinImg *p_band);
+
+private:
+  MinImg image;   ///< The source image header.
+  int    next_y;  ///< The next row to be read.
+};
+
+/**
+ * @brief   Specifies a band sink writing to an allocated image in memory.
+ * @ingroup MinImgAPI_Utility
+ */
+class MINIMGAPI_API ImageBandSink : public MinImgBandSink {
+public:
+  /// Constructor. The image must stay valid while rows are written.
+  explicit ImageBandSink(const MinImg &image);
+
+  int Begin(const MinImg *p_prototype);
+  int WriteRows(const MinImg *p_band);
+  int End();
+
+private:
+  MinImg image;   ///< The destination image header.
+  int    next_y;  ///< The next row to be written.
+};
+
+/**
+ * @brief   Specifies a band operator changing the sample rate of its source.
+ * @ingroup MinImgAPI_Utility
+ *
+ * The operator selects the same source pixels as @c ResampleMinImage() and
+ * holds a single source row.
+ */
+class MINIMGAPI_API BandResampler : public MinImgBandSource {
+public:
+  /// Constructor. The source must outlive the operator.
+  BandResampler(MinImgBandSource *p_source, int width, int height,
+                double x_phase = 0.5, double y_phase = 0.5);
+
+  int GetPrototype(MinImg *p_prototype);
+  int ReadRows(const MinImg *p_band);
+
+private:
+  MinImgBandSource    *p_source;     ///< The upstream source.
+  int                  width;        ///< The resulting width.
+  int                  height;       ///< The resulting height.
+  double               x_phase;      ///< Horizontal phase of resampling.
+  double               y_phase;      ///< Vertical phase of resampling.
+  MinImg               src_row;      ///< The last source row read.
+  std::vector<uint8_t> row_buffer;   ///< The storage of @c src_row.
+  std::vector<int>     src_x;        ///< Source columns by result columns.
+  int                  src_y;        ///< The index of @c src_row.
+  int                  next_y;       ///< The next row to be produced.
+};
+
+/**
+ * @brief   Specifies a band operator averaging its source over a rectangular
+ *          window.
+ * @ingroup MinImgAPI_Utility
+ *
+ * The operator computes the mean of each channel over the window of the given
+ * size centered at each pixel (extending further to the right and to the
+ * bottom for even sizes), reconstructing pixels out of the image as
+ * @c #BO_REPEAT does; integer results are rounded. It holds @c filter_height
+ * source rows and running column sums, so each pixel costs a constant number
+ * of operations regardless of the window size.
+ */
+class MINIMGAPI_API BandBoxFilter : public MinImgBandSource {
+public:
+  /// Constructor. The source must outlive the operator.
+  BandBoxFilter(MinImgBandSource *p_source, int filter_width,
+                int filter_height);
+
+  int GetPrototype(MinImg *p_prototype);
+  int ReadRows(const MinImg *p_band);
+
+private:
+  int PullRow(int y);
+  int UpdateColumnSums(int y, double sign);
+
+  MinImgBandSource    *p_source;       ///< The upstream source.
+  int                  filter_width;   ///< The width of the window.
+  int                  filter_height;  ///< The height of the window.
+  MinImg               prototype;      ///< The source prototype.
+  std::vector<uint8_t> window_rows;    ///< The ring of source rows.
+  std::vector<double>  column_sums;    ///< Column sums over the window.
+  int                  next_y;         ///< The next row to be produced.
+};
+
+/**
+ * @brief   Transfers an image from a band source to a band sink.
+ * @param   p_sink       The sink.
+ * @param   p_source     The source.
+ * @param   band_height  The number of rows transferred at once.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_Utility
+ *
+ * The function allocates a single band of @c band_height rows, so the memory
+ * used by the whole chain does not depend on the image height.
+ */
+MINIMGAPI_API int PumpMinImageBands(
+    MinImgBandSink   *p_sink,
+    MinImgBandSource *p_source,
+    int               band_height = 64);
+
+#endif // MINIMGAPI_BANDS_HPP_INCLUDED
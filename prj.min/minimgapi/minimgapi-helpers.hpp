@@ -57,7 +57,8 @@ template<> MinFmt MUSTINLINE GetMinFmtByCType<real32_t>() { return FMT_REAL; }
 template<> MinFmt MUSTINLINE GetMinFmtByCType<real64_t>() { return FMT_REAL; }
 
 template<typename T> MUSTINLINE MinTyp GetMinTypByCType() {
-  return _GetTypByFmtAndDepth(GetMinFmtByCType<T>(), sizeof(T));
+  return static_cast<MinTyp>(
+      _GetTypByFmtAndDepth(GetMinFmtByCType<T>(), sizeof(T)));
 }
 template<> MUSTINLINE MinTyp GetMinTypByCType<bool>() {
   return TYP_UINT1;
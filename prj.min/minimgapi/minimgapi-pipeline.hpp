@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   minimgapi-pipeline.hpp
+ * @brief  MinImgAPI deferred pipeline interface.
+ */
+
+#pragma once
+#ifndef MINIMGAPI_PIPELINE_HPP_INCLUDED
+#define MINIMGAPI_PIPELINE_HPP_INCLUDED
+
+#include <vector>
+#include <minutils/minerr.h>
+#include <minutils/crossplat.h>
+#include <minimgapi/minimgapi.h>
+
+/**
+ * @brief   Specifies a deferred chain of image transformations.
+ * @ingroup MinImgAPI_Utility
+ *
+ * The class records a chain of cropping, slicing, flipping, transposition,
+ * resampling (see @c ResampleMinImage()) and type conversion steps applied to
+ * a source image, and executes the whole chain in a single pass over the
+ * destination image. Geometric steps only select source pixels, so they are
+ * folded into a pair of per-axis coordinate maps and never touch the pixels
+ * while recording. Execution gathers the source pixels tile by tile (rows for
+ * non-transposing chains and cache-sized squares otherwise) and converts the
+ * tile in place, so no intermediate image is allocated.
+ *
+ * Each step returns @c NO_ERRORS on success or an error code otherwise (see
+ * @c #MinErr); a failed step leaves the pipeline unchanged. The source image
+ * must stay valid until the last @c Execute() call.
+ */
+class MINIMGAPI_API MinImgPipeline {
+public:
+  /// Constructor. Starts the pipeline with the identity transformation.
+  explicit MinImgPipeline(const MinImg &src_image);
+
+  /// Takes the rectangular region (see @c GetMinImageRegion()).
+  int Crop(int x0, int y0, int width, int height);
+  /// Takes equidistant lines (see @c SliceMinImageVertically()).
+  int Slice(int begin, int period, int end = -1);
+  /// Flips the image (see @c FlipMinImage()).
+  int Flip(DirectionOption direction);
+  /// Transposes the image (see @c TransposeMinImage()).
+  int Transpose();
+  /// Rotates the image clockwise (see @c RotateMinImageBy90()).
+  int RotateBy90(int num_rotations);
+  /// Changes the sample rate (see @c ResampleMinImage()).
+  int Resample(int width, int height, double x_phase = 0.5,
+               double y_phase = 0.5);
+  /// Converts the element type with rounding and saturation.
+  int Retype(MinTyp type);
+
+  /// Makes the prototype of the resulting image, allocated or not.
+  int CloneResultPrototype(
+      MinImg          *p_dst_image,
+      AllocationOption allocation = AO_PREALLOCATED) const;
+  /// Executes the pipeline into an image with the resulting prototype.
+  int Execute(const MinImg *p_dst_image) const;
+
+private:
+  /// Returns the element type of the resulting image.
+  MinTyp GetResultType() const;
+
+  MinImg              src_image;   ///< The source image header.
+  std::vector<int>    x_map;       ///< Source coordinates by result columns.
+  std::vector<int>    y_map;       ///< Source coordinates by result rows.
+  bool                transposed;  ///< Whether result columns map to rows.
+  std::vector<MinTyp> types;       ///< Element types after each conversion.
+};
+
+#endif // MINIMGAPI_PIPELINE_HPP_INCLUDED
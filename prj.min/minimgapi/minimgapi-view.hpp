@@ -0,0 +1,249 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   minimgapi-view.hpp
+ * @brief  MinImgAPI typed image views.
+ */
+
+#pragma once
+#ifndef MINIMGAPI_VIEW_HPP_INCLUDED
+#define MINIMGAPI_VIEW_HPP_INCLUDED
+
+#include <cstddef>
+#include <minutils/minerr.h>
+#include <minutils/crossplat.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/minimgapi-helpers.hpp>
+
+/// Strips @c const from the element type of a view.
+template<typename T> struct MinImgViewElement { typedef T type; };
+template<typename T> struct MinImgViewElement<const T> { typedef T type; };
+
+/**
+ * @brief   Specifies a typed view of an image with @c Channels channels of
+ *          type @c T.
+ * @ingroup MinImgAPI_Utility
+ *
+ * The image header is validated once, when the view is made; all the
+ * accessors are unchecked and inline, so loops over a view cost as much as
+ * loops over a plain array. Use <tt>const T</tt> for read-only views. Views of
+ * 1-bit images cannot be made. The view does not own the pixels.
+ */
+template<typename T, int Channels = 1>
+class MinImgView {
+public:
+  typedef T Element;
+
+  /// Constructor. Makes an empty view.
+  MinImgView() : p_scan0(NULL), width(0), height(0), stride(0) {
+  }
+  /// Constructor. Makes a view of the image, or an empty one if the image
+  /// is invalid or its type or channel count differ from the view's.
+  explicit MinImgView(const MinImg *p_image)
+      : p_scan0(NULL), width(0), height(0), stride(0) {
+    Assign(p_image);
+  }
+
+  /// Makes a view of the image. Returns @c BAD_ARGS and leaves the view
+  /// empty if the image cannot be viewed as @c T with @c Channels channels.
+  int Assign(const MinImg *p_image) {
+    *this = MinImgView();
+    PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+    if (p_image->channelDepth == 0 || p_image->channels != Channels)
+      return BAD_ARGS;
+    typedef typename MinImgViewElement<T>::type Plain;
+    if (_GetMinImageType(p_image) != GetMinTypByCType<Plain>())
+      return BAD_ARGS;
+    p_scan0 = p_image->pScan0;
+    width = p_image->width;
+    height = p_image->height;
+    stride = p_image->stride;
+    return NO_ERRORS;
+  }
+
+  /// Returns whether the view refers to any pixels.
+  bool IsValid() const { return p_scan0 != NULL; }
+  int Width() const { return width; }
+  int Height() const { return height; }
+  /// Returns the distance between the rows in bytes.
+  int Stride() const { return stride; }
+  /// Returns whether the rows follow each other without gaps.
+  bool IsContinuous() const {
+    return stride == static_cast<int>(width * Channels * sizeof(T));
+  }
+
+  /// Returns the first element of row @c y.
+  MUSTINLINE T *Row(int y) const {
+    return reinterpret_cast<T *>(p_scan0 + static_cast<ptrdiff_t>(y) * stride);
+  }
+  /// Returns the first channel of pixel (@c x, @c y).
+  MUSTINLINE T *Pixel(int x, int y) const {
+    return Row(y) + x * Channels;
+  }
+  /// Returns channel @c c of pixel (@c x, @c y).
+  MUSTINLINE T &operator ()(int x, int y, int c = 0) const {
+    return Pixel(x, y)[c];
+  }
+
+  /**
+   * @brief Iterates over the rows of a view.
+   *
+   * Dereferencing gives the first element of the current row.
+   */
+  class RowIterator {
+  public:
+    RowIterator(uint8_t *p_line, int stride) : p_line(p_line), stride(stride) {
+    }
+    MUSTINLINE T *operator *() const { return reinterpret_cast<T *>(p_line); }
+    MUSTINLINE RowIterator &operator ++() { p_line += stride; return *this; }
+    MUSTINLINE bool operator ==(const RowIterator &other) const {
+      return p_line == other.p_line;
+    }
+    MUSTINLINE bool operator !=(const RowIterator &other) const {
+      return p_line != other.p_line;
+    }
+  private:
+    uint8_t *p_line;
+    int      stride;
+  };
+
+  RowIterator RowsBegin() const { return RowIterator(p_scan0, stride); }
+  RowIterator RowsEnd() const {
+    return RowIterator(p_scan0 + static_cast<ptrdiff_t>(height) * stride,
+                       stride);
+  }
+
+private:
+  uint8_t *p_scan0;  ///< The first row.
+  int      width;    ///< The width in pixels.
+  int      height;   ///< The height in pixels.
+  int      stride;   ///< The distance between the rows in bytes.
+};
+
+/**
+ * @brief   Calls @c f(element) for every element of every pixel of the view.
+ * @ingroup MinImgAPI_Utility
+ *
+ * Continuous views are processed as one row. Returns the functor, so it can
+ * accumulate results (as @c std::for_each does).
+ */
+template<typename T, int Channels, typename Func>
+Func ForEachElement(const MinImgView<T, Channels> &view, Func f) {
+  int row_size = view.Width() * Channels;
+  int rows = view.Height();
+  if (view.IsContinuous()) {
+    row_size *= rows;
+    rows = rows > 0 ? 1 : 0;
+  }
+  for (int y = 0; y < rows; ++y) {
+    T *p_row = view.Row(y);
+    for (int i = 0; i < row_size; ++i)
+      f(p_row[i]);
+  }
+  return f;
+}
+
+/**
+ * @brief   Calls @c f(p_pixel) for every pixel of the view, where @c p_pixel
+ *          points to the first of its @c Channels elements.
+ * @ingroup MinImgAPI_Utility
+ */
+template<typename T, int Channels, typename Func>
+Func ForEachPixel(const MinImgView<T, Channels> &view, Func f) {
+  for (int y = 0; y < view.Height(); ++y) {
+    T *p_row = view.Row(y);
+    for (int x = 0; x < view.Width(); ++x)
+      f(p_row + x * Channels);
+  }
+  return f;
+}
+
+/**
+ * @brief   Sets every element of @c dst to @c f applied to the same element
+ *          of @c src.
+ * @returns @c NO_ERRORS on success or @c BAD_ARGS if the sizes differ.
+ * @ingroup MinImgAPI_Utility
+ *
+ * The views may refer to the same image.
+ */
+template<typename TDst, typename TSrc, int Channels, typename Func>
+int Transform(const MinImgView<TDst, Channels> &dst,
+              const MinImgView<TSrc, Channels> &src, Func f) {
+  if (dst.Width() != src.Width() || dst.Height() != src.Height())
+    return BAD_ARGS;
+  int row_size = dst.Width() * Channels;
+  int rows = dst.Height();
+  if (dst.IsContinuous() && src.IsContinuous()) {
+    row_size *= rows;
+    rows = rows > 0 ? 1 : 0;
+  }
+  for (int y = 0; y < rows; ++y) {
+    TDst *p_dst = dst.Row(y);
+    const TSrc *p_src = src.Row(y);
+    for (int i = 0; i < row_size; ++i)
+      p_dst[i] = f(p_src[i]);
+  }
+  return NO_ERRORS;
+}
+
+/**
+ * @brief   Sets every element of @c dst to @c f applied to the same elements
+ *          of @c src1 and @c src2.
+ * @returns @c NO_ERRORS on success or @c BAD_ARGS if the sizes differ.
+ * @ingroup MinImgAPI_Utility
+ */
+template<typename TDst, typename TSrc1, typename TSrc2, int Channels,
+         typename Func>
+int Transform(const MinImgView<TDst, Channels> &dst,
+              const MinImgView<TSrc1, Channels> &src1,
+              const MinImgView<TSrc2, Channels> &src2, Func f) {
+  if (dst.Width() != src1.Width() || dst.Height() != src1.Height() ||
+      dst.Width() != src2.Width() || dst.Height() != src2.Height())
+    return BAD_ARGS;
+  int row_size = dst.Width() * Channels;
+  int rows = dst.Height();
+  if (dst.IsContinuous() && src1.IsContinuous() && src2.IsContinuous()) {
+    row_size *= rows;
+    rows = rows > 0 ? 1 : 0;
+  }
+  for (int y = 0; y < rows; ++y) {
+    TDst *p_dst = dst.Row(y);
+    const TSrc1 *p_src1 = src1.Row(y);
+    const TSrc2 *p_src2 = src2.Row(y);
+    for (int i = 0; i < row_size; ++i)
+      p_dst[i] = f(p_src1[i], p_src2[i]);
+  }
+  return NO_ERRORS;
+}
+
+#endif // MINIMGAPI_VIEW_HPP_INCLUDED
@@ -41,6 +41,10 @@ either expressed or implied, of copyright holders.
 #include <stdlib.h>
 #include <minutils/crossplat.h>
 #include <minutils/minimg.h>
+#include <minutils/mathoper.h>
+#include <minutils/minrect.h>
+#include <minutils/minsegm.h>
+#include <minutils/minband.h>
 
 /**
  * @mainpage Overview
@@ -262,6 +266,69 @@ typedef enum {
   ///  for other cases one needs to copy source.
 } TangleCheckResult;
 
+/**
+ * @brief   Specifies the depth of image comparison.
+ * @details The enum specifies which metrics @c CompareMinImageContents()
+ *          computes; each next level includes the previous ones.
+ */
+typedef enum {
+  CO_EXACT,        ///< Only check whether images are equal, stopping at the
+                   ///  first difference.
+  CO_DIFFERENCE,   ///< Count mismatches and compute the maximal absolute
+                   ///  difference and PSNR.
+  CO_SSIM          ///< Compute the windowed SSIM as well.
+} ComparisonOption;
+
+/**
+ * @brief   Results of image comparison.
+ * @details The struct holds the metrics computed by
+ *          @c CompareMinImageContents(). Metrics which were not requested are
+ *          set to NaN.
+ */
+typedef struct {
+  int64_t mismatch_count;  ///< The number of unequal channel values (only
+                           ///  whether it is nonzero for @c #CO_EXACT).
+  double  max_abs_diff;    ///< The maximal absolute difference.
+  double  psnr;            ///< The peak signal-to-noise ratio in decibels.
+  double  ssim;            ///< The mean structural similarity index.
+} MinImgComparison;
+
+/**
+ * @brief   Specifies which neighbouring pixels are connected.
+ */
+typedef enum {
+  CN_4 = 4,        ///< Pixels sharing a side are connected.
+  CN_8 = 8         ///< Pixels sharing a side or a corner are connected.
+} ConnectivityOption;
+
+/**
+ * @brief   Describes a connected component of an image.
+ * @details The struct is filled by @c LabelMinImageComponents().
+ */
+typedef struct {
+  MinRect bounds;      ///< The bounding box.
+  int32_t area;        ///< The number of pixels.
+  double  centroid_x;  ///< The mean x-coordinate of the pixels.
+  double  centroid_y;  ///< The mean y-coordinate of the pixels.
+} MinImgComponent;
+
+/**
+ * @brief   Specifies the 3x3 gradient operator.
+ */
+typedef enum {
+  GO_SOBEL,        ///< The Sobel operator with weights (1, 2, 1).
+  GO_SCHARR        ///< The Scharr operator with weights (3, 10, 3).
+} GradientOption;
+
+/**
+ * @brief   Specifies the perceptual hash algorithm.
+ */
+typedef enum {
+  PH_DIFFERENCE,   ///< Signs of horizontal differences of a 9x8 thumbnail.
+  PH_DCT           ///< Signs of low DCT frequencies of a 32x32 thumbnail
+                   ///  against their median.
+} PerceptualHashOption;
+
 /**
  * @brief   Makes new MinImg, allocated or not.
  * @param   p_image       The image.
@@ -311,11 +378,58 @@ MINIMGAPI_API int AllocMinImage(
  * @ingroup MinImgAPI_API
  *
  * The function deallocates the image data and clean @c p_image->pScan0 and
- * @c p_image->stride fields.
+ * @c p_image->stride fields. If the data is shared (see @c RetainMinImage()),
+ * the function releases the reference of @c p_image only, and the data is
+ * deallocated with the last reference.
  */
 MINIMGAPI_API int FreeMinImage(
     MinImg *p_image);
 
+/**
+ * @brief   Makes another reference to the data of an image.
+ * @param   p_dst_image The new reference, must not be allocated.
+ * @param   p_src_image The image allocated with @c AllocMinImage() (not a
+ *                      region of it) or another reference to its data.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function copies the image header and increments the reference count of
+ * the image data instead of copying it. Every reference must be released with
+ * @c FreeMinImage(). The references are read-only: the API functions write to
+ * their destination images without checking whether the data is shared, so a
+ * write through one reference is seen through all the others. Call
+ * @c UnshareMinImage() before modifying the data through any of them. Making,
+ * releasing and unsharing references of the same data is thread-safe.
+ */
+MINIMGAPI_API int RetainMinImage(
+    MinImg       *p_dst_image,
+    const MinImg *p_src_image);
+
+/**
+ * @brief   Gives an image exclusive ownership of its data.
+ * @param   p_image The image allocated with @c AllocMinImage() or a reference
+ *                  made with @c RetainMinImage().
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * If the data of the image is shared with other references, the function
+ * copies it to a new buffer (with a new stride) and releases the old one.
+ * Otherwise the function does nothing, so the last reference never copies.
+ */
+MINIMGAPI_API int UnshareMinImage(
+    MinImg *p_image);
+
+/**
+ * @brief   Returns the number of references to the data of an image.
+ * @param   p_image The image allocated with @c AllocMinImage() or a reference
+ *                  made with @c RetainMinImage().
+ * @returns The number of references (0 for an image without data) on success
+ *          or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ */
+MINIMGAPI_API int GetMinImageReferenceCount(
+    const MinImg *p_image);
+
 /**
  * @brief   Makes a copy of the image header.
  * @param   p_dst_image The destination image.
@@ -1010,6 +1124,27 @@ MINIMGAPI_API int FillMinImage(
     const void   *p_canvas,
     int           value_size IS_BY_DEFAULT(0));
 
+/**
+ * @brief   Fills the pixels of an image selected by a mask with a given value.
+ * @param   p_image      The input image.
+ * @param   p_canvas     The pointer to the fill pixel.
+ * @param   p_mask_image The mask image, or @c NULL to fill all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The input image must be already allocated.
+ * @remarks The mask must have the same size as the image, one channel and
+ *          either @c #TYP_UINT1 or @c #TYP_UINT8 type.
+ * @remarks 1-bit images are not supported yet.
+ * @ingroup MinImgAPI_API
+ *
+ * The function sets the pixels with nonzero mask to the pixel pointed by
+ * @c p_canvas and leaves the others untouched. Runs of unset and set mask
+ * are skipped and filled at once, so sparse masks cost close to nothing.
+*/
+MINIMGAPI_API int FillMinImageMasked(
+    const MinImg *p_image,
+    const void   *p_canvas,
+    const MinImg *p_mask_image);
+
 /**
  * @brief   Copies one image to another.
  * @param   p_dst_image The destination image.
@@ -1027,6 +1162,29 @@ MINIMGAPI_API int CopyMinImage(
     const MinImg *p_dst_image,
     const MinImg *p_src_image);
 
+/**
+ * @brief   Copies the pixels of an image selected by a mask.
+ * @param   p_dst_image  The destination image.
+ * @param   p_src_image  The source image.
+ * @param   p_mask_image The mask image, or @c NULL to copy all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both source and destination images must have the same size, the same
+ *          format, and the same number of channels.
+ * @remarks The mask must have the same size as the images, one channel and
+ *          either @c #TYP_UINT1 or @c #TYP_UINT8 type.
+ * @remarks 1-bit images are not supported yet.
+ * @ingroup MinImgAPI_API
+ *
+ * The function copies the pixels with nonzero mask from the source image to
+ * the destination one and leaves the others untouched. Runs of unset and set
+ * mask are skipped and copied at once, so sparse masks cost close to nothing.
+*/
+MINIMGAPI_API int CopyMinImageMasked(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image);
+
 /**
  * @brief   Copies fragment of one image to fragment of another.
  * @param   p_dst_image The destination image.
@@ -1060,6 +1218,75 @@ MINIMGAPI_API int CopyMinImageFragment(
     int           width,
     int           height);
 
+/**
+ * @brief   Copies an image surrounded by a reconstructed border.
+ * @param   p_dst_image The destination (padded) image.
+ * @param   p_src_image The source image.
+ * @param   left        The width of the left margin.
+ * @param   top         The height of the top margin.
+ * @param   right       The width of the right margin.
+ * @param   bottom      The height of the bottom margin.
+ * @param   border      The border condition (see @c #BorderOption).
+ * @param   p_canvas    The pixel of the border in case of @c BO_CONSTANT.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated and be larger than
+ *          the source one by the margins in each dimension.
+ * @remarks Both source and destination images must have the same format
+ *          and the same number of channels.
+ * @remarks 1-bit images are not supported yet.
+ * @ingroup MinImgAPI_API
+ *
+ * The function copies the source image to the destination one at
+ * (@p left, @p top) and fills the margins around it with pixels reconstructed
+ * in accordance with the border condition, so that the following filters can
+ * read neighbourhoods without checking coordinates. If the source image is
+ * exactly the interior region of the destination one (see
+ * @c ClonePaddedMinImage()), only the margins are refreshed.
+*/
+MINIMGAPI_API int CopyMinImageWithBorder(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           left,
+    int           top,
+    int           right,
+    int           bottom,
+    BorderOption  border IS_BY_DEFAULT(BO_REPEAT),
+    const void   *p_canvas IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Allocates a padded copy of an image.
+ * @param   p_padded_image   The padded image to allocate.
+ * @param   p_interior_image The region of the padded image taken by the
+ *                           source image.
+ * @param   p_src_image      The source image.
+ * @param   left             The width of the left margin.
+ * @param   top              The height of the top margin.
+ * @param   right            The width of the right margin.
+ * @param   bottom           The height of the bottom margin.
+ * @param   border           The border condition (see @c #BorderOption).
+ * @param   p_canvas         The pixel of the border in case of
+ *                           @c BO_CONSTANT.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function allocates @p p_padded_image, fills it by
+ * @c CopyMinImageWithBorder() and sets @p p_interior_image to the region view
+ * of the source pixels. The buffer can be reused for the next images of the
+ * same size by writing them to the interior and calling
+ * @c CopyMinImageWithBorder() with the interior as the source. Use
+ * @c FreeMinImage() for @p p_padded_image only.
+*/
+MINIMGAPI_API int ClonePaddedMinImage(
+    MinImg       *p_padded_image,
+    MinImg       *p_interior_image,
+    const MinImg *p_src_image,
+    int           left,
+    int           top,
+    int           right,
+    int           bottom,
+    BorderOption  border IS_BY_DEFAULT(BO_REPEAT),
+    const void   *p_canvas IS_BY_DEFAULT(NULL));
+
 /**
  * @brief   Flips an image around vertical or horizontal axis.
  * @param   p_dst_image The destination image.
@@ -1197,6 +1424,627 @@ MINIMGAPI_API int ResampleMinImage(
     double        x_phase IS_BY_DEFAULT(0.5),
     double        y_phase IS_BY_DEFAULT(0.5));
 
+/**
+ * @brief   Applies an element-wise binary operation to two images.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image_a The first operand image.
+ * @param   p_src_image_b The second operand image.
+ * @param   op            The binary operation (see @c #BiOp).
+ * @param   p_mask_image  The mask image, or @c NULL to process all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks All images must have the same type. Each operand must either have
+ *          the same size and number of channels as the destination image,
+ *          or be a single pixel (see @c #WrapPixelWithMinImage) with either
+ *          the same number of channels or one channel.
+ * @remarks Operands may coincide with the destination image.
+ * @remarks The mask must have the same size as the destination image, one
+ *          channel and either @c #TYP_UINT1 or @c #TYP_UINT8 type. Masks are
+ *          not supported for 1-bit images yet.
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes @f[ p_dst_image(i, j) = op(p_src_image_a(i, j),
+ * p_src_image_b(i, j)) @f] for each element of the destination image. A
+ * single-pixel operand is broadcasted over the whole image, a single-channel
+ * one is also broadcasted over all channels. Integer results are saturated
+ * to the range of the image type, average and Euclidean norm are rounded to
+ * the nearest integer, integer division truncates toward zero and gives zero
+ * for the zero divisor. For bit images the operations degenerate into logical
+ * ones (for instance, @c #BIOP_ADD is @c OR and @c #BIOP_MUL is @c AND). With
+ * a mask only the pixels with nonzero mask are written, and rows without such
+ * pixels are not computed at all.
+ */
+MINIMGAPI_API int BinaryOperationMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image_a,
+    const MinImg *p_src_image_b,
+    BiOp          op,
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Applies an element-wise binary operation to an image and a scalar.
+ * @param   p_dst_image The destination image.
+ * @param   p_src_image The source image.
+ * @param   value       The second operand of the operation.
+ * @param   op          The binary operation (see @c #BiOp).
+ * @param   p_mask_image The mask image, or @c NULL to process all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both source and destination images must have the same size, the same
+ *          format, and the same number of channels.
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes @f[ p_dst_image(i, j) = op(p_src_image(i, j), value)
+ * @f] The value is rounded and saturated to the image type first, and then
+ * the function acts as @c #BinaryOperationMinImage with a broadcasted scalar.
+ */
+MINIMGAPI_API int BinaryOperationMinImageWithScalar(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    double        value,
+    BiOp          op,
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Computes a weighted sum of two images.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image_a The first source image.
+ * @param   p_src_image_b The second source image.
+ * @param   alpha         The weight of the second image, in [0, 1].
+ * @param   p_mask_image  The mask image, or @c NULL to process all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks All images must have the same size, the same format, and the same
+ *          number of channels. @c TYP_UINT8, @c TYP_UINT16, @c TYP_REAL32 and
+ *          @c TYP_REAL64 images are supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes @f[ p_dst_image(i, j) = (1 - alpha) p_src_image_a(i, j)
+ * + alpha p_src_image_b(i, j) @f] For integer images alpha is rounded to
+ * a multiple of 1/255 (1/65535 for 16-bit ones) and the result is rounded to
+ * the nearest integer exactly. The destination may coincide with any source;
+ * sources tangled with the destination in other ways (see
+ * @c CheckMinImagesTangle()) are copied first. With a mask only the pixels
+ * with nonzero mask are written (see @c CopyMinImageMasked()).
+ */
+MINIMGAPI_API int BlendMinImages(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image_a,
+    const MinImg *p_src_image_b,
+    double        alpha,
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Composites an image with alpha channel over another image.
+ * @param   p_dst_image The destination image.
+ * @param   p_fg_image  The foreground 4-channel image with straight (not
+ *                      premultiplied) alpha in the last channel.
+ * @param   p_bg_image  The background 3-channel or 4-channel image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated and have the same
+ *          size, format, and number of channels as the background one.
+ * @remarks Only @c TYP_UINT8 and @c TYP_UINT16 images are supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function mixes each colour channel of the foreground and the
+ * background by the foreground alpha @f$ a @f$: @f[ dst = (fg a + bg (M - a))
+ * / M @f] where @f$ M @f$ is the maximal value of the type, with exact
+ * rounding. The alpha of a 4-channel background becomes @f$ a + bg_a (M - a)
+ * / M @f$. Compositing in place, that is with the background as the
+ * destination, is the intended usage.
+ */
+MINIMGAPI_API int AlphaCompositeMinImages(
+    const MinImg *p_dst_image,
+    const MinImg *p_fg_image,
+    const MinImg *p_bg_image);
+
+/**
+ * @brief   Reduces an image by an associative-commutative operation.
+ * @param   p_dst_image The destination image.
+ * @param   p_src_image The source image.
+ * @param   direction   The direction of the reduction (see @c #DirectionOption).
+ * @param   op          The reduction operation (see @c #AsCoOp).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks The destination image must have the number of channels either equal
+ *          to the one of the source image or equal to 1. Its size must be
+ *          1 x @c height for @c #DO_HORIZONTAL, @c width x 1 for
+ *          @c #DO_VERTICAL, and 1 x 1 for @c #DO_BOTH.
+ * @ingroup MinImgAPI_API
+ *
+ * The function folds the elements of the source image with the operation:
+ * along the lines for @c #DO_HORIZONTAL (a row projection profile), along
+ * the columns for @c #DO_VERTICAL (a column projection profile), or over the
+ * whole image for @c #DO_BOTH. Channels are reduced separately unless the
+ * destination image has the only channel, in which case all the channels are
+ * folded together.
+ *
+ * The types of the source and the destination images may differ. Sums are
+ * accumulated in 64-bit integers for integer images (sums of 64-bit integers
+ * saturate) and in doubles for real ones; products and Euclidean norms are
+ * accumulated in doubles. The results are rounded and saturated to the
+ * destination type. Bit images are reduced as images of zeros and ones, so
+ * that @c #ASCOOP_ADD counts set pixels.
+ */
+MINIMGAPI_API int ReduceMinImage(
+    const MinImg    *p_dst_image,
+    const MinImg    *p_src_image,
+    DirectionOption  direction,
+    AsCoOp           op);
+
+/**
+ * @brief   Applies a rectangular minimum or maximum filter to an image.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image   The source image.
+ * @param   filter_width  The width of the filter window.
+ * @param   filter_height The height of the filter window.
+ * @param   op            The filter operation (see @c #IdOp).
+ * @param   border        The border condition (see @c #BorderOption).
+ * @param   p_canvas      The pointer to the pixel value to be used if the
+ *                        @c border is @c #BO_CONSTANT.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The destination image must be already allocated.
+ * @remarks Both source and destination images must have the same size, the same
+ *          format, and the same number of channels.
+ * @remarks @c #BO_IGNORE border condition is not supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes the minimum (grayscale erosion) or the maximum
+ * (grayscale dilation) of each channel over the window of the given size
+ * centered at each pixel; for even sizes the window extends further to the
+ * right and to the bottom. Pixels out of the image are reconstructed in
+ * accordance with the border condition, @c #BO_VOID and @c #BO_REPEAT give the
+ * same result for these operations.
+ *
+ * The filter is separable and uses the van Herk/Gil-Werman algorithm, so it
+ * takes three comparisons per pixel and direction regardless of the window
+ * size.
+ */
+MINIMGAPI_API int MinMaxFilterMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           filter_width,
+    int           filter_height,
+    IdOp          op,
+    BorderOption  border IS_BY_DEFAULT(BO_REPEAT),
+    const void   *p_canvas IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Applies the median filter to an image.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image   The source image.
+ * @param   radius        The radius of the square window, which is
+ *                        <tt>2 * radius + 1</tt> pixels wide.
+ * @param   border        The border condition (see @c #BorderOption).
+ * @param   p_canvas      The pointer to the pixel value to be used if the
+ *                        @c border is @c #BO_CONSTANT.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Only @c #TYP_UINT8 images are supported.
+ * @remarks Both source and destination images must have the same size, the same
+ *          format, and the same number of channels.
+ * @remarks @c #BO_IGNORE and @c #BO_VOID border conditions and radii over 127
+ *          are not supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function replaces each channel of each pixel with the median of the
+ * channel over the window centered at the pixel. Pixels out of the image are
+ * reconstructed in accordance with the border condition. The images may be
+ * the same.
+ *
+ * Windows of 3x3 and 5x5 pixels are handled by selection networks of packed
+ * minimums and maximums. Larger ones use the Perreault-Hebert algorithm with
+ * coarse and fine column histograms, so the cost per pixel does not depend on
+ * the radius.
+ */
+MINIMGAPI_API int MedianFilterMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           radius,
+    BorderOption  border IS_BY_DEFAULT(BO_REPEAT),
+    const void   *p_canvas IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Computes per-channel histograms of an image.
+ * @param   p_histogram   The pointer to the output histograms.
+ * @param   p_src_image   The source image.
+ * @param   p_mask_image  The mask image, or @c NULL to count all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Only @c #TYP_UINT8 and @c #TYP_UINT16 source images are supported.
+ * @remarks The mask must have the same size as the source image, one channel
+ *          and either @c #TYP_UINT1 or @c #TYP_UINT8 type.
+ * @ingroup MinImgAPI_API
+ *
+ * The function writes @c channels consecutive histograms of 256 (for 8-bit
+ * images) or 65536 (for 16-bit images) bins each to @c p_histogram, so the
+ * count of value @c v in channel @c c is @c p_histogram[c * bins + v]. Only
+ * pixels with nonzero mask are counted. To process a region of interest, pass
+ * region views (see @c GetMinImageRegion()) of both the source and the mask.
+ *
+ * Each thread counts into several interleaved sub-histograms, so that runs of
+ * equal values do not serialize on the same counter; the sub-histograms are
+ * then summed in parallel.
+ */
+MINIMGAPI_API int ComputeMinImageHistogram(
+    uint32_t     *p_histogram,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Computes per-channel statistics of an image.
+ * @param   p_min         The pointer to the output minimums, or @c NULL.
+ * @param   p_max         The pointer to the output maximums, or @c NULL.
+ * @param   p_mean        The pointer to the output means, or @c NULL.
+ * @param   p_stddev      The pointer to the output standard deviations, or
+ *                        @c NULL.
+ * @param   p_src_image   The source image.
+ * @param   p_mask_image  The mask image, or @c NULL to take all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Each non-null output array must hold @c channels values.
+ * @remarks The mask must have the same size as the source image, one channel
+ *          and either @c #TYP_UINT1 or @c #TYP_UINT8 type.
+ * @remarks The function returns @c NO_SENSE if no pixel is taken.
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes the minimum, the maximum, the mean and the population
+ * standard deviation of each channel over pixels with nonzero mask. For 8-bit
+ * and 16-bit unsigned images the statistics are exactly derived from the
+ * histogram (see @c ComputeMinImageHistogram()).
+ */
+MINIMGAPI_API int ComputeMinImageStats(
+    double       *p_min,
+    double       *p_max,
+    double       *p_mean,
+    double       *p_stddev,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Maps image elements through lookup tables.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image   The source image.
+ * @param   p_lut         The pointer to the lookup tables.
+ * @param   lut_channels  The number of tables: either 1 to map all channels
+ *                        with the same table or the number of channels.
+ * @param   p_mask_image  The mask image, or @c NULL to map all pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Only @c #TYP_UINT8 and @c #TYP_UINT16 source images are supported.
+ * @remarks The destination image must have the same size and number of
+ *          channels as the source one and may have any type but
+ *          @c #TYP_UINT1.
+ * @ingroup MinImgAPI_API
+ *
+ * Each table holds 256 (for 8-bit sources) or 65536 (for 16-bit sources)
+ * elements of the destination type, and the tables of several channels follow
+ * each other, so channel @c c of a pixel with value @c v becomes
+ * <tt>p_lut[c * bins + v]</tt>. This covers gamma correction, contrast
+ * stretching and thresholding. For palette expansion, replicate the indices
+ * into as many channels as the palette has (see @c InterleaveMinImages()) and
+ * pass one table per palette channel. The images may be the same if their
+ * types have equal depth. Large images are split between threads by rows.
+ * With a mask (of the same size, one channel and either @c #TYP_UINT1 or
+ * @c #TYP_UINT8 type) only the pixels with nonzero mask are written.
+ */
+MINIMGAPI_API int ApplyLutMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const void   *p_lut,
+    int           lut_channels IS_BY_DEFAULT(1),
+    const MinImg *p_mask_image IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Labels connected components of a bit image.
+ * @param   p_label_image    The output label image, or @c NULL.
+ * @param   p_components     The output component table, or @c NULL.
+ * @param   max_components   The capacity of @c p_components.
+ * @param   p_num_components The pointer to the number of components found.
+ * @param   p_src_image      The source image.
+ * @param   connectivity     The pixel connectivity (see
+ *                           @c #ConnectivityOption).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have @c #TYP_UINT1 type and one channel.
+ * @remarks The label image must have the same size as the source image, one
+ *          channel and @c #TYP_INT32 type.
+ * @ingroup MinImgAPI_API
+ *
+ * The function finds the connected components of set pixels and numbers them
+ * from 1 in the raster order of their first pixels. The label image receives
+ * the number of the component of each set pixel and 0 for the others. The
+ * component with number @c n is described by <tt>p_components[n - 1]</tt>;
+ * if there are more than @c max_components components, the rest are not
+ * described, but @c p_num_components still receives their total number.
+ *
+ * Lines are scanned 64 pixels at a time into runs of set pixels with
+ * count-leading-zeros, and overlapping runs of adjacent lines are merged by
+ * union-find with path compression. Large images are split into bands of
+ * lines which are labelled in parallel and then merged along their
+ * boundaries.
+ */
+MINIMGAPI_API int LabelMinImageComponents(
+    const MinImg       *p_label_image,
+    MinImgComponent    *p_components,
+    int                 max_components,
+    int                *p_num_components,
+    const MinImg       *p_src_image,
+    ConnectivityOption  connectivity IS_BY_DEFAULT(CN_8));
+
+/**
+ * @brief   Computes the Euclidean distance transform of an image.
+ * @param   p_dst_image   The destination image.
+ * @param   p_src_image   The source image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have one channel and @c #TYP_UINT1 or
+ *          @c #TYP_UINT8 type.
+ * @remarks The destination image must have the same size as the source image,
+ *          one channel and @c #TYP_REAL32 or @c #TYP_UINT16 type.
+ * @ingroup MinImgAPI_API
+ *
+ * The function replaces each pixel by the exact Euclidean distance to the
+ * nearest zero pixel of the source image, so zero pixels get 0. Integer
+ * distances are rounded and saturated. If the source image has no zero
+ * pixels, the distances are infinite for @c #TYP_REAL32 and 65535 for
+ * @c #TYP_UINT16.
+ *
+ * The transform is separable and takes linear time (Felzenszwalb and
+ * Huttenlocher). Distances along columns are found by two sweeps over lines,
+ * which are split between threads by columns. Each line is then reduced with
+ * the lower envelope of parabolas, and lines are split between threads.
+ */
+MINIMGAPI_API int DistanceTransformMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image);
+
+/**
+ * @brief   Computes the derivatives of an image.
+ * @param   p_dx_image    The horizontal derivative image, or @c NULL.
+ * @param   p_dy_image    The vertical derivative image, or @c NULL.
+ * @param   p_src_image   The source image.
+ * @param   kernel        The gradient operator (see @c #GradientOption).
+ * @param   border        The border condition (see @c #BorderOption).
+ * @param   p_canvas      The pointer to the pixel value to be used if the
+ *                        @c border is @c #BO_CONSTANT.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have one channel and @c #TYP_UINT8 type.
+ * @remarks The derivative images must have the same size as the source image,
+ *          one channel and @c #TYP_INT16 type. At least one of them must be
+ *          given.
+ * @remarks @c #BO_IGNORE and @c #BO_VOID border conditions are not supported.
+ * @ingroup MinImgAPI_API
+ *
+ * The function applies the unnormalised 3x3 operator, so the derivatives of
+ * a unit step are 4 for @c #GO_SOBEL and 16 for @c #GO_SCHARR. The vertical
+ * derivative is positive when the brightness grows downwards. The operator is
+ * separable and computed with the vector unit; lines are split between
+ * threads.
+ */
+MINIMGAPI_API int GradientMinImage(
+    const MinImg   *p_dx_image,
+    const MinImg   *p_dy_image,
+    const MinImg   *p_src_image,
+    GradientOption  kernel IS_BY_DEFAULT(GO_SOBEL),
+    BorderOption    border IS_BY_DEFAULT(BO_REPEAT),
+    const void     *p_canvas IS_BY_DEFAULT(NULL));
+
+/**
+ * @brief   Computes the gradient magnitude and direction.
+ * @param   p_magnitude_image The magnitude image, or @c NULL.
+ * @param   p_direction_image The direction image, or @c NULL.
+ * @param   p_dx_image        The horizontal derivative image.
+ * @param   p_dy_image        The vertical derivative image.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The derivative images must have one channel and @c #TYP_INT16 type
+ *          (see @c GradientMinImage()).
+ * @remarks The magnitude image must have @c #TYP_REAL32 or @c #TYP_UINT16 type,
+ *          and the direction image must have @c #TYP_REAL32 type. Both must
+ *          have the same size as the derivative images and one channel.
+ * @ingroup MinImgAPI_API
+ *
+ * The magnitude is the Euclidean norm of the derivatives, rounded for
+ * integer images. The direction is the angle in radians from -pi to pi
+ * measured from the x axis towards the y axis.
+ */
+MINIMGAPI_API int GradientMagnitudeMinImage(
+    const MinImg *p_magnitude_image,
+    const MinImg *p_direction_image,
+    const MinImg *p_dx_image,
+    const MinImg *p_dy_image);
+
+/**
+ * @brief   Detects edges by the Canny method.
+ * @param   p_dst_image     The edge map.
+ * @param   p_src_image     The source image.
+ * @param   low_threshold   The magnitude required to extend an edge.
+ * @param   high_threshold  The magnitude required to start an edge.
+ * @param   kernel          The gradient operator (see @c #GradientOption).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have one channel and @c #TYP_UINT8 type.
+ * @remarks The edge map must have the same size as the source image, one
+ *          channel and @c #TYP_UINT1 or @c #TYP_UINT8 type.
+ * @ingroup MinImgAPI_API
+ *
+ * The thresholds apply to the gradient magnitude as computed by
+ * @c GradientMagnitudeMinImage(). Edge pixels are set to 1 in bit maps and to
+ * 255 in byte maps, and the other pixels are cleared. The images may be the
+ * same.
+ *
+ * Each line is differentiated once, and the magnitudes of three lines are kept
+ * to suppress non-maxima in the same pass; bands of lines are processed in
+ * parallel. Pixels above the high threshold are pushed onto a stack, and
+ * hysteresis pops them and marks the connected candidates.
+ */
+MINIMGAPI_API int CannyMinImage(
+    const MinImg   *p_dst_image,
+    const MinImg   *p_src_image,
+    double          low_threshold,
+    double          high_threshold,
+    GradientOption  kernel IS_BY_DEFAULT(GO_SOBEL));
+
+/**
+ * @brief   Finds straight lines by the standard Hough transform.
+ * @param   p_lines       The output lines, or @c NULL.
+ * @param   max_lines     The capacity of @c p_lines.
+ * @param   p_num_lines   The pointer to the number of lines found.
+ * @param   p_src_image   The source image.
+ * @param   rho_step      The distance resolution in pixels.
+ * @param   theta_step    The angle resolution in radians.
+ * @param   threshold     The minimal number of votes of a line.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have one channel and @c #TYP_UINT1 or
+ *          @c #TYP_UINT8 type, such as an edge map of @c CannyMinImage().
+ * @ingroup MinImgAPI_API
+ *
+ * Each nonzero pixel votes for the lines <tt>x cos(theta) + y sin(theta) =
+ * rho</tt> through it, with theta sampled from 0 to pi. Lines are the local
+ * maxima of the accumulator with at least @c threshold votes, ordered by the
+ * number of votes. A line is returned as a band whose ends are the
+ * intersections with the image bounds and whose width is @c rho_step rounded
+ * up. If there are more than @c max_lines lines, the weaker ones are not
+ * returned, but @c p_num_lines still receives their total number.
+ *
+ * Accumulator indices of each point are computed for several angles at once
+ * by the vector unit from precomputed sine and cosine tables. Bands of lines
+ * vote into separate accumulators in parallel, which are summed at the end.
+ */
+MINIMGAPI_API int HoughLinesMinImage(
+    MinBand      *p_lines,
+    int           max_lines,
+    int          *p_num_lines,
+    const MinImg *p_src_image,
+    double        rho_step,
+    double        theta_step,
+    int           threshold);
+
+/**
+ * @brief   Finds line segments by the progressive probabilistic Hough
+ *          transform.
+ * @param   p_segments     The output segments.
+ * @param   max_segments   The capacity of @c p_segments.
+ * @param   p_num_segments The pointer to the number of segments found.
+ * @param   p_src_image    The source image.
+ * @param   rho_step       The distance resolution in pixels.
+ * @param   theta_step     The angle resolution in radians.
+ * @param   threshold      The number of votes to look for a segment.
+ * @param   min_length     The minimal projection of a segment on an axis.
+ * @param   max_gap        The longest gap within a segment in pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image must have one channel and @c #TYP_UINT1 or
+ *          @c #TYP_UINT8 type.
+ * @ingroup MinImgAPI_API
+ *
+ * The function implements the method of Matas, Galambos and Kittler. Nonzero
+ * pixels vote in random order. Once the line of a pixel gets @c threshold
+ * votes, the line is walked from the pixel in both directions until a gap
+ * longer than @c max_gap. The pixels walked are removed; if the segment is
+ * long enough, it is returned and their votes are withdrawn. The search
+ * stops after @c max_segments segments. The random order is seeded
+ * identically on each call, so the result is reproducible.
+ */
+MINIMGAPI_API int HoughSegmentsMinImage(
+    MinLineSegment *p_segments,
+    int             max_segments,
+    int            *p_num_segments,
+    const MinImg   *p_src_image,
+    double          rho_step,
+    double          theta_step,
+    int             threshold,
+    int             min_length,
+    int             max_gap);
+
+/**
+ * @brief   Matches a template by normalized cross-correlation.
+ * @param   p_dst_image    The response map.
+ * @param   p_src_image    The source image.
+ * @param   p_templ_image  The template.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks The source image and the template must have one channel and
+ *          @c #TYP_UINT8 type, and the template must fit in the image.
+ * @remarks The response map must have one channel, @c #TYP_REAL32 type and
+ *          the size of the image minus the size of the template plus one.
+ * @ingroup MinImgAPI_API
+ *
+ * Each element of the response map receives the correlation coefficient of
+ * the template and the image window with the same top left corner, from -1
+ * to 1. Windows or templates of constant brightness get 0.
+ *
+ * The window sums and sums of squares needed for normalization come from
+ * integral images. The sums of products are computed either directly, several
+ * windows at a time by the vector unit, or through 2D real-to-complex Fourier
+ * transforms of power-of-two sizes, whichever is estimated to be cheaper. The
+ * transform tables are cached for each size.
+ */
+MINIMGAPI_API int MatchTemplateMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const MinImg *p_templ_image);
+
+/**
+ * @brief   Compares contents of two images.
+ * @param   p_result      The comparison results.
+ * @param   p_image_a     The first image.
+ * @param   p_image_b     The second image.
+ * @param   option        The depth of comparison (see @c #ComparisonOption).
+ * @param   ssim_window   The side of the square SSIM window in pixels.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Both images must have the same size, the same format, and the same
+ *          number of channels.
+ * @ingroup MinImgAPI_API
+ *
+ * The function compares the meaningful payload of image lines only, so the
+ * padding between lines and unused tail bits of bit images are ignored. With
+ * @c #CO_EXACT the lines are compared by @c memcmp until the first
+ * difference. PSNR is computed against the dynamic range of the type (one for
+ * real and bit images) and is infinite for equal images. SSIM is averaged
+ * over all positions of a sliding uniform window (clamped to the image size)
+ * in all channels.
+ */
+MINIMGAPI_API int CompareMinImageContents(
+    MinImgComparison *p_result,
+    const MinImg     *p_image_a,
+    const MinImg     *p_image_b,
+    ComparisonOption  option IS_BY_DEFAULT(CO_DIFFERENCE),
+    int               ssim_window IS_BY_DEFAULT(8));
+
+/**
+ * @brief   Computes a hash of image contents.
+ * @param   p_hash   The pointer to the output hash.
+ * @param   p_image  The image.
+ * @param   seed     The seed of the hash.
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @ingroup MinImgAPI_API
+ *
+ * The function computes the XXH64 hash of the image size, number of channels
+ * and type (as four little-endian 32-bit integers) followed by the meaningful
+ * payload of image lines. The padding between lines and unused tail bits of
+ * bit images are ignored, so equal images give equal hashes whatever their
+ * strides are. The hash is meant for cache keys and exact deduplication; use
+ * @c PerceptualHashMinImage() to find near duplicates.
+ */
+MINIMGAPI_API int HashMinImage(
+    uint64_t     *p_hash,
+    const MinImg *p_image,
+    uint64_t      seed IS_BY_DEFAULT(0));
+
+/**
+ * @brief   Computes a perceptual hash of an image.
+ * @param   p_hash   The pointer to the output hash.
+ * @param   p_image  The image.
+ * @param   method   The hash algorithm (see @c #PerceptualHashOption).
+ * @returns @c NO_ERRORS on success or an error code otherwise (see @c #MinErr).
+ * @remarks Only @c #TYP_UINT8, @c #TYP_UINT16 and @c #TYP_REAL32 images are
+ *          supported.
+ * @remarks The function returns @c NO_SENSE for empty images.
+ * @ingroup MinImgAPI_API
+ *
+ * The function averages the channels of the image over the cells of a small
+ * grid and derives 64 bits from the thumbnail, the first bit being the most
+ * significant one. Similar images give hashes at a small Hamming distance,
+ * which survives rescaling, recompression and mild brightness changes.
+ * @c #PH_DCT is more robust, @c #PH_DIFFERENCE is cheaper.
+ */
+MINIMGAPI_API int PerceptualHashMinImage(
+    uint64_t             *p_hash,
+    const MinImg         *p_image,
+    PerceptualHashOption  method IS_BY_DEFAULT(PH_DCT));
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
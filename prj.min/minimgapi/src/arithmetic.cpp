@@ -0,0 +1,352 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minutils/mathoper.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "mask.h"
+#include "vector/arithmetic-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_BinaryOperationMinImage, "BinaryOperationMinImage");
+DECLARE_MINSTOPWATCH(gsw_BinaryOperationMinImageWithScalar,
+                     "BinaryOperationMinImageWithScalar");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// An operand as it is seen by the line kernels. Broadcasted operands have
+// zero stride, so that the same line is fed to the kernel for each row.
+struct BiOpOperand {
+  const uint8_t *p_line;
+  int            stride;
+};
+
+template<typename T, int op>
+static int BinaryOperationLines(
+    const MinImg      *p_dst_image,
+    const BiOpOperand &a,
+    const BiOpOperand &b,
+    int                len,
+    int                height) {
+  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, 0);
+  const uint8_t *p_a_line = a.p_line;
+  const uint8_t *p_b_line = b.p_line;
+  if (!p_dst_line || !p_a_line || !p_b_line)
+    return INTERNAL_ERROR;
+  for (int y = 0; y < height; ++y) {
+    vector_biop<T, op>(reinterpret_cast<T *>(p_dst_line),
+                       reinterpret_cast<const T *>(p_a_line),
+                       reinterpret_cast<const T *>(p_b_line), len);
+    p_dst_line += p_dst_image->stride;
+    p_a_line += a.stride;
+    p_b_line += b.stride;
+  }
+  return NO_ERRORS;
+}
+
+template<int op>
+static int BinaryOperationBitLines(
+    const MinImg      *p_dst_image,
+    const BiOpOperand &a,
+    const BiOpOperand &b,
+    int                len,
+    int                height) {
+  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, 0);
+  const uint8_t *p_a_line = a.p_line;
+  const uint8_t *p_b_line = b.p_line;
+  if (!p_dst_line || !p_a_line || !p_b_line)
+    return INTERNAL_ERROR;
+  for (int y = 0; y < height; ++y) {
+    vector_bit_biop<op>(p_dst_line, p_a_line, p_b_line, len);
+    p_dst_line += p_dst_image->stride;
+    p_a_line += a.stride;
+    p_b_line += b.stride;
+  }
+  return NO_ERRORS;
+}
+
+template<int op>
+static int BinaryOperationByType(
+    const MinImg      *p_dst_image,
+    const BiOpOperand &a,
+    const BiOpOperand &b,
+    int                len,
+    int                height) {
+  switch (_GetMinImageType(p_dst_image)) {
+  case TYP_UINT1:
+    return BinaryOperationBitLines<op>(p_dst_image, a, b, len, height);
+  case TYP_UINT8:
+    return BinaryOperationLines<uint8_t, op>(p_dst_image, a, b, len, height);
+  case TYP_INT8:
+    return BinaryOperationLines<int8_t, op>(p_dst_image, a, b, len, height);
+  case TYP_UINT16:
+    return BinaryOperationLines<uint16_t, op>(p_dst_image, a, b, len, height);
+  case TYP_INT16:
+    return BinaryOperationLines<int16_t, op>(p_dst_image, a, b, len, height);
+  case TYP_UINT32:
+    return BinaryOperationLines<uint32_t, op>(p_dst_image, a, b, len, height);
+  case TYP_INT32:
+    return BinaryOperationLines<int32_t, op>(p_dst_image, a, b, len, height);
+  case TYP_UINT64:
+    return BinaryOperationLines<uint64_t, op>(p_dst_image, a, b, len, height);
+  case TYP_INT64:
+    return BinaryOperationLines<int64_t, op>(p_dst_image, a, b, len, height);
+  case TYP_REAL32:
+    return BinaryOperationLines<real32_t, op>(p_dst_image, a, b, len, height);
+  case TYP_REAL64:
+    return BinaryOperationLines<real64_t, op>(p_dst_image, a, b, len, height);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+// Makes the operand usable by the line kernels. An operand of the same
+// prototype as the destination image is used as is (or via a temporary copy
+// if it is tangled with the destination), a pixel or a scalar operand is
+// replicated to a line buffer.
+static int PrepareBiOpOperand(
+    BiOpOperand  *p_operand,
+    MinImg       *p_buffer_image,
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image) {
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  if (!_CompareMinImagePrototypes(p_dst_image, p_src_image)) {
+    uint32_t tangling = 0;
+    PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+    p_operand->p_line = _GetMinImageLine(p_src_image, 0);
+    p_operand->stride = p_src_image->stride;
+    if (tangling != TCR_SAME_IMAGE && (~tangling & TCR_FORWARD_PASS_POSSIBLE)) {
+      PROPAGATE_ERROR(_CloneMinImagePrototype(p_buffer_image, p_src_image));
+      PROPAGATE_ERROR(CopyMinImage(p_buffer_image, p_src_image));
+      p_operand->p_line = _GetMinImageLine(p_buffer_image, 0);
+      p_operand->stride = p_buffer_image->stride;
+    }
+    return p_operand->p_line ? NO_ERRORS : INTERNAL_ERROR;
+  }
+
+  if (_CompareMinImageTypes(p_dst_image, p_src_image) ||
+      _AssureMinImageIsPixel(p_src_image) != NO_ERRORS)
+    return BAD_ARGS;
+  if (p_src_image->channels != p_dst_image->channels &&
+      p_src_image->channels != 1)
+    return BAD_ARGS;
+
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(p_buffer_image, p_dst_image,
+                                                 p_dst_image->width, 1));
+  if (p_src_image->channels == p_dst_image->channels) {
+    PROPAGATE_ERROR(FillMinImage(p_buffer_image, p_src_image->pScan0));
+  } else {
+    MinImg unfolded_image = {0};
+    PROPAGATE_ERROR(_UnfoldMinImageChannels(&unfolded_image, p_buffer_image));
+    PROPAGATE_ERROR(FillMinImage(&unfolded_image, p_src_image->pScan0));
+  }
+  p_operand->p_line = p_buffer_image->pScan0;
+  p_operand->stride = 0;
+
+  return NO_ERRORS;
+}
+
+static int ApplyBinaryOperation(
+    BiOp               op,
+    const MinImg      *p_dst_image,
+    const BiOpOperand &a,
+    const BiOpOperand &b,
+    int                len,
+    int                height) {
+  switch (op) {
+  case BIOP_MIN:
+    return BinaryOperationByType<OP_MIN>(p_dst_image, a, b, len, height);
+  case BIOP_MAX:
+    return BinaryOperationByType<OP_MAX>(p_dst_image, a, b, len, height);
+  case BIOP_ADD:
+    return BinaryOperationByType<OP_ADD>(p_dst_image, a, b, len, height);
+  case BIOP_DIF:
+    return BinaryOperationByType<OP_DIF>(p_dst_image, a, b, len, height);
+  case BIOP_ADF:
+    return BinaryOperationByType<OP_ADF>(p_dst_image, a, b, len, height);
+  case BIOP_MUL:
+    return BinaryOperationByType<OP_MUL>(p_dst_image, a, b, len, height);
+  case BIOP_AVE:
+    return BinaryOperationByType<OP_AVE>(p_dst_image, a, b, len, height);
+  case BIOP_EUC:
+    return BinaryOperationByType<OP_EUC>(p_dst_image, a, b, len, height);
+  case BIOP_DIV:
+    return BinaryOperationByType<OP_DIV>(p_dst_image, a, b, len, height);
+  case BIOP_SSQ:
+    return BinaryOperationByType<OP_SSQ>(p_dst_image, a, b, len, height);
+  default:
+    return BAD_ARGS;
+  }
+}
+
+// Applies the operation to the rows with any pixel set in the mask through a
+// line buffer and merges the buffer into the destination by the mask.
+static int ApplyBinaryOperationMasked(
+    BiOp               op,
+    const MinImg      *p_dst_image,
+    const BiOpOperand &a,
+    const BiOpOperand &b,
+    const MinImg      *p_mask_image) {
+  const int width = p_dst_image->width;
+  const int pixel_size = p_dst_image->channels * p_dst_image->channelDepth;
+  const bool bit_mask = _GetMinImageType(p_mask_image) == TYP_UINT1;
+  DECLARE_GUARDED_MINIMG(line_image);
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&line_image, p_dst_image,
+                                                 width, 1));
+  for (int y = 0; y < p_dst_image->height; ++y) {
+    const uint8_t *p_mask_line = _GetMinImageLine(p_mask_image, y);
+    if (IsMaskLineEmpty(p_mask_line, bit_mask, width))
+      continue;
+    BiOpOperand a_line = {a.p_line + y * a.stride, 0};
+    BiOpOperand b_line = {b.p_line + y * b.stride, 0};
+    PROPAGATE_ERROR(ApplyBinaryOperation(op, &line_image, a_line, b_line,
+                                         width * p_dst_image->channels, 1));
+    CopyLineMasked(_GetMinImageLine(p_dst_image, y), line_image.pScan0,
+                   p_mask_line, bit_mask, width, pixel_size);
+  }
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int BinaryOperationMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image_a,
+    const MinImg *p_src_image_b,
+    BiOp          op,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_BinaryOperationMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image_a));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image_b));
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_dst_image));
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  if (p_mask_image && p_dst_image->channelDepth == 0)
+    return NOT_IMPLEMENTED;
+
+  BiOpOperand a = {0}, b = {0};
+  DECLARE_GUARDED_MINIMG(buffer_image_a);
+  DECLARE_GUARDED_MINIMG(buffer_image_b);
+  PROPAGATE_ERROR(PrepareBiOpOperand(&a, &buffer_image_a,
+                                     p_dst_image, p_src_image_a));
+  PROPAGATE_ERROR(PrepareBiOpOperand(&b, &buffer_image_b,
+                                     p_dst_image, p_src_image_b));
+  if (p_mask_image)
+    return ApplyBinaryOperationMasked(op, p_dst_image, a, b, p_mask_image);
+
+  int len = p_dst_image->width * p_dst_image->channels;
+  int height = p_dst_image->height;
+  if (_AssureMinImageIsSolid(p_dst_image) == NO_ERRORS &&
+      a.stride == p_dst_image->stride && b.stride == p_dst_image->stride) {
+    len *= height;
+    height = 1;
+  }
+
+  return ApplyBinaryOperation(op, p_dst_image, a, b, len, height);
+}
+
+template<typename T>
+static void StoreScalar(void *p_scalar, double value) {
+  *reinterpret_cast<T *>(p_scalar) = round_cast<T>(value);
+}
+
+MINIMGAPI_API int BinaryOperationMinImageWithScalar(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    double        value,
+    BiOp          op,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_BinaryOperationMinImageWithScalar);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  int type = 0;
+  PROPAGATE_ERROR(type = _GetMinImageType(p_src_image));
+
+  union {
+    uint8_t  bytes[8];
+    uint64_t aligner;
+  } scalar = {{0}};
+  switch (type) {
+  case TYP_UINT1:
+    scalar.bytes[0] = value != 0 ? 0xFF : 0x00;
+    break;
+  case TYP_UINT8:
+    StoreScalar<uint8_t>(scalar.bytes, value);
+    break;
+  case TYP_INT8:
+    StoreScalar<int8_t>(scalar.bytes, value);
+    break;
+  case TYP_UINT16:
+    StoreScalar<uint16_t>(scalar.bytes, value);
+    break;
+  case TYP_INT16:
+    StoreScalar<int16_t>(scalar.bytes, value);
+    break;
+  case TYP_UINT32:
+    StoreScalar<uint32_t>(scalar.bytes, value);
+    break;
+  case TYP_INT32:
+    StoreScalar<int32_t>(scalar.bytes, value);
+    break;
+  case TYP_UINT64:
+    StoreScalar<uint64_t>(scalar.bytes, value);
+    break;
+  case TYP_INT64:
+    StoreScalar<int64_t>(scalar.bytes, value);
+    break;
+  case TYP_REAL32:
+    StoreScalar<real32_t>(scalar.bytes, value);
+    break;
+  case TYP_REAL64:
+    StoreScalar<real64_t>(scalar.bytes, value);
+    break;
+  default:
+    return NOT_IMPLEMENTED;
+  }
+
+  MinImg scalar_image = {0};
+  PROPAGATE_ERROR(_WrapScalarWithMinImage(&scalar_image, scalar.bytes,
+                                          static_cast<MinTyp>(type)));
+  return BinaryOperationMinImage(p_dst_image, p_src_image, &scalar_image, op,
+                                 p_mask_image);
+}
@@ -0,0 +1,371 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/minimgapi-bands.hpp>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "vector/arithmetic-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_PumpMinImageBands, "PumpMinImageBands");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Checks that the band has the width and the pixel format of the prototype.
+static int AssureBandFitsPrototype(
+    const MinImg *p_band,
+    const MinImg *p_prototype) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_band));
+  if (p_band->width != p_prototype->width ||
+      _CompareMinImagePixels(p_band, p_prototype))
+    return BAD_ARGS;
+  if (p_band->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  return NO_ERRORS;
+}
+
+static MUSTINLINE int ClampIndex(int i, int size) {
+  return std::min(std::max(i, 0), size - 1);
+}
+
+ImageBandSource::ImageBandSource(const MinImg &image)
+    : image(image), next_y(0) {
+}
+
+int ImageBandSource::GetPrototype(MinImg *p_prototype) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&image));
+  return _CloneMinImagePrototype(p_prototype, &image, AO_EMPTY);
+}
+
+int ImageBandSource::ReadRows(const MinImg *p_band) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&image));
+  PROPAGATE_ERROR(AssureBandFitsPrototype(p_band, &image));
+  if (next_y + p_band->height > image.height)
+    return BAD_STATE;
+
+  MinImg rows = {0};
+  PROPAGATE_ERROR(_GetMinImageRegion(&rows, &image, 0, next_y, image.width,
+                                     p_band->height));
+  PROPAGATE_ERROR(CopyMinImage(p_band, &rows));
+  next_y += p_band->height;
+  return NO_ERRORS;
+}
+
+ImageBandSink::ImageBandSink(const MinImg &image)
+    : image(image), next_y(0) {
+}
+
+int ImageBandSink::Begin(const MinImg *p_prototype) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&image));
+  if (!p_prototype || _CompareMinImage3DSizes(&image, p_prototype) ||
+      _CompareMinImageTypes(&image, p_prototype))
+    return BAD_ARGS;
+  next_y = 0;
+  return NO_ERRORS;
+}
+
+int ImageBandSink::WriteRows(const MinImg *p_band) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&image));
+  PROPAGATE_ERROR(AssureBandFitsPrototype(p_band, &image));
+  if (next_y + p_band->height > image.height)
+    return BAD_STATE;
+
+  MinImg rows = {0};
+  PROPAGATE_ERROR(_GetMinImageRegion(&rows, &image, 0, next_y, image.width,
+                                     p_band->height));
+  PROPAGATE_ERROR(CopyMinImage(&rows, p_band));
+  next_y += p_band->height;
+  return NO_ERRORS;
+}
+
+int ImageBandSink::End() {
+  return next_y == image.height ? NO_ERRORS : BAD_STATE;
+}
+
+BandResampler::BandResampler(MinImgBandSource *p_source, int width,
+                             int height, double x_phase, double y_phase)
+    : p_source(p_source), width(width), height(height),
+      x_phase(x_phase - std::floor(x_phase)),
+      y_phase(y_phase - std::floor(y_phase)),
+      row_buffer(), src_x(), src_y(-1), next_y(0) {
+  ::memset(&src_row, 0, sizeof(src_row));
+}
+
+int BandResampler::GetPrototype(MinImg *p_prototype) {
+  if (!p_source || !p_prototype || width < 0 || height < 0)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(p_source->GetPrototype(p_prototype));
+  if ((width && !p_prototype->width) || (height && !p_prototype->height))
+    return BAD_ARGS;
+  p_prototype->width = width;
+  p_prototype->height = height;
+  return NO_ERRORS;
+}
+
+int BandResampler::ReadRows(const MinImg *p_band) {
+  MinImg src_prototype = {0}, prototype = {0};
+  PROPAGATE_ERROR(GetPrototype(&prototype));
+  PROPAGATE_ERROR(AssureBandFitsPrototype(p_band, &prototype));
+  if (next_y + p_band->height > height)
+    return BAD_STATE;
+  PROPAGATE_ERROR(p_source->GetPrototype(&src_prototype));
+
+  if (row_buffer.empty()) {
+    row_buffer.resize(std::max(1, _GetMinImageBytesPerLine(&src_prototype)));
+    PROPAGATE_ERROR(_WrapSolidBufferWithMinImage(&src_row, &row_buffer[0],
+        src_prototype.width, 1, src_prototype.channels,
+        static_cast<MinTyp>(_GetMinImageType(&src_prototype))));
+    // The same source pixel selection as in ResampleMinImage().
+    src_x.resize(width);
+    double x_quotient = src_prototype.width / (width + 0.);
+    for (int x = 0; x < width; ++x)
+      src_x[x] = std::min(src_prototype.width - 1,
+                          static_cast<int>((x + x_phase) * x_quotient));
+  }
+
+  const int pixel_bits = _GetMinImageBitsPerPixel(&src_prototype);
+  const double y_quotient = src_prototype.height / (height + 0.);
+  for (int y = 0; y < p_band->height; ++y, ++next_y) {
+    int wanted_y = std::min(src_prototype.height - 1,
+                            static_cast<int>((next_y + y_phase) * y_quotient));
+    for (; src_y < wanted_y; ++src_y)
+      PROPAGATE_ERROR(p_source->ReadRows(&src_row));
+
+    uint8_t *p_dst = _GetMinImageLine(p_band, y);
+    if (pixel_bits & 0x07) {
+      for (int x = 0; x < width; ++x)
+        for (int b = 0; b < pixel_bits; ++b) {
+          if (GET_IMAGE_LINE_BIT(src_row.pScan0, src_x[x] * pixel_bits + b))
+            SET_IMAGE_LINE_BIT(p_dst, x * pixel_bits + b);
+          else
+            CLEAR_IMAGE_LINE_BIT(p_dst, x * pixel_bits + b);
+        }
+    } else {
+      const int pixel_bytes = pixel_bits >> 3;
+      for (int x = 0; x < width; ++x)
+        ::memcpy(p_dst + x * pixel_bytes,
+                 src_row.pScan0 + src_x[x] * pixel_bytes, pixel_bytes);
+    }
+  }
+
+  return NO_ERRORS;
+}
+
+template<typename T>
+static void AddRowToColumnSums(
+    double        *p_sums,
+    const uint8_t *p_row,
+    int            len,
+    double         sign) {
+  const T *p = reinterpret_cast<const T *>(p_row);
+  for (int i = 0; i < len; ++i)
+    p_sums[i] += sign * static_cast<double>(p[i]);
+}
+
+// Writes means of the window sums along a row. The sum is slid along the row
+// by adding the entering column and subtracting the leaving one.
+template<typename T>
+static void WriteMeanRow(
+    uint8_t      *p_dst_row,
+    const double *p_column_sums,
+    int           width,
+    int           channels,
+    int           filter_width,
+    double        area) {
+  T *p_dst = reinterpret_cast<T *>(p_dst_row);
+  const int left = (filter_width - 1) / 2, right = filter_width / 2;
+  for (int c = 0; c < channels; ++c) {
+    double sum = 0;
+    for (int k = -left; k <= right; ++k)
+      sum += p_column_sums[ClampIndex(k, width) * channels + c];
+    for (int x = 0; x < width; ++x) {
+      p_dst[x * channels + c] = round_cast<T>(sum / area);
+      sum += p_column_sums[ClampIndex(x + 1 + right, width) * channels + c] -
+             p_column_sums[ClampIndex(x - left, width) * channels + c];
+    }
+  }
+}
+
+BandBoxFilter::BandBoxFilter(MinImgBandSource *p_source, int filter_width,
+                             int filter_height)
+    : p_source(p_source), filter_width(filter_width),
+      filter_height(filter_height), window_rows(), column_sums(),
+      next_y(0) {
+  ::memset(&prototype, 0, sizeof(prototype));
+}
+
+int BandBoxFilter::GetPrototype(MinImg *p_prototype) {
+  if (!p_source || !p_prototype || filter_width <= 0 || filter_height <= 0)
+    return BAD_ARGS;
+  return p_source->GetPrototype(p_prototype);
+}
+
+int BandBoxFilter::PullRow(int y) {
+  const int row_bytes = _GetMinImageBytesPerLine(&prototype);
+  MinImg row = {0};
+  PROPAGATE_ERROR(_WrapSolidBufferWithMinImage(&row,
+      &window_rows[(y % filter_height) * row_bytes], prototype.width, 1,
+      prototype.channels, static_cast<MinTyp>(_GetMinImageType(&prototype))));
+  PROPAGATE_ERROR(p_source->ReadRows(&row));
+  return NO_ERRORS;
+}
+
+int BandBoxFilter::UpdateColumnSums(int y, double sign) {
+  const int row_bytes = _GetMinImageBytesPerLine(&prototype);
+  const uint8_t *p_row = &window_rows[(y % filter_height) * row_bytes];
+  double *p_sums = &column_sums[0];
+  const int len = prototype.width * prototype.channels;
+  switch (_GetMinImageType(&prototype)) {
+  case TYP_UINT8:  AddRowToColumnSums<uint8_t>(p_sums, p_row, len, sign);  break;
+  case TYP_INT8:   AddRowToColumnSums<int8_t>(p_sums, p_row, len, sign);   break;
+  case TYP_UINT16: AddRowToColumnSums<uint16_t>(p_sums, p_row, len, sign); break;
+  case TYP_INT16:  AddRowToColumnSums<int16_t>(p_sums, p_row, len, sign);  break;
+  case TYP_UINT32: AddRowToColumnSums<uint32_t>(p_sums, p_row, len, sign); break;
+  case TYP_INT32:  AddRowToColumnSums<int32_t>(p_sums, p_row, len, sign);  break;
+  case TYP_REAL32: AddRowToColumnSums<real32_t>(p_sums, p_row, len, sign); break;
+  case TYP_REAL64: AddRowToColumnSums<real64_t>(p_sums, p_row, len, sign); break;
+  default:         return NOT_IMPLEMENTED;
+  }
+  return NO_ERRORS;
+}
+
+int BandBoxFilter::ReadRows(const MinImg *p_band) {
+  if (!next_y) {
+    PROPAGATE_ERROR(GetPrototype(&prototype));
+    const int type = _GetMinImageType(&prototype);
+    if (type == TYP_UINT1 || type == TYP_REAL16 || type == TYP_UINT64 ||
+        type == TYP_INT64)
+      return NOT_IMPLEMENTED;
+  }
+  PROPAGATE_ERROR(AssureBandFitsPrototype(p_band, &prototype));
+  const int height = prototype.height;
+  if (next_y + p_band->height > height)
+    return BAD_STATE;
+  if (!p_band->height)
+    return NO_ERRORS;
+
+  const int top = (filter_height - 1) / 2, bottom = filter_height / 2;
+  if (!next_y) {
+    window_rows.assign(filter_height * _GetMinImageBytesPerLine(&prototype), 0);
+    column_sums.assign(prototype.width * prototype.channels, 0.);
+    for (int y = 0; y <= std::min(bottom, height - 1); ++y)
+      PROPAGATE_ERROR(PullRow(y));
+    for (int k = -top; k <= bottom; ++k)
+      PROPAGATE_ERROR(UpdateColumnSums(ClampIndex(k, height), 1.));
+  }
+
+  const double area = static_cast<double>(filter_width) * filter_height;
+  for (int y = 0; y < p_band->height; ++y, ++next_y) {
+    uint8_t *p_dst = _GetMinImageLine(p_band, y);
+    const double *p_sums = &column_sums[0];
+    switch (_GetMinImageType(&prototype)) {
+    case TYP_UINT8:
+      WriteMeanRow<uint8_t>(p_dst, p_sums, prototype.width, prototype.channels,
+                            filter_width, area);
+      break;
+    case TYP_INT8:
+      WriteMeanRow<int8_t>(p_dst, p_sums, prototype.width, prototype.channels,
+                           filter_width, area);
+      break;
+    case TYP_UINT16:
+      WriteMeanRow<uint16_t>(p_dst, p_sums, prototype.width,
+                             prototype.channels, filter_width, area);
+      break;
+    case TYP_INT16:
+      WriteMeanRow<int16_t>(p_dst, p_sums, prototype.width, prototype.channels,
+                            filter_width, area);
+      break;
+    case TYP_UINT32:
+      WriteMeanRow<uint32_t>(p_dst, p_sums, prototype.width,
+                             prototype.channels, filter_width, area);
+      break;
+    case TYP_INT32:
+      WriteMeanRow<int32_t>(p_dst, p_sums, prototype.width, prototype.channels,
+                            filter_width, area);
+      break;
+    case TYP_REAL32:
+      WriteMeanRow<real32_t>(p_dst, p_sums, prototype.width,
+                             prototype.channels, filter_width, area);
+      break;
+    default:
+      WriteMeanRow<real64_t>(p_dst, p_sums, prototype.width,
+                             prototype.channels, filter_width, area);
+      break;
+    }
+
+    if (next_y + 1 == height)
+      continue;
+    // The row entering the window takes the ring slot of the leaving one, so
+    // the leaving row is subtracted first.
+    const int entering_y = next_y + 1 + bottom;
+    PROPAGATE_ERROR(UpdateColumnSums(ClampIndex(next_y - top, height), -1.));
+    if (entering_y < height)
+      PROPAGATE_ERROR(PullRow(entering_y));
+    PROPAGATE_ERROR(UpdateColumnSums(ClampIndex(entering_y, height), 1.));
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int PumpMinImageBands(
+    MinImgBandSink   *p_sink,
+    MinImgBandSource *p_source,
+    int               band_height) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_PumpMinImageBands);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_sink || !p_source || band_height <= 0)
+    return BAD_ARGS;
+  MinImg prototype = {0};
+  PROPAGATE_ERROR(p_source->GetPrototype(&prototype));
+  PROPAGATE_ERROR(p_sink->Begin(&prototype));
+
+  DECLARE_GUARDED_MINIMG(band_image);
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&band_image, &prototype,
+      prototype.width, std::min(band_height, prototype.height)));
+  for (int y = 0; y < prototype.height; y += band_image.height) {
+    MinImg band = {0};
+    PROPAGATE_ERROR(_GetMinImageRegion(&band, &band_image, 0, 0,
+        band_image.width, std::min(band_image.height, prototype.height - y)));
+    PROPAGATE_ERROR(p_source->ReadRows(&band));
+    PROPAGATE_ERROR(p_sink->WriteRows(&band));
+  }
+
+  return p_sink->End();
+}
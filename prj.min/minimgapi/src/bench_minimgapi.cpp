@@ -0,0 +1,396 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+#if defined(_OPENMP)
+#  include <omp.h>
+#endif
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+
+// Benchmark of the MinImgAPI copying and geometric transformation functions.
+// Every function is run over a sweep of image sizes, element types, channel
+// counts, line paddings and buffer offsets, and the results are printed as a
+// single JSON document, so that runs of different releases or of builds with
+// and without WITH_SIMD can be compared by a script.
+//
+// Usage: bench_minimgapi [--quick] [--filter=<substring>] [--min-time=<sec>]
+//                        [--output=<path>]
+
+static const char *TYPE_NAMES[] = {
+  "UINT1", "UINT8", "INT8", "UINT16", "INT16", "REAL16",
+  "UINT32", "INT32", "REAL32", "UINT64", "INT64", "REAL64"
+};
+
+static double GetSeconds() {
+#if defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  ::QueryPerformanceFrequency(&frequency);
+  ::QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+  timespec now;
+  ::clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+struct BenchConfig {
+  int    width;
+  int    height;
+  int    channels;
+  MinTyp type;
+  int    stride_pad;  // Bytes appended to every line.
+  int    offset;      // Offset of the first line from a 64-byte boundary.
+};
+
+// An image over a buffer with controlled line padding and alignment.
+class BenchImage {
+public:
+  BenchImage() {
+    ::memset(&image, 0, sizeof(image));
+  }
+
+  int Create(int width, int height, int channels, MinTyp type,
+             int stride_pad, int offset) {
+    MinImg prototype = {0};
+    PROPAGATE_ERROR(NewMinImagePrototype(&prototype, width, height, channels,
+                                         type, 0, AO_EMPTY));
+    const int stride = _GetMinImageBytesPerLine(&prototype) + stride_pad;
+    buffer.assign(static_cast<size_t>(stride) * height + 64 + offset, 0);
+    uint8_t *p_base = &buffer[0];
+    p_base += (64 - reinterpret_cast<size_t>(p_base) % 64) % 64;
+    for (size_t i = 0; i < static_cast<size_t>(stride) * height; ++i)
+      p_base[offset + i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    return _WrapAlignedBufferWithMinImage(&image, p_base + offset, width,
+                                          height, channels, type, stride);
+  }
+
+  MinImg image;
+
+private:
+  BenchImage(const BenchImage &);
+  void operator =(const BenchImage &);
+
+  std::vector<uint8_t> buffer;
+};
+
+// Images involved in a single run, and the amount of work it does.
+struct BenchCase {
+  BenchImage src;
+  BenchImage dst;
+  BenchImage planes[4];
+  int64_t    bytes;   // Bytes read and written by a single run.
+  int64_t    pixels;  // Pixels produced by a single run.
+};
+
+static int64_t GetImageBytes(const MinImg &image) {
+  return static_cast<int64_t>(_GetMinImageBytesPerLine(&image)) *
+         image.height;
+}
+
+static int PrepareSameSize(BenchCase *p_case, const BenchConfig &c) {
+  PROPAGATE_ERROR(p_case->src.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  PROPAGATE_ERROR(p_case->dst.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  p_case->bytes = 2 * GetImageBytes(p_case->dst.image);
+  p_case->pixels = static_cast<int64_t>(c.width) * c.height;
+  return NO_ERRORS;
+}
+
+static int PrepareTransposed(BenchCase *p_case, const BenchConfig &c) {
+  PROPAGATE_ERROR(p_case->src.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  PROPAGATE_ERROR(p_case->dst.Create(c.height, c.width, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  p_case->bytes = 2 * GetImageBytes(p_case->dst.image);
+  p_case->pixels = static_cast<int64_t>(c.width) * c.height;
+  return NO_ERRORS;
+}
+
+static int PrepareFill(BenchCase *p_case, const BenchConfig &c) {
+  PROPAGATE_ERROR(p_case->dst.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  p_case->bytes = GetImageBytes(p_case->dst.image);
+  p_case->pixels = static_cast<int64_t>(c.width) * c.height;
+  return NO_ERRORS;
+}
+
+static int PrepareResample(BenchCase *p_case, const BenchConfig &c) {
+  const int width = std::max(1, c.width * 3 / 4);
+  const int height = std::max(1, c.height * 3 / 4);
+  PROPAGATE_ERROR(p_case->src.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  PROPAGATE_ERROR(p_case->dst.Create(width, height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  p_case->bytes = 2 * GetImageBytes(p_case->dst.image);
+  p_case->pixels = static_cast<int64_t>(width) * height;
+  return NO_ERRORS;
+}
+
+static int PrepareOneChannel(BenchCase *p_case, const BenchConfig &c) {
+  PROPAGATE_ERROR(p_case->src.Create(c.width, c.height, c.channels, c.type,
+                                     c.stride_pad, c.offset));
+  PROPAGATE_ERROR(p_case->dst.Create(c.width, c.height, 1, c.type,
+                                     c.stride_pad, c.offset));
+  p_case->bytes = 2 * GetImageBytes(p_case->dst.image);
+  p_case->pixels = static_cast<int64_t>(c.width) * c.height;
+  return NO_ERRORS;
+}
+
+static int PreparePlanes(BenchCase *p_case, const BenchConfig &c) {
+  if (c.channels > 4)
+    return NOT_SUPPORTED;
+  PROPAGATE_ERROR(PrepareSameSize(p_case, c));
+  for (int i = 0; i < c.channels; ++i)
+    PROPAGATE_ERROR(p_case->planes[i].Create(c.width, c.height, 1, c.type,
+                                             c.stride_pad, c.offset));
+  return NO_ERRORS;
+}
+
+static int RunCopy(const BenchCase &bc) {
+  return CopyMinImage(&bc.dst.image, &bc.src.image);
+}
+
+static int RunFill(const BenchCase &bc) {
+  static const uint8_t value[64] = {0x5A};
+  return FillMinImage(&bc.dst.image, value);
+}
+
+static int RunTranspose(const BenchCase &bc) {
+  return TransposeMinImage(&bc.dst.image, &bc.src.image);
+}
+
+static int RunFlipVertical(const BenchCase &bc) {
+  return FlipMinImage(&bc.dst.image, &bc.src.image, DO_VERTICAL);
+}
+
+static int RunFlipHorizontal(const BenchCase &bc) {
+  return FlipMinImage(&bc.dst.image, &bc.src.image, DO_HORIZONTAL);
+}
+
+static int RunRotateBy90(const BenchCase &bc) {
+  return RotateMinImageBy90(&bc.dst.image, &bc.src.image, 1);
+}
+
+static int RunRotateBy180(const BenchCase &bc) {
+  return RotateMinImageBy90(&bc.dst.image, &bc.src.image, 2);
+}
+
+static int RunResample(const BenchCase &bc) {
+  return ResampleMinImage(&bc.dst.image, &bc.src.image);
+}
+
+static int RunCopyChannels(const BenchCase &bc) {
+  const int dst_channel = 0, src_channel = bc.src.image.channels - 1;
+  return CopyMinImageChannels(&bc.dst.image, &bc.src.image, &dst_channel,
+                              &src_channel, 1);
+}
+
+static int RunInterleave(const BenchCase &bc) {
+  const MinImg *p_planes[4] = {0};
+  for (int i = 0; i < bc.src.image.channels; ++i)
+    p_planes[i] = &bc.planes[i].image;
+  return InterleaveMinImages(&bc.dst.image, p_planes, bc.src.image.channels);
+}
+
+static int RunDeinterleave(const BenchCase &bc) {
+  const MinImg *p_planes[4] = {0};
+  for (int i = 0; i < bc.src.image.channels; ++i)
+    p_planes[i] = &bc.planes[i].image;
+  return DeinterleaveMinImage(p_planes, &bc.src.image, bc.src.image.channels);
+}
+
+struct Operation {
+  const char *name;
+  int (*prepare)(BenchCase *p_case, const BenchConfig &config);
+  int (*run)(const BenchCase &bench_case);
+};
+
+static const Operation OPERATIONS[] = {
+  {"CopyMinImage",                PrepareSameSize,   RunCopy},
+  {"FillMinImage",                PrepareFill,       RunFill},
+  {"TransposeMinImage",           PrepareTransposed, RunTranspose},
+  {"FlipMinImage/vertical",       PrepareSameSize,   RunFlipVertical},
+  {"FlipMinImage/horizontal",     PrepareSameSize,   RunFlipHorizontal},
+  {"RotateMinImageBy90/1",        PrepareTransposed, RunRotateBy90},
+  {"RotateMinImageBy90/2",        PrepareSameSize,   RunRotateBy180},
+  {"ResampleMinImage",            PrepareResample,   RunResample},
+  {"CopyMinImageChannels",        PrepareOneChannel, RunCopyChannels},
+  {"InterleaveMinImages",         PreparePlanes,     RunInterleave},
+  {"DeinterleaveMinImage",        PreparePlanes,     RunDeinterleave}
+};
+
+// Runs the operation in batches of growing size until a batch lasts at least
+// min_time, and returns the time of a single run from that batch.
+static int Measure(
+    double          *p_seconds,
+    int64_t         *p_iterations,
+    const Operation &operation,
+    const BenchCase &bench_case,
+    double           min_time) {
+  PROPAGATE_ERROR(operation.run(bench_case));  // Warm up and check support.
+  for (int64_t iterations = 1; ; iterations *= 2) {
+    double start = GetSeconds();
+    for (int64_t i = 0; i < iterations; ++i)
+      PROPAGATE_ERROR(operation.run(bench_case));
+    double elapsed = GetSeconds() - start;
+    if (elapsed >= min_time || iterations >= (static_cast<int64_t>(1) << 40)) {
+      *p_seconds = elapsed / iterations;
+      *p_iterations = iterations;
+      return NO_ERRORS;
+    }
+  }
+}
+
+static const char *GetSimdName() {
+#if defined(USE_SSE_SIMD)
+  return "sse";
+#elif defined(USE_NEON_SIMD)
+  return "neon";
+#else
+  return "none";
+#endif
+}
+
+int main(int argc, char **argv) {
+  bool quick = false;
+  std::string filter;
+  double min_time = 0.02;
+  const char *p_output = NULL;
+  for (int i = 1; i < argc; ++i) {
+    if (!::strcmp(argv[i], "--quick"))
+      quick = true;
+    else if (!::strncmp(argv[i], "--filter=", 9))
+      filter = argv[i] + 9;
+    else if (!::strncmp(argv[i], "--min-time=", 11))
+      min_time = ::atof(argv[i] + 11);
+    else if (!::strncmp(argv[i], "--output=", 9))
+      p_output = argv[i] + 9;
+    else {
+      ::fprintf(stderr, "Usage: %s [--quick] [--filter=<substring>] "
+                "[--min-time=<sec>] [--output=<path>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  FILE *p_file = p_output ? ::fopen(p_output, "w") : stdout;
+  if (!p_file) {
+    ::fprintf(stderr, "Cannot open %s\n", p_output);
+    return 1;
+  }
+
+  static const int SIZES[][2] = {{61, 47}, {640, 480}, {1920, 1080}};
+  static const int CHANNELS[] = {1, 3, 4};
+  static const int STRIDE_PADS[] = {0, 64};
+  const int num_sizes = quick ? 1 : 3;
+  const int first_size = quick ? 1 : 0;
+
+  int threads = 1;
+#if defined(_OPENMP)
+  threads = omp_get_max_threads();
+#endif
+  ::fprintf(p_file, "{\n  \"benchmark\": \"minimgapi\",\n"
+            "  \"simd\": \"%s\",\n  \"threads\": %d,\n  \"results\": [",
+            GetSimdName(), threads);
+
+  bool first = true;
+  const int num_operations = sizeof(OPERATIONS) / sizeof(OPERATIONS[0]);
+  for (int o = 0; o < num_operations; ++o) {
+    const Operation &operation = OPERATIONS[o];
+    if (!filter.empty() && !::strstr(operation.name, filter.c_str()))
+      continue;
+    for (int s = first_size; s < first_size + num_sizes; ++s)
+    for (int t = TYP_UINT1; t <= TYP_REAL64; ++t) {
+      if (quick && t != TYP_UINT8 && t != TYP_REAL32)
+        continue;
+      for (int ch = 0; ch < 3; ++ch)
+      for (int pad = 0; pad < 2; ++pad)
+      for (int misaligned = 0; misaligned < 2; ++misaligned) {
+        if (quick && (ch == 2 || pad || misaligned))
+          continue;
+        BenchConfig config;
+        config.width = SIZES[s][0];
+        config.height = SIZES[s][1];
+        config.channels = CHANNELS[ch];
+        config.type = static_cast<MinTyp>(t);
+        config.stride_pad = STRIDE_PADS[pad];
+        // Keeps elements aligned but breaks the alignment of vectors.
+        config.offset = misaligned ? std::max(1, _GetDepthByTyp(config.type)) : 0;
+
+        BenchCase bench_case;
+        double seconds = 0;
+        int64_t iterations = 0;
+        int result = operation.prepare(&bench_case, config);
+        if (result >= 0)
+          result = Measure(&seconds, &iterations, operation, bench_case,
+                           min_time);
+
+        ::fprintf(p_file, "%s\n    {\"function\": \"%s\", \"type\": \"%s\", "
+                  "\"width\": %d, \"height\": %d, \"channels\": %d, "
+                  "\"stride_pad\": %d, \"offset\": %d, ",
+                  first ? "" : ",", operation.name, TYPE_NAMES[t],
+                  config.width, config.height, config.channels,
+                  config.stride_pad, config.offset);
+        if (result < 0)
+          ::fprintf(p_file, "\"error\": %d}", result);
+        else
+          ::fprintf(p_file, "\"iterations\": %lld, \"ns_per_pixel\": %.4f, "
+                    "\"gb_per_s\": %.4f}",
+                    static_cast<long long>(iterations),
+                    seconds * 1e9 / bench_case.pixels,
+                    bench_case.bytes / seconds * 1e-9);
+        first = false;
+        ::fflush(p_file);
+      }
+    }
+  }
+
+  ::fprintf(p_file, "\n  ]\n}\n");
+  if (p_output)
+    ::fclose(p_file);
+  return 0;
+}
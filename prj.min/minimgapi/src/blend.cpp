@@ -0,0 +1,306 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cstddef>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "mask.h"
+#include "parallel.h"
+#include "vector/blend-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_BlendMinImages, "BlendMinImages");
+DECLARE_MINSTOPWATCH(gsw_AlphaCompositeMinImages, "AlphaCompositeMinImages");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// A source image as it is seen by the line kernels.
+struct BlendOperand {
+  const uint8_t *p_line;
+  int            stride;
+};
+
+// Makes the source image usable by the line kernels. The kernels go forward
+// and load each portion of the sources before storing the destination, so a
+// source is read in place whenever CheckMinImagesTangle() allows a forward
+// pass and via a temporary copy otherwise. Clears *p_parallel if the rows of
+// the destination may not be processed in arbitrary order.
+static int PrepareBlendOperand(
+    BlendOperand *p_operand,
+    MinImg       *p_buffer_image,
+    bool         *p_parallel,
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image) {
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  p_operand->p_line = p_src_image->pScan0;
+  p_operand->stride = p_src_image->stride;
+  if (~tangling & TCR_FORWARD_PASS_POSSIBLE) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(p_buffer_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(p_buffer_image, p_src_image));
+    p_operand->p_line = p_buffer_image->pScan0;
+    p_operand->stride = p_buffer_image->stride;
+  } else if (tangling != TCR_SAME_IMAGE &&
+             tangling != TCR_INDEPENDENT_IMAGES) {
+    *p_parallel = false;
+  }
+  return NO_ERRORS;
+}
+
+// Blends a row of integer elements in fixed point.
+template<typename T>
+static MUSTINLINE void BlendRow(
+    T       *p_dst,
+    const T *p_a,
+    const T *p_b,
+    int      len,
+    double   alpha) {
+  BlendLine<T>(p_dst, p_a, p_b, len, static_cast<uint32_t>(
+      alpha * BlendTraits<T>::MAX_VALUE + 0.5));
+}
+
+template<typename T>
+static MUSTINLINE void BlendRealRow(
+    T       *p_dst,
+    const T *p_a,
+    const T *p_b,
+    int      len,
+    double   alpha) {
+  const T weight_b = static_cast<T>(alpha);
+  const T weight_a = static_cast<T>(1.0 - alpha);
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = p_a[i] * weight_a + p_b[i] * weight_b;
+}
+
+static MUSTINLINE void BlendRow(
+    real32_t       *p_dst,
+    const real32_t *p_a,
+    const real32_t *p_b,
+    int             len,
+    double          alpha) {
+  BlendRealRow(p_dst, p_a, p_b, len, alpha);
+}
+
+static MUSTINLINE void BlendRow(
+    real64_t       *p_dst,
+    const real64_t *p_a,
+    const real64_t *p_b,
+    int             len,
+    double          alpha) {
+  BlendRealRow(p_dst, p_a, p_b, len, alpha);
+}
+
+// Blends the rows [y_begin, y_end). With a mask the rows with any pixel set
+// are blended into p_line_buffer and merged into the destination by the mask.
+template<typename T>
+static void BlendRows(
+    const MinImg       *p_dst_image,
+    const BlendOperand &a,
+    const BlendOperand &b,
+    const MinImg       *p_mask_image,
+    uint8_t            *p_line_buffer,
+    int                 y_begin,
+    int                 y_end,
+    double              alpha) {
+  const int width = p_dst_image->width;
+  const int len = width * p_dst_image->channels;
+  const int pixel_size = p_dst_image->channels * static_cast<int>(sizeof(T));
+  const bool bit_mask = p_mask_image &&
+                        _GetMinImageType(p_mask_image) == TYP_UINT1;
+  for (int y = y_begin; y < y_end; ++y) {
+    uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, y);
+    const uint8_t *p_mask_line = NULL;
+    T *p_dst = reinterpret_cast<T *>(p_dst_line);
+    if (p_mask_image) {
+      p_mask_line = _GetMinImageLine(p_mask_image, y);
+      if (IsMaskLineEmpty(p_mask_line, bit_mask, width))
+        continue;
+      p_dst = reinterpret_cast<T *>(p_line_buffer);
+    }
+    BlendRow(p_dst,
+             reinterpret_cast<const T *>(a.p_line +
+                                         static_cast<ptrdiff_t>(y) * a.stride),
+             reinterpret_cast<const T *>(b.p_line +
+                                         static_cast<ptrdiff_t>(y) * b.stride),
+             len, alpha);
+    if (p_mask_line)
+      CopyLineMasked(p_dst_line, p_line_buffer, p_mask_line, bit_mask, width,
+                     pixel_size);
+  }
+}
+
+MINIMGAPI_API int BlendMinImages(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image_a,
+    const MinImg *p_src_image_b,
+    double        alpha,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_BlendMinImages);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image_a));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image_b));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image_a) ||
+      _CompareMinImagePrototypes(p_dst_image, p_src_image_b))
+    return BAD_ARGS;
+  if (!(alpha >= 0.0 && alpha <= 1.0))
+    return BAD_ARGS;
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_dst_image));
+  const int type = _GetMinImageType(p_dst_image);
+  if (type != TYP_UINT8 && type != TYP_UINT16 &&
+      type != TYP_REAL32 && type != TYP_REAL64)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  bool parallel = true;
+  BlendOperand a = {0}, b = {0};
+  DECLARE_GUARDED_MINIMG(buffer_image_a);
+  DECLARE_GUARDED_MINIMG(buffer_image_b);
+  PROPAGATE_ERROR(PrepareBlendOperand(&a, &buffer_image_a, &parallel,
+                                      p_dst_image, p_src_image_a));
+  PROPAGATE_ERROR(PrepareBlendOperand(&b, &buffer_image_b, &parallel,
+                                      p_dst_image, p_src_image_b));
+
+  const int height = p_dst_image->height;
+  const int num_threads = !parallel ? 1 : ChooseThreadCount(height,
+      static_cast<int64_t>(p_dst_image->width) * p_dst_image->channels *
+      height);
+  const size_t line_size = _GetMinImageBytesPerLine(p_dst_image);
+  scoped_cpp_array<uint8_t> lines(
+      p_mask_image ? new uint8_t[num_threads * line_size] : NULL);
+#pragma omp parallel for num_threads(num_threads)
+  for (int i = 0; i < num_threads; ++i) {
+    const int y_begin = height * i / num_threads;
+    const int y_end = height * (i + 1) / num_threads;
+    uint8_t *p_line_buffer = p_mask_image ? lines + i * line_size : NULL;
+    switch (type) {
+    case TYP_UINT8:
+      BlendRows<uint8_t>(p_dst_image, a, b, p_mask_image, p_line_buffer,
+                         y_begin, y_end, alpha);
+      break;
+    case TYP_UINT16:
+      BlendRows<uint16_t>(p_dst_image, a, b, p_mask_image, p_line_buffer,
+                          y_begin, y_end, alpha);
+      break;
+    case TYP_REAL32:
+      BlendRows<real32_t>(p_dst_image, a, b, p_mask_image, p_line_buffer,
+                          y_begin, y_end, alpha);
+      break;
+    default:
+      BlendRows<real64_t>(p_dst_image, a, b, p_mask_image, p_line_buffer,
+                          y_begin, y_end, alpha);
+      break;
+    }
+  }
+
+  return NO_ERRORS;
+}
+
+template<typename T, int BgChannels>
+static void CompositeRows(
+    const MinImg       *p_dst_image,
+    const BlendOperand &fg,
+    const BlendOperand &bg,
+    int                 y_begin,
+    int                 y_end) {
+  for (int y = y_begin; y < y_end; ++y)
+    CompositeLine<T, BgChannels>(
+        reinterpret_cast<T *>(_GetMinImageLine(p_dst_image, y)),
+        reinterpret_cast<const T *>(fg.p_line +
+                                    static_cast<ptrdiff_t>(y) * fg.stride),
+        reinterpret_cast<const T *>(bg.p_line +
+                                    static_cast<ptrdiff_t>(y) * bg.stride),
+        p_dst_image->width);
+}
+
+MINIMGAPI_API int AlphaCompositeMinImages(
+    const MinImg *p_dst_image,
+    const MinImg *p_fg_image,
+    const MinImg *p_bg_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_AlphaCompositeMinImages);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_fg_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_bg_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_bg_image) ||
+      _CompareMinImage2DSizes(p_dst_image, p_fg_image) ||
+      _CompareMinImageTypes(p_dst_image, p_fg_image))
+    return BAD_ARGS;
+  const int channels = p_dst_image->channels;
+  if (p_fg_image->channels != 4 || (channels != 3 && channels != 4))
+    return BAD_ARGS;
+  const int type = _GetMinImageType(p_dst_image);
+  if (type != TYP_UINT8 && type != TYP_UINT16)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0 || p_fg_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  bool parallel = true;
+  BlendOperand fg = {0}, bg = {0};
+  DECLARE_GUARDED_MINIMG(buffer_image_fg);
+  DECLARE_GUARDED_MINIMG(buffer_image_bg);
+  PROPAGATE_ERROR(PrepareBlendOperand(&fg, &buffer_image_fg, &parallel,
+                                      p_dst_image, p_fg_image));
+  PROPAGATE_ERROR(PrepareBlendOperand(&bg, &buffer_image_bg, &parallel,
+                                      p_dst_image, p_bg_image));
+
+  const int height = p_dst_image->height;
+  const int num_threads = !parallel ? 1 : ChooseThreadCount(height,
+      static_cast<int64_t>(p_dst_image->width) * channels * height);
+#pragma omp parallel for num_threads(num_threads)
+  for (int i = 0; i < num_threads; ++i) {
+    const int y_begin = height * i / num_threads;
+    const int y_end = height * (i + 1) / num_threads;
+    if (type == TYP_UINT8 && channels == 3)
+      CompositeRows<uint8_t, 3>(p_dst_image, fg, bg, y_begin, y_end);
+    else if (type == TYP_UINT8)
+      CompositeRows<uint8_t, 4>(p_dst_image, fg, bg, y_begin, y_end);
+    else if (channels == 3)
+      CompositeRows<uint16_t, 3>(p_dst_image, fg, bg, y_begin, y_end);
+    else
+      CompositeRows<uint16_t, 4>(p_dst_image, fg, bg, y_begin, y_end);
+  }
+
+  return NO_ERRORS;
+}
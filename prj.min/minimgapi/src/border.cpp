@@ -0,0 +1,310 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include "parallel.h"
+#include "vector/border-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_CopyMinImageWithBorder, "CopyMinImageWithBorder");
+DECLARE_MINSTOPWATCH(gsw_ClonePaddedMinImage, "ClonePaddedMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Maps a coordinate out of [0, size) in accordance with the border condition,
+// the same way _GetMinImageLine() maps lines. Returns -1 for BO_CONSTANT.
+static MUSTINLINE int MapCoordinate(int x, int size, BorderOption border) {
+  if (x >= 0 && x < size)
+    return x;
+  switch (border) {
+  case BO_REPEAT:
+    return std::min(std::max(0, x), size - 1);
+  case BO_CYCLIC:
+    return (x % size + size) % size;
+  case BO_SYMMETRIC: {
+    int size2 = size * 2;
+    x = (x % size2 + size2) % size2;
+    return std::min(x, size2 - 1 - x);
+  }
+  default:
+    return -1;
+  }
+}
+
+// Fills count pixels of pixel_size bytes with a copy of p_pixel. Wider pixels
+// are replicated by doubling the already written part, so the work is done by
+// a logarithmic number of memcpy() calls.
+static void FillPixels(
+    uint8_t       *p_dst,
+    const uint8_t *p_pixel,
+    int            count,
+    int            pixel_size) {
+  if (count <= 0)
+    return;
+  if (pixel_size == 1) {
+    ::memset(p_dst, *p_pixel, count);
+    return;
+  }
+  ::memcpy(p_dst, p_pixel, pixel_size);
+  for (int done = 1; done < count; ) {
+    int chunk = std::min(done, count - done);
+    ::memcpy(p_dst + done * pixel_size, p_dst, chunk * pixel_size);
+    done += chunk;
+  }
+}
+
+// Copies len pixels of pixel_size bytes in reverse order.
+static void ReversePixelRun(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    int            len,
+    int            pixel_size) {
+  switch (pixel_size) {
+  case 1:
+    ReversePixels<1>(p_dst, p_src, len);
+    break;
+  case 2:
+    ReversePixels<2>(p_dst, p_src, len);
+    break;
+  case 4:
+    ReversePixels<4>(p_dst, p_src, len);
+    break;
+  default:
+    for (int i = 0; i < len; ++i)
+      ::memcpy(p_dst + i * pixel_size, p_src + (len - 1 - i) * pixel_size,
+               pixel_size);
+  }
+}
+
+// Reconstructs count pixels of the margin starting at the image column
+// x_begin (which is out of [0, width)) from the interior of the row.
+static void FillMarginByMapping(
+    uint8_t       *p_margin,
+    const uint8_t *p_interior,
+    int            x_begin,
+    int            count,
+    int            width,
+    int            pixel_size,
+    BorderOption   border) {
+  for (int i = 0; i < count; ++i)
+    ::memcpy(p_margin + i * pixel_size,
+             p_interior + MapCoordinate(x_begin + i, width, border) *
+                          pixel_size,
+             pixel_size);
+}
+
+// Fills the left and right margins of a padded row whose interior is already
+// in place. The common cases of margins no wider than the image are handled
+// by bulk copies, wider ones are mapped pixel by pixel.
+static void FillRowMargins(
+    uint8_t       *p_row,
+    int            width,
+    int            left,
+    int            right,
+    int            pixel_size,
+    BorderOption   border,
+    const uint8_t *p_canvas_line) {
+  uint8_t *p_interior = p_row + left * pixel_size;
+  uint8_t *p_right = p_interior + width * pixel_size;
+  switch (border) {
+  case BO_CONSTANT:
+    ::memcpy(p_row, p_canvas_line, left * pixel_size);
+    ::memcpy(p_right, p_canvas_line, right * pixel_size);
+    return;
+  case BO_REPEAT:
+    FillPixels(p_row, p_interior, left, pixel_size);
+    FillPixels(p_right, p_right - pixel_size, right, pixel_size);
+    return;
+  case BO_SYMMETRIC:
+    if (left <= width)
+      ReversePixelRun(p_row, p_interior, left, pixel_size);
+    else
+      FillMarginByMapping(p_row, p_interior, -left, left, width, pixel_size,
+                          border);
+    if (right <= width)
+      ReversePixelRun(p_right, p_right - right * pixel_size, right,
+                      pixel_size);
+    else
+      FillMarginByMapping(p_right, p_interior, width, right, width,
+                          pixel_size, border);
+    return;
+  default:
+    if (left <= width)
+      ::memcpy(p_row, p_right - left * pixel_size, left * pixel_size);
+    else
+      FillMarginByMapping(p_row, p_interior, -left, left, width, pixel_size,
+                          border);
+    if (right <= width)
+      ::memcpy(p_right, p_interior, right * pixel_size);
+    else
+      FillMarginByMapping(p_right, p_interior, width, right, width,
+                          pixel_size, border);
+    return;
+  }
+}
+
+MINIMGAPI_API int CopyMinImageWithBorder(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           left,
+    int           top,
+    int           right,
+    int           bottom,
+    BorderOption  border,
+    const void   *p_canvas) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImageWithBorder);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (left < 0 || top < 0 || right < 0 || bottom < 0)
+    return BAD_ARGS;
+  if (p_dst_image->width != p_src_image->width + left + right ||
+      p_dst_image->height != p_src_image->height + top + bottom)
+    return BAD_ARGS;
+  if (p_dst_image->channels != p_src_image->channels ||
+      _GetMinImageType(p_dst_image) != _GetMinImageType(p_src_image))
+    return BAD_ARGS;
+  if (border == BO_CONSTANT && !p_canvas)
+    return BAD_ARGS;
+  if (border == BO_IGNORE)
+    return NOT_SUPPORTED;
+  if (border == BO_VOID)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->channelDepth == 0)
+    return NOT_IMPLEMENTED;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS) {
+    if (border != BO_CONSTANT)
+      return BAD_ARGS;
+    return FillMinImage(p_dst_image, p_canvas);
+  }
+
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int dst_width = p_dst_image->width;
+  const int pixel_size = p_src_image->channels * p_src_image->channelDepth;
+  const int row_size = dst_width * pixel_size;
+
+  DECLARE_GUARDED_MINIMG(canvas_line);
+  if (border == BO_CONSTANT) {
+    PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&canvas_line, p_dst_image,
+                                                   dst_width, 1));
+    PROPAGATE_ERROR(FillMinImage(&canvas_line, p_canvas));
+  }
+
+  // The source may already be the interior of the destination, in which case
+  // only the margins need to be refreshed. A source overlapping the
+  // destination in any other way is copied first, since lines are copied in
+  // parallel and the margins are filled from the destination.
+  MinImg interior_image = {0};
+  PROPAGATE_ERROR(_GetMinImageRegion(&interior_image, p_dst_image, left, top,
+                                     width, height));
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, &interior_image,
+                                       p_src_image));
+  const bool in_place = tangling == TCR_SAME_IMAGE;
+  DECLARE_GUARDED_MINIMG(buffer_image);
+  if (!in_place) {
+    PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+    if (tangling != TCR_INDEPENDENT_IMAGES) {
+      PROPAGATE_ERROR(_CloneMinImagePrototype(&buffer_image, p_src_image));
+      PROPAGATE_ERROR(CopyMinImage(&buffer_image, p_src_image));
+      p_src_image = &buffer_image;
+    }
+  }
+
+  const int num_threads = ChooseThreadCount(
+      height, static_cast<int64_t>(dst_width) * height);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    uint8_t *p_row = _GetMinImageLine(p_dst_image, top + y);
+    if (!in_place)
+      ::memcpy(p_row + left * pixel_size, _GetMinImageLine(p_src_image, y),
+               width * pixel_size);
+    FillRowMargins(p_row, width, left, right, pixel_size, border,
+                   canvas_line.pScan0);
+  }
+
+  // The top and bottom margins consist of whole padded rows.
+  for (int y = 0; y < top + bottom; ++y) {
+    const int dst_y = y < top ? y : height + y;
+    const int src_y = MapCoordinate(dst_y - top, height, border);
+    const uint8_t *p_line = src_y < 0 ? canvas_line.pScan0 :
+                            _GetMinImageLine(p_dst_image, top + src_y);
+    ::memcpy(_GetMinImageLine(p_dst_image, dst_y), p_line, row_size);
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int ClonePaddedMinImage(
+    MinImg       *p_padded_image,
+    MinImg       *p_interior_image,
+    const MinImg *p_src_image,
+    int           left,
+    int           top,
+    int           right,
+    int           bottom,
+    BorderOption  border,
+    const void   *p_canvas) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ClonePaddedMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_padded_image || !p_interior_image || p_padded_image->pScan0 ||
+      p_interior_image->pScan0)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (left < 0 || top < 0 || right < 0 || bottom < 0)
+    return BAD_ARGS;
+
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(p_padded_image, p_src_image,
+                  p_src_image->width + left + right,
+                  p_src_image->height + top + bottom));
+  int result = CopyMinImageWithBorder(p_padded_image, p_src_image, left, top,
+                                      right, bottom, border, p_canvas);
+  if (result == NO_ERRORS)
+    result = GetMinImageRegion(p_interior_image, p_padded_image, left, top,
+                               p_src_image->width, p_src_image->height);
+  if (result != NO_ERRORS)
+    FreeMinImage(p_padded_image);
+  return result;
+}
@@ -0,0 +1,400 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "vector/compare-inl.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_CompareMinImageContents, "CompareMinImageContents");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+static MUSTINLINE int CountBits(uint8_t byte) {
+  byte = static_cast<uint8_t>(byte - ((byte >> 1) & 0x55));
+  byte = static_cast<uint8_t>((byte & 0x33) + ((byte >> 2) & 0x33));
+  return (byte + (byte >> 4)) & 0x0F;
+}
+
+// Returns the mask of meaningful bits in the last byte of a bit line.
+static MUSTINLINE uint8_t GetTailBitMask(int len_bits) {
+  return static_cast<uint8_t>(len_bits & 7 ? 0xFF00U >> (len_bits & 7) : 0xFF);
+}
+
+static bool AreMinImageContentsEqual(
+    const MinImg *p_image_a,
+    const MinImg *p_image_b) {
+  const int len_bits = p_image_a->width * p_image_a->channels;
+  const bool bit_lines = p_image_a->channelDepth == 0;
+  const int bytes = _GetMinImageBytesPerLine(p_image_a);
+  const int full_bytes = bit_lines ? bytes - 1 : bytes;
+  const uint8_t tail_mask = GetTailBitMask(len_bits);
+  for (int y = 0; y < p_image_a->height; ++y) {
+    const uint8_t *p_a = _GetMinImageLine(p_image_a, y);
+    const uint8_t *p_b = _GetMinImageLine(p_image_b, y);
+    if (::memcmp(p_a, p_b, full_bytes))
+      return false;
+    if (bit_lines && ((p_a[full_bytes] ^ p_b[full_bytes]) & tail_mask))
+      return false;
+  }
+  return true;
+}
+
+static void AccumulateBitLineDiff(
+    DiffStats     *p_stats,
+    const uint8_t *p_a,
+    const uint8_t *p_b,
+    int            len_bits) {
+  const int full_bytes = len_bits >> 3;
+  int64_t mismatches = 0;
+  for (int i = 0; i < full_bytes; ++i)
+    mismatches += CountBits(p_a[i] ^ p_b[i]);
+  if (len_bits & 7)
+    mismatches += CountBits((p_a[full_bytes] ^ p_b[full_bytes]) &
+                            GetTailBitMask(len_bits));
+  p_stats->mismatches += mismatches;
+  p_stats->sse += static_cast<double>(mismatches);
+  if (mismatches)
+    p_stats->max_abs_diff = 1.;
+}
+
+template<typename T>
+static void AccumulateBandDiff(
+    DiffStats    *p_stats,
+    const MinImg *p_image_a,
+    const MinImg *p_image_b,
+    int           y_begin,
+    int           y_end) {
+  const int len = p_image_a->width * p_image_a->channels;
+  for (int y = y_begin; y < y_end; ++y)
+    AccumulateLineDiff<T>(p_stats,
+        reinterpret_cast<const T *>(_GetMinImageLine(p_image_a, y)),
+        reinterpret_cast<const T *>(_GetMinImageLine(p_image_b, y)), len);
+}
+
+static int AccumulateDiff(
+    DiffStats    *p_stats,
+    const MinImg *p_image_a,
+    const MinImg *p_image_b,
+    int           y_begin,
+    int           y_end) {
+  switch (_GetMinImageType(p_image_a)) {
+  case TYP_UINT1:
+    for (int y = y_begin; y < y_end; ++y)
+      AccumulateBitLineDiff(p_stats, _GetMinImageLine(p_image_a, y),
+                            _GetMinImageLine(p_image_b, y),
+                            p_image_a->width * p_image_a->channels);
+    return NO_ERRORS;
+  case TYP_UINT8:
+    AccumulateBandDiff<uint8_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_INT8:
+    AccumulateBandDiff<int8_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_UINT16:
+    AccumulateBandDiff<uint16_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_INT16:
+    AccumulateBandDiff<int16_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_UINT32:
+    AccumulateBandDiff<uint32_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_INT32:
+    AccumulateBandDiff<int32_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_UINT64:
+    AccumulateBandDiff<uint64_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_INT64:
+    AccumulateBandDiff<int64_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_REAL32:
+    AccumulateBandDiff<real32_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  case TYP_REAL64:
+    AccumulateBandDiff<real64_t>(p_stats, p_image_a, p_image_b, y_begin, y_end);
+    return NO_ERRORS;
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+// Returns the dynamic range of the image type used as the peak signal value.
+static double GetPeakValue(
+    const MinImg *p_image) {
+  if (p_image->format == FMT_REAL || p_image->channelDepth == 0)
+    return 1.;
+  return std::ldexp(1., 8 * p_image->channelDepth) - 1.;
+}
+
+template<typename T>
+static void ConvertLineToReals(
+    double        *p_dst,
+    const uint8_t *p_src,
+    int            len) {
+  const T *p = reinterpret_cast<const T *>(p_src);
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = static_cast<double>(p[i]);
+}
+
+static void LoadLineAsReals(
+    double       *p_dst,
+    const MinImg *p_image,
+    int           y) {
+  const uint8_t *p_src = _GetMinImageLine(p_image, y);
+  const int len = p_image->width * p_image->channels;
+  switch (_GetMinImageType(p_image)) {
+  case TYP_UINT1:
+    for (int i = 0; i < len; ++i)
+      p_dst[i] = GET_IMAGE_LINE_BIT(p_src, i) ? 1. : 0.;
+    break;
+  case TYP_UINT8:  ConvertLineToReals<uint8_t>(p_dst, p_src, len);  break;
+  case TYP_INT8:   ConvertLineToReals<int8_t>(p_dst, p_src, len);   break;
+  case TYP_UINT16: ConvertLineToReals<uint16_t>(p_dst, p_src, len); break;
+  case TYP_INT16:  ConvertLineToReals<int16_t>(p_dst, p_src, len);  break;
+  case TYP_UINT32: ConvertLineToReals<uint32_t>(p_dst, p_src, len); break;
+  case TYP_INT32:  ConvertLineToReals<int32_t>(p_dst, p_src, len);  break;
+  case TYP_UINT64: ConvertLineToReals<uint64_t>(p_dst, p_src, len); break;
+  case TYP_INT64:  ConvertLineToReals<int64_t>(p_dst, p_src, len);  break;
+  case TYP_REAL32: ConvertLineToReals<real32_t>(p_dst, p_src, len); break;
+  default:         ConvertLineToReals<real64_t>(p_dst, p_src, len); break;
+  }
+}
+
+// Sums of a window (or a column of a window) needed for SSIM.
+enum { SSIM_A, SSIM_B, SSIM_AA, SSIM_BB, SSIM_AB, SSIM_NUM_SUMS };
+
+// Adds (sign = 1) or removes (sign = -1) a line pair to the column sums.
+static void UpdateSsimColumns(
+    double       *p_columns,
+    const double *p_a,
+    const double *p_b,
+    int           len,
+    double        sign) {
+  for (int i = 0; i < len; ++i) {
+    double *p_sums = p_columns + i * SSIM_NUM_SUMS;
+    p_sums[SSIM_A] += sign * p_a[i];
+    p_sums[SSIM_B] += sign * p_b[i];
+    p_sums[SSIM_AA] += sign * p_a[i] * p_a[i];
+    p_sums[SSIM_BB] += sign * p_b[i] * p_b[i];
+    p_sums[SSIM_AB] += sign * p_a[i] * p_b[i];
+  }
+}
+
+// Returns the sum of SSIM values of all windows with top rows in the band.
+// Window sums are maintained incrementally, first over columns and then
+// along each row, so the cost per window does not depend on its size.
+static double SumSsimOverBand(
+    const MinImg *p_image_a,
+    const MinImg *p_image_b,
+    int           window,
+    int           y_begin,
+    int           y_end) {
+  const int channels = p_image_a->channels;
+  const int len = p_image_a->width * channels;
+  const double area = static_cast<double>(window) * window;
+  const double peak = GetPeakValue(p_image_a);
+  const double c1 = (0.01 * peak) * (0.01 * peak);
+  const double c2 = (0.03 * peak) * (0.03 * peak);
+
+  scoped_cpp_array<double> line_a(new double[len]);
+  scoped_cpp_array<double> line_b(new double[len]);
+  scoped_cpp_array<double> columns(new double[len * SSIM_NUM_SUMS]);
+  std::fill(&columns[0], &columns[0] + len * SSIM_NUM_SUMS, 0.);
+  for (int y = y_begin; y < y_begin + window - 1; ++y) {
+    LoadLineAsReals(&line_a[0], p_image_a, y);
+    LoadLineAsReals(&line_b[0], p_image_b, y);
+    UpdateSsimColumns(&columns[0], &line_a[0], &line_b[0], len, 1.);
+  }
+
+  double ssim_sum = 0;
+  for (int y = y_begin; y < y_end; ++y) {
+    LoadLineAsReals(&line_a[0], p_image_a, y + window - 1);
+    LoadLineAsReals(&line_b[0], p_image_b, y + window - 1);
+    UpdateSsimColumns(&columns[0], &line_a[0], &line_b[0], len, 1.);
+
+    for (int c = 0; c < channels; ++c) {
+      double sums[SSIM_NUM_SUMS] = {0};
+      for (int x = 0; x < p_image_a->width; ++x) {
+        const double *p_in = &columns[(x * channels + c) * SSIM_NUM_SUMS];
+        for (int k = 0; k < SSIM_NUM_SUMS; ++k)
+          sums[k] += p_in[k];
+        if (x < window - 1)
+          continue;
+        double mu_a = sums[SSIM_A] / area, mu_b = sums[SSIM_B] / area;
+        double var_a = sums[SSIM_AA] / area - mu_a * mu_a;
+        double var_b = sums[SSIM_BB] / area - mu_b * mu_b;
+        double cov = sums[SSIM_AB] / area - mu_a * mu_b;
+        ssim_sum += (2 * mu_a * mu_b + c1) * (2 * cov + c2) /
+                    ((mu_a * mu_a + mu_b * mu_b + c1) * (var_a + var_b + c2));
+        const double *p_out =
+            &columns[((x - window + 1) * channels + c) * SSIM_NUM_SUMS];
+        for (int k = 0; k < SSIM_NUM_SUMS; ++k)
+          sums[k] -= p_out[k];
+      }
+    }
+
+    LoadLineAsReals(&line_a[0], p_image_a, y);
+    LoadLineAsReals(&line_b[0], p_image_b, y);
+    UpdateSsimColumns(&columns[0], &line_a[0], &line_b[0], len, -1.);
+  }
+
+  return ssim_sum;
+}
+
+static int ComputeSsim(
+    double       *p_ssim,
+    const MinImg *p_image_a,
+    const MinImg *p_image_b,
+    int           window) {
+  window = std::min(window, std::min(p_image_a->width, p_image_a->height));
+  const int num_tops = p_image_a->height - window + 1;
+  const int64_t num_windows = static_cast<int64_t>(num_tops) *
+                   (p_image_a->width - window + 1) * p_image_a->channels;
+  const int num_threads = ChooseThreadCount(num_tops,
+                              num_windows * SSIM_NUM_SUMS * 2);
+
+  scoped_cpp_array<double> sums(new double[num_threads]);
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band)
+    sums[band] = SumSsimOverBand(p_image_a, p_image_b, window,
+        static_cast<int>(static_cast<int64_t>(num_tops) * band / num_threads),
+        static_cast<int>(static_cast<int64_t>(num_tops) * (band + 1) /
+                         num_threads));
+
+  double ssim_sum = 0;
+  for (int band = 0; band < num_threads; ++band)
+    ssim_sum += sums[band];
+  *p_ssim = ssim_sum / static_cast<double>(num_windows);
+  return NO_ERRORS;
+}
+
+static int ComputeDifference(
+    MinImgComparison *p_result,
+    const MinImg     *p_image_a,
+    const MinImg     *p_image_b) {
+  const int height = p_image_a->height;
+  const int64_t num_elements = static_cast<int64_t>(p_image_a->width) *
+                               p_image_a->channels * height;
+  const int num_threads = ChooseThreadCount(height, num_elements);
+
+  scoped_cpp_array<DiffStats> stats(new DiffStats[num_threads]);
+  int result = NO_ERRORS;
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band) {
+    DiffStats band_stats = {0, 0., 0.};
+    int band_result = AccumulateDiff(&band_stats, p_image_a, p_image_b,
+        static_cast<int>(static_cast<int64_t>(height) * band / num_threads),
+        static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                         num_threads));
+    if (band_result != NO_ERRORS) {
+#pragma omp critical
+      result = band_result;
+    }
+    stats[band] = band_stats;
+  }
+  PROPAGATE_ERROR(result);
+
+  DiffStats total = stats[0];
+  for (int band = 1; band < num_threads; ++band) {
+    total.mismatches += stats[band].mismatches;
+    total.max_abs_diff = std::max(total.max_abs_diff, stats[band].max_abs_diff);
+    total.sse += stats[band].sse;
+  }
+
+  const double peak = GetPeakValue(p_image_a);
+  const double mse = total.sse / static_cast<double>(num_elements);
+  p_result->mismatch_count = total.mismatches;
+  p_result->max_abs_diff = total.max_abs_diff;
+  p_result->psnr = mse > 0 ? 10. * std::log10(peak * peak / mse) :
+                             std::numeric_limits<double>::infinity();
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int CompareMinImageContents(
+    MinImgComparison *p_result,
+    const MinImg     *p_image_a,
+    const MinImg     *p_image_b,
+    ComparisonOption  option,
+    int               ssim_window) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CompareMinImageContents);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_result)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image_a));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image_b));
+  if (_CompareMinImagePrototypes(p_image_a, p_image_b))
+    return BAD_ARGS;
+  if (option == CO_SSIM && ssim_window <= 0)
+    return BAD_ARGS;
+  if (_GetMinImageType(p_image_a) == TYP_REAL16)
+    return NOT_IMPLEMENTED;
+
+  p_result->mismatch_count = 0;
+  p_result->max_abs_diff = 0;
+  p_result->psnr = std::numeric_limits<double>::infinity();
+  p_result->ssim = 1.;
+  if (_AssureMinImageIsEmpty(p_image_a) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_image_a->addressSpace != 0 || p_image_b->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  switch (option) {
+  case CO_EXACT:
+    if (!AreMinImageContentsEqual(p_image_a, p_image_b)) {
+      p_result->mismatch_count = 1;
+      p_result->max_abs_diff = std::numeric_limits<double>::quiet_NaN();
+      p_result->psnr = std::numeric_limits<double>::quiet_NaN();
+      p_result->ssim = std::numeric_limits<double>::quiet_NaN();
+    }
+    return NO_ERRORS;
+  case CO_DIFFERENCE:
+    p_result->ssim = std::numeric_limits<double>::quiet_NaN();
+    return ComputeDifference(p_result, p_image_a, p_image_b);
+  case CO_SSIM:
+    PROPAGATE_ERROR(ComputeDifference(p_result, p_image_a, p_image_b));
+    return ComputeSsim(&p_result->ssim, p_image_a, p_image_b, ssim_window);
+  default:
+    return BAD_ARGS;
+  }
+}
@@ -0,0 +1,330 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include "parallel.h"
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_LabelMinImageComponents, "LabelMinImageComponents");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+/// A horizontal run of set pixels [x_begin, x_end) of line y.
+struct PixelRun {
+  int32_t x_begin;
+  int32_t x_end;
+  int32_t y;
+};
+
+// Returns the number of leading zero bits of a nonzero value.
+static MUSTINLINE int CountLeadingZeros64(uint64_t value) {
+#if defined(__GNUC__)
+  return __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return 63 - static_cast<int>(index);
+#else
+  int count = 0;
+  for (uint64_t bit = 1ULL << 63; !(value & bit); bit >>= 1)
+    ++count;
+  return count;
+#endif
+}
+
+// Loads up to 8 bytes so that the first pixel becomes the highest bit.
+static MUSTINLINE uint64_t LoadPixelWord(const uint8_t *p, int num_bytes) {
+  uint64_t word = 0;
+  if (num_bytes == 8) {
+    for (int i = 0; i < 8; ++i)
+      word |= static_cast<uint64_t>(p[i]) << (56 - 8 * i);
+  } else {
+    for (int i = 0; i < num_bytes; ++i)
+      word |= static_cast<uint64_t>(p[i]) << (56 - 8 * i);
+  }
+  return word;
+}
+
+// Appends the runs of set pixels of a bit line. Each word of 64 pixels costs
+// one count-leading-zeros per run boundary, so empty and full words are
+// skipped at once.
+static void ExtractRuns(
+    std::vector<PixelRun> *p_runs,
+    const uint8_t         *p_line,
+    int                    width,
+    int                    y) {
+  const int num_bytes = (width + 7) >> 3;
+  bool inside = false;
+  PixelRun run = {0, 0, y};
+  for (int byte = 0; byte < num_bytes; byte += 8) {
+    const int bits = std::min(64, width - (byte << 3));
+    uint64_t word = LoadPixelWord(p_line + byte, std::min(8, num_bytes - byte));
+    if (bits < 64)
+      word &= ~(~0ULL >> bits);
+    int pos = 0;
+    while (pos < bits) {
+      // Bits past the width are clear in word and set in ~word, so looking
+      // for the end of a run stops at the width at the latest.
+      uint64_t rest = (inside ? ~word : word) << pos;
+      if (!rest)
+        break;
+      pos += CountLeadingZeros64(rest);
+      if (pos >= bits)
+        break;
+      if (inside) {
+        run.x_end = (byte << 3) + pos;
+        p_runs->push_back(run);
+      } else {
+        run.x_begin = (byte << 3) + pos;
+      }
+      inside = !inside;
+    }
+  }
+  if (inside) {
+    run.x_end = width;
+    p_runs->push_back(run);
+  }
+}
+
+static MUSTINLINE int32_t FindRoot(int32_t *p_parents, int32_t i) {
+  while (p_parents[i] != i) {
+    p_parents[i] = p_parents[p_parents[i]];
+    i = p_parents[i];
+  }
+  return i;
+}
+
+// Merges the sets of two runs. The smaller index becomes the root, so the
+// root of a component is always its first run in the raster order.
+static MUSTINLINE void UniteRuns(int32_t *p_parents, int32_t a, int32_t b) {
+  a = FindRoot(p_parents, a);
+  b = FindRoot(p_parents, b);
+  if (a < b)
+    p_parents[b] = a;
+  else if (b < a)
+    p_parents[a] = b;
+}
+
+// Unites the runs of a line [cur_begin, cur_end) with the touching runs of
+// the previous line [prev_begin, prev_end). Runs touch if they overlap or,
+// for 8-connectivity, if they are diagonal neighbours.
+static void UniteAdjacentLines(
+    int32_t        *p_parents,
+    const PixelRun *p_runs,
+    int             prev_begin,
+    int             prev_end,
+    int             cur_begin,
+    int             cur_end,
+    int             reach) {
+  int i = prev_begin;
+  for (int j = cur_begin; j < cur_end; ++j) {
+    while (i < prev_end && p_runs[i].x_end + reach <= p_runs[j].x_begin)
+      ++i;
+    for (int k = i; k < prev_end &&
+                    p_runs[k].x_begin < p_runs[j].x_end + reach; ++k)
+      UniteRuns(p_parents, k, j);
+  }
+}
+
+MINIMGAPI_API int LabelMinImageComponents(
+    const MinImg       *p_label_image,
+    MinImgComponent    *p_components,
+    int                 max_components,
+    int                *p_num_components,
+    const MinImg       *p_src_image,
+    ConnectivityOption  connectivity) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_LabelMinImageComponents);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_num_components || (p_components && max_components < 0))
+    return BAD_ARGS;
+  if (connectivity != CN_4 && connectivity != CN_8)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_GetMinImageType(p_src_image) != TYP_UINT1 ||
+      p_src_image->channels != 1)
+    return BAD_ARGS;
+  if (p_label_image) {
+    PROPAGATE_ERROR(_AssureMinImageIsValid(p_label_image));
+    if (_CompareMinImage2DSizes(p_label_image, p_src_image) ||
+        _GetMinImageType(p_label_image) != TYP_INT32 ||
+        p_label_image->channels != 1)
+      return BAD_ARGS;
+    if (p_label_image->addressSpace != 0)
+      return NOT_IMPLEMENTED;
+  }
+  *p_num_components = 0;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int reach = connectivity == CN_8 ? 1 : 0;
+  const int num_bands = ChooseThreadCount(height,
+                            static_cast<int64_t>(width) * height / 8);
+
+  // Runs of each band of lines are extracted in parallel.
+  std::vector<std::vector<PixelRun> > band_runs(num_bands);
+  std::vector<int> line_ends(height);
+#pragma omp parallel for num_threads(num_bands)
+  for (int band = 0; band < num_bands; ++band) {
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_bands);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_bands);
+    for (int y = y_begin; y < y_end; ++y) {
+      ExtractRuns(&band_runs[band], _GetMinImageLine(p_src_image, y), width,
+                  y);
+      line_ends[y] = static_cast<int>(band_runs[band].size());
+    }
+  }
+
+  std::vector<int> band_offsets(num_bands + 1, 0);
+  for (int band = 0; band < num_bands; ++band)
+    band_offsets[band + 1] = band_offsets[band] +
+                             static_cast<int>(band_runs[band].size());
+  const int num_runs = band_offsets[num_bands];
+  std::vector<PixelRun> runs(num_runs);
+  std::vector<int> line_begins(height + 1);
+  for (int band = 0; band < num_bands; ++band) {
+    if (!band_runs[band].empty())
+      ::memcpy(&runs[band_offsets[band]], &band_runs[band][0],
+               band_runs[band].size() * sizeof(PixelRun));
+    std::vector<PixelRun>().swap(band_runs[band]);
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_bands);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_bands);
+    for (int y = y_begin; y < y_end; ++y)
+      line_begins[y + 1] = band_offsets[band] + line_ends[y];
+    line_begins[y_begin] = band_offsets[band];
+  }
+  if (num_runs == 0) {
+    for (int y = 0; p_label_image && y < height; ++y)
+      ::memset(_GetMinImageLine(p_label_image, y), 0, width * sizeof(int32_t));
+    return NO_ERRORS;
+  }
+
+  // Bands are united inside in parallel and then along their boundaries.
+  std::vector<int32_t> parents(num_runs);
+  for (int i = 0; i < num_runs; ++i)
+    parents[i] = i;
+#pragma omp parallel for num_threads(num_bands)
+  for (int band = 0; band < num_bands; ++band) {
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_bands);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_bands);
+    for (int y = y_begin + 1; y < y_end; ++y)
+      UniteAdjacentLines(&parents[0], &runs[0], line_begins[y - 1],
+                         line_begins[y], line_begins[y], line_begins[y + 1],
+                         reach);
+  }
+  for (int band = 1; band < num_bands; ++band) {
+    int y = static_cast<int>(static_cast<int64_t>(height) * band / num_bands);
+    if (y > 0)
+      UniteAdjacentLines(&parents[0], &runs[0], line_begins[y - 1],
+                         line_begins[y], line_begins[y], line_begins[y + 1],
+                         reach);
+  }
+
+  // Roots are the first runs of their components, so numbering them in the
+  // run order gives the raster order of components.
+  std::vector<int32_t> labels(num_runs);
+  int num_components = 0;
+  for (int i = 0; i < num_runs; ++i) {
+    int32_t root = FindRoot(&parents[0], i);
+    labels[i] = root == i ? ++num_components : labels[root];
+  }
+  *p_num_components = num_components;
+
+  if (p_components && max_components > 0) {
+    const int num_described = std::min(num_components, max_components);
+    std::vector<int64_t> sums(2 * num_described, 0);
+    std::vector<int32_t> x_max(num_described), y_max(num_described);
+    for (int n = 0; n < num_described; ++n) {
+      p_components[n].bounds.x = width;
+      p_components[n].bounds.y = height;
+      p_components[n].area = 0;
+      x_max[n] = y_max[n] = 0;
+    }
+    for (int i = 0; i < num_runs; ++i) {
+      const int n = labels[i] - 1;
+      if (n >= num_described)
+        continue;
+      const PixelRun &run = runs[i];
+      const int len = run.x_end - run.x_begin;
+      MinImgComponent &component = p_components[n];
+      component.area += len;
+      component.bounds.x = std::min(component.bounds.x, run.x_begin);
+      component.bounds.y = std::min(component.bounds.y, run.y);
+      x_max[n] = std::max(x_max[n], run.x_end);
+      y_max[n] = std::max(y_max[n], run.y + 1);
+      sums[2 * n] += static_cast<int64_t>(run.x_begin + run.x_end - 1) * len;
+      sums[2 * n + 1] += static_cast<int64_t>(run.y) * len;
+    }
+    for (int n = 0; n < num_described; ++n) {
+      MinImgComponent &component = p_components[n];
+      component.bounds.width = x_max[n] - component.bounds.x;
+      component.bounds.height = y_max[n] - component.bounds.y;
+      component.centroid_x = sums[2 * n] / (2.0 * component.area);
+      component.centroid_y = static_cast<double>(sums[2 * n + 1]) /
+                             component.area;
+    }
+  }
+
+  if (p_label_image) {
+#pragma omp parallel for num_threads(num_bands)
+    for (int y = 0; y < height; ++y) {
+      int32_t *p_line = reinterpret_cast<int32_t *>(
+                            _GetMinImageLine(p_label_image, y));
+      ::memset(p_line, 0, width * sizeof(int32_t));
+      for (int i = line_begins[y]; i < line_begins[y + 1]; ++i)
+        std::fill(p_line + runs[i].x_begin, p_line + runs[i].x_end,
+                  labels[i]);
+    }
+  }
+
+  return NO_ERRORS;
+}
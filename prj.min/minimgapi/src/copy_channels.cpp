@@ -37,6 +37,11 @@ either expressed or implied, of copyright holders.
 #include <minutils/smartptr.h>
 #include "vector/copy_channels-inl.h"
 
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_CopyMinImageChannels, "CopyMinImageChannels");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
 template <typename TChannel>
 static int DeinterleaveMinImage43(
     const MinImg *p_dst_image,
@@ -88,6 +93,9 @@ MINIMGAPI_API int CopyMinImageChannels(
     const int    *p_dst_channels,
     const int    *p_src_channels,
     int           num_channels) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImageChannels);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (!p_dst_channels || !p_src_channels || num_channels < 0)
     return BAD_ARGS;
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
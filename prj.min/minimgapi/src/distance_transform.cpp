@@ -0,0 +1,208 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_DistanceTransformMinImage,
+                     "DistanceTransformMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Sweeps the columns [x_begin, x_end) down and up, so that each element of
+// p_dist gets the distance to the nearest zero pixel of its column, or
+// infinity if there is none. Both sweeps go along lines to keep the memory
+// access sequential.
+template <typename SrcType>
+static void ComputeColumnDistances(
+    int32_t      *p_dist,
+    const MinImg *p_src_image,
+    int           x_begin,
+    int           x_end,
+    int32_t       infinity) {
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  int32_t *p_prev = NULL;
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *p_src = _GetMinImageLine(p_src_image, y);
+    int32_t *p_line = p_dist + static_cast<size_t>(y) * width;
+    for (int x = x_begin; x < x_end; ++x) {
+      bool set = SrcType::IsSet(p_src, x);
+      p_line[x] = !set ? 0 : p_prev ? std::min(p_prev[x] + 1, infinity)
+                                    : infinity;
+    }
+    p_prev = p_line;
+  }
+  for (int y = height - 2; y >= 0; --y) {
+    int32_t *p_line = p_dist + static_cast<size_t>(y) * width;
+    const int32_t *p_next = p_line + width;
+    for (int x = x_begin; x < x_end; ++x)
+      p_line[x] = std::min(p_line[x], p_next[x] + 1);
+  }
+}
+
+struct BitPixels {
+  static MUSTINLINE bool IsSet(const uint8_t *p_line, int x) {
+    return GET_IMAGE_LINE_BIT(p_line, x) != 0;
+  }
+};
+
+struct BytePixels {
+  static MUSTINLINE bool IsSet(const uint8_t *p_line, int x) {
+    return p_line[x] != 0;
+  }
+};
+
+// Computes squared distances of a line as the lower envelope of parabolas
+// (x - q)^2 + f(q), where f(q) is the squared column distance. p_vertices and
+// p_bounds need width and width + 1 elements.
+static void ComputeLineDistances(
+    double        *p_sqr_dist,
+    const int32_t *p_column_dist,
+    int            width,
+    int           *p_vertices,
+    double        *p_bounds) {
+  int k = 0;
+  p_vertices[0] = 0;
+  p_bounds[0] = -std::numeric_limits<double>::infinity();
+  p_bounds[1] = std::numeric_limits<double>::infinity();
+  for (int q = 1; q < width; ++q) {
+    const double f_q = static_cast<double>(p_column_dist[q]) *
+                       p_column_dist[q] + static_cast<double>(q) * q;
+    double s = 0;
+    for (;;) {
+      const int v = p_vertices[k];
+      const double f_v = static_cast<double>(p_column_dist[v]) *
+                         p_column_dist[v] + static_cast<double>(v) * v;
+      s = (f_q - f_v) / (2.0 * (q - v));
+      if (s > p_bounds[k])
+        break;
+      --k;
+    }
+    ++k;
+    p_vertices[k] = q;
+    p_bounds[k] = s;
+    p_bounds[k + 1] = std::numeric_limits<double>::infinity();
+  }
+  k = 0;
+  for (int q = 0; q < width; ++q) {
+    while (p_bounds[k + 1] < q)
+      ++k;
+    const int v = p_vertices[k];
+    p_sqr_dist[q] = static_cast<double>(q - v) * (q - v) +
+                    static_cast<double>(p_column_dist[v]) * p_column_dist[v];
+  }
+}
+
+MINIMGAPI_API int DistanceTransformMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_DistanceTransformMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImage2DSizes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  const int src_type = _GetMinImageType(p_src_image);
+  const int dst_type = _GetMinImageType(p_dst_image);
+  if (p_src_image->channels != 1 || p_dst_image->channels != 1 ||
+      (src_type != TYP_UINT1 && src_type != TYP_UINT8) ||
+      (dst_type != TYP_REAL32 && dst_type != TYP_UINT16))
+    return BAD_ARGS;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_src_image->addressSpace != 0 || p_dst_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  // Any finite squared distance is less than (width + height)^2, so this
+  // value marks columns without zero pixels and never overflows.
+  const int32_t infinity = width + height;
+  const double sqr_infinity = static_cast<double>(infinity) * infinity;
+  const int64_t num_pixels = static_cast<int64_t>(width) * height;
+  scoped_cpp_array<int32_t> column_dist(new int32_t[num_pixels]);
+
+  // Columns are split into groups of whole cache lines.
+  const int num_groups = (width + 15) / 16;
+  const int num_col_threads = ChooseThreadCount(num_groups, num_pixels);
+#pragma omp parallel for num_threads(num_col_threads)
+  for (int i = 0; i < num_col_threads; ++i) {
+    int x_begin = std::min(width, num_groups * i / num_col_threads * 16);
+    int x_end = std::min(width, num_groups * (i + 1) / num_col_threads * 16);
+    if (src_type == TYP_UINT1)
+      ComputeColumnDistances<BitPixels>(column_dist, p_src_image,
+                                        x_begin, x_end, infinity);
+    else
+      ComputeColumnDistances<BytePixels>(column_dist, p_src_image,
+                                         x_begin, x_end, infinity);
+  }
+
+  const int num_row_threads = ChooseThreadCount(height, num_pixels);
+  scoped_cpp_array<int> vertices(new int[num_row_threads * width]);
+  scoped_cpp_array<double> buffers(
+      new double[num_row_threads * (2 * width + 1)]);
+#pragma omp parallel for num_threads(num_row_threads)
+  for (int y = 0; y < height; ++y) {
+    const int thread = GetThreadNumber();
+    double *p_sqr_dist = buffers + thread * (2 * width + 1);
+    ComputeLineDistances(p_sqr_dist,
+                         column_dist + static_cast<size_t>(y) * width,
+                         width, vertices + thread * width,
+                         p_sqr_dist + width);
+    uint8_t *p_dst = _GetMinImageLine(p_dst_image, y);
+    if (dst_type == TYP_REAL32) {
+      real32_t *p_line = reinterpret_cast<real32_t *>(p_dst);
+      for (int x = 0; x < width; ++x)
+        p_line[x] = p_sqr_dist[x] >= sqr_infinity ?
+                    std::numeric_limits<real32_t>::infinity() :
+                    static_cast<real32_t>(std::sqrt(p_sqr_dist[x]));
+    } else {
+      uint16_t *p_line = reinterpret_cast<uint16_t *>(p_dst);
+      for (int x = 0; x < width; ++x)
+        p_line[x] = p_sqr_dist[x] >= sqr_infinity ? 0xFFFF :
+                    static_cast<uint16_t>(std::min(65535.0,
+                        std::floor(std::sqrt(p_sqr_dist[x]) + 0.5)));
+    }
+  }
+
+  return NO_ERRORS;
+}
@@ -0,0 +1,271 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#include "fft.h"
+
+// Guards the plan cache. Each transform takes the lock once for a map lookup,
+// and only the first transform of a size also builds its twiddles under it,
+// so waiting threads spin briefly and an OS mutex would not pay off.
+class FftPlanLock {
+public:
+  FftPlanLock() {
+#if defined(_MSC_VER)
+    while (_InterlockedExchange(&flag, 1))
+      ;
+#else
+    while (__sync_lock_test_and_set(&flag, 1))
+      ;
+#endif
+  }
+  ~FftPlanLock() {
+#if defined(_MSC_VER)
+    _InterlockedExchange(&flag, 0);
+#else
+    __sync_lock_release(&flag);
+#endif
+  }
+
+private:
+  static volatile long flag;
+};
+
+volatile long FftPlanLock::flag = 0;
+
+const FftPlan *GetFftPlan(int size) {
+  if (size < 1 || (size & (size - 1)))
+    return NULL;
+  FftPlanLock lock;
+  // Elements of a map are never moved, so the returned pointers stay valid
+  // until the map is destroyed at exit.
+  static std::map<int, FftPlan> plans;
+  std::map<int, FftPlan>::iterator it = plans.find(size);
+  if (it != plans.end())
+    return &it->second;
+
+  FftPlan &plan = plans[size];
+  plan.size = size;
+  plan.bit_reversal.resize(size);
+  int bits = 0;
+  while ((1 << bits) < size)
+    ++bits;
+  for (int i = 0; i < size; ++i) {
+    int reversed = 0;
+    for (int b = 0; b < bits; ++b)
+      reversed |= ((i >> b) & 1) << (bits - 1 - b);
+    plan.bit_reversal[i] = reversed;
+  }
+  plan.twiddles.resize(size / 2);
+  for (int k = 0; k < size / 2; ++k)
+    plan.twiddles[k] = std::polar(1.0, -2 * M_PI * k / size);
+  return &plan;
+}
+
+int GetFftSize(int size) {
+  int fft_size = 1;
+  while (fft_size < size)
+    fft_size <<= 1;
+  return fft_size;
+}
+
+void TransformComplex(FftComplex *p_data, const FftPlan &plan, bool inverse) {
+  const int size = plan.size;
+  for (int i = 0; i < size; ++i) {
+    const int j = plan.bit_reversal[i];
+    if (i < j)
+      std::swap(p_data[i], p_data[j]);
+  }
+  // Products are written out, since std::complex multiplication checks for
+  // infinities on each call.
+  double *p = reinterpret_cast<double *>(p_data);
+  const double *p_twiddles = reinterpret_cast<const double *>(
+                                 &plan.twiddles[0]);
+  const double sign = inverse ? -1.0 : 1.0;
+  for (int len = 2; len <= size; len <<= 1) {
+    const int half = len >> 1;
+    const int step = size / len;
+    for (int start = 0; start < size; start += len) {
+      double *p_lo = p + 2 * start;
+      double *p_hi = p_lo + 2 * half;
+      for (int k = 0; k < half; ++k) {
+        const double w_re = p_twiddles[2 * k * step];
+        const double w_im = sign * p_twiddles[2 * k * step + 1];
+        const double v_re = p_hi[2 * k] * w_re - p_hi[2 * k + 1] * w_im;
+        const double v_im = p_hi[2 * k] * w_im + p_hi[2 * k + 1] * w_re;
+        p_hi[2 * k] = p_lo[2 * k] - v_re;
+        p_hi[2 * k + 1] = p_lo[2 * k + 1] - v_im;
+        p_lo[2 * k] += v_re;
+        p_lo[2 * k + 1] += v_im;
+      }
+    }
+  }
+}
+
+static MUSTINLINE FftComplex Multiply(const FftComplex &a,
+                                      const FftComplex &b) {
+  return FftComplex(a.real() * b.real() - a.imag() * b.imag(),
+                    a.real() * b.imag() + a.imag() * b.real());
+}
+
+// Multiplies by i.
+static MUSTINLINE FftComplex Rotate(const FftComplex &a) {
+  return FftComplex(-a.imag(), a.real());
+}
+
+// Transforms a real line of a power-of-two size (at least 2) into its
+// width / 2 + 1 spectrum values by a complex transform of half the size.
+static void TransformRealLine(
+    FftComplex    *p_spectrum,
+    const double  *p_line,
+    const FftPlan &half_plan,
+    const FftPlan &plan) {
+  const int half = half_plan.size;
+  for (int k = 0; k < half; ++k)
+    p_spectrum[k] = FftComplex(p_line[2 * k], p_line[2 * k + 1]);
+  TransformComplex(p_spectrum, half_plan, false);
+  const FftComplex z0 = p_spectrum[0];
+  p_spectrum[half] = FftComplex(z0.real() - z0.imag(), 0);
+  p_spectrum[0] = FftComplex(z0.real() + z0.imag(), 0);
+  for (int k = 1; k <= half / 2; ++k) {
+    const FftComplex a = p_spectrum[k];
+    const FftComplex b = std::conj(p_spectrum[half - k]);
+    const FftComplex even = 0.5 * (a + b);
+    const FftComplex odd = -0.5 * Rotate(a - b);
+    const FftComplex w = plan.twiddles[k];
+    const FftComplex rotated = Multiply(w, odd);
+    p_spectrum[k] = even + rotated;
+    // The mirrored bin uses W^(half - k) = -conj(W^k).
+    p_spectrum[half - k] = std::conj(even - rotated);
+  }
+}
+
+// Inverts TransformRealLine(), destroying the spectrum. The result is scaled
+// by half the size.
+static void InverseTransformRealLine(
+    double        *p_line,
+    FftComplex    *p_spectrum,
+    const FftPlan &half_plan,
+    const FftPlan &plan) {
+  const int half = half_plan.size;
+  const double x0 = p_spectrum[0].real(), xh = p_spectrum[half].real();
+  p_spectrum[0] = FftComplex(0.5 * (x0 + xh), 0.5 * (x0 - xh));
+  for (int k = 1; k <= half / 2; ++k) {
+    const FftComplex a = p_spectrum[k];
+    const FftComplex b = std::conj(p_spectrum[half - k]);
+    const FftComplex even = 0.5 * (a + b);
+    const FftComplex odd = Multiply(0.5 * (a - b),
+                                    std::conj(plan.twiddles[k]));
+    p_spectrum[k] = even + Rotate(odd);
+    p_spectrum[half - k] = std::conj(even - Rotate(odd));
+  }
+  TransformComplex(p_spectrum, half_plan, true);
+  for (int k = 0; k < half; ++k) {
+    p_line[2 * k] = p_spectrum[k].real();
+    p_line[2 * k + 1] = p_spectrum[k].imag();
+  }
+}
+
+/// The number of columns gathered at once, so that each line is read by
+/// whole cache lines.
+const int FFT_COLUMN_BLOCK = 8;
+
+// Transforms all columns of a spectrum in place, a block of columns at a time
+// through a buffer.
+static void TransformColumns(
+    FftComplex *p_spectrum,
+    int         num_columns,
+    int         fft_height,
+    bool        inverse) {
+  const FftPlan &plan = *GetFftPlan(fft_height);
+  std::vector<FftComplex> buffer(FFT_COLUMN_BLOCK * fft_height);
+  for (int x_begin = 0; x_begin < num_columns; x_begin += FFT_COLUMN_BLOCK) {
+    const int count = std::min(FFT_COLUMN_BLOCK, num_columns - x_begin);
+    for (int y = 0; y < fft_height; ++y) {
+      const FftComplex *p_line = p_spectrum +
+                                 static_cast<size_t>(y) * num_columns + x_begin;
+      for (int i = 0; i < count; ++i)
+        buffer[i * fft_height + y] = p_line[i];
+    }
+    for (int i = 0; i < count; ++i)
+      TransformComplex(&buffer[i * fft_height], plan, inverse);
+    for (int y = 0; y < fft_height; ++y) {
+      FftComplex *p_line = p_spectrum + static_cast<size_t>(y) * num_columns +
+                           x_begin;
+      for (int i = 0; i < count; ++i)
+        p_line[i] = buffer[i * fft_height + y];
+    }
+  }
+}
+
+void TransformReal2D(
+    FftComplex   *p_spectrum,
+    const double *p_data,
+    int           data_stride,
+    int           width,
+    int           height,
+    int           fft_height) {
+  const FftPlan &plan = *GetFftPlan(width);
+  const FftPlan &half_plan = *GetFftPlan(width / 2);
+  const int num_columns = width / 2 + 1;
+  for (int y = 0; y < height; ++y)
+    TransformRealLine(p_spectrum + static_cast<size_t>(y) * num_columns,
+                      p_data + static_cast<size_t>(y) * data_stride,
+                      half_plan, plan);
+  std::fill(p_spectrum + static_cast<size_t>(height) * num_columns,
+            p_spectrum + static_cast<size_t>(fft_height) * num_columns,
+            FftComplex());
+  TransformColumns(p_spectrum, num_columns, fft_height, false);
+}
+
+void InverseTransformReal2D(
+    double     *p_data,
+    int         data_stride,
+    FftComplex *p_spectrum,
+    int         width,
+    int         height,
+    int         fft_height) {
+  const FftPlan &plan = *GetFftPlan(width);
+  const FftPlan &half_plan = *GetFftPlan(width / 2);
+  const int num_columns = width / 2 + 1;
+  TransformColumns(p_spectrum, num_columns, fft_height, true);
+  for (int y = 0; y < height; ++y)
+    InverseTransformRealLine(p_data + static_cast<size_t>(y) * data_stride,
+                             p_spectrum + static_cast<size_t>(y) * num_columns,
+                             half_plan, plan);
+}
@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef MINIMGAPI_FFT_H_INCLUDED
+#define MINIMGAPI_FFT_H_INCLUDED
+
+#include <complex>
+#include <vector>
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+typedef std::complex<double> FftComplex;
+
+/// Precomputed tables of a radix-2 transform of a power-of-two size.
+struct FftPlan {
+  int                     size;
+  std::vector<int>        bit_reversal;  ///< The input permutation.
+  std::vector<FftComplex> twiddles;      ///< exp(-2 pi i k / size), k < size/2.
+};
+
+/// Returns the plan of the given power-of-two size, or @c NULL if the size is
+/// not a power of two. Plans are created once and shared between threads.
+const FftPlan *GetFftPlan(int size);
+
+/// Returns the least power of two which is not less than @c size.
+int GetFftSize(int size);
+
+/// Transforms @c p_data of the plan size in place. The inverse transform is
+/// not scaled.
+void TransformComplex(FftComplex *p_data, const FftPlan &plan, bool inverse);
+
+/**
+ * @brief   Transforms real 2D data into the half spectrum.
+ * @details The data have @c height lines of @c width (a power of two)
+ *          elements with the given stride, and the rest of @c fft_height
+ *          lines are zero. The spectrum has @c fft_height lines of
+ *          <tt>width / 2 + 1</tt> elements. The transform runs on the
+ *          calling thread.
+ */
+void TransformReal2D(
+    FftComplex   *p_spectrum,
+    const double *p_data,
+    int           data_stride,
+    int           width,
+    int           height,
+    int           fft_height);
+
+/**
+ * @brief   Transforms the half spectrum back into the first @c height lines of
+ *          real 2D data, destroying the spectrum.
+ * @details The result is scaled by <tt>width * fft_height / 2</tt>.
+ */
+void InverseTransformReal2D(
+    double     *p_data,
+    int         data_stride,
+    FftComplex *p_spectrum,
+    int         width,
+    int         height,
+    int         fft_height);
+
+#endif // MINIMGAPI_FFT_H_INCLUDED
@@ -0,0 +1,446 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "parallel.h"
+#include "vector/gradient-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_GradientMinImage, "GradientMinImage");
+DECLARE_MINSTOPWATCH(gsw_GradientMagnitudeMinImage,
+                     "GradientMagnitudeMinImage");
+DECLARE_MINSTOPWATCH(gsw_CannyMinImage, "CannyMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+/// The weights of a separable 3x3 gradient operator.
+struct GradientWeights {
+  int side;
+  int center;
+};
+
+static int GetGradientWeights(GradientWeights *p_weights,
+                              GradientOption   kernel) {
+  switch (kernel) {
+  case GO_SOBEL:
+    p_weights->side = 1;
+    p_weights->center = 2;
+    return NO_ERRORS;
+  case GO_SCHARR:
+    p_weights->side = 3;
+    p_weights->center = 10;
+    return NO_ERRORS;
+  default:
+    return BAD_ARGS;
+  }
+}
+
+/// The source lines and buffers used to differentiate one line.
+struct GradientContext {
+  const MinImg   *p_src_image;
+  GradientWeights weights;
+  BorderOption    border;
+  uint8_t         canvas;
+  const uint8_t  *p_canvas_line;  ///< A line filled with the canvas value.
+};
+
+// Computes the derivatives of line y. p_smooth and p_diff need width + 2
+// elements each.
+static void ComputeGradientLine(
+    int16_t               *p_dx,
+    int16_t               *p_dy,
+    int16_t               *p_smooth,
+    int16_t               *p_diff,
+    const GradientContext &context,
+    int                    y) {
+  const MinImg *p_src_image = context.p_src_image;
+  const int width = p_src_image->width;
+  const int side = context.weights.side;
+  const int center = context.weights.center;
+  void *p_canvas = const_cast<uint8_t *>(context.p_canvas_line);
+  const uint8_t *p_above = _GetMinImageLine(p_src_image, y - 1,
+                                            context.border, p_canvas);
+  const uint8_t *p_line = _GetMinImageLine(p_src_image, y);
+  const uint8_t *p_below = _GetMinImageLine(p_src_image, y + 1,
+                                            context.border, p_canvas);
+  ComputeGradientColumns(p_smooth + 1, p_diff + 1, p_above, p_line, p_below,
+                         side, center, width);
+  if (context.border == BO_CONSTANT) {
+    p_smooth[0] = p_smooth[width + 1] =
+        static_cast<int16_t>((2 * side + center) * context.canvas);
+    p_diff[0] = p_diff[width + 1] = 0;
+  } else {
+    const int left = context.border == BO_CYCLIC ? width : 1;
+    const int right = context.border == BO_CYCLIC ? 1 : width;
+    p_smooth[0] = p_smooth[left];
+    p_diff[0] = p_diff[left];
+    p_smooth[width + 1] = p_smooth[right];
+    p_diff[width + 1] = p_diff[right];
+  }
+  ComputeGradientRows(p_dx, p_dy, p_smooth + 1, p_diff + 1, side, center,
+                      width);
+}
+
+static int CheckGradientSource(
+    const MinImg *p_src_image,
+    BorderOption  border,
+    const void   *p_canvas) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (p_src_image->channels != 1 ||
+      _GetMinImageType(p_src_image) != TYP_UINT8)
+    return BAD_ARGS;
+  if (border == BO_CONSTANT && !p_canvas)
+    return BAD_ARGS;
+  if (border == BO_IGNORE)
+    return NOT_SUPPORTED;
+  if (border == BO_VOID)
+    return NOT_IMPLEMENTED;
+  return NO_ERRORS;
+}
+
+static int CheckDerivativeImage(
+    const MinImg *p_image,
+    const MinImg *p_src_image,
+    int           type) {
+  if (!p_image)
+    return NO_ERRORS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (_CompareMinImage2DSizes(p_image, p_src_image) ||
+      p_image->channels != 1 || _GetMinImageType(p_image) != type)
+    return BAD_ARGS;
+  if (p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GradientMinImage(
+    const MinImg   *p_dx_image,
+    const MinImg   *p_dy_image,
+    const MinImg   *p_src_image,
+    GradientOption  kernel,
+    BorderOption    border,
+    const void     *p_canvas) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GradientMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  GradientContext context;
+  PROPAGATE_ERROR(GetGradientWeights(&context.weights, kernel));
+  PROPAGATE_ERROR(CheckGradientSource(p_src_image, border, p_canvas));
+  if (!p_dx_image && !p_dy_image)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(CheckDerivativeImage(p_dx_image, p_src_image, TYP_INT16));
+  PROPAGATE_ERROR(CheckDerivativeImage(p_dy_image, p_src_image, TYP_INT16));
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  context.p_src_image = p_src_image;
+  context.border = border;
+  context.canvas = p_canvas ? *reinterpret_cast<const uint8_t *>(p_canvas) : 0;
+  std::vector<uint8_t> canvas_line(width, context.canvas);
+  context.p_canvas_line = &canvas_line[0];
+
+  // Each thread needs the vertical parts and a spare derivative line.
+  const int buffer_size = 3 * (width + 2);
+  const int num_threads = ChooseThreadCount(height,
+                              static_cast<int64_t>(width) * height);
+  scoped_cpp_array<int16_t> buffers(new int16_t[num_threads * buffer_size]);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    int16_t *p_buffer = buffers + GetThreadNumber() * buffer_size;
+    int16_t *p_spare = p_buffer + 2 * (width + 2);
+    int16_t *p_dx = p_dx_image ? reinterpret_cast<int16_t *>(
+                        _GetMinImageLine(p_dx_image, y)) : p_spare;
+    int16_t *p_dy = p_dy_image ? reinterpret_cast<int16_t *>(
+                        _GetMinImageLine(p_dy_image, y)) : p_spare;
+    ComputeGradientLine(p_dx, p_dy, p_buffer, p_buffer + width + 2, context,
+                        y);
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GradientMagnitudeMinImage(
+    const MinImg *p_magnitude_image,
+    const MinImg *p_direction_image,
+    const MinImg *p_dx_image,
+    const MinImg *p_dy_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GradientMagnitudeMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dx_image));
+  if (!p_dx_image || !p_dy_image || (!p_magnitude_image && !p_direction_image))
+    return BAD_ARGS;
+  if (p_dx_image->channels != 1 || _GetMinImageType(p_dx_image) != TYP_INT16)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(CheckDerivativeImage(p_dy_image, p_dx_image, TYP_INT16));
+  const bool real_magnitude = p_magnitude_image &&
+      _GetMinImageType(p_magnitude_image) == TYP_REAL32;
+  PROPAGATE_ERROR(CheckDerivativeImage(p_magnitude_image, p_dx_image,
+                      real_magnitude ? TYP_REAL32 : TYP_UINT16));
+  PROPAGATE_ERROR(CheckDerivativeImage(p_direction_image, p_dx_image,
+                                       TYP_REAL32));
+  if (_AssureMinImageIsEmpty(p_dx_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dx_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int width = p_dx_image->width;
+  const int height = p_dx_image->height;
+  const int num_threads = ChooseThreadCount(height,
+                              static_cast<int64_t>(width) * height);
+  scoped_cpp_array<int32_t> buffers(new int32_t[num_threads * width]);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    const int16_t *p_dx = reinterpret_cast<const int16_t *>(
+                              _GetMinImageLine(p_dx_image, y));
+    const int16_t *p_dy = reinterpret_cast<const int16_t *>(
+                              _GetMinImageLine(p_dy_image, y));
+    if (p_magnitude_image) {
+      int32_t *p_squares = buffers + GetThreadNumber() * width;
+      ComputeSquaredMagnitudes(p_squares, p_dx, p_dy, width);
+      uint8_t *p_dst = _GetMinImageLine(p_magnitude_image, y);
+      if (real_magnitude) {
+        real32_t *p_line = reinterpret_cast<real32_t *>(p_dst);
+        for (int x = 0; x < width; ++x)
+          p_line[x] = std::sqrt(static_cast<real32_t>(p_squares[x]));
+      } else {
+        uint16_t *p_line = reinterpret_cast<uint16_t *>(p_dst);
+        for (int x = 0; x < width; ++x)
+          p_line[x] = static_cast<uint16_t>(
+                          std::sqrt(static_cast<real32_t>(p_squares[x])) +
+                          0.5f);
+      }
+    }
+    if (p_direction_image) {
+      real32_t *p_line = reinterpret_cast<real32_t *>(
+                             _GetMinImageLine(p_direction_image, y));
+      for (int x = 0; x < width; ++x)
+        p_line[x] = static_cast<real32_t>(std::atan2(
+                        static_cast<double>(p_dy[x]), p_dx[x]));
+    }
+  }
+
+  return NO_ERRORS;
+}
+
+// Values of the Canny edge map.
+enum {
+  CANNY_NONE      = 0,  ///< Not a local maximum or below the low threshold.
+  CANNY_CANDIDATE = 1,  ///< A local maximum between the thresholds.
+  CANNY_EDGE      = 2   ///< An edge pixel.
+};
+
+// Returns a squared threshold such that m > threshold iff m^2 > result.
+static int32_t SquareThreshold(double threshold) {
+  return static_cast<int32_t>(
+      std::min<double>(INT_MAX, std::floor(threshold * threshold)));
+}
+
+// Differentiates lines [y_begin, y_end) and suppresses non-maxima into the
+// edge map, where line y starts at p_map + (y + 1) * map_stride + 1. The
+// magnitude of each line is computed once and kept in a ring of three lines.
+static void SuppressNonMaxima(
+    std::vector<uint8_t *> *p_edges,
+    uint8_t                *p_map,
+    int                     map_stride,
+    const GradientContext  &context,
+    int                     y_begin,
+    int                     y_end,
+    int32_t                 low,
+    int32_t                 high) {
+  // tan(22.5 degrees) in Q15.
+  const int32_t TG22 = 13573;
+  const int width = context.p_src_image->width;
+  const int height = context.p_src_image->height;
+  const int line_size = width + 2;
+  std::vector<int16_t> buffer(8 * line_size);
+  std::vector<int32_t> magnitudes(3 * line_size, 0);
+  int16_t *p_smooth = &buffer[0];
+  int16_t *p_diff = p_smooth + line_size;
+  int16_t *p_dxs = p_diff + line_size;
+  int16_t *p_dys = p_dxs + 3 * line_size;
+
+  for (int y = y_begin - 1; y <= y_end; ++y) {
+    const int slot = (y + 3) % 3;
+    int32_t *p_magnitude = &magnitudes[slot * line_size];
+    int16_t *p_dx = p_dxs + slot * line_size;
+    int16_t *p_dy = p_dys + slot * line_size;
+    if (y >= 0 && y < height) {
+      ComputeGradientLine(p_dx, p_dy, p_smooth, p_diff, context, y);
+      ComputeSquaredMagnitudes(p_magnitude + 1, p_dx, p_dy, width);
+    } else {
+      std::fill(p_magnitude, p_magnitude + line_size, 0);
+    }
+    if (y <= y_begin)
+      continue;
+
+    // Suppression of the line above the one just differentiated.
+    const int line = y - 1;
+    const int32_t *p_next = p_magnitude + 1;
+    const int32_t *p_cur = &magnitudes[((line + 3) % 3) * line_size] + 1;
+    const int32_t *p_prev = &magnitudes[((line + 2) % 3) * line_size] + 1;
+    p_dx = p_dxs + ((line + 3) % 3) * line_size;
+    p_dy = p_dys + ((line + 3) % 3) * line_size;
+    uint8_t *p_out = p_map + (line + 1) * map_stride + 1;
+    for (int x = 0; x < width; ++x) {
+      const int32_t m = p_cur[x];
+      p_out[x] = CANNY_NONE;
+      if (m <= low)
+        continue;
+      const int32_t ax = std::abs(p_dx[x]);
+      const int32_t ay = std::abs(p_dy[x]) << 15;
+      const int32_t tg22x = ax * TG22;
+      bool maximum;
+      if (ay < tg22x) {
+        maximum = m > p_cur[x - 1] && m >= p_cur[x + 1];
+      } else if (ay > tg22x + (ax << 16)) {
+        maximum = m > p_prev[x] && m >= p_next[x];
+      } else {
+        const int s = (p_dx[x] ^ p_dy[x]) < 0 ? -1 : 1;
+        maximum = m > p_prev[x - s] && m > p_next[x + s];
+      }
+      if (!maximum)
+        continue;
+      if (m > high) {
+        p_out[x] = CANNY_EDGE;
+        p_edges->push_back(p_out + x);
+      } else {
+        p_out[x] = CANNY_CANDIDATE;
+      }
+    }
+  }
+}
+
+MINIMGAPI_API int CannyMinImage(
+    const MinImg   *p_dst_image,
+    const MinImg   *p_src_image,
+    double          low_threshold,
+    double          high_threshold,
+    GradientOption  kernel) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CannyMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  GradientContext context;
+  PROPAGATE_ERROR(GetGradientWeights(&context.weights, kernel));
+  PROPAGATE_ERROR(CheckGradientSource(p_src_image, BO_REPEAT, NULL));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  if (!(low_threshold >= 0) || !(low_threshold <= high_threshold))
+    return BAD_ARGS;
+  const int dst_type = _GetMinImageType(p_dst_image);
+  if (dst_type != TYP_UINT1 && dst_type != TYP_UINT8)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(CheckDerivativeImage(p_dst_image, p_src_image, dst_type));
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  context.p_src_image = p_src_image;
+  context.border = BO_REPEAT;
+  context.canvas = 0;
+  context.p_canvas_line = NULL;
+  const int32_t low = SquareThreshold(low_threshold);
+  const int32_t high = SquareThreshold(high_threshold);
+
+  // The map has a frame of non-edges, so tracing needs no bound checks.
+  const int map_stride = width + 2;
+  scoped_cpp_array<uint8_t> map(
+      new uint8_t[static_cast<size_t>(map_stride) * (height + 2)]);
+  ::memset(map, CANNY_NONE, map_stride);
+  ::memset(map + static_cast<size_t>(map_stride) * (height + 1), CANNY_NONE,
+           map_stride);
+  for (int y = 1; y <= height; ++y)
+    map[y * map_stride] = map[y * map_stride + width + 1] = CANNY_NONE;
+
+  const int num_bands = ChooseThreadCount(height,
+                            static_cast<int64_t>(width) * height);
+  std::vector<std::vector<uint8_t *> > band_edges(num_bands);
+#pragma omp parallel for num_threads(num_bands)
+  for (int band = 0; band < num_bands; ++band)
+    SuppressNonMaxima(&band_edges[band], map, map_stride, context,
+        static_cast<int>(static_cast<int64_t>(height) * band / num_bands),
+        static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                         num_bands),
+        low, high);
+
+  // Hysteresis: candidates connected to edges become edges.
+  std::vector<uint8_t *> stack;
+  for (int band = 0; band < num_bands; ++band)
+    stack.insert(stack.end(), band_edges[band].begin(),
+                 band_edges[band].end());
+  const ptrdiff_t offsets[8] = {
+    -map_stride - 1, -map_stride, -map_stride + 1, -1, 1,
+    map_stride - 1, map_stride, map_stride + 1
+  };
+  while (!stack.empty()) {
+    uint8_t *p = stack.back();
+    stack.pop_back();
+    for (int i = 0; i < 8; ++i)
+      if (p[offsets[i]] == CANNY_CANDIDATE) {
+        p[offsets[i]] = CANNY_EDGE;
+        stack.push_back(p + offsets[i]);
+      }
+  }
+
+#pragma omp parallel for num_threads(num_bands)
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *p_edges = map + (y + 1) * map_stride + 1;
+    uint8_t *p_dst = _GetMinImageLine(p_dst_image, y);
+    if (dst_type == TYP_UINT8) {
+      for (int x = 0; x < width; ++x)
+        p_dst[x] = p_edges[x] == CANNY_EDGE ? 0xFF : 0;
+    } else {
+      ::memset(p_dst, 0, (width + 7) >> 3);
+      for (int x = 0; x < width; ++x)
+        if (p_edges[x] == CANNY_EDGE)
+          p_dst[x >> 3] |= static_cast<uint8_t>(0x80U >> (x & 7));
+    }
+  }
+
+  return NO_ERRORS;
+}
@@ -0,0 +1,351 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "hash.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_HashMinImage, "HashMinImage");
+DECLARE_MINSTOPWATCH(gsw_PerceptualHashMinImage, "PerceptualHashMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+static const uint64_t XXH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t XXH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t XXH_PRIME_3 = 0x165667B19E3779F9ULL;
+static const uint64_t XXH_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t XXH_PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+static MUSTINLINE uint64_t RotateLeft(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// The hash is defined over little-endian words, which all supported
+// platforms are.
+static MUSTINLINE uint64_t ReadWord64(const uint8_t *p) {
+  uint64_t word;
+  ::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+static MUSTINLINE uint32_t ReadWord32(const uint8_t *p) {
+  uint32_t word;
+  ::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+static MUSTINLINE uint64_t XxRound(uint64_t accumulator, uint64_t input) {
+  accumulator += input * XXH_PRIME_2;
+  return RotateLeft(accumulator, 31) * XXH_PRIME_1;
+}
+
+static MUSTINLINE uint64_t XxMergeRound(uint64_t hash, uint64_t accumulator) {
+  hash ^= XxRound(0, accumulator);
+  return hash * XXH_PRIME_1 + XXH_PRIME_4;
+}
+
+// Consumes the 32-byte stripes of p_data and returns the number of bytes
+// consumed.
+static MUSTINLINE size_t XxConsumeStripes(
+    uint64_t      *p_accumulators,
+    const uint8_t *p_data,
+    size_t         size) {
+  uint64_t v0 = p_accumulators[0];
+  uint64_t v1 = p_accumulators[1];
+  uint64_t v2 = p_accumulators[2];
+  uint64_t v3 = p_accumulators[3];
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    v0 = XxRound(v0, ReadWord64(p_data + i));
+    v1 = XxRound(v1, ReadWord64(p_data + i + 8));
+    v2 = XxRound(v2, ReadWord64(p_data + i + 16));
+    v3 = XxRound(v3, ReadWord64(p_data + i + 24));
+  }
+  p_accumulators[0] = v0;
+  p_accumulators[1] = v1;
+  p_accumulators[2] = v2;
+  p_accumulators[3] = v3;
+  return i;
+}
+
+XxHash64::XxHash64(uint64_t seed) : seed(seed), buffered(0), total_size(0) {
+  accumulators[0] = seed + XXH_PRIME_1 + XXH_PRIME_2;
+  accumulators[1] = seed + XXH_PRIME_2;
+  accumulators[2] = seed;
+  accumulators[3] = seed - XXH_PRIME_1;
+}
+
+void XxHash64::Update(const void *p_data, size_t size) {
+  const uint8_t *p_bytes = reinterpret_cast<const uint8_t *>(p_data);
+  total_size += size;
+  if (buffered + size < sizeof(buffer)) {
+    ::memcpy(buffer + buffered, p_bytes, size);
+    buffered += size;
+    return;
+  }
+  if (buffered) {
+    size_t fill = sizeof(buffer) - buffered;
+    ::memcpy(buffer + buffered, p_bytes, fill);
+    XxConsumeStripes(accumulators, buffer, sizeof(buffer));
+    p_bytes += fill;
+    size -= fill;
+    buffered = 0;
+  }
+  size_t consumed = XxConsumeStripes(accumulators, p_bytes, size);
+  buffered = size - consumed;
+  ::memcpy(buffer, p_bytes + consumed, buffered);
+}
+
+uint64_t XxHash64::Digest() const {
+  uint64_t hash = seed + XXH_PRIME_5;
+  if (total_size >= sizeof(buffer)) {
+    hash = RotateLeft(accumulators[0], 1) + RotateLeft(accumulators[1], 7) +
+           RotateLeft(accumulators[2], 12) + RotateLeft(accumulators[3], 18);
+    for (int i = 0; i < 4; ++i)
+      hash = XxMergeRound(hash, accumulators[i]);
+  }
+  hash += total_size;
+
+  size_t i = 0;
+  for (; i + 8 <= buffered; i += 8) {
+    hash ^= XxRound(0, ReadWord64(buffer + i));
+    hash = RotateLeft(hash, 27) * XXH_PRIME_1 + XXH_PRIME_4;
+  }
+  if (i + 4 <= buffered) {
+    hash ^= ReadWord32(buffer + i) * XXH_PRIME_1;
+    hash = RotateLeft(hash, 23) * XXH_PRIME_2 + XXH_PRIME_3;
+    i += 4;
+  }
+  for (; i < buffered; ++i) {
+    hash ^= buffer[i] * XXH_PRIME_5;
+    hash = RotateLeft(hash, 11) * XXH_PRIME_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= XXH_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= XXH_PRIME_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+MINIMGAPI_API int HashMinImage(
+    uint64_t     *p_hash,
+    const MinImg *p_image,
+    uint64_t      seed) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_HashMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_hash)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  const int type = _GetMinImageType(p_image);
+  const bool empty = _AssureMinImageIsEmpty(p_image) == NO_ERRORS;
+  if (!empty && p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  XxHash64 hasher(seed);
+  const int32_t header[4] = {p_image->width, p_image->height,
+                             p_image->channels, type};
+  hasher.Update(header, sizeof(header));
+  if (!empty) {
+    const int64_t bits = static_cast<int64_t>(p_image->width) *
+                         _GetMinImageBitsPerPixel(p_image);
+    const size_t full_bytes = static_cast<size_t>(bits >> 3);
+    const int tail_bits = static_cast<int>(bits & 7);
+    for (int y = 0; y < p_image->height; ++y) {
+      const uint8_t *p_line = _GetMinImageLine(p_image, y);
+      if (!p_line)
+        return INTERNAL_ERROR;
+      hasher.Update(p_line, full_bytes);
+      if (tail_bits) {
+        const uint8_t tail = static_cast<uint8_t>(p_line[full_bytes] &
+                                                  (0xFF00 >> tail_bits));
+        hasher.Update(&tail, 1);
+      }
+    }
+  }
+  *p_hash = hasher.Digest();
+  return NO_ERRORS;
+}
+
+/// The side of the thumbnail for PH_DCT.
+static const int DCT_HASH_SIZE = 32;
+/// The number of DCT frequencies per axis the bits are taken from; the lowest
+/// one (the mean along the axis) is skipped.
+static const int DCT_HASH_FREQUENCIES = 8;
+
+// Averages the channels of the image over the cells of a grid_width by
+// grid_height grid. A cell covers at least one pixel, so cells of images
+// smaller than the grid sample single pixels.
+template<typename T>
+static void ComputeThumbnail(
+    double       *p_thumbnail,
+    int           grid_width,
+    int           grid_height,
+    const MinImg *p_image) {
+  const int width = p_image->width;
+  const int height = p_image->height;
+  const int channels = p_image->channels;
+  scoped_cpp_array<int> x_bounds(new int[2 * grid_width]);
+  for (int gx = 0; gx < grid_width; ++gx) {
+    x_bounds[2 * gx] = std::min(width - 1,
+        static_cast<int>(static_cast<int64_t>(gx) * width / grid_width));
+    x_bounds[2 * gx + 1] = std::max(x_bounds[2 * gx] + 1,
+        static_cast<int>(static_cast<int64_t>(gx + 1) * width / grid_width));
+  }
+
+  const int num_threads = ChooseThreadCount(grid_height,
+      static_cast<int64_t>(width) * height * channels);
+#pragma omp parallel for num_threads(num_threads)
+  for (int gy = 0; gy < grid_height; ++gy) {
+    const int y_begin = std::min(height - 1,
+        static_cast<int>(static_cast<int64_t>(gy) * height / grid_height));
+    const int y_end = std::max(y_begin + 1,
+        static_cast<int>(static_cast<int64_t>(gy + 1) * height / grid_height));
+    double *p_row = p_thumbnail + gy * grid_width;
+    std::fill(p_row, p_row + grid_width, 0.0);
+    for (int y = y_begin; y < y_end; ++y) {
+      const T *p_line =
+          reinterpret_cast<const T *>(_GetMinImageLine(p_image, y));
+      for (int gx = 0; gx < grid_width; ++gx) {
+        double sum = 0.0;
+        for (int i = x_bounds[2 * gx] * channels;
+             i < x_bounds[2 * gx + 1] * channels; ++i)
+          sum += p_line[i];
+        p_row[gx] += sum;
+      }
+    }
+    for (int gx = 0; gx < grid_width; ++gx)
+      p_row[gx] /= static_cast<double>(y_end - y_begin) * channels *
+                   (x_bounds[2 * gx + 1] - x_bounds[2 * gx]);
+  }
+}
+
+// Sets a bit per pixel of a 9x8 thumbnail which is brighter than its left
+// neighbour.
+static uint64_t ComputeDifferenceHash(const double *p_thumbnail) {
+  uint64_t hash = 0;
+  for (int y = 0; y < 8; ++y)
+    for (int x = 0; x < 8; ++x)
+      hash = (hash << 1) |
+             (p_thumbnail[y * 9 + x] < p_thumbnail[y * 9 + x + 1] ? 1 : 0);
+  return hash;
+}
+
+// Takes the DCT-II frequencies [1, 8] along both axes of a 32x32 thumbnail
+// and sets a bit per frequency which is above their median. Only the needed
+// frequencies are computed, first along lines and then along columns.
+static uint64_t ComputeDctHash(const double *p_thumbnail) {
+  const int n = DCT_HASH_SIZE;
+  const int m = DCT_HASH_FREQUENCIES;
+  double cosines[m][DCT_HASH_SIZE];
+  for (int u = 0; u < m; ++u)
+    for (int x = 0; x < n; ++x)
+      cosines[u][x] = std::cos((2 * x + 1) * (u + 1) * M_PI / (2 * n));
+
+  double rows[DCT_HASH_SIZE][DCT_HASH_FREQUENCIES];
+  for (int y = 0; y < n; ++y)
+    for (int u = 0; u < m; ++u) {
+      double sum = 0.0;
+      for (int x = 0; x < n; ++x)
+        sum += p_thumbnail[y * n + x] * cosines[u][x];
+      rows[y][u] = sum;
+    }
+  double frequencies[DCT_HASH_FREQUENCIES * DCT_HASH_FREQUENCIES];
+  for (int v = 0; v < m; ++v)
+    for (int u = 0; u < m; ++u) {
+      double sum = 0.0;
+      for (int y = 0; y < n; ++y)
+        sum += rows[y][u] * cosines[v][y];
+      frequencies[v * m + u] = sum;
+    }
+
+  double sorted[DCT_HASH_FREQUENCIES * DCT_HASH_FREQUENCIES];
+  std::copy(frequencies, frequencies + m * m, sorted);
+  std::nth_element(sorted, sorted + m * m / 2, sorted + m * m);
+  const double upper = sorted[m * m / 2];
+  const double lower = *std::max_element(sorted, sorted + m * m / 2);
+  const double median = (lower + upper) / 2;
+  uint64_t hash = 0;
+  for (int i = 0; i < m * m; ++i)
+    hash = (hash << 1) | (frequencies[i] > median ? 1 : 0);
+  return hash;
+}
+
+MINIMGAPI_API int PerceptualHashMinImage(
+    uint64_t             *p_hash,
+    const MinImg         *p_image,
+    PerceptualHashOption  method) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_PerceptualHashMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_hash)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (method != PH_DIFFERENCE && method != PH_DCT)
+    return BAD_ARGS;
+  const int type = _GetMinImageType(p_image);
+  if (type != TYP_UINT8 && type != TYP_UINT16 && type != TYP_REAL32)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_image) == NO_ERRORS)
+    return NO_SENSE;
+  if (p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  const int grid_width = method == PH_DCT ? DCT_HASH_SIZE : 9;
+  const int grid_height = method == PH_DCT ? DCT_HASH_SIZE : 8;
+  double thumbnail[DCT_HASH_SIZE * DCT_HASH_SIZE];
+  switch (type) {
+  case TYP_UINT8:
+    ComputeThumbnail<uint8_t>(thumbnail, grid_width, grid_height, p_image);
+    break;
+  case TYP_UINT16:
+    ComputeThumbnail<uint16_t>(thumbnail, grid_width, grid_height, p_image);
+    break;
+  default:
+    ComputeThumbnail<real32_t>(thumbnail, grid_width, grid_height, p_image);
+    break;
+  }
+  *p_hash = method == PH_DCT ? ComputeDctHash(thumbnail) :
+                               ComputeDifferenceHash(thumbnail);
+  return NO_ERRORS;
+}
@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef MINIMGAPI_HASH_H_INCLUDED
+#define MINIMGAPI_HASH_H_INCLUDED
+
+#include <cstddef>
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/**
+ * @brief   Computes the XXH64 hash of a byte sequence fed by portions.
+ * @details The result does not depend on how the sequence is split between
+ *          calls of @c Update(). Four independent accumulators consume 32
+ *          bytes per round, so the hash runs at the memory speed without
+ *          vector instructions.
+ */
+class XxHash64 {
+public:
+  /// Constructor. Starts an empty sequence.
+  explicit XxHash64(uint64_t seed = 0);
+
+  /// Appends @c size bytes to the sequence.
+  void Update(const void *p_data, size_t size);
+  /// Returns the hash of the sequence appended so far.
+  uint64_t Digest() const;
+
+private:
+  uint64_t seed;             ///< The seed.
+  uint64_t accumulators[4];  ///< The lane accumulators.
+  uint8_t  buffer[32];       ///< The bytes of an incomplete round.
+  size_t   buffered;         ///< The number of bytes in the buffer.
+  uint64_t total_size;       ///< The length of the sequence.
+};
+
+#endif // MINIMGAPI_HASH_H_INCLUDED
@@ -0,0 +1,373 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "mask.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_ComputeMinImageHistogram, "ComputeMinImageHistogram");
+DECLARE_MINSTOPWATCH(gsw_ComputeMinImageStats, "ComputeMinImageStats");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+static MUSTINLINE bool IsMaskSet(
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            x) {
+  return bit_mask ? GET_IMAGE_LINE_BIT(p_mask_line, x) != 0 :
+                    p_mask_line[x] != 0;
+}
+
+// Counts values of a line into NumBanks interleaved sub-histograms, so that
+// increments of equal neighbouring values do not wait for each other.
+template<typename T, int NumBanks>
+static void AccumulateHistogramLine(
+    uint32_t      *p_banks,
+    int            bank_size,
+    int            bins,
+    const T       *p_line,
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            width,
+    int            channels) {
+  if (channels == 1 && !p_mask_line) {
+    int x = 0;
+    for (; x + NumBanks <= width; x += NumBanks)
+      for (int bank = 0; bank < NumBanks; ++bank)
+        ++p_banks[bank * bank_size + p_line[x + bank]];
+    for (; x < width; ++x)
+      ++p_banks[p_line[x]];
+    return;
+  }
+  for (int x = 0; x < width; ++x) {
+    if (p_mask_line && !IsMaskSet(p_mask_line, bit_mask, x))
+      continue;
+    uint32_t *p_bank = p_banks + (x % NumBanks) * bank_size;
+    const T *p_pixel = p_line + x * channels;
+    for (int c = 0; c < channels; ++c)
+      ++p_bank[c * bins + p_pixel[c]];
+  }
+}
+
+template<typename T, int NumBanks>
+static int ComputeHistogram(
+    uint32_t     *p_histogram,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image) {
+  const int bins = 1 << (sizeof(T) << 3);
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int channels = p_src_image->channels;
+  const int bank_size = channels * bins;
+  const int num_threads = ChooseThreadCount(height,
+                              static_cast<int64_t>(width) * channels * height);
+  const bool bit_mask = p_mask_image &&
+                        _GetMinImageType(p_mask_image) == TYP_UINT1;
+
+  const int partial_size = NumBanks * bank_size;
+  scoped_cpp_array<uint32_t> partials(
+      new uint32_t[static_cast<size_t>(num_threads) * partial_size]);
+  std::fill(&partials[0], &partials[0] +
+            static_cast<size_t>(num_threads) * partial_size, 0U);
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band) {
+    uint32_t *p_banks = &partials[static_cast<size_t>(band) * partial_size];
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_threads);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_threads);
+    for (int y = y_begin; y < y_end; ++y)
+      AccumulateHistogramLine<T, NumBanks>(p_banks, bank_size, bins,
+          reinterpret_cast<const T *>(_GetMinImageLine(p_src_image, y)),
+          p_mask_image ? _GetMinImageLine(p_mask_image, y) : NULL,
+          bit_mask, width, channels);
+  }
+
+  // Sub-histograms of all threads are merged in parallel by ranges of bins.
+  const int num_parts = num_threads * NumBanks;
+#pragma omp parallel for num_threads(num_threads)
+  for (int i = 0; i < bank_size; ++i) {
+    uint32_t count = 0;
+    for (int part = 0; part < num_parts; ++part)
+      count += partials[static_cast<size_t>(part) * bank_size + i];
+    p_histogram[i] = count;
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int ComputeMinImageHistogram(
+    uint32_t     *p_histogram,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ComputeMinImageHistogram);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_histogram)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_src_image));
+
+  int type = _GetMinImageType(p_src_image);
+  if (type != TYP_UINT8 && type != TYP_UINT16)
+    return NOT_IMPLEMENTED;
+  const int bins = type == TYP_UINT8 ? 0x100 : 0x10000;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS) {
+    ::memset(p_histogram, 0,
+             p_src_image->channels * bins * sizeof(*p_histogram));
+    return NO_ERRORS;
+  }
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  // 16-bit histograms are too sparse to suffer from store-to-load conflicts,
+  // and more banks would not fit the cache.
+  if (type == TYP_UINT8)
+    return ComputeHistogram<uint8_t, 4>(p_histogram, p_src_image, p_mask_image);
+  return ComputeHistogram<uint16_t, 1>(p_histogram, p_src_image, p_mask_image);
+}
+
+static int ComputeStatsByHistogram(
+    double       *p_min,
+    double       *p_max,
+    double       *p_mean,
+    double       *p_stddev,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image,
+    int           bins) {
+  const int channels = p_src_image->channels;
+  scoped_cpp_array<uint32_t> histogram(new uint32_t[channels * bins]);
+  PROPAGATE_ERROR(ComputeMinImageHistogram(&histogram[0], p_src_image,
+                                           p_mask_image));
+
+  for (int c = 0; c < channels; ++c) {
+    const uint32_t *p_hist = &histogram[c * bins];
+    int64_t count = 0, sum = 0;
+    int min = -1, max = -1;
+    for (int v = 0; v < bins; ++v) {
+      if (!p_hist[v])
+        continue;
+      if (min < 0)
+        min = v;
+      max = v;
+      count += p_hist[v];
+      sum += static_cast<int64_t>(v) * p_hist[v];
+    }
+    if (!count)
+      return NO_SENSE;
+    double mean = static_cast<double>(sum) / count;
+    double ssd = 0;
+    for (int v = min; v <= max; ++v)
+      ssd += p_hist[v] * (v - mean) * (v - mean);
+
+    if (p_min)
+      p_min[c] = min;
+    if (p_max)
+      p_max[c] = max;
+    if (p_mean)
+      p_mean[c] = mean;
+    if (p_stddev)
+      p_stddev[c] = std::sqrt(ssd / count);
+  }
+
+  return NO_ERRORS;
+}
+
+// Per-channel moments of a part of an image. Values are accumulated relative
+// to a shift close to the data to keep the variance from cancellation.
+struct ChannelMoments {
+  double  min;
+  double  max;
+  double  sum;
+  double  ssq;
+  int64_t count;
+};
+
+template<typename T>
+static void AccumulateMoments(
+    ChannelMoments *p_moments,
+    const double   *p_shifts,
+    const MinImg   *p_src_image,
+    const MinImg   *p_mask_image,
+    int             y_begin,
+    int             y_end) {
+  const int channels = p_src_image->channels;
+  const bool bit_mask = p_mask_image &&
+                        _GetMinImageType(p_mask_image) == TYP_UINT1;
+  for (int c = 0; c < channels; ++c) {
+    p_moments[c].min = std::numeric_limits<double>::infinity();
+    p_moments[c].max = -std::numeric_limits<double>::infinity();
+    p_moments[c].sum = p_moments[c].ssq = 0;
+    p_moments[c].count = 0;
+  }
+  for (int y = y_begin; y < y_end; ++y) {
+    const T *p_line = reinterpret_cast<const T *>(
+                                            _GetMinImageLine(p_src_image, y));
+    const uint8_t *p_mask_line = p_mask_image ?
+                                 _GetMinImageLine(p_mask_image, y) : NULL;
+    for (int x = 0; x < p_src_image->width; ++x) {
+      if (p_mask_line && !IsMaskSet(p_mask_line, bit_mask, x))
+        continue;
+      for (int c = 0; c < channels; ++c) {
+        double v = static_cast<double>(p_line[x * channels + c]);
+        ChannelMoments &m = p_moments[c];
+        m.min = std::min(m.min, v);
+        m.max = std::max(m.max, v);
+        v -= p_shifts[c];
+        m.sum += v;
+        m.ssq += v * v;
+        ++m.count;
+      }
+    }
+  }
+}
+
+template<typename T>
+static int ComputeStatsByMoments(
+    double       *p_min,
+    double       *p_max,
+    double       *p_mean,
+    double       *p_stddev,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image) {
+  const int channels = p_src_image->channels;
+  const int height = p_src_image->height;
+  const int num_threads = ChooseThreadCount(height,
+      static_cast<int64_t>(p_src_image->width) * channels * height);
+
+  scoped_cpp_array<double> shifts(new double[channels]);
+  const T *p_first = reinterpret_cast<const T *>(p_src_image->pScan0);
+  for (int c = 0; c < channels; ++c)
+    shifts[c] = static_cast<double>(p_first[c]);
+
+  scoped_cpp_array<ChannelMoments> moments(
+      new ChannelMoments[num_threads * channels]);
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band) {
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_threads);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_threads);
+    AccumulateMoments<T>(&moments[band * channels], &shifts[0], p_src_image,
+                         p_mask_image, y_begin, y_end);
+  }
+
+  for (int c = 0; c < channels; ++c) {
+    ChannelMoments total = moments[c];
+    for (int band = 1; band < num_threads; ++band) {
+      const ChannelMoments &m = moments[band * channels + c];
+      total.min = std::min(total.min, m.min);
+      total.max = std::max(total.max, m.max);
+      total.sum += m.sum;
+      total.ssq += m.ssq;
+      total.count += m.count;
+    }
+    if (!total.count)
+      return NO_SENSE;
+    double mean = total.sum / total.count;
+    if (p_min)
+      p_min[c] = total.min;
+    if (p_max)
+      p_max[c] = total.max;
+    if (p_mean)
+      p_mean[c] = shifts[c] + mean;
+    if (p_stddev)
+      p_stddev[c] = std::sqrt(std::max(0., total.ssq / total.count -
+                                           mean * mean));
+  }
+
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int ComputeMinImageStats(
+    double       *p_min,
+    double       *p_max,
+    double       *p_mean,
+    double       *p_stddev,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ComputeMinImageStats);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_src_image));
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_SENSE;
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  switch (_GetMinImageType(p_src_image)) {
+  case TYP_UINT8:
+    return ComputeStatsByHistogram(p_min, p_max, p_mean, p_stddev,
+                                   p_src_image, p_mask_image, 0x100);
+  case TYP_UINT16:
+    return ComputeStatsByHistogram(p_min, p_max, p_mean, p_stddev,
+                                   p_src_image, p_mask_image, 0x10000);
+  case TYP_INT8:
+    return ComputeStatsByMoments<int8_t>(p_min, p_max, p_mean, p_stddev,
+                                         p_src_image, p_mask_image);
+  case TYP_INT16:
+    return ComputeStatsByMoments<int16_t>(p_min, p_max, p_mean, p_stddev,
+                                          p_src_image, p_mask_image);
+  case TYP_UINT32:
+    return ComputeStatsByMoments<uint32_t>(p_min, p_max, p_mean, p_stddev,
+                                           p_src_image, p_mask_image);
+  case TYP_INT32:
+    return ComputeStatsByMoments<int32_t>(p_min, p_max, p_mean, p_stddev,
+                                          p_src_image, p_mask_image);
+  case TYP_UINT64:
+    return ComputeStatsByMoments<uint64_t>(p_min, p_max, p_mean, p_stddev,
+                                           p_src_image, p_mask_image);
+  case TYP_INT64:
+    return ComputeStatsByMoments<int64_t>(p_min, p_max, p_mean, p_stddev,
+                                          p_src_image, p_mask_image);
+  case TYP_REAL32:
+    return ComputeStatsByMoments<real32_t>(p_min, p_max, p_mean, p_stddev,
+                                           p_src_image, p_mask_image);
+  case TYP_REAL64:
+    return ComputeStatsByMoments<real64_t>(p_min, p_max, p_mean, p_stddev,
+                                           p_src_image, p_mask_image);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
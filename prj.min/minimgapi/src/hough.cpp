@@ -0,0 +1,423 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include "parallel.h"
+#include "vector/hough-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_HoughLinesMinImage, "HoughLinesMinImage");
+DECLARE_MINSTOPWATCH(gsw_HoughSegmentsMinImage, "HoughSegmentsMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+/// The layout of a Hough accumulator and its angle tables. Each angle has a
+/// line of rho cells framed by a cell on each side, and there is a framing
+/// line above and below, so peaks are found without bound checks.
+struct HoughSpace {
+  int                   num_angles;
+  int                   num_rhos;
+  int                   stride;      ///< The distance between angle lines.
+  int                   center;      ///< The rho cell of the origin.
+  double                rho_step;
+  double                theta_step;
+  std::vector<real32_t> cos_table;   ///< cos(theta) / rho_step.
+  std::vector<real32_t> sin_table;   ///< sin(theta) / rho_step.
+  std::vector<int32_t>  bases;       ///< The first rho cell of each angle.
+
+  size_t size() const {
+    return static_cast<size_t>(num_angles + 2) * stride;
+  }
+
+  /// Computes accumulator indices of a point for all angles.
+  void index(int32_t *p_indices, int x, int y) const {
+    ComputeHoughIndices(p_indices, &cos_table[0], &sin_table[0], &bases[0],
+                        static_cast<real32_t>(x), static_cast<real32_t>(y),
+                        center + 0.5f, num_angles);
+  }
+};
+
+static int InitHoughSpace(
+    HoughSpace *p_space,
+    int         width,
+    int         height,
+    double      rho_step,
+    double      theta_step) {
+  if (!(rho_step > 0) || !(theta_step > 0) || !(theta_step <= M_PI))
+    return BAD_ARGS;
+  // Rounding keeps |rho| / rho_step + 0.5 below center + 1, so the sum
+  // truncated by ComputeHoughIndices() is positive.
+  const double diagonal = std::sqrt(static_cast<double>(width) * width +
+                                    static_cast<double>(height) * height);
+  p_space->center = static_cast<int>(std::ceil(diagonal / rho_step)) + 1;
+  p_space->num_rhos = 2 * p_space->center + 1;
+  p_space->stride = p_space->num_rhos + 2;
+  p_space->num_angles = std::max(1, static_cast<int>(
+                                        std::floor(M_PI / theta_step + 0.5)));
+  p_space->rho_step = rho_step;
+  p_space->theta_step = theta_step;
+  p_space->cos_table.resize(p_space->num_angles);
+  p_space->sin_table.resize(p_space->num_angles);
+  p_space->bases.resize(p_space->num_angles);
+  for (int t = 0; t < p_space->num_angles; ++t) {
+    const double theta = t * theta_step;
+    p_space->cos_table[t] = static_cast<real32_t>(std::cos(theta) / rho_step);
+    p_space->sin_table[t] = static_cast<real32_t>(std::sin(theta) / rho_step);
+    p_space->bases[t] = (t + 1) * p_space->stride + 1;
+  }
+  return NO_ERRORS;
+}
+
+static int CheckHoughSource(const MinImg *p_src_image) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  const int type = _GetMinImageType(p_src_image);
+  if (p_src_image->channels != 1 || (type != TYP_UINT1 && type != TYP_UINT8))
+    return BAD_ARGS;
+  if (p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  return NO_ERRORS;
+}
+
+// Replaces p_xs by the x-coordinates of nonzero pixels of line y. Zero bytes
+// of bit images are skipped at once.
+static void CollectLinePoints(
+    std::vector<int> *p_xs,
+    const MinImg     *p_src_image,
+    int               y) {
+  const uint8_t *p_line = _GetMinImageLine(p_src_image, y);
+  const int width = p_src_image->width;
+  p_xs->clear();
+  if (p_src_image->channelDepth == 0) {
+    for (int i = 0; i < (width + 7) >> 3; ++i) {
+      if (!p_line[i])
+        continue;
+      for (int x = i << 3; x < std::min(width, (i + 1) << 3); ++x)
+        if (GET_IMAGE_LINE_BIT(p_line, x))
+          p_xs->push_back(x);
+    }
+  } else {
+    for (int x = 0; x < width; ++x)
+      if (p_line[x])
+        p_xs->push_back(x);
+  }
+}
+
+// Clips the line x cos(theta) + y sin(theta) = rho to the image and returns
+// the ends of the chord. A line passing within half a cell of the image but
+// missing it yields the nearest pixel.
+static void ClipHoughLine(
+    MinPoint *p_u,
+    MinPoint *p_v,
+    double    rho,
+    double    theta,
+    int       width,
+    int       height) {
+  const double c = std::cos(theta), s = std::sin(theta);
+  const double origin[2] = {rho * c, rho * s};
+  const double direction[2] = {-s, c};
+  const double limits[2] = {width - 1.0, height - 1.0};
+  double t_min = -HUGE_VAL, t_max = HUGE_VAL;
+  for (int axis = 0; axis < 2; ++axis) {
+    if (std::fabs(direction[axis]) < 1e-9) {
+      if (origin[axis] < 0 || origin[axis] > limits[axis])
+        t_min = t_max = 0;
+      continue;
+    }
+    double t1 = -origin[axis] / direction[axis];
+    double t2 = (limits[axis] - origin[axis]) / direction[axis];
+    if (t1 > t2)
+      std::swap(t1, t2);
+    t_min = std::max(t_min, t1);
+    t_max = std::min(t_max, t2);
+  }
+  if (t_min > t_max)
+    t_min = t_max = 0;
+  const double ends[2] = {t_min, t_max};
+  MinPoint *p_ends[2] = {p_u, p_v};
+  for (int i = 0; i < 2; ++i) {
+    const double x = origin[0] + ends[i] * direction[0];
+    const double y = origin[1] + ends[i] * direction[1];
+    *p_ends[i] = minPoint(
+        std::min(width - 1, std::max(0, static_cast<int>(
+                                            std::floor(x + 0.5)))),
+        std::min(height - 1, std::max(0, static_cast<int>(
+                                             std::floor(y + 0.5)))));
+  }
+}
+
+MINIMGAPI_API int HoughLinesMinImage(
+    MinBand      *p_lines,
+    int           max_lines,
+    int          *p_num_lines,
+    const MinImg *p_src_image,
+    double        rho_step,
+    double        theta_step,
+    int           threshold) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_HoughLinesMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_num_lines || (!p_lines && max_lines > 0) || max_lines < 0 ||
+      threshold < 1)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(CheckHoughSource(p_src_image));
+  *p_num_lines = 0;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  HoughSpace space;
+  PROPAGATE_ERROR(InitHoughSpace(&space, width, height, rho_step,
+                                 theta_step));
+
+  // Bands of lines vote into their own accumulators, which are summed.
+  const size_t size = space.size();
+  const int num_threads = ChooseThreadCount(height,
+      static_cast<int64_t>(width) * height * space.num_angles / 64);
+  std::vector<int32_t> accumulators(num_threads * size, 0);
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band) {
+    int32_t *p_accumulator = &accumulators[band * size];
+    std::vector<int> xs;
+    std::vector<int32_t> indices(space.num_angles);
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_threads);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_threads);
+    for (int y = y_begin; y < y_end; ++y) {
+      CollectLinePoints(&xs, p_src_image, y);
+      for (size_t i = 0; i < xs.size(); ++i) {
+        space.index(&indices[0], xs[i], y);
+        for (int t = 0; t < space.num_angles; ++t)
+          ++p_accumulator[indices[t]];
+      }
+    }
+  }
+  int32_t *p_accumulator = &accumulators[0];
+#pragma omp parallel for num_threads(num_threads)
+  for (int t = 0; t < space.num_angles; ++t)
+    for (int band = 1; band < num_threads; ++band)
+      AddAccumulator(p_accumulator + space.bases[t],
+                     &accumulators[band * size] + space.bases[t],
+                     space.num_rhos);
+
+  // Peaks are cells over the threshold which beat their four neighbours.
+  std::vector<std::pair<int32_t, int32_t> > peaks;
+  for (int t = 0; t < space.num_angles; ++t)
+    for (int r = 0; r < space.num_rhos; ++r) {
+      const int i = space.bases[t] + r;
+      const int32_t votes = p_accumulator[i];
+      if (votes >= threshold &&
+          votes > p_accumulator[i - 1] && votes >= p_accumulator[i + 1] &&
+          votes > p_accumulator[i - space.stride] &&
+          votes >= p_accumulator[i + space.stride])
+        peaks.push_back(std::make_pair(-votes, i));
+    }
+  std::sort(peaks.begin(), peaks.end());
+  *p_num_lines = static_cast<int>(peaks.size());
+
+  const int band_width = std::max(1, static_cast<int>(std::ceil(rho_step)));
+  const int num_written = std::min(max_lines, *p_num_lines);
+  for (int n = 0; n < num_written; ++n) {
+    const int t = peaks[n].second / space.stride - 1;
+    const int r = peaks[n].second % space.stride - 1;
+    MinPoint u, v;
+    ClipHoughLine(&u, &v, (r - space.center) * rho_step, t * theta_step,
+                  width, height);
+    p_lines[n] = minBand(u, v, band_width);
+  }
+
+  return NO_ERRORS;
+}
+
+/// Walks along a line in fixed point, one pixel per step along its major
+/// axis.
+struct HoughWalker {
+  static const int SHIFT = 16;
+
+  int  x0, y0;       ///< The start, fixed point along the minor axis.
+  int  dx, dy;       ///< The step, fixed point along the minor axis.
+  bool x_major;
+
+  HoughWalker(int x, int y, double theta) {
+    const double a = -std::sin(theta), b = std::cos(theta);
+    x_major = std::fabs(a) > std::fabs(b);
+    if (x_major) {
+      dx = a > 0 ? 1 : -1;
+      dy = static_cast<int>(std::floor(b * (1 << SHIFT) / std::fabs(a) + 0.5));
+      x0 = x;
+      y0 = (y << SHIFT) + (1 << (SHIFT - 1));
+    } else {
+      dy = b > 0 ? 1 : -1;
+      dx = static_cast<int>(std::floor(a * (1 << SHIFT) / std::fabs(b) + 0.5));
+      x0 = (x << SHIFT) + (1 << (SHIFT - 1));
+      y0 = y;
+    }
+  }
+
+  MUSTINLINE int pixel_x(int x) const { return x_major ? x : x >> SHIFT; }
+  MUSTINLINE int pixel_y(int y) const { return x_major ? y >> SHIFT : y; }
+};
+
+// States of pixels in the progressive transform.
+enum {
+  HOUGH_EMPTY   = 0,  ///< Not a point, or a point taken by a segment.
+  HOUGH_PENDING = 1,  ///< A point which has not voted yet.
+  HOUGH_VOTED   = 2   ///< A point whose votes are in the accumulator.
+};
+
+MINIMGAPI_API int HoughSegmentsMinImage(
+    MinLineSegment *p_segments,
+    int             max_segments,
+    int            *p_num_segments,
+    const MinImg   *p_src_image,
+    double          rho_step,
+    double          theta_step,
+    int             threshold,
+    int             min_length,
+    int             max_gap) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_HoughSegmentsMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_num_segments || (!p_segments && max_segments > 0) ||
+      max_segments < 0 || threshold < 1 || min_length < 0 || max_gap < 0)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(CheckHoughSource(p_src_image));
+  *p_num_segments = 0;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS || max_segments == 0)
+    return NO_ERRORS;
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  HoughSpace space;
+  PROPAGATE_ERROR(InitHoughSpace(&space, width, height, rho_step,
+                                 theta_step));
+
+  std::vector<uint8_t> states(static_cast<size_t>(width) * height,
+                              HOUGH_EMPTY);
+  std::vector<std::pair<int, int> > points;
+  std::vector<int> xs;
+  for (int y = 0; y < height; ++y) {
+    CollectLinePoints(&xs, p_src_image, y);
+    for (size_t i = 0; i < xs.size(); ++i) {
+      states[static_cast<size_t>(y) * width + xs[i]] = HOUGH_PENDING;
+      points.push_back(std::make_pair(xs[i], y));
+    }
+  }
+
+  std::vector<int32_t> accumulator(space.size(), 0);
+  std::vector<int32_t> indices(space.num_angles);
+  // A fixed seed makes the result reproducible.
+  uint32_t random = 0x9E3779B9U;
+  for (size_t count = points.size(); count > 0; --count) {
+    // Points are drawn at random without replacement.
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    const size_t k = random % count;
+    const int x = points[k].first, y = points[k].second;
+    points[k] = points[count - 1];
+    uint8_t &state = states[static_cast<size_t>(y) * width + x];
+    if (state != HOUGH_PENDING)
+      continue;
+    state = HOUGH_VOTED;
+
+    space.index(&indices[0], x, y);
+    int32_t max_votes = 0;
+    int best_angle = 0;
+    for (int t = 0; t < space.num_angles; ++t) {
+      const int32_t votes = ++accumulator[indices[t]];
+      if (votes > max_votes) {
+        max_votes = votes;
+        best_angle = t;
+      }
+    }
+    if (max_votes < threshold)
+      continue;
+
+    // Walks both ways from the point until the gap gets too long.
+    const HoughWalker walker(x, y, best_angle * theta_step);
+    MinPoint ends[2] = {minPoint(x, y), minPoint(x, y)};
+    for (int side = 0; side < 2; ++side) {
+      const int dx = side ? -walker.dx : walker.dx;
+      const int dy = side ? -walker.dy : walker.dy;
+      int gap = 0;
+      for (int wx = walker.x0, wy = walker.y0;; wx += dx, wy += dy) {
+        const int px = walker.pixel_x(wx), py = walker.pixel_y(wy);
+        if (px < 0 || px >= width || py < 0 || py >= height)
+          break;
+        if (states[static_cast<size_t>(py) * width + px] != HOUGH_EMPTY) {
+          gap = 0;
+          ends[side] = minPoint(px, py);
+        } else if (++gap > max_gap) {
+          break;
+        }
+      }
+    }
+    const bool good = std::abs(ends[1].x - ends[0].x) >= min_length ||
+                      std::abs(ends[1].y - ends[0].y) >= min_length;
+
+    // Takes the points of the segment and withdraws their votes.
+    for (int side = 0; side < 2; ++side) {
+      const int dx = side ? -walker.dx : walker.dx;
+      const int dy = side ? -walker.dy : walker.dy;
+      for (int wx = walker.x0, wy = walker.y0;; wx += dx, wy += dy) {
+        const int px = walker.pixel_x(wx), py = walker.pixel_y(wy);
+        uint8_t &taken = states[static_cast<size_t>(py) * width + px];
+        if (good && taken == HOUGH_VOTED) {
+          space.index(&indices[0], px, py);
+          for (int t = 0; t < space.num_angles; ++t)
+            --accumulator[indices[t]];
+        }
+        taken = HOUGH_EMPTY;
+        if (px == ends[side].x && py == ends[side].y)
+          break;
+      }
+    }
+
+    if (good) {
+      p_segments[(*p_num_segments)++] = minLineSegment(ends[1], ends[0]);
+      if (*p_num_segments == max_segments)
+        break;
+    }
+  }
+
+  return NO_ERRORS;
+}
@@ -0,0 +1,226 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "mask.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_ApplyLutMinImage, "ApplyLutMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Looks up len elements in the shared table. The loop is unrolled so that
+// independent loads of the table overlap.
+template<typename TSrc, typename TDst>
+static MUSTINLINE void ApplySharedLutLine(
+    TDst       *p_dst,
+    const TSrc *p_src,
+    const TDst *p_lut,
+    int         len) {
+  int i = 0;
+  for (; i + 4 <= len; i += 4) {
+    TDst v0 = p_lut[p_src[i]];
+    TDst v1 = p_lut[p_src[i + 1]];
+    TDst v2 = p_lut[p_src[i + 2]];
+    TDst v3 = p_lut[p_src[i + 3]];
+    p_dst[i] = v0;
+    p_dst[i + 1] = v1;
+    p_dst[i + 2] = v2;
+    p_dst[i + 3] = v3;
+  }
+  for (; i < len; ++i)
+    p_dst[i] = p_lut[p_src[i]];
+}
+
+// Looks up each channel of width pixels in its own table.
+template<typename TSrc, typename TDst>
+static MUSTINLINE void ApplyChannelLutsLine(
+    TDst       *p_dst,
+    const TSrc *p_src,
+    const TDst *p_luts,
+    int         bins,
+    int         width,
+    int         channels) {
+  if (channels == 3) {
+    const TDst *p_lut0 = p_luts;
+    const TDst *p_lut1 = p_luts + bins;
+    const TDst *p_lut2 = p_luts + 2 * bins;
+    for (int x = 0; x < 3 * width; x += 3) {
+      TDst v0 = p_lut0[p_src[x]];
+      TDst v1 = p_lut1[p_src[x + 1]];
+      TDst v2 = p_lut2[p_src[x + 2]];
+      p_dst[x] = v0;
+      p_dst[x + 1] = v1;
+      p_dst[x + 2] = v2;
+    }
+    return;
+  }
+  for (int x = 0; x < width * channels; x += channels)
+    for (int c = 0; c < channels; ++c)
+      p_dst[x + c] = p_luts[c * bins + p_src[x + c]];
+}
+
+template<typename TSrc, typename TDst>
+static int ApplyLut(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const void   *p_lut,
+    bool          per_channel,
+    const MinImg *p_mask_image,
+    bool          parallel) {
+  const int bins = 1 << (sizeof(TSrc) << 3);
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int channels = p_src_image->channels;
+  const TDst *p_table = reinterpret_cast<const TDst *>(p_lut);
+  const int num_threads = !parallel ? 1 : ChooseThreadCount(height,
+      static_cast<int64_t>(width) * channels * height);
+
+  // With a mask each thread maps rows into its own line buffer, which is then
+  // merged into the destination by the mask.
+  const bool bit_mask = p_mask_image &&
+                        _GetMinImageType(p_mask_image) == TYP_UINT1;
+  const int pixel_size = channels * static_cast<int>(sizeof(TDst));
+  const size_t line_size = static_cast<size_t>(width) * pixel_size;
+  scoped_cpp_array<uint8_t> lines(
+      p_mask_image ? new uint8_t[num_threads * line_size] : NULL);
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *p_mask_line = NULL;
+    TDst *p_dst = reinterpret_cast<TDst *>(_GetMinImageLine(p_dst_image, y));
+    if (p_mask_image) {
+      p_mask_line = _GetMinImageLine(p_mask_image, y);
+      if (IsMaskLineEmpty(p_mask_line, bit_mask, width))
+        continue;
+      p_dst = reinterpret_cast<TDst *>(lines + GetThreadNumber() * line_size);
+    }
+    const TSrc *p_src =
+        reinterpret_cast<const TSrc *>(_GetMinImageLine(p_src_image, y));
+    if (per_channel && channels > 1)
+      ApplyChannelLutsLine(p_dst, p_src, p_table, bins, width, channels);
+    else
+      ApplySharedLutLine(p_dst, p_src, p_table, width * channels);
+    if (p_mask_line)
+      CopyLineMasked(_GetMinImageLine(p_dst_image, y),
+                     reinterpret_cast<const uint8_t *>(p_dst), p_mask_line,
+                     bit_mask, width, pixel_size);
+  }
+  return NO_ERRORS;
+}
+
+template<typename TSrc>
+static int ApplyLutByDstDepth(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const void   *p_lut,
+    bool          per_channel,
+    const MinImg *p_mask_image,
+    bool          parallel) {
+  switch (p_dst_image->channelDepth) {
+  case 1:
+    return ApplyLut<TSrc, uint8_t>(p_dst_image, p_src_image, p_lut,
+                                   per_channel, p_mask_image, parallel);
+  case 2:
+    return ApplyLut<TSrc, uint16_t>(p_dst_image, p_src_image, p_lut,
+                                    per_channel, p_mask_image, parallel);
+  case 4:
+    return ApplyLut<TSrc, uint32_t>(p_dst_image, p_src_image, p_lut,
+                                    per_channel, p_mask_image, parallel);
+  case 8:
+    return ApplyLut<TSrc, uint64_t>(p_dst_image, p_src_image, p_lut,
+                                    per_channel, p_mask_image, parallel);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+MINIMGAPI_API int ApplyLutMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const void   *p_lut,
+    int           lut_channels,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ApplyLutMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_lut)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImage3DSizes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  if (lut_channels != 1 && lut_channels != p_src_image->channels)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_dst_image));
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  // Lines are mapped forward, element by element, so a source overlapping the
+  // destination is copied unless it lies ahead of it. With different depths
+  // the elements are written at other offsets than they are read from, so
+  // any overlap requires the copy.
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  DECLARE_GUARDED_MINIMG(buffer_image);
+  if ((~tangling & TCR_FORWARD_PASS_POSSIBLE) ||
+      (tangling != TCR_INDEPENDENT_IMAGES &&
+       p_dst_image->channelDepth != p_src_image->channelDepth)) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&buffer_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(&buffer_image, p_src_image));
+    p_src_image = &buffer_image;
+    tangling = TCR_INDEPENDENT_IMAGES;
+  }
+  const bool parallel = tangling == TCR_SAME_IMAGE ||
+                        tangling == TCR_INDEPENDENT_IMAGES;
+
+  const bool per_channel = lut_channels > 1;
+  switch (_GetMinImageType(p_src_image)) {
+  case TYP_UINT8:
+    return ApplyLutByDstDepth<uint8_t>(p_dst_image, p_src_image, p_lut,
+                                       per_channel, p_mask_image, parallel);
+  case TYP_UINT16:
+    return ApplyLutByDstDepth<uint16_t>(p_dst_image, p_src_image, p_lut,
+                                        per_channel, p_mask_image, parallel);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
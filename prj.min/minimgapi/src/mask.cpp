@@ -0,0 +1,278 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include "mask.h"
+#include "parallel.h"
+#include "vector/mask-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_CopyMinImageMasked, "CopyMinImageMasked");
+DECLARE_MINSTOPWATCH(gsw_FillMinImageMasked, "FillMinImageMasked");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+int AssureMaskFitsMinImage(
+    const MinImg *p_mask_image,
+    const MinImg *p_image) {
+  if (!p_mask_image)
+    return NO_ERRORS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_mask_image));
+  if (_CompareMinImage2DSizes(p_mask_image, p_image) ||
+      p_mask_image->channels != 1)
+    return BAD_ARGS;
+  int mask_type = _GetMinImageType(p_mask_image);
+  if (mask_type != TYP_UINT1 && mask_type != TYP_UINT8)
+    return BAD_ARGS;
+  if (p_mask_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  return NO_ERRORS;
+}
+
+bool IsMaskLineEmpty(
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            width) {
+  int len = bit_mask ? width >> 3 : width;
+  int i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    ::memcpy(&word, p_mask_line + i, sizeof(word));
+    if (word)
+      return false;
+  }
+  for (; i < len; ++i)
+    if (p_mask_line[i])
+      return false;
+  if (bit_mask && (width & 7))
+    return (p_mask_line[len] & (0xFF00 >> (width & 7))) == 0;
+  return true;
+}
+
+// Copies the pixels of a line with byte mask. PixelSize of zero stands for
+// the pixel size known at run time only. Blocks of 32 and 8 pixels with zero
+// mask are skipped.
+template<int PixelSize>
+static void CopyLineByByteMask(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    const uint8_t *p_mask_line,
+    int            width,
+    int            pixel_size) {
+  const int size = PixelSize ? PixelSize : pixel_size;
+  int x = CopyMaskedVector<PixelSize>::run(p_dst, p_src, p_mask_line, width);
+  for (; x < width; x += 8) {
+    while (x + 32 <= width) {
+      uint64_t words[4];
+      ::memcpy(words, p_mask_line + x, sizeof(words));
+      if (words[0] | words[1] | words[2] | words[3])
+        break;
+      x += 32;
+    }
+    if (x >= width)
+      break;
+    const int count = std::min(8, width - x);
+    if (count == 8) {
+      uint64_t word;
+      ::memcpy(&word, p_mask_line + x, sizeof(word));
+      if (!word)
+        continue;
+    }
+    for (int i = x; i < x + count; ++i)
+      if (p_mask_line[i])
+        ::memcpy(p_dst + i * size, p_src + i * size, size);
+  }
+}
+
+// Copies the pixels of a line with bit mask. Whole 64-bit words and bytes of
+// the mask which are either unset or set are skipped or copied at once.
+static void CopyLineByBitMask(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    const uint8_t *p_mask_line,
+    int            width,
+    int            pixel_size) {
+  for (int x = 0; x < width; ) {
+    const uint8_t *p_mask = p_mask_line + (x >> 3);
+    if (x + 64 <= width) {
+      uint64_t word;
+      ::memcpy(&word, p_mask, sizeof(word));
+      if (word == 0) {
+        x += 64;
+        continue;
+      }
+      if (word == ~static_cast<uint64_t>(0)) {
+        ::memcpy(p_dst + x * pixel_size, p_src + x * pixel_size,
+                 64 * pixel_size);
+        x += 64;
+        continue;
+      }
+    }
+    const int count = std::min(8, width - x);
+    const uint32_t bits = *p_mask;
+    if (bits == 0xFF && count == 8) {
+      ::memcpy(p_dst + x * pixel_size, p_src + x * pixel_size,
+               8 * pixel_size);
+    } else if (bits) {
+      for (int i = 0; i < count; ++i)
+        if (bits & (0x80 >> i))
+          ::memcpy(p_dst + (x + i) * pixel_size, p_src + (x + i) * pixel_size,
+                   pixel_size);
+    }
+    x += 8;
+  }
+}
+
+void CopyLineMasked(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            width,
+    int            pixel_size) {
+  if (bit_mask) {
+    CopyLineByBitMask(p_dst, p_src, p_mask_line, width, pixel_size);
+    return;
+  }
+  switch (pixel_size) {
+  case 1:
+    CopyLineByByteMask<1>(p_dst, p_src, p_mask_line, width, pixel_size);
+    break;
+  case 2:
+    CopyLineByByteMask<2>(p_dst, p_src, p_mask_line, width, pixel_size);
+    break;
+  case 3:
+    CopyLineByByteMask<3>(p_dst, p_src, p_mask_line, width, pixel_size);
+    break;
+  case 4:
+    CopyLineByByteMask<4>(p_dst, p_src, p_mask_line, width, pixel_size);
+    break;
+  default:
+    CopyLineByByteMask<0>(p_dst, p_src, p_mask_line, width, pixel_size);
+    break;
+  }
+}
+
+// Copies the masked pixels of the source rows into the destination ones.
+// A zero source stride stands for a single line replicated to all rows.
+static void CopyRowsMasked(
+    const MinImg  *p_dst_image,
+    const uint8_t *p_src,
+    int            src_stride,
+    const MinImg  *p_mask_image,
+    bool           parallel) {
+  const int width = p_dst_image->width;
+  const int height = p_dst_image->height;
+  const int pixel_size = p_dst_image->channels * p_dst_image->channelDepth;
+  const bool bit_mask = _GetMinImageType(p_mask_image) == TYP_UINT1;
+  const int num_threads = !parallel ? 1 : ChooseThreadCount(height,
+      static_cast<int64_t>(width) * height);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y)
+    CopyLineMasked(_GetMinImageLine(p_dst_image, y),
+                   p_src + static_cast<ptrdiff_t>(y) * src_stride,
+                   _GetMinImageLine(p_mask_image, y), bit_mask, width,
+                   pixel_size);
+}
+
+MINIMGAPI_API int CopyMinImageMasked(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImageMasked);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_dst_image));
+  if (!p_mask_image)
+    return CopyMinImage(p_dst_image, p_src_image);
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->channelDepth == 0)
+    return NOT_IMPLEMENTED;
+  if (p_dst_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  if (tangling == TCR_SAME_IMAGE)
+    return NO_ERRORS;
+  DECLARE_GUARDED_MINIMG(buffer_image);
+  const MinImg *p_src = p_src_image;
+  if (~tangling & TCR_FORWARD_PASS_POSSIBLE) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&buffer_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(&buffer_image, p_src_image));
+    p_src = &buffer_image;
+    tangling = TCR_INDEPENDENT_IMAGES;
+  }
+  CopyRowsMasked(p_dst_image, p_src->pScan0, p_src->stride, p_mask_image,
+                 tangling == TCR_INDEPENDENT_IMAGES);
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int FillMinImageMasked(
+    const MinImg *p_image,
+    const void   *p_canvas,
+    const MinImg *p_mask_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_FillMinImageMasked);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_canvas)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  PROPAGATE_ERROR(AssureMaskFitsMinImage(p_mask_image, p_image));
+  if (!p_mask_image)
+    return FillMinImage(p_image, p_canvas);
+  if (_AssureMinImageIsEmpty(p_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_image->channelDepth == 0)
+    return NOT_IMPLEMENTED;
+  if (p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  DECLARE_GUARDED_MINIMG(pattern_line);
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&pattern_line, p_image,
+                                                 p_image->width, 1));
+  PROPAGATE_ERROR(FillMinImage(&pattern_line, p_canvas));
+  CopyRowsMasked(p_image, pattern_line.pScan0, 0, p_mask_image, true);
+  return NO_ERRORS;
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef MINIMGAPI_MASK_H_INCLUDED
+#define MINIMGAPI_MASK_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+#include <minimgapi/minimgapi.h>
+
+/// Checks that the mask fits the image: it must have the same size, the only
+/// channel and be either a bit or a byte image. A null mask fits any image.
+int AssureMaskFitsMinImage(
+    const MinImg *p_mask_image,
+    const MinImg *p_image);
+
+/// Returns whether no pixel of the mask line of @c width pixels is set.
+bool IsMaskLineEmpty(
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            width);
+
+/**
+ * @brief   Copies the pixels of a line whose mask is nonzero.
+ * @details Pixels are @c pixel_size bytes long. Whole words of the mask which
+ *          are unset are skipped and whole words which are set are copied at
+ *          once, so sparse and dense masks cost close to a plain skip or
+ *          copy. The source is read before the destination is written for
+ *          each portion of the line, so a forward pass is safe.
+ */
+void CopyLineMasked(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    const uint8_t *p_mask_line,
+    bool           bit_mask,
+    int            width,
+    int            pixel_size);
+
+#endif // MINIMGAPI_MASK_H_INCLUDED
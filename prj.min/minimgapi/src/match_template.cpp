@@ -0,0 +1,325 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include "fft.h"
+#include "parallel.h"
+#include "vector/match-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_MatchTemplateMinImage, "MatchTemplateMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+/// The cost of a spatial multiply-add relative to an FFT butterfly per
+/// element and pass, as measured with SSE2.
+const double SPATIAL_TO_FFT_COST = 0.25;
+
+/// Tiles of an overlap-save correlation.
+struct FftTiling {
+  int    fft_width;
+  int    fft_height;
+  int    num_columns;  ///< The number of tiles along x.
+  int    num_lines;    ///< The number of tiles along y.
+  double cost;         ///< Butterflies per element and pass of all tiles.
+};
+
+// Chooses power-of-two tiles with the least total cost of the forward and
+// inverse transforms. Each tile yields the responses of its size minus the
+// template size plus one. Tiles are at least two elements wide, so a single
+// tile may be larger than the whole padded image when that is one column.
+static FftTiling ChooseFftTiling(
+    int dst_width,
+    int dst_height,
+    int templ_width,
+    int templ_height) {
+  const int min_fft_width = GetFftSize(std::max(templ_width, 2));
+  const int max_fft_width = std::max(min_fft_width,
+                                     GetFftSize(dst_width + templ_width - 1));
+  const int min_fft_height = GetFftSize(templ_height);
+  const int max_fft_height = std::max(
+      min_fft_height, GetFftSize(dst_height + templ_height - 1));
+  FftTiling best = {0, 0, 0, 0, 0};
+  for (int fft_width = min_fft_width; fft_width <= max_fft_width;
+       fft_width *= 2)
+    for (int fft_height = min_fft_height; fft_height <= max_fft_height;
+         fft_height *= 2) {
+      const int step_x = fft_width - templ_width + 1;
+      const int step_y = fft_height - templ_height + 1;
+      FftTiling tiling = {fft_width, fft_height,
+                          (dst_width + step_x - 1) / step_x,
+                          (dst_height + step_y - 1) / step_y, 0};
+      const double area = static_cast<double>(fft_width) * fft_height;
+      tiling.cost = 2.0 * tiling.num_columns * tiling.num_lines * area *
+                    std::log(area) / std::log(2.0);
+      if (best.cost == 0 || tiling.cost < best.cost)
+        best = tiling;
+    }
+  return best;
+}
+
+// Writes the sums of products of image windows and the weights into the
+// destination lines. The weights are multiplied by lines of a float copy of
+// the image, several output elements at a time.
+static void CorrelateSpatially(
+    const MinImg              *p_dst_image,
+    const MinImg              *p_src_image,
+    const MinImg              *p_templ_image,
+    const std::vector<double> &weights) {
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int templ_width = p_templ_image->width;
+  const int templ_height = p_templ_image->height;
+  const int dst_width = p_dst_image->width;
+  const int dst_height = p_dst_image->height;
+  std::vector<real32_t> image(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; ++y)
+    std::copy(_GetMinImageLine(p_src_image, y),
+              _GetMinImageLine(p_src_image, y) + width,
+              &image[static_cast<size_t>(y) * width]);
+  std::vector<real32_t> weights_32(weights.begin(), weights.end());
+
+  const int num_threads = ChooseThreadCount(dst_height,
+      static_cast<int64_t>(dst_width) * dst_height * templ_width *
+      templ_height);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < dst_height; ++y) {
+    real32_t *p_sum = reinterpret_cast<real32_t *>(
+                          _GetMinImageLine(p_dst_image, y));
+    std::fill(p_sum, p_sum + dst_width, 0.0f);
+    for (int j = 0; j < templ_height; ++j) {
+      const real32_t *p_line = &image[static_cast<size_t>(y + j) * width];
+      const real32_t *p_weights = &weights_32[j * templ_width];
+      for (int i = 0; i < templ_width; ++i)
+        MultiplyAddLine(p_sum, p_line + i, p_weights[i], dst_width);
+    }
+  }
+}
+
+// Writes the same sums as CorrelateSpatially() by overlap-save: each tile
+// of the image is transformed, multiplied by the conjugate template spectrum
+// and transformed back. A tile is not less than the template, so the cyclic
+// correlation does not wrap within the responses it yields. Tiles are split
+// between threads.
+static void CorrelateByFft(
+    const MinImg              *p_dst_image,
+    const MinImg              *p_src_image,
+    const MinImg              *p_templ_image,
+    const std::vector<double> &weights,
+    const FftTiling           &tiling) {
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int templ_width = p_templ_image->width;
+  const int templ_height = p_templ_image->height;
+  const int dst_width = p_dst_image->width;
+  const int dst_height = p_dst_image->height;
+  const int fft_width = tiling.fft_width;
+  const int fft_height = tiling.fft_height;
+  const int step_x = fft_width - templ_width + 1;
+  const int step_y = fft_height - templ_height + 1;
+  const size_t data_size = static_cast<size_t>(fft_width) * fft_height;
+  const size_t spectrum_size = static_cast<size_t>(fft_width / 2 + 1) *
+                               fft_height;
+
+  std::vector<double> templ_data(static_cast<size_t>(fft_width) *
+                                 templ_height, 0.0);
+  for (int y = 0; y < templ_height; ++y)
+    std::copy(&weights[y * templ_width], &weights[(y + 1) * templ_width],
+              &templ_data[static_cast<size_t>(y) * fft_width]);
+  std::vector<FftComplex> templ_spectrum(spectrum_size);
+  TransformReal2D(&templ_spectrum[0], &templ_data[0], fft_width, fft_width,
+                  templ_height, fft_height);
+
+  const int num_tiles = tiling.num_columns * tiling.num_lines;
+  const int num_threads = ChooseThreadCount(num_tiles,
+                              static_cast<int64_t>(data_size) * num_tiles);
+  std::vector<double> data(num_threads * data_size);
+  std::vector<FftComplex> spectra(num_threads * spectrum_size);
+  const double scale = 2.0 / (static_cast<double>(fft_width) * fft_height);
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    double *p_data = &data[GetThreadNumber() * data_size];
+    FftComplex *p_spectrum = &spectra[GetThreadNumber() * spectrum_size];
+    const int x0 = tile % tiling.num_columns * step_x;
+    const int y0 = tile / tiling.num_columns * step_y;
+    const int tile_width = std::min(fft_width, width - x0);
+    const int tile_height = std::min(fft_height, height - y0);
+    for (int y = 0; y < tile_height; ++y) {
+      const uint8_t *p_line = _GetMinImageLine(p_src_image, y0 + y) + x0;
+      double *p_row = p_data + static_cast<size_t>(y) * fft_width;
+      std::copy(p_line, p_line + tile_width, p_row);
+      std::fill(p_row + tile_width, p_row + fft_width, 0.0);
+    }
+    TransformReal2D(p_spectrum, p_data, fft_width, fft_width, tile_height,
+                    fft_height);
+    for (size_t k = 0; k < spectrum_size; ++k) {
+      const FftComplex a = p_spectrum[k], b = templ_spectrum[k];
+      p_spectrum[k] = FftComplex(a.real() * b.real() + a.imag() * b.imag(),
+                                 a.imag() * b.real() - a.real() * b.imag());
+    }
+    const int out_width = std::min(step_x, dst_width - x0);
+    const int out_height = std::min(step_y, dst_height - y0);
+    InverseTransformReal2D(p_data, fft_width, p_spectrum, fft_width,
+                           out_height, fft_height);
+    for (int y = 0; y < out_height; ++y) {
+      real32_t *p_sum = reinterpret_cast<real32_t *>(
+                            _GetMinImageLine(p_dst_image, y0 + y)) + x0;
+      const double *p_row = p_data + static_cast<size_t>(y) * fft_width;
+      for (int x = 0; x < out_width; ++x)
+        p_sum[x] = static_cast<real32_t>(p_row[x] * scale);
+    }
+  }
+}
+
+MINIMGAPI_API int MatchTemplateMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    const MinImg *p_templ_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_MatchTemplateMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_templ_image));
+  if (p_src_image->channels != 1 || p_templ_image->channels != 1 ||
+      p_dst_image->channels != 1 ||
+      _GetMinImageType(p_src_image) != TYP_UINT8 ||
+      _GetMinImageType(p_templ_image) != TYP_UINT8 ||
+      _GetMinImageType(p_dst_image) != TYP_REAL32)
+    return BAD_ARGS;
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int templ_width = p_templ_image->width;
+  const int templ_height = p_templ_image->height;
+  if (templ_width < 1 || templ_height < 1 || templ_width > width ||
+      templ_height > height ||
+      p_dst_image->width != width - templ_width + 1 ||
+      p_dst_image->height != height - templ_height + 1)
+    return BAD_ARGS;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0 ||
+      p_templ_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  // The template is centred, so the window mean drops out of the sums of
+  // products and only enters the window variance.
+  const int64_t num_pixels = static_cast<int64_t>(templ_width) * templ_height;
+  int64_t templ_sum = 0, templ_square_sum = 0;
+  for (int y = 0; y < templ_height; ++y) {
+    const uint8_t *p_line = _GetMinImageLine(p_templ_image, y);
+    for (int x = 0; x < templ_width; ++x) {
+      templ_sum += p_line[x];
+      templ_square_sum += p_line[x] * p_line[x];
+    }
+  }
+  const double templ_variance = static_cast<double>(
+      num_pixels * templ_square_sum - templ_sum * templ_sum) / num_pixels;
+  const int dst_width = p_dst_image->width;
+  const int dst_height = p_dst_image->height;
+  if (templ_variance == 0) {
+    for (int y = 0; y < dst_height; ++y) {
+      real32_t *p_line = reinterpret_cast<real32_t *>(
+                             _GetMinImageLine(p_dst_image, y));
+      std::fill(p_line, p_line + dst_width, 0.0f);
+    }
+    return NO_ERRORS;
+  }
+  const double templ_mean = static_cast<double>(templ_sum) / num_pixels;
+  std::vector<double> weights(static_cast<size_t>(num_pixels));
+  for (int y = 0; y < templ_height; ++y) {
+    const uint8_t *p_line = _GetMinImageLine(p_templ_image, y);
+    for (int x = 0; x < templ_width; ++x)
+      weights[y * templ_width + x] = p_line[x] - templ_mean;
+  }
+
+  // Integral images give the window sums and sums of squares in O(1).
+  const int integral_stride = width + 1;
+  std::vector<int64_t> sums(static_cast<size_t>(integral_stride) *
+                            (height + 1), 0);
+  std::vector<int64_t> squares(sums.size(), 0);
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *p_line = _GetMinImageLine(p_src_image, y);
+    const size_t above = static_cast<size_t>(y) * integral_stride;
+    const size_t below = above + integral_stride;
+    int64_t line_sum = 0, line_square_sum = 0;
+    for (int x = 0; x < width; ++x) {
+      line_sum += p_line[x];
+      line_square_sum += p_line[x] * p_line[x];
+      sums[below + x + 1] = sums[above + x + 1] + line_sum;
+      squares[below + x + 1] = squares[above + x + 1] + line_square_sum;
+    }
+  }
+
+  const FftTiling tiling = ChooseFftTiling(dst_width, dst_height,
+                                           templ_width, templ_height);
+  const double spatial_cost = SPATIAL_TO_FFT_COST * dst_width * dst_height *
+                              static_cast<double>(num_pixels);
+  if (tiling.cost < spatial_cost)
+    CorrelateByFft(p_dst_image, p_src_image, p_templ_image, weights, tiling);
+  else
+    CorrelateSpatially(p_dst_image, p_src_image, p_templ_image, weights);
+
+  const int num_threads = ChooseThreadCount(dst_height,
+      static_cast<int64_t>(dst_width) * dst_height);
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < dst_height; ++y) {
+    real32_t *p_line = reinterpret_cast<real32_t *>(
+                           _GetMinImageLine(p_dst_image, y));
+    const int64_t *p_sums = &sums[static_cast<size_t>(y) * integral_stride];
+    const int64_t *p_squares = &squares[static_cast<size_t>(y) *
+                                        integral_stride];
+    const size_t down = static_cast<size_t>(templ_height) * integral_stride;
+    for (int x = 0; x < dst_width; ++x) {
+      const int x1 = x + templ_width;
+      const int64_t sum = p_sums[down + x1] - p_sums[down + x] - p_sums[x1] +
+                          p_sums[x];
+      const int64_t square_sum = p_squares[down + x1] - p_squares[down + x] -
+                                 p_squares[x1] + p_squares[x];
+      const int64_t scaled_variance = num_pixels * square_sum - sum * sum;
+      if (scaled_variance <= 0) {
+        p_line[x] = 0.0f;
+        continue;
+      }
+      const double norm = std::sqrt(templ_variance * scaled_variance /
+                                    num_pixels);
+      const double score = p_line[x] / norm;
+      p_line[x] = static_cast<real32_t>(std::min(1.0, std::max(-1.0, score)));
+    }
+  }
+
+  return NO_ERRORS;
+}
@@ -0,0 +1,411 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "parallel.h"
+#include "vector/median-inl.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_MedianFilterMinImage, "MedianFilterMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+/// The number of bytes of column histograms a strip is allowed to take.
+static const int MEDIAN_STRIP_BYTES = 1 << 18;
+/// The largest radius whose window population fits 16-bit counters.
+static const int MEDIAN_MAX_RADIUS = 127;
+
+static const int COARSE_BINS = 16;
+static const int FINE_BINS = 256;
+
+/// The number of pixels a selection network processes at once.
+static const int NETWORK_LANES = 32;
+
+typedef uint8_t NetworkLanes[NETWORK_LANES];
+
+// Orders NETWORK_LANES pairs of values at once, so the loop compiles to
+// packed minimums and maximums.
+static MUSTINLINE void SortPair(NetworkLanes &a, NetworkLanes &b) {
+  for (int i = 0; i < NETWORK_LANES; ++i) {
+    uint8_t lo = std::min(a[i], b[i]);
+    b[i] = std::max(a[i], b[i]);
+    a[i] = lo;
+  }
+}
+
+// Moves the median of 9 values to p[4] by the 19-comparator network of Paeth.
+static MUSTINLINE void Median9(NetworkLanes *p) {
+  SortPair(p[1], p[2]); SortPair(p[4], p[5]); SortPair(p[7], p[8]);
+  SortPair(p[0], p[1]); SortPair(p[3], p[4]); SortPair(p[6], p[7]);
+  SortPair(p[1], p[2]); SortPair(p[4], p[5]); SortPair(p[7], p[8]);
+  SortPair(p[0], p[3]); SortPair(p[5], p[8]); SortPair(p[4], p[7]);
+  SortPair(p[3], p[6]); SortPair(p[1], p[4]); SortPair(p[2], p[5]);
+  SortPair(p[4], p[7]); SortPair(p[4], p[2]); SortPair(p[6], p[4]);
+  SortPair(p[4], p[2]);
+}
+
+// Moves the median of 25 values to p[12] by the 99-comparator network of
+// Devillard.
+static MUSTINLINE void Median25(NetworkLanes *p) {
+  SortPair(p[0], p[1]);   SortPair(p[3], p[4]);   SortPair(p[2], p[4]);
+  SortPair(p[2], p[3]);   SortPair(p[6], p[7]);   SortPair(p[5], p[7]);
+  SortPair(p[5], p[6]);   SortPair(p[9], p[10]);  SortPair(p[8], p[10]);
+  SortPair(p[8], p[9]);   SortPair(p[12], p[13]); SortPair(p[11], p[13]);
+  SortPair(p[11], p[12]); SortPair(p[15], p[16]); SortPair(p[14], p[16]);
+  SortPair(p[14], p[15]); SortPair(p[18], p[19]); SortPair(p[17], p[19]);
+  SortPair(p[17], p[18]); SortPair(p[21], p[22]); SortPair(p[20], p[22]);
+  SortPair(p[20], p[21]); SortPair(p[23], p[24]); SortPair(p[2], p[5]);
+  SortPair(p[3], p[6]);   SortPair(p[0], p[6]);   SortPair(p[0], p[3]);
+  SortPair(p[4], p[7]);   SortPair(p[1], p[7]);   SortPair(p[1], p[4]);
+  SortPair(p[11], p[14]); SortPair(p[8], p[14]);  SortPair(p[8], p[11]);
+  SortPair(p[12], p[15]); SortPair(p[9], p[15]);  SortPair(p[9], p[12]);
+  SortPair(p[13], p[16]); SortPair(p[10], p[16]); SortPair(p[10], p[13]);
+  SortPair(p[20], p[23]); SortPair(p[17], p[23]); SortPair(p[17], p[20]);
+  SortPair(p[21], p[24]); SortPair(p[18], p[24]); SortPair(p[18], p[21]);
+  SortPair(p[19], p[22]); SortPair(p[8], p[17]);  SortPair(p[9], p[18]);
+  SortPair(p[0], p[18]);  SortPair(p[0], p[9]);   SortPair(p[10], p[19]);
+  SortPair(p[1], p[19]);  SortPair(p[1], p[10]);  SortPair(p[11], p[20]);
+  SortPair(p[2], p[20]);  SortPair(p[2], p[11]);  SortPair(p[12], p[21]);
+  SortPair(p[3], p[21]);  SortPair(p[3], p[12]);  SortPair(p[13], p[22]);
+  SortPair(p[4], p[22]);  SortPair(p[4], p[13]);  SortPair(p[14], p[23]);
+  SortPair(p[5], p[23]);  SortPair(p[5], p[14]);  SortPair(p[15], p[24]);
+  SortPair(p[6], p[24]);  SortPair(p[6], p[15]);  SortPair(p[7], p[16]);
+  SortPair(p[7], p[19]);  SortPair(p[13], p[21]); SortPair(p[15], p[23]);
+  SortPair(p[7], p[13]);  SortPair(p[7], p[15]);  SortPair(p[1], p[9]);
+  SortPair(p[3], p[11]);  SortPair(p[5], p[17]);  SortPair(p[11], p[17]);
+  SortPair(p[9], p[17]);  SortPair(p[4], p[10]);  SortPair(p[6], p[12]);
+  SortPair(p[7], p[14]);  SortPair(p[4], p[6]);   SortPair(p[4], p[7]);
+  SortPair(p[12], p[14]); SortPair(p[10], p[14]); SortPair(p[6], p[7]);
+  SortPair(p[10], p[12]); SortPair(p[6], p[10]);  SortPair(p[6], p[17]);
+  SortPair(p[12], p[17]); SortPair(p[7], p[17]);  SortPair(p[7], p[10]);
+  SortPair(p[12], p[18]); SortPair(p[7], p[12]);  SortPair(p[10], p[18]);
+  SortPair(p[12], p[20]); SortPair(p[10], p[20]); SortPair(p[10], p[12]);
+}
+
+template<int Radius> static MUSTINLINE void SelectMedian(NetworkLanes *p);
+template<> MUSTINLINE void SelectMedian<1>(NetworkLanes *p) { Median9(p); }
+template<> MUSTINLINE void SelectMedian<2>(NetworkLanes *p) { Median25(p); }
+
+// Filters all lines of the image by a selection network, NETWORK_LANES
+// elements of a line at a time.
+template<int Radius>
+static int FilterMinImageByNetwork(
+    const MinImg  *p_dst_image,
+    const uint8_t *p_padded,
+    int            padded_stride) {
+  const int size = 2 * Radius + 1;
+  const int height = p_dst_image->height;
+  const int channels = p_dst_image->channels;
+  const int len = p_dst_image->width * channels;
+  const int num_threads = ChooseThreadCount(height,
+                              static_cast<int64_t>(len) * height * size);
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    uint8_t *p_dst = _GetMinImageLine(p_dst_image, y);
+    const uint8_t *p_rows[size];
+    for (int dy = 0; dy < size; ++dy)
+      p_rows[dy] = p_padded + static_cast<size_t>(y + dy) * padded_stride;
+    NetworkLanes p[size * size] = {{0}};
+    int i = 0;
+    for (; i + NETWORK_LANES <= len; i += NETWORK_LANES) {
+      for (int dy = 0; dy < size; ++dy)
+        for (int dx = 0; dx < size; ++dx)
+          ::memcpy(p[dy * size + dx], p_rows[dy] + i + dx * channels,
+                   NETWORK_LANES);
+      SelectMedian<Radius>(p);
+      ::memcpy(p_dst + i, p[size * size / 2], NETWORK_LANES);
+    }
+    if (i < len) {
+      for (int dy = 0; dy < size; ++dy)
+        for (int dx = 0; dx < size; ++dx)
+          ::memcpy(p[dy * size + dx], p_rows[dy] + i + dx * channels, len - i);
+      SelectMedian<Radius>(p);
+      ::memcpy(p_dst + i, p[size * size / 2], len - i);
+    }
+  }
+  return NO_ERRORS;
+}
+
+// Histograms of one channel of the sliding window of a strip. The coarse
+// histogram counts values by their high nibble and is kept up to date at
+// every step; a segment of the fine histogram is only brought up to date when
+// the median falls into it.
+struct KernelHistogram {
+  uint16_t coarse[COARSE_BINS];
+  uint16_t fine[FINE_BINS];
+  int      fine_column[COARSE_BINS];  ///< Window position of each segment.
+};
+
+// Finds the median of the window starting at strip column j, where p_fine
+// points to the fine column histograms of the strip for this channel, taken
+// every step histograms.
+static MUSTINLINE uint8_t FindMedian(
+    KernelHistogram *p_kernel,
+    const uint16_t  *p_fine,
+    int              step,
+    int              j,
+    int              size) {
+  const int half = size * size / 2;
+  int count = 0;
+  const int k = HistogramSearchVector<uint16_t>::find(p_kernel->coarse, &count,
+                                                      half);
+
+  const int offset = k * COARSE_BINS;
+  const size_t column_size = static_cast<size_t>(step) * FINE_BINS;
+  const uint16_t *p_columns = p_fine + offset;
+  uint16_t *p_segment = p_kernel->fine + offset;
+  int last = p_kernel->fine_column[k];
+  if (j - last >= size) {
+    std::fill(p_segment, p_segment + COARSE_BINS, 0);
+    for (int s = j; s < j + size; ++s) {
+      const uint16_t *p_col = p_columns + s * column_size;
+      for (int b = 0; b < COARSE_BINS; ++b)
+        p_segment[b] = static_cast<uint16_t>(p_segment[b] + p_col[b]);
+    }
+  } else {
+    for (int s = last + 1; s <= j; ++s)
+      UpdateHistogram(p_segment, p_columns + (s + size - 1) * column_size,
+                      p_columns + (s - 1) * column_size, COARSE_BINS);
+  }
+  p_kernel->fine_column[k] = j;
+
+  return static_cast<uint8_t>(offset +
+      HistogramSearchVector<uint16_t>::find(p_segment, &count, half));
+}
+
+static MUSTINLINE void CountValue(
+    uint16_t *p_coarse,
+    uint16_t *p_fine,
+    uint8_t   value,
+    int       delta) {
+  p_coarse[value >> 4] = static_cast<uint16_t>(p_coarse[value >> 4] + delta);
+  p_fine[value] = static_cast<uint16_t>(p_fine[value] + delta);
+}
+
+// Filters lines [y_begin, y_end) of output columns [x_begin, x_end) with the
+// Perreault-Hebert algorithm: a histogram is kept for every column of the
+// strip and slid down by one line per output line, and the window histogram
+// is slid right by adding one column histogram and subtracting another, so
+// the cost per pixel does not depend on the radius.
+static void FilterStripByHistograms(
+    const MinImg    *p_dst_image,
+    const uint8_t   *p_padded,
+    int              padded_stride,
+    int              radius,
+    int              x_begin,
+    int              x_end,
+    int              y_begin,
+    int              y_end,
+    uint16_t        *p_col_coarse,
+    uint16_t        *p_col_fine,
+    KernelHistogram *p_kernels) {
+  const int size = 2 * radius + 1;
+  const int channels = p_dst_image->channels;
+  const int num_columns = x_end - x_begin + 2 * radius;
+  const int num_hists = num_columns * channels;
+  std::fill(p_col_coarse, p_col_coarse + num_hists * COARSE_BINS, 0);
+  std::fill(p_col_fine, p_col_fine + static_cast<size_t>(num_hists) * FINE_BINS,
+            0);
+
+  for (int y = y_begin; y < y_begin + size - 1; ++y) {
+    const uint8_t *p_row = p_padded + static_cast<size_t>(y) * padded_stride +
+                           x_begin * channels;
+    for (int i = 0; i < num_hists; ++i)
+      CountValue(p_col_coarse + i * COARSE_BINS,
+                 p_col_fine + static_cast<size_t>(i) * FINE_BINS, p_row[i], 1);
+  }
+
+  for (int y = y_begin; y < y_end; ++y) {
+    const uint8_t *p_in = p_padded +
+        static_cast<size_t>(y + size - 1) * padded_stride + x_begin * channels;
+    for (int i = 0; i < num_hists; ++i)
+      CountValue(p_col_coarse + i * COARSE_BINS,
+                 p_col_fine + static_cast<size_t>(i) * FINE_BINS, p_in[i], 1);
+    if (y > y_begin) {
+      const uint8_t *p_out = p_padded +
+          static_cast<size_t>(y - 1) * padded_stride + x_begin * channels;
+      for (int i = 0; i < num_hists; ++i)
+        CountValue(p_col_coarse + i * COARSE_BINS,
+                   p_col_fine + static_cast<size_t>(i) * FINE_BINS, p_out[i],
+                   -1);
+    }
+
+    for (int c = 0; c < channels; ++c) {
+      KernelHistogram &kernel = p_kernels[c];
+      std::fill(kernel.coarse, kernel.coarse + COARSE_BINS, 0);
+      std::fill(kernel.fine_column, kernel.fine_column + COARSE_BINS,
+                INT_MIN / 2);
+      for (int s = 0; s < size - 1; ++s) {
+        const uint16_t *p_col = p_col_coarse + (s * channels + c) * COARSE_BINS;
+        for (int b = 0; b < COARSE_BINS; ++b)
+          kernel.coarse[b] = static_cast<uint16_t>(kernel.coarse[b] + p_col[b]);
+      }
+    }
+
+    uint8_t *p_dst = _GetMinImageLine(p_dst_image, y) + x_begin * channels;
+    for (int j = 0; j < x_end - x_begin; ++j) {
+      for (int c = 0; c < channels; ++c) {
+        KernelHistogram &kernel = p_kernels[c];
+        const uint16_t *p_coarse = p_col_coarse + c * COARSE_BINS;
+        const uint16_t *p_add = p_coarse +
+                                (j + size - 1) * channels * COARSE_BINS;
+        if (j == 0) {
+          for (int b = 0; b < COARSE_BINS; ++b)
+            kernel.coarse[b] = static_cast<uint16_t>(kernel.coarse[b] +
+                                                     p_add[b]);
+        } else {
+          UpdateHistogram(kernel.coarse, p_add,
+                          p_coarse + (j - 1) * channels * COARSE_BINS,
+                          COARSE_BINS);
+        }
+        p_dst[j * channels + c] = FindMedian(&kernel,
+            p_col_fine + static_cast<size_t>(c) * FINE_BINS, channels, j,
+            size);
+      }
+    }
+  }
+}
+
+static int FilterMinImageByHistograms(
+    const MinImg  *p_dst_image,
+    const uint8_t *p_padded,
+    int            padded_stride,
+    int            radius) {
+  const int size = 2 * radius + 1;
+  const int width = p_dst_image->width;
+  const int height = p_dst_image->height;
+  const int channels = p_dst_image->channels;
+  const int column_bytes = channels * (COARSE_BINS + FINE_BINS) *
+                           static_cast<int>(sizeof(uint16_t));
+  const int strip_width = std::min(width, std::max(4 * size,
+                              MEDIAN_STRIP_BYTES / column_bytes - 2 * radius));
+  const int num_strips = (width + strip_width - 1) / strip_width;
+
+  // Narrow images are also split into bands of lines, each of which pays
+  // for building the column histograms of its first window.
+  const int num_threads = ChooseThreadCount(INT_MAX,
+      static_cast<int64_t>(width) * height * channels * COARSE_BINS);
+  int num_bands = 1;
+  if (num_threads > num_strips)
+    num_bands = std::max(1, std::min((num_threads + num_strips - 1) /
+                                     num_strips, height / (4 * size)));
+  const int num_tasks = num_strips * num_bands;
+  const int num_columns = strip_width + 2 * radius;
+
+  const size_t coarse_size = static_cast<size_t>(num_columns) * channels *
+                             COARSE_BINS;
+  const size_t fine_size = static_cast<size_t>(num_columns) * channels *
+                           FINE_BINS;
+  const int num_buffers = std::min(num_threads, num_tasks);
+  scoped_cpp_array<uint16_t> col_coarse(
+      new uint16_t[num_buffers * coarse_size]);
+  scoped_cpp_array<uint16_t> col_fine(new uint16_t[num_buffers * fine_size]);
+  scoped_cpp_array<KernelHistogram> kernels(
+      new KernelHistogram[num_buffers * channels]);
+
+#pragma omp parallel for num_threads(num_buffers)
+  for (int task = 0; task < num_tasks; ++task) {
+    int thread = GetThreadNumber();
+    int strip = task % num_strips;
+    int band = task / num_strips;
+    int x_begin = strip * strip_width;
+    int x_end = std::min(width, x_begin + strip_width);
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_bands);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_bands);
+    FilterStripByHistograms(p_dst_image, p_padded, padded_stride, radius,
+                            x_begin, x_end, y_begin, y_end,
+                            &col_coarse[thread * coarse_size],
+                            &col_fine[thread * fine_size],
+                            &kernels[thread * channels]);
+  }
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int MedianFilterMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           radius,
+    BorderOption  border,
+    const void   *p_canvas) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_MedianFilterMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  if (radius < 0)
+    return BAD_ARGS;
+  if (border == BO_CONSTANT && !p_canvas)
+    return BAD_ARGS;
+  if (border == BO_IGNORE)
+    return NOT_SUPPORTED;
+  if (_GetMinImageType(p_src_image) != TYP_UINT8)
+    return NOT_IMPLEMENTED;
+  if (border == BO_VOID || radius > MEDIAN_MAX_RADIUS)
+    return NOT_IMPLEMENTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  if (radius == 0)
+    return CopyMinImage(p_dst_image, p_src_image);
+
+  // The padded copy also makes filtering in place safe.
+  DECLARE_GUARDED_MINIMG(padded_image);
+  PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&padded_image, p_src_image,
+                  p_src_image->width + 2 * radius,
+                  p_src_image->height + 2 * radius));
+  PROPAGATE_ERROR(CopyMinImageWithBorder(&padded_image, p_src_image, radius,
+                                         radius, radius, radius, border,
+                                         p_canvas));
+
+  const uint8_t *p_padded = padded_image.pScan0;
+  const int padded_stride = padded_image.stride;
+  if (radius == 1)
+    return FilterMinImageByNetwork<1>(p_dst_image, p_padded, padded_stride);
+  if (radius == 2)
+    return FilterMinImageByNetwork<2>(p_dst_image, p_padded, padded_stride);
+  return FilterMinImageByHistograms(p_dst_image, p_padded, padded_stride,
+                                    radius);
+}
@@ -39,6 +39,22 @@ either expressed or implied, of copyright holders.
 #include <minutils/crossplat.h>
 #include <minimgapi/minimgapi.h>
 #include <minimgapi/imgguard.hpp>
+#include "shared.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_NewMinImagePrototype, "NewMinImagePrototype");
+DECLARE_MINSTOPWATCH(gsw_AllocMinImage, "AllocMinImage");
+DECLARE_MINSTOPWATCH(gsw_FreeMinImage, "FreeMinImage");
+DECLARE_MINSTOPWATCH(gsw_ZeroFillMinImage, "ZeroFillMinImage");
+DECLARE_MINSTOPWATCH(gsw_FillMinImage, "FillMinImage");
+DECLARE_MINSTOPWATCH(gsw_CopyMinImage, "CopyMinImage");
+DECLARE_MINSTOPWATCH(gsw_CopyMinImageFragment, "CopyMinImageFragment");
+DECLARE_MINSTOPWATCH(gsw_FlipMinImage, "FlipMinImage");
+DECLARE_MINSTOPWATCH(gsw_RotateMinImageBy90, "RotateMinImageBy90");
+DECLARE_MINSTOPWATCH(gsw_InterleaveMinImages, "InterleaveMinImages");
+DECLARE_MINSTOPWATCH(gsw_DeinterleaveMinImage, "DeinterleaveMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
 
 
 MINIMGAPI_API int NewMinImagePrototype(
@@ -49,6 +65,9 @@ MINIMGAPI_API int NewMinImagePrototype(
     MinTyp           element_type,
     int              address_space,
     AllocationOption allocation) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_NewMinImagePrototype);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (!p_image || p_image->pScan0)
     return BAD_ARGS;
 
@@ -68,6 +87,9 @@ MINIMGAPI_API int NewMinImagePrototype(
 MINIMGAPI_API int AllocMinImage(
     MinImg *p_image,
     int     alignment) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_AllocMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   PROPAGATE_ERROR(_AssureMinImagePrototypeIsValid(p_image));
   if (p_image->pScan0)
     return BAD_ARGS;
@@ -105,6 +127,9 @@ MINIMGAPI_API int AllocMinImage(
 
 MINIMGAPI_API int FreeMinImage(
     MinImg *p_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_FreeMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (!p_image)
     return BAD_ARGS;
   if (!p_image->pScan0) {
@@ -114,11 +139,11 @@ MINIMGAPI_API int FreeMinImage(
   if (p_image->addressSpace != 0)
     return NOT_IMPLEMENTED;
 
-  uint8_t *const p_buffer = p_image->stride > 0 ? p_image->pScan0 :
-                                 _GetMinImageLine(p_image, p_image->height - 1);
+  uint8_t *const p_buffer = GetMinImageBufferBase(p_image);
   if (!p_buffer)
     return INTERNAL_ERROR;
-  ::alignedfree(p_buffer);
+  if (ReleaseMinImageBuffer(p_buffer))
+    ::alignedfree(p_buffer);
   ::memset(p_image, 0, sizeof(*p_image));
 
   return NO_ERRORS;
@@ -450,6 +475,9 @@ MINIMGAPI_API int CheckMinImagesTangle(
 
 MINIMGAPI_API int ZeroFillMinImage(
     const MinImg *p_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ZeroFillMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   uint8_t zero = 0;
   return FillMinImage(p_image, &zero, 1);
 }
@@ -458,6 +486,9 @@ MINIMGAPI_API int FillMinImage(
     const MinImg *p_image,
     const void   *p_canvas,
     int           value_size) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_FillMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
   if (!p_canvas || value_size < 0)
     return BAD_ARGS;
@@ -558,6 +589,11 @@ MINIMGAPI_API int FillMinImage(
   for (int y = 1; y < p_image->height; ++y) {
     current_line.pScan0 += current_line.stride;
     ::memcpy(current_line.pScan0, first_line.pScan0, line_byte_width);
+    if (tail_mask) {
+      current_line.pScan0[line_byte_width] &= ~tail_mask;
+      current_line.pScan0[line_byte_width] |=
+                                first_line.pScan0[line_byte_width] & tail_mask;
+    }
   }
 
   return NO_ERRORS;
@@ -566,6 +602,9 @@ MINIMGAPI_API int FillMinImage(
 MINIMGAPI_API int CopyMinImage(
     const MinImg *p_dst_image,
     const MinImg *p_src_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
   if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
@@ -650,6 +689,9 @@ MINIMGAPI_API int CopyMinImageFragment(
     int           src_y0,
     int           width,
     int           height) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImageFragment);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (_CompareMinImagePixels(p_dst_image, p_src_image))
     return BAD_ARGS;
   if (dst_x0 < 0 || dst_x0 + width > p_dst_image->width   ||
@@ -795,6 +837,9 @@ MINIMGAPI_API int FlipMinImage(
     const MinImg *p_dst_image,
     const MinImg *p_src_image,
     DirectionOption direction) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_FlipMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (direction == DO_BOTH)
     return RotateMinImageBy90(p_dst_image, p_src_image, 2);
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
@@ -976,6 +1021,9 @@ MINIMGAPI_API int RotateMinImageBy90(
     const MinImg *p_dst_image,
     const MinImg *p_src_image,
     int           num_rotations) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_RotateMinImageBy90);
+#endif // defined(MINSTOPWATCH_ENABLED)
   num_rotations = (num_rotations % 4 + 4) % 4;
   MinImg tmp_image = {0};
 
@@ -1005,6 +1053,9 @@ MINIMGAPI_API int InterleaveMinImages(
     const MinImg        *p_dst_image,
     const MinImg *const *p_p_src_images,
     int                  num_src_images) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_InterleaveMinImages);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (!p_p_src_images || num_src_images <= 0)
     return BAD_ARGS;
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
@@ -1074,6 +1125,9 @@ MINIMGAPI_API int DeinterleaveMinImage(
     const MinImg *const *p_p_dst_images,
     const MinImg        *p_src_image,
     int                  num_dst_images) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_DeinterleaveMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (!p_p_dst_images || num_dst_images <= 0)
     return BAD_ARGS;
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
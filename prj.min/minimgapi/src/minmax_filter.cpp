@@ -0,0 +1,318 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+
+#include <minutils/minerr.h>
+#include <minutils/mathoper.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "vector/arithmetic-inl.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_MinMaxFilterMinImage, "MinMaxFilterMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// The size of the van Herk/Gil-Werman buffers of a single strip of columns.
+static const int VHGW_STRIP_BYTES = 1 << 18;
+
+// Bytes of packed bit lines, which are combined bitwise.
+struct PackedBits {
+  uint8_t bits;
+};
+
+template<typename T, int op> struct IdOpLine {
+  static MUSTINLINE void apply(
+      uint8_t       *p_dst,
+      const uint8_t *p_src_a,
+      const uint8_t *p_src_b,
+      int            len) {
+    vector_biop<T, op>(reinterpret_cast<T *>(p_dst),
+                       reinterpret_cast<const T *>(p_src_a),
+                       reinterpret_cast<const T *>(p_src_b), len);
+  }
+};
+
+template<int op> struct IdOpLine<PackedBits, op> {
+  static MUSTINLINE void apply(
+      uint8_t       *p_dst,
+      const uint8_t *p_src_a,
+      const uint8_t *p_src_b,
+      int            len) {
+    vector_bit_biop<op>(p_dst, p_src_a, p_src_b, len << 3);
+  }
+};
+
+// Filters a strip of columns [x0, x0 + strip_len) of the source image with
+// a vertical window of the given size. Lines of the source image extended
+// by the border are split into blocks of the window size; prefix (g) and
+// suffix (h) accumulations within the blocks give the result for any window
+// as op(h[y], g[y + size - 1]), that is three operations per element
+// regardless of the window size.
+template<typename T, int op>
+static void FilterStripVertically(
+    const MinImg   *p_dst_image,
+    const uint8_t **pp_lines,
+    int             size,
+    int             x0,
+    int             strip_len,
+    int             dst_bit_len,
+    uint8_t        *p_g,
+    uint8_t        *p_h) {
+  const int num_lines = p_dst_image->height + size - 1;
+  const int offset = x0 * static_cast<int>(sizeof(T));
+  const int line_size = strip_len * static_cast<int>(sizeof(T));
+
+  for (int begin = 0; begin < num_lines; begin += size) {
+    int end = std::min(begin + size, num_lines);
+    ::memcpy(p_g + begin * line_size, pp_lines[begin] + offset, line_size);
+    for (int i = begin + 1; i < end; ++i)
+      IdOpLine<T, op>::apply(p_g + i * line_size, p_g + (i - 1) * line_size,
+                             pp_lines[i] + offset, strip_len);
+    ::memcpy(p_h + (end - 1) * line_size, pp_lines[end - 1] + offset,
+             line_size);
+    for (int i = end - 2; i >= begin; --i)
+      IdOpLine<T, op>::apply(p_h + i * line_size, p_h + (i + 1) * line_size,
+                             pp_lines[i] + offset, strip_len);
+  }
+
+  uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, 0) + offset;
+  for (int y = 0; y < p_dst_image->height; ++y) {
+    const uint8_t *p_h_line = p_h + y * line_size;
+    const uint8_t *p_g_line = p_g + (y + size - 1) * line_size;
+    if (dst_bit_len >= 0)
+      vector_bit_biop<op>(p_dst_line, p_h_line, p_g_line, dst_bit_len);
+    else
+      IdOpLine<T, op>::apply(p_dst_line, p_h_line, p_g_line, strip_len);
+    p_dst_line += p_dst_image->stride;
+  }
+}
+
+template<typename T, int op>
+static int FilterMinImageVertically(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           size,
+    BorderOption  border,
+    const void   *p_canvas) {
+  const int height = p_src_image->height;
+  const int num_lines = height + size - 1;
+  const bool bits = _GetMinImageType(p_src_image) == TYP_UINT1;
+  const int len = bits ? (p_src_image->width * p_src_image->channels + 7) >> 3
+                       : p_src_image->width * p_src_image->channels;
+
+  // For idempotent operations repeating the nearest pixel is the same as
+  // ignoring pixels out of the image.
+  if (border == BO_VOID)
+    border = BO_REPEAT;
+  DECLARE_GUARDED_MINIMG(canvas_line);
+  if (border == BO_CONSTANT) {
+    PROPAGATE_ERROR(_CloneResizedMinImagePrototype(&canvas_line, p_src_image,
+                                                   p_src_image->width, 1));
+    PROPAGATE_ERROR(FillMinImage(&canvas_line, p_canvas));
+  }
+
+  scoped_cpp_array<const uint8_t *> lines(new const uint8_t *[num_lines]);
+  for (int i = 0; i < num_lines; ++i) {
+    lines[i] = _GetMinImageLine(p_src_image, i - (size - 1) / 2, border,
+                                canvas_line.pScan0);
+    if (!lines[i])
+      return INTERNAL_ERROR;
+  }
+
+  const int strip_bytes = VHGW_STRIP_BYTES / (2 * num_lines);
+  const int strip_len = std::min(len, std::max(64,
+                  (strip_bytes / static_cast<int>(sizeof(T))) & ~0x0F));
+  const int num_strips = (len + strip_len - 1) / strip_len;
+  const int num_threads = ChooseThreadCount(num_strips,
+                          static_cast<int64_t>(len) * num_lines);
+  const int buffer_size = num_lines * strip_len * static_cast<int>(sizeof(T));
+  scoped_cpp_array<uint8_t> buffers(
+      new uint8_t[2 * num_threads * buffer_size]);
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int strip = 0; strip < num_strips; ++strip) {
+    int thread = GetThreadNumber();
+    int x0 = strip * strip_len;
+    int cur_len = std::min(strip_len, len - x0);
+    int dst_bit_len = -1;
+    if (bits)
+      dst_bit_len = std::min(cur_len << 3,
+                      p_dst_image->width * p_dst_image->channels - (x0 << 3));
+    FilterStripVertically<T, op>(p_dst_image, &lines[0], size, x0, cur_len,
+                         dst_bit_len,
+                         &buffers[(2 * thread) * buffer_size],
+                         &buffers[(2 * thread + 1) * buffer_size]);
+  }
+
+  return NO_ERRORS;
+}
+
+template<int op>
+static int FilterMinImageVerticallyByType(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           size,
+    BorderOption  border,
+    const void   *p_canvas) {
+  switch (_GetMinImageType(p_src_image)) {
+  case TYP_UINT1:
+    return FilterMinImageVertically<PackedBits, op>(p_dst_image, p_src_image,
+                                                    size, border, p_canvas);
+  case TYP_UINT8:
+    return FilterMinImageVertically<uint8_t, op>(p_dst_image, p_src_image,
+                                                 size, border, p_canvas);
+  case TYP_INT8:
+    return FilterMinImageVertically<int8_t, op>(p_dst_image, p_src_image,
+                                                size, border, p_canvas);
+  case TYP_UINT16:
+    return FilterMinImageVertically<uint16_t, op>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  case TYP_INT16:
+    return FilterMinImageVertically<int16_t, op>(p_dst_image, p_src_image,
+                                                 size, border, p_canvas);
+  case TYP_UINT32:
+    return FilterMinImageVertically<uint32_t, op>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  case TYP_INT32:
+    return FilterMinImageVertically<int32_t, op>(p_dst_image, p_src_image,
+                                                 size, border, p_canvas);
+  case TYP_UINT64:
+    return FilterMinImageVertically<uint64_t, op>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  case TYP_INT64:
+    return FilterMinImageVertically<int64_t, op>(p_dst_image, p_src_image,
+                                                 size, border, p_canvas);
+  case TYP_REAL32:
+    return FilterMinImageVertically<real32_t, op>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  case TYP_REAL64:
+    return FilterMinImageVertically<real64_t, op>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+static int FilterMinImageVerticallyByOp(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           size,
+    IdOp          op,
+    BorderOption  border,
+    const void   *p_canvas) {
+  if (op == IDOP_MIN)
+    return FilterMinImageVerticallyByType<OP_MIN>(p_dst_image, p_src_image,
+                                                  size, border, p_canvas);
+  return FilterMinImageVerticallyByType<OP_MAX>(p_dst_image, p_src_image,
+                                                size, border, p_canvas);
+}
+
+// The horizontal pass is the vertical one in the transposed space, so that
+// the vector kernels work across lines in both passes.
+static int FilterMinImageHorizontallyByOp(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           size,
+    IdOp          op,
+    BorderOption  border,
+    const void   *p_canvas) {
+  DECLARE_GUARDED_MINIMG(transposed_src_image);
+  DECLARE_GUARDED_MINIMG(transposed_dst_image);
+  PROPAGATE_ERROR(_CloneTransposedMinImagePrototype(&transposed_src_image,
+                                                    p_src_image));
+  PROPAGATE_ERROR(_CloneMinImagePrototype(&transposed_dst_image,
+                                          &transposed_src_image));
+  PROPAGATE_ERROR(TransposeMinImage(&transposed_src_image, p_src_image));
+  PROPAGATE_ERROR(FilterMinImageVerticallyByOp(&transposed_dst_image,
+                  &transposed_src_image, size, op, border, p_canvas));
+  return TransposeMinImage(p_dst_image, &transposed_dst_image);
+}
+
+MINIMGAPI_API int MinMaxFilterMinImage(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    int           filter_width,
+    int           filter_height,
+    IdOp          op,
+    BorderOption  border,
+    const void   *p_canvas) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_MinMaxFilterMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (_CompareMinImagePrototypes(p_dst_image, p_src_image))
+    return BAD_ARGS;
+  if (filter_width < 1 || filter_height < 1)
+    return BAD_ARGS;
+  if (op != IDOP_MIN && op != IDOP_MAX)
+    return BAD_ARGS;
+  if (border == BO_CONSTANT && !p_canvas)
+    return BAD_ARGS;
+  if (border == BO_IGNORE)
+    return NOT_SUPPORTED;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  if (filter_width == 1 && filter_height == 1)
+    return CopyMinImage(p_dst_image, p_src_image);
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, p_src_image));
+  const MinImg *p_work_src_image = p_src_image;
+  DECLARE_GUARDED_MINIMG(tmp_src_image);
+  if (tangling != TCR_INDEPENDENT_IMAGES) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&tmp_src_image, p_src_image));
+    PROPAGATE_ERROR(CopyMinImage(&tmp_src_image, p_src_image));
+    p_work_src_image = &tmp_src_image;
+  }
+
+  if (filter_width == 1)
+    return FilterMinImageVerticallyByOp(p_dst_image, p_work_src_image,
+                                        filter_height, op, border, p_canvas);
+  if (filter_height == 1)
+    return FilterMinImageHorizontallyByOp(p_dst_image, p_work_src_image,
+                                          filter_width, op, border, p_canvas);
+
+  DECLARE_GUARDED_MINIMG(columns_image);
+  PROPAGATE_ERROR(_CloneMinImagePrototype(&columns_image, p_dst_image));
+  PROPAGATE_ERROR(FilterMinImageVerticallyByOp(&columns_image, p_work_src_image,
+                                       filter_height, op, border, p_canvas));
+  return FilterMinImageHorizontallyByOp(p_dst_image, &columns_image,
+                                        filter_width, op, border, p_canvas);
+}
@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef MINIMGAPI_PARALLEL_H_INCLUDED
+#define MINIMGAPI_PARALLEL_H_INCLUDED
+
+#include <algorithm>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// The minimal number of elements worth to be processed by a separate thread.
+const int64_t MIN_ELEMENTS_PER_THREAD = 1 << 16;
+
+static MUSTINLINE int GetMaxThreadCount() {
+#if defined(_OPENMP)
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+static MUSTINLINE int GetThreadNumber() {
+#if defined(_OPENMP)
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/// Returns the number of threads to split @c num_tasks independent tasks of
+/// @c num_elements elements in total between.
+static MUSTINLINE int ChooseThreadCount(
+    int     num_tasks,
+    int64_t num_elements) {
+  int64_t by_work = std::max<int64_t>(1, num_elements / MIN_ELEMENTS_PER_THREAD);
+  return static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(
+                  std::min<int64_t>(GetMaxThreadCount(), num_tasks), by_work)));
+}
+
+#endif // MINIMGAPI_PARALLEL_H_INCLUDED
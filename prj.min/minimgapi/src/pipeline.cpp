@@ -0,0 +1,450 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/minimgapi-pipeline.hpp>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "vector/arithmetic-inl.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_MinImgPipeline_Execute, "MinImgPipeline::Execute");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Transposing chains are executed by square tiles whose source pixels fit into
+// this number of bytes, so that the source lines a tile touches stay cached.
+static const int PIPELINE_TILE_BYTES = 1 << 15;
+
+static bool IsConvertibleType(
+    MinTyp type) {
+  return type != TYP_UINT1 && type != TYP_REAL16 &&
+         _GetDepthByTyp(type) > 0;
+}
+
+template<typename TSrc, typename TDst>
+static void ConvertElements(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    int            len) {
+  TDst *p_d = reinterpret_cast<TDst *>(p_dst);
+  const TSrc *p_s = reinterpret_cast<const TSrc *>(p_src);
+  for (int i = 0; i < len; ++i)
+    p_d[i] = round_cast<TDst>(static_cast<double>(p_s[i]));
+}
+
+template<typename TSrc>
+static int ConvertElementsTo(
+    uint8_t       *p_dst,
+    MinTyp         dst_type,
+    const uint8_t *p_src,
+    int            len) {
+  switch (dst_type) {
+  case TYP_UINT8:  ConvertElements<TSrc, uint8_t>(p_dst, p_src, len);  break;
+  case TYP_INT8:   ConvertElements<TSrc, int8_t>(p_dst, p_src, len);   break;
+  case TYP_UINT16: ConvertElements<TSrc, uint16_t>(p_dst, p_src, len); break;
+  case TYP_INT16:  ConvertElements<TSrc, int16_t>(p_dst, p_src, len);  break;
+  case TYP_UINT32: ConvertElements<TSrc, uint32_t>(p_dst, p_src, len); break;
+  case TYP_INT32:  ConvertElements<TSrc, int32_t>(p_dst, p_src, len);  break;
+  case TYP_UINT64: ConvertElements<TSrc, uint64_t>(p_dst, p_src, len); break;
+  case TYP_INT64:  ConvertElements<TSrc, int64_t>(p_dst, p_src, len);  break;
+  case TYP_REAL32: ConvertElements<TSrc, real32_t>(p_dst, p_src, len); break;
+  case TYP_REAL64: ConvertElements<TSrc, real64_t>(p_dst, p_src, len); break;
+  default:         return NOT_IMPLEMENTED;
+  }
+  return NO_ERRORS;
+}
+
+static int ConvertElements(
+    uint8_t       *p_dst,
+    MinTyp         dst_type,
+    const uint8_t *p_src,
+    MinTyp         src_type,
+    int            len) {
+  if (dst_type == src_type) {
+    ::memcpy(p_dst, p_src, len * _GetDepthByTyp(src_type));
+    return NO_ERRORS;
+  }
+  switch (src_type) {
+  case TYP_UINT8:  return ConvertElementsTo<uint8_t>(p_dst, dst_type, p_src, len);
+  case TYP_INT8:   return ConvertElementsTo<int8_t>(p_dst, dst_type, p_src, len);
+  case TYP_UINT16: return ConvertElementsTo<uint16_t>(p_dst, dst_type, p_src, len);
+  case TYP_INT16:  return ConvertElementsTo<int16_t>(p_dst, dst_type, p_src, len);
+  case TYP_UINT32: return ConvertElementsTo<uint32_t>(p_dst, dst_type, p_src, len);
+  case TYP_INT32:  return ConvertElementsTo<int32_t>(p_dst, dst_type, p_src, len);
+  case TYP_UINT64: return ConvertElementsTo<uint64_t>(p_dst, dst_type, p_src, len);
+  case TYP_INT64:  return ConvertElementsTo<int64_t>(p_dst, dst_type, p_src, len);
+  case TYP_REAL32: return ConvertElementsTo<real32_t>(p_dst, dst_type, p_src, len);
+  case TYP_REAL64: return ConvertElementsTo<real64_t>(p_dst, dst_type, p_src, len);
+  default:         return NOT_IMPLEMENTED;
+  }
+}
+
+// Copies the pixel at p_rows[i * row_step] + p_offsets[i * offset_step] to
+// the i-th position of the destination, so that both row-wise (fixed line,
+// varying offsets) and transposed (varying lines, fixed offset) gathers share
+// the code.
+template<typename TChunk>
+static void GatherPixels(
+    uint8_t              *p_dst,
+    const uint8_t *const *p_rows,
+    int                   row_step,
+    const int            *p_offsets,
+    int                   offset_step,
+    int                   count,
+    int                   chunks_per_pixel) {
+  TChunk *p_d = reinterpret_cast<TChunk *>(p_dst);
+  for (int i = 0; i < count; ++i) {
+    const TChunk *p_s = reinterpret_cast<const TChunk *>(
+                            p_rows[i * row_step] + p_offsets[i * offset_step]);
+    for (int chunk = 0; chunk < chunks_per_pixel; ++chunk)
+      *p_d++ = p_s[chunk];
+  }
+}
+
+// The same as GatherPixels() for bit images, offsets are given in bits.
+static void GatherBitPixels(
+    uint8_t              *p_dst_line,
+    int                   dst_bit,
+    const uint8_t *const *p_rows,
+    int                   row_step,
+    const int            *p_offsets,
+    int                   offset_step,
+    int                   count,
+    int                   bits_per_pixel) {
+  for (int i = 0; i < count; ++i) {
+    const uint8_t *p_row = p_rows[i * row_step];
+    int src_bit = p_offsets[i * offset_step];
+    for (int b = 0; b < bits_per_pixel; ++b, ++dst_bit) {
+      if (GET_IMAGE_LINE_BIT(p_row, src_bit + b))
+        SET_IMAGE_LINE_BIT(p_dst_line, dst_bit);
+      else
+        CLEAR_IMAGE_LINE_BIT(p_dst_line, dst_bit);
+    }
+  }
+}
+
+struct PipelineGeometry {
+  std::vector<const uint8_t *> rows;  // Source lines by result rows (columns
+                                      // for transposing chains).
+  std::vector<int> offsets;           // Source offsets by result columns
+                                      // (rows for transposing chains).
+  bool transposed;
+  int  tile_width;
+  int  tile_height;
+};
+
+static void ExecuteTileRow(
+    const MinImg           *p_dst_image,
+    const MinImg           *p_src_image,
+    const PipelineGeometry &geometry,
+    const MinTyp           *p_types,
+    int                     num_types,
+    int                     y_begin,
+    int                     y_end,
+    uint8_t                *p_buffers[2]) {
+  const int pixel_bits = _GetMinImageBitsPerPixel(p_src_image);
+  const int pixel_bytes = pixel_bits >> 3;
+  const int channels = p_src_image->channels;
+  int chunk_size = 8;
+  while (pixel_bytes % chunk_size)
+    chunk_size >>= 1;
+  const int chunks_per_pixel = pixel_bytes / chunk_size;
+  MinTyp src_type = static_cast<MinTyp>(_GetMinImageType(p_src_image));
+  const int dst_pixel_bytes = _GetMinImageBitsPerPixel(p_dst_image) >> 3;
+
+  for (int x0 = 0; x0 < p_dst_image->width; x0 += geometry.tile_width) {
+    const int count = std::min(geometry.tile_width, p_dst_image->width - x0);
+    for (int y = y_begin; y < y_end; ++y) {
+      const uint8_t *const *p_rows = geometry.transposed ?
+                                     &geometry.rows[x0] : &geometry.rows[y];
+      const int *p_offsets = geometry.transposed ?
+                             &geometry.offsets[y] : &geometry.offsets[x0];
+      const int row_step = geometry.transposed ? 1 : 0;
+      const int offset_step = geometry.transposed ? 0 : 1;
+      uint8_t *p_dst_line = _GetMinImageLine(p_dst_image, y);
+
+      if (pixel_bits & 0x07) {
+        GatherBitPixels(p_dst_line, x0 * pixel_bits, p_rows, row_step,
+                        p_offsets, offset_step, count, pixel_bits);
+        continue;
+      }
+
+      uint8_t *p_gathered = num_types ? p_buffers[0] :
+                                        p_dst_line + x0 * dst_pixel_bytes;
+      switch (chunk_size) {
+      case 8:
+        GatherPixels<uint64_t>(p_gathered, p_rows, row_step, p_offsets,
+                               offset_step, count, chunks_per_pixel);
+        break;
+      case 4:
+        GatherPixels<uint32_t>(p_gathered, p_rows, row_step, p_offsets,
+                               offset_step, count, chunks_per_pixel);
+        break;
+      case 2:
+        GatherPixels<uint16_t>(p_gathered, p_rows, row_step, p_offsets,
+                               offset_step, count, chunks_per_pixel);
+        break;
+      default:
+        GatherPixels<uint8_t>(p_gathered, p_rows, row_step, p_offsets,
+                              offset_step, count, chunks_per_pixel);
+        break;
+      }
+
+      MinTyp type = src_type;
+      for (int i = 0; i < num_types; ++i) {
+        uint8_t *p_converted = i + 1 < num_types ? p_buffers[(i + 1) & 1] :
+                               p_dst_line + x0 * dst_pixel_bytes;
+        ConvertElements(p_converted, p_types[i], p_buffers[i & 1], type,
+                        count * channels);
+        type = p_types[i];
+      }
+    }
+  }
+}
+
+MinImgPipeline::MinImgPipeline(const MinImg &src_image)
+    : src_image(src_image), x_map(), y_map(), transposed(false), types() {
+  if (_AssureMinImageIsValid(&src_image) != NO_ERRORS)
+    return;
+  x_map.resize(src_image.width);
+  for (int x = 0; x < src_image.width; ++x)
+    x_map[x] = x;
+  y_map.resize(src_image.height);
+  for (int y = 0; y < src_image.height; ++y)
+    y_map[y] = y;
+}
+
+MinTyp MinImgPipeline::GetResultType() const {
+  return types.empty() ? static_cast<MinTyp>(_GetMinImageType(&src_image)) :
+                         types.back();
+}
+
+int MinImgPipeline::Crop(int x0, int y0, int width, int height) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  if (x0 < 0 || width < 0 || x0 + width > static_cast<int>(x_map.size()))
+    return BAD_ARGS;
+  if (y0 < 0 || height < 0 || y0 + height > static_cast<int>(y_map.size()))
+    return BAD_ARGS;
+
+  x_map.erase(x_map.begin() + x0 + width, x_map.end());
+  x_map.erase(x_map.begin(), x_map.begin() + x0);
+  y_map.erase(y_map.begin() + y0 + height, y_map.end());
+  y_map.erase(y_map.begin(), y_map.begin() + y0);
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::Slice(int begin, int period, int end) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  const int height = static_cast<int>(y_map.size());
+  if (end < 0)
+    end = height;
+  if (begin < 0 || end < begin || height < end || period <= 0)
+    return BAD_ARGS;
+
+  std::vector<int> sliced((end - begin + period - 1) / period);
+  for (size_t i = 0; i < sliced.size(); ++i)
+    sliced[i] = y_map[begin + i * period];
+  y_map.swap(sliced);
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::Flip(DirectionOption direction) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  if (direction != DO_VERTICAL && direction != DO_HORIZONTAL &&
+      direction != DO_BOTH)
+    return BAD_ARGS;
+
+  if (direction != DO_VERTICAL)
+    std::reverse(x_map.begin(), x_map.end());
+  if (direction != DO_HORIZONTAL)
+    std::reverse(y_map.begin(), y_map.end());
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::Transpose() {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  x_map.swap(y_map);
+  transposed = !transposed;
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::RotateBy90(int num_rotations) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  switch ((num_rotations % 4 + 4) % 4) {
+  case 1:
+    SHOULD_WORK(Transpose());
+    return Flip(DO_HORIZONTAL);
+  case 2:
+    return Flip(DO_BOTH);
+  case 3:
+    SHOULD_WORK(Transpose());
+    return Flip(DO_VERTICAL);
+  default:
+    return NO_ERRORS;
+  }
+}
+
+int MinImgPipeline::Resample(int width, int height, double x_phase,
+                             double y_phase) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  const int src_width = static_cast<int>(x_map.size());
+  const int src_height = static_cast<int>(y_map.size());
+  if (width < 0 || height < 0)
+    return BAD_ARGS;
+  if ((width && !src_width) || (height && !src_height))
+    return BAD_ARGS;
+
+  // The same source pixel selection as in ResampleMinImage().
+  x_phase -= std::floor(x_phase);
+  y_phase -= std::floor(y_phase);
+  std::vector<int> resampled_x(width), resampled_y(height);
+  double x_quotient = src_width / (width + 0.);
+  for (int x = 0; x < width; ++x)
+    resampled_x[x] = x_map[std::min(src_width - 1,
+                         static_cast<int>((x + x_phase) * x_quotient))];
+  double y_quotient = src_height / (height + 0.);
+  for (int y = 0; y < height; ++y)
+    resampled_y[y] = y_map[std::min(src_height - 1,
+                         static_cast<int>((y + y_phase) * y_quotient))];
+  x_map.swap(resampled_x);
+  y_map.swap(resampled_y);
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::Retype(MinTyp type) {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  if (_GetDepthByTyp(type) < 0)
+    return BAD_ARGS;
+  if (!IsConvertibleType(type) || !IsConvertibleType(GetResultType()))
+    return NOT_IMPLEMENTED;
+
+  types.push_back(type);
+  return NO_ERRORS;
+}
+
+int MinImgPipeline::CloneResultPrototype(
+    MinImg          *p_dst_image,
+    AllocationOption allocation) const {
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  return NewMinImagePrototype(p_dst_image, static_cast<int>(x_map.size()),
+                              static_cast<int>(y_map.size()),
+                              src_image.channels, GetResultType(),
+                              src_image.addressSpace, allocation);
+}
+
+int MinImgPipeline::Execute(const MinImg *p_dst_image) const {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_MinImgPipeline_Execute);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(&src_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  MinImg prototype = {0};
+  PROPAGATE_ERROR(CloneResultPrototype(&prototype, AO_EMPTY));
+  if (_CompareMinImagePrototypes(p_dst_image, &prototype))
+    return BAD_ARGS;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (p_dst_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  uint32_t tangling = 0;
+  PROPAGATE_ERROR(CheckMinImagesTangle(&tangling, p_dst_image, &src_image));
+  const MinImg *p_src_image = &src_image;
+  DECLARE_GUARDED_MINIMG(tmp_image);
+  if (tangling != TCR_INDEPENDENT_IMAGES) {
+    PROPAGATE_ERROR(_CloneMinImagePrototype(&tmp_image, &src_image));
+    PROPAGATE_ERROR(CopyMinImage(&tmp_image, &src_image));
+    p_src_image = &tmp_image;
+  }
+
+  const int width = p_dst_image->width;
+  const int height = p_dst_image->height;
+  const int pixel_bits = _GetMinImageBitsPerPixel(p_src_image);
+  const int offset_scale = pixel_bits & 0x07 ? pixel_bits : pixel_bits >> 3;
+
+  PipelineGeometry geometry;
+  geometry.transposed = transposed;
+  const std::vector<int> &row_map = transposed ? x_map : y_map;
+  const std::vector<int> &offset_map = transposed ? y_map : x_map;
+  geometry.rows.resize(row_map.size());
+  for (size_t i = 0; i < row_map.size(); ++i)
+    geometry.rows[i] = _GetMinImageLine(p_src_image, row_map[i]);
+  geometry.offsets.resize(offset_map.size());
+  for (size_t i = 0; i < offset_map.size(); ++i)
+    geometry.offsets[i] = offset_map[i] * offset_scale;
+
+  if (transposed) {
+    const int pixel_bytes = std::max(1, pixel_bits >> 3);
+    int side = 8;
+    while (4 * side * side * pixel_bytes <= PIPELINE_TILE_BYTES)
+      side <<= 1;
+    geometry.tile_width = side;
+    geometry.tile_height = side;
+  } else {
+    geometry.tile_width = width;
+    geometry.tile_height = 1;
+  }
+
+  const int num_tile_rows = (height + geometry.tile_height - 1) /
+                            geometry.tile_height;
+  const int num_threads = ChooseThreadCount(num_tile_rows,
+      static_cast<int64_t>(width) * height * p_src_image->channels);
+  const int buffer_size = geometry.tile_width * p_src_image->channels * 8;
+  const MinTyp *p_types = types.empty() ? NULL : &types[0];
+  const int num_types = static_cast<int>(types.size());
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int band = 0; band < num_threads; ++band) {
+    scoped_cpp_array<uint8_t> buffers(new uint8_t[2 * buffer_size]);
+    uint8_t *p_buffers[2] = {&buffers[0], &buffers[buffer_size]};
+    const int tile_row_begin = static_cast<int>(
+        static_cast<int64_t>(num_tile_rows) * band / num_threads);
+    const int tile_row_end = static_cast<int>(
+        static_cast<int64_t>(num_tile_rows) * (band + 1) / num_threads);
+    for (int tile_row = tile_row_begin; tile_row < tile_row_end; ++tile_row) {
+      const int y_begin = tile_row * geometry.tile_height;
+      const int y_end = std::min(height, y_begin + geometry.tile_height);
+      ExecuteTileRow(p_dst_image, p_src_image, geometry, p_types, num_types,
+                     y_begin, y_end, p_buffers);
+    }
+  }
+
+  return NO_ERRORS;
+}
@@ -0,0 +1,416 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+
+#include <minutils/minerr.h>
+#include <minutils/mathoper.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minimgapi/imgguard.hpp>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+#include "vector/reduce-inl.h"
+#include "parallel.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_ReduceMinImage, "ReduceMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+// Lines are reduced by chunks of that many pixels, so that the vertical
+// kernels can be reused for horizontal reductions.
+static const int REDUCE_CHUNK_PIXELS = 64;
+
+template<typename TDst, typename TSrc>
+static MUSTINLINE TDst ReduceCast(TSrc value) {
+  if (!std::numeric_limits<TSrc>::is_integer ||
+      !std::numeric_limits<TDst>::is_integer)
+    return round_cast<TDst>(static_cast<real64_t>(value));
+  if (std::numeric_limits<TSrc>::is_signed && value < TSrc(0)) {
+    if (!std::numeric_limits<TDst>::is_signed ||
+        static_cast<int64_t>(value) <
+        static_cast<int64_t>(std::numeric_limits<TDst>::min()))
+      return std::numeric_limits<TDst>::min();
+    return static_cast<TDst>(value);
+  }
+  if (static_cast<uint64_t>(value) >
+      static_cast<uint64_t>(std::numeric_limits<TDst>::max()))
+    return std::numeric_limits<TDst>::max();
+  return static_cast<TDst>(value);
+}
+
+template<typename TDst, typename TAcc>
+static void StoreReducedValues(
+    uint8_t    *p_dst,
+    const TAcc *p_values,
+    int         count) {
+  TDst *p = reinterpret_cast<TDst *>(p_dst);
+  for (int i = 0; i < count; ++i)
+    p[i] = ReduceCast<TDst>(p_values[i]);
+}
+
+// Stores the reduced values to the given line of the destination image
+// converting them to the destination type with saturation.
+template<typename TAcc>
+static int StoreReducedLine(
+    const MinImg *p_dst_image,
+    int           y,
+    const TAcc   *p_values,
+    int           count) {
+  uint8_t *p_dst = _GetMinImageLine(p_dst_image, y);
+  if (!p_dst)
+    return INTERNAL_ERROR;
+  switch (_GetMinImageType(p_dst_image)) {
+  case TYP_UINT8:
+    StoreReducedValues<uint8_t>(p_dst, p_values, count);
+    break;
+  case TYP_INT8:
+    StoreReducedValues<int8_t>(p_dst, p_values, count);
+    break;
+  case TYP_UINT16:
+    StoreReducedValues<uint16_t>(p_dst, p_values, count);
+    break;
+  case TYP_INT16:
+    StoreReducedValues<int16_t>(p_dst, p_values, count);
+    break;
+  case TYP_UINT32:
+    StoreReducedValues<uint32_t>(p_dst, p_values, count);
+    break;
+  case TYP_INT32:
+    StoreReducedValues<int32_t>(p_dst, p_values, count);
+    break;
+  case TYP_UINT64:
+    StoreReducedValues<uint64_t>(p_dst, p_values, count);
+    break;
+  case TYP_INT64:
+    StoreReducedValues<int64_t>(p_dst, p_values, count);
+    break;
+  case TYP_REAL32:
+    StoreReducedValues<real32_t>(p_dst, p_values, count);
+    break;
+  case TYP_REAL64:
+    StoreReducedValues<real64_t>(p_dst, p_values, count);
+    break;
+  default:
+    return NOT_IMPLEMENTED;
+  }
+  return NO_ERRORS;
+}
+
+// Returns the source line as an array of elements; bit lines are unpacked
+// to the buffer as bytes of zeros and ones.
+template<typename T>
+static MUSTINLINE const T *GetReducedLine(
+    const uint8_t *p_line,
+    uint8_t       *p_bits,
+    int            len) {
+  if (!p_bits)
+    return reinterpret_cast<const T *>(p_line);
+  for (int x = 0; x < len; ++x)
+    p_bits[x] = GET_IMAGE_LINE_BIT(p_line, x) ? 1 : 0;
+  return reinterpret_cast<const T *>(p_bits);
+}
+
+// Reduces the lines [y_begin, y_end) of the source image element-wise.
+template<typename T, int op>
+static void ReduceLinesVertically(
+    typename Reducer<T, op>::acc_t  *p_acc,
+    typename Reducer<T, op>::part_t *p_part,
+    uint8_t                         *p_bits,
+    const MinImg                    *p_src_image,
+    int                              y_begin,
+    int                              y_end) {
+  typedef Reducer<T, op> R;
+  const int len = p_src_image->width * p_src_image->channels;
+  const int period = R::period;
+  std::fill(p_acc, p_acc + len, R::identity());
+  const uint8_t *p_line = _GetMinImageLine(p_src_image, y_begin);
+  for (int y = y_begin; y < y_end; ) {
+    int block_end = y + std::min(period, y_end - y);
+    std::fill(p_part, p_part + len, R::part_identity());
+    for (; y < block_end; ++y, p_line += p_src_image->stride)
+      R::accumulate(p_part, GetReducedLine<T>(p_line, p_bits, len), len);
+    R::merge(p_acc, p_part, len);
+  }
+}
+
+// Reduces a line to a value per channel. The line is folded into a chunk of
+// REDUCE_CHUNK_PIXELS pixels first, so that the vertical kernels do the bulk
+// of work.
+template<typename T, int op>
+static void ReduceLineHorizontally(
+    typename Reducer<T, op>::acc_t  *p_result,
+    typename Reducer<T, op>::acc_t  *p_acc,
+    typename Reducer<T, op>::part_t *p_part,
+    const T                         *p_line,
+    int                              width,
+    int                              channels) {
+  typedef Reducer<T, op> R;
+  const int len = width * channels;
+  const int chunk_len = REDUCE_CHUNK_PIXELS * channels;
+  const int acc_len = std::min(len, chunk_len);
+  const int period = R::period;
+  std::fill(p_acc, p_acc + acc_len, R::identity());
+  for (int x = 0; x < len; ) {
+    std::fill(p_part, p_part + acc_len, R::part_identity());
+    for (int k = 0; k < period && x < len; ++k, x += chunk_len)
+      R::accumulate(p_part, p_line + x, std::min(chunk_len, len - x));
+    R::merge(p_acc, p_part, acc_len);
+  }
+  for (int c = 0; c < channels; ++c) {
+    p_result[c] = R::identity();
+    for (int i = c; i < acc_len; i += channels)
+      p_result[c] = R::fold(p_result[c], p_acc[i]);
+  }
+}
+
+// Folds groups of channels of each pixel into a single value and finalizes
+// the values.
+template<typename T, int op>
+static void FinalizeReducedValues(
+    typename Reducer<T, op>::acc_t *p_values,
+    int                             num_pixels,
+    int                             channels,
+    bool                            fold_channels) {
+  typedef Reducer<T, op> R;
+  if (fold_channels) {
+    for (int i = 0; i < num_pixels; ++i) {
+      typename R::acc_t value = p_values[i * channels];
+      for (int c = 1; c < channels; ++c)
+        value = R::fold(value, p_values[i * channels + c]);
+      p_values[i] = value;
+    }
+    channels = 1;
+  }
+  for (int i = 0; i < num_pixels * channels; ++i)
+    p_values[i] = R::finalize(p_values[i]);
+}
+
+template<typename T, int op>
+static int ReduceMinImageRows(
+    const MinImg *p_dst_image,
+    const MinImg *p_src_image,
+    bool          unpack_bits) {
+  typedef Reducer<T, op> R;
+  typedef typename R::acc_t acc_t;
+  typedef typename R::part_t part_t;
+  const int channels = p_src_image->channels;
+  const int height = p_src_image->height;
+  const int len = p_src_image->width * channels;
+  const int chunk_len = std::min(len, REDUCE_CHUNK_PIXELS * channels);
+  const int num_threads = ChooseThreadCount(height,
+                                            static_cast<int64_t>(len) * height);
+
+  scoped_cpp_array<acc_t> results(new acc_t[height * channels]);
+  scoped_cpp_array<acc_t> accs(new acc_t[num_threads * chunk_len]);
+  scoped_cpp_array<part_t> parts(new part_t[num_threads * chunk_len]);
+  scoped_cpp_array<uint8_t> bits(unpack_bits ?
+                                 new uint8_t[num_threads * len] : NULL);
+
+#pragma omp parallel for num_threads(num_threads)
+  for (int y = 0; y < height; ++y) {
+    const int thread = GetThreadNumber();
+    uint8_t *p_bits = unpack_bits ? &bits[thread * len] : NULL;
+    ReduceLineHorizontally<T, op>(&results[y * channels],
+                                  &accs[thread * chunk_len],
+                                  &parts[thread * chunk_len],
+                                  GetReducedLine<T>(_GetMinImageLine(p_src_image, y),
+                                                    p_bits, len),
+                                  p_src_image->width, channels);
+  }
+
+  const bool fold_channels = p_dst_image->channels != channels;
+  FinalizeReducedValues<T, op>(&results[0], height, channels, fold_channels);
+  const int dst_channels = p_dst_image->channels;
+  for (int y = 0; y < height; ++y)
+    PROPAGATE_ERROR(StoreReducedLine(p_dst_image, y,
+                                     &results[y * dst_channels], dst_channels));
+
+  return NO_ERRORS;
+}
+
+template<typename T, int op>
+static int ReduceMinImageColumns(
+    const MinImg    *p_dst_image,
+    const MinImg    *p_src_image,
+    DirectionOption  direction,
+    bool             unpack_bits) {
+  typedef Reducer<T, op> R;
+  typedef typename R::acc_t acc_t;
+  typedef typename R::part_t part_t;
+  const int channels = p_src_image->channels;
+  const int width = p_src_image->width;
+  const int height = p_src_image->height;
+  const int len = width * channels;
+  const int num_bands = ChooseThreadCount(height,
+                                          static_cast<int64_t>(len) * height);
+
+  scoped_cpp_array<acc_t> accs(new acc_t[num_bands * len]);
+  scoped_cpp_array<part_t> parts(new part_t[num_bands * len]);
+  scoped_cpp_array<uint8_t> bits(unpack_bits ?
+                                 new uint8_t[num_bands * len] : NULL);
+
+  // Each thread reduces its own band of lines...
+#pragma omp parallel for num_threads(num_bands)
+  for (int band = 0; band < num_bands; ++band) {
+    int y_begin = static_cast<int>(static_cast<int64_t>(height) * band /
+                                   num_bands);
+    int y_end = static_cast<int>(static_cast<int64_t>(height) * (band + 1) /
+                                 num_bands);
+    ReduceLinesVertically<T, op>(&accs[band * len], &parts[band * len],
+                                 unpack_bits ? &bits[band * len] : NULL,
+                                 p_src_image, y_begin, y_end);
+  }
+
+  // ...and then the bands are combined pairwise in a tree.
+  for (int step = 1; step < num_bands; step <<= 1) {
+#pragma omp parallel for num_threads(num_bands / (2 * step) + 1)
+    for (int band = 0; band < num_bands - step; band += 2 * step)
+      R::combine(&accs[band * len], &accs[(band + step) * len], len);
+  }
+
+  const bool fold_channels = p_dst_image->channels != channels;
+  acc_t *p_values = &accs[0];
+  int num_pixels = width;
+  if (direction == DO_BOTH) {
+    for (int c = 0; c < channels; ++c) {
+      acc_t value = p_values[c];
+      for (int i = c + channels; i < len; i += channels)
+        value = R::fold(value, p_values[i]);
+      p_values[c] = value;
+    }
+    num_pixels = 1;
+  }
+  FinalizeReducedValues<T, op>(p_values, num_pixels, channels, fold_channels);
+  return StoreReducedLine(p_dst_image, 0, p_values,
+                          num_pixels * p_dst_image->channels);
+}
+
+template<typename T, int op>
+static int ReduceMinImageTyped(
+    const MinImg    *p_dst_image,
+    const MinImg    *p_src_image,
+    DirectionOption  direction,
+    bool             unpack_bits) {
+  if (direction == DO_HORIZONTAL)
+    return ReduceMinImageRows<T, op>(p_dst_image, p_src_image, unpack_bits);
+  return ReduceMinImageColumns<T, op>(p_dst_image, p_src_image, direction,
+                                      unpack_bits);
+}
+
+template<int op>
+static int ReduceMinImageByType(
+    const MinImg    *p_dst_image,
+    const MinImg    *p_src_image,
+    DirectionOption  direction) {
+  switch (_GetMinImageType(p_src_image)) {
+  case TYP_UINT1:
+    return ReduceMinImageTyped<uint8_t, op>(p_dst_image, p_src_image,
+                                            direction, true);
+  case TYP_UINT8:
+    return ReduceMinImageTyped<uint8_t, op>(p_dst_image, p_src_image,
+                                            direction, false);
+  case TYP_INT8:
+    return ReduceMinImageTyped<int8_t, op>(p_dst_image, p_src_image,
+                                           direction, false);
+  case TYP_UINT16:
+    return ReduceMinImageTyped<uint16_t, op>(p_dst_image, p_src_image,
+                                             direction, false);
+  case TYP_INT16:
+    return ReduceMinImageTyped<int16_t, op>(p_dst_image, p_src_image,
+                                            direction, false);
+  case TYP_UINT32:
+    return ReduceMinImageTyped<uint32_t, op>(p_dst_image, p_src_image,
+                                             direction, false);
+  case TYP_INT32:
+    return ReduceMinImageTyped<int32_t, op>(p_dst_image, p_src_image,
+                                            direction, false);
+  case TYP_UINT64:
+    return ReduceMinImageTyped<uint64_t, op>(p_dst_image, p_src_image,
+                                             direction, false);
+  case TYP_INT64:
+    return ReduceMinImageTyped<int64_t, op>(p_dst_image, p_src_image,
+                                            direction, false);
+  case TYP_REAL32:
+    return ReduceMinImageTyped<real32_t, op>(p_dst_image, p_src_image,
+                                             direction, false);
+  case TYP_REAL64:
+    return ReduceMinImageTyped<real64_t, op>(p_dst_image, p_src_image,
+                                             direction, false);
+  default:
+    return NOT_IMPLEMENTED;
+  }
+}
+
+MINIMGAPI_API int ReduceMinImage(
+    const MinImg    *p_dst_image,
+    const MinImg    *p_src_image,
+    DirectionOption  direction,
+    AsCoOp           op) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ReduceMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+
+  int dst_width = direction == DO_VERTICAL ? p_src_image->width : 1;
+  int dst_height = direction == DO_HORIZONTAL ? p_src_image->height : 1;
+  if (direction != DO_VERTICAL && direction != DO_HORIZONTAL &&
+      direction != DO_BOTH)
+    return BAD_ARGS;
+  if (p_dst_image->width != dst_width || p_dst_image->height != dst_height)
+    return BAD_ARGS;
+  if (p_dst_image->channels != p_src_image->channels &&
+      p_dst_image->channels != 1)
+    return BAD_ARGS;
+  if (_AssureMinImageIsEmpty(p_dst_image) == NO_ERRORS)
+    return NO_ERRORS;
+  if (_AssureMinImageIsEmpty(p_src_image) == NO_ERRORS)
+    return NO_SENSE;
+  if (p_dst_image->addressSpace != 0 || p_src_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+
+  switch (op) {
+  case ASCOOP_MIN:
+    return ReduceMinImageByType<OP_MIN>(p_dst_image, p_src_image, direction);
+  case ASCOOP_MAX:
+    return ReduceMinImageByType<OP_MAX>(p_dst_image, p_src_image, direction);
+  case ASCOOP_ADD:
+    return ReduceMinImageByType<OP_ADD>(p_dst_image, p_src_image, direction);
+  case ASCOOP_MUL:
+    return ReduceMinImageByType<OP_MUL>(p_dst_image, p_src_image, direction);
+  case ASCOOP_EUC:
+    return ReduceMinImageByType<OP_EUC>(p_dst_image, p_src_image, direction);
+  default:
+    return BAD_ARGS;
+  }
+}
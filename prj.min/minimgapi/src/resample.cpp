@@ -219,6 +219,9 @@ MINIMGAPI_API int ResampleMinImage(
     const MinImg *p_src_image,
     double        x_phase,
     double        y_phase) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_ResampleMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
   PROPAGATE_ERROR(_AssureMinImageIsValid(p_dst_image));
   PROPAGATE_ERROR(_CompareMinImagePixels(p_dst_image, p_src_image));
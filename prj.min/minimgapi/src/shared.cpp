@@ -0,0 +1,249 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <map>
+#include <new>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/minimgapi-inl.h>
+#include <minutils/crossplat.h>
+#include "shared.h"
+
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_RetainMinImage, "RetainMinImage");
+DECLARE_MINSTOPWATCH(gsw_UnshareMinImage, "UnshareMinImage");
+DECLARE_MINSTOPWATCH(gsw_GetMinImageReferenceCount,
+                     "GetMinImageReferenceCount");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
+namespace {
+
+class Mutex {
+public:
+#if defined(_WIN32)
+  Mutex() { InitializeCriticalSection(&section); }
+  ~Mutex() { DeleteCriticalSection(&section); }
+  void Lock() { EnterCriticalSection(&section); }
+  void Unlock() { LeaveCriticalSection(&section); }
+#else
+  Mutex() { pthread_mutex_init(&mutex, NULL); }
+  ~Mutex() { pthread_mutex_destroy(&mutex); }
+  void Lock() { pthread_mutex_lock(&mutex); }
+  void Unlock() { pthread_mutex_unlock(&mutex); }
+#endif
+
+private:
+  Mutex(const Mutex &);
+  void operator =(const Mutex &);
+
+#if defined(_WIN32)
+  CRITICAL_SECTION section;
+#else
+  pthread_mutex_t mutex;
+#endif
+};
+
+class ScopedLock {
+public:
+  explicit ScopedLock(Mutex &mutex) : mutex(mutex) { mutex.Lock(); }
+  ~ScopedLock() { mutex.Unlock(); }
+
+private:
+  ScopedLock(const ScopedLock &);
+  void operator =(const ScopedLock &);
+
+  Mutex &mutex;
+};
+
+// Counts the references to the shared buffers. Buffers which have never been
+// shared, or whose other references have all been released, are not listed
+// and have a single reference implicitly, so the table stays as small as the
+// number of buffers shared at the moment. The number of listed buffers is
+// also kept in an atomic counter, so that releasing a buffer while nothing is
+// shared, which is what FreeMinImage() mostly does, takes neither the lock nor
+// the lookup.
+class ReferenceTable {
+public:
+  static ReferenceTable &Instance() {
+    static ReferenceTable table;
+    return table;
+  }
+
+  int Retain(const uint8_t *p_buffer) {
+    ScopedLock lock(mutex);
+    try {
+      int &count = counts[p_buffer];
+      if (!count)
+        AddShared(1);
+      count = count ? count + 1 : 2;
+    } catch (const std::bad_alloc &) {
+      return NO_MEMORY;
+    }
+    return NO_ERRORS;
+  }
+
+  bool Release(const uint8_t *p_buffer) {
+    // The caller owns a reference, so if the buffer is listed, the listing
+    // happened before the reference was handed to the caller, and the caller
+    // sees a nonzero counter.
+    if (!AddShared(0))
+      return true;
+    ScopedLock lock(mutex);
+    std::map<const uint8_t *, int>::iterator it = counts.find(p_buffer);
+    if (it == counts.end())
+      return true;
+    if (--it->second == 1) {
+      counts.erase(it);
+      AddShared(-1);
+    }
+    return false;
+  }
+
+  int Count(const uint8_t *p_buffer) {
+    if (!AddShared(0))
+      return 1;
+    ScopedLock lock(mutex);
+    std::map<const uint8_t *, int>::const_iterator it = counts.find(p_buffer);
+    return it == counts.end() ? 1 : it->second;
+  }
+
+private:
+  ReferenceTable() : shared(0) {}
+
+  // Atomically adds the delta to the number of listed buffers and returns the
+  // previous value, with a full memory barrier.
+  long AddShared(long delta) {
+#if defined(_MSC_VER)
+    return _InterlockedExchangeAdd(&shared, delta);
+#else
+    return __sync_fetch_and_add(&shared, delta);
+#endif
+  }
+
+  Mutex                          mutex;
+  std::map<const uint8_t *, int> counts;
+  volatile long                  shared;
+};
+
+} // namespace
+
+uint8_t *GetMinImageBufferBase(const MinImg *p_image) {
+  return p_image->stride > 0 ? p_image->pScan0 :
+                               _GetMinImageLine(p_image, p_image->height - 1);
+}
+
+bool ReleaseMinImageBuffer(const uint8_t *p_buffer) {
+  return ReferenceTable::Instance().Release(p_buffer);
+}
+
+MINIMGAPI_API int RetainMinImage(
+    MinImg       *p_dst_image,
+    const MinImg *p_src_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_RetainMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!p_dst_image || p_dst_image == p_src_image)
+    return BAD_ARGS;
+  if (p_dst_image->pScan0)
+    return BAD_ARGS;
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_src_image));
+  if (p_src_image->pScan0) {
+    if (p_src_image->addressSpace != 0)
+      return NOT_IMPLEMENTED;
+    const uint8_t *p_buffer = GetMinImageBufferBase(p_src_image);
+    if (!p_buffer)
+      return INTERNAL_ERROR;
+    PROPAGATE_ERROR(ReferenceTable::Instance().Retain(p_buffer));
+  }
+  *p_dst_image = *p_src_image;
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int UnshareMinImage(
+    MinImg *p_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_UnshareMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (!p_image->pScan0)
+    return NO_ERRORS;
+  if (p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  const uint8_t *p_buffer = GetMinImageBufferBase(p_image);
+  if (!p_buffer)
+    return INTERNAL_ERROR;
+  // Another owner may release its reference meanwhile, which at worst costs
+  // an unnecessary copy: the buffer stays alive until FreeMinImage() below.
+  if (ReferenceTable::Instance().Count(p_buffer) == 1)
+    return NO_ERRORS;
+
+  MinImg private_image = {0};
+  PROPAGATE_ERROR(_CloneMinImagePrototype(&private_image, p_image));
+  int result = CopyMinImage(&private_image, p_image);
+  if (result != NO_ERRORS) {
+    FreeMinImage(&private_image);
+    return result;
+  }
+  PROPAGATE_ERROR(FreeMinImage(p_image));
+  *p_image = private_image;
+  return NO_ERRORS;
+}
+
+MINIMGAPI_API int GetMinImageReferenceCount(
+    const MinImg *p_image) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetMinImageReferenceCount);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  PROPAGATE_ERROR(_AssureMinImageIsValid(p_image));
+  if (!p_image->pScan0)
+    return 0;
+  if (p_image->addressSpace != 0)
+    return NOT_IMPLEMENTED;
+  const uint8_t *p_buffer = GetMinImageBufferBase(p_image);
+  if (!p_buffer)
+    return INTERNAL_ERROR;
+  return ReferenceTable::Instance().Count(p_buffer);
+}
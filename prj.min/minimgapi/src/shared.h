@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef MINIMGAPI_SHARED_H_INCLUDED
+#define MINIMGAPI_SHARED_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+#include <minimgapi/minimgapi.h>
+
+/**
+ * @brief   Returns the address of the memory block the image buffer starts at,
+ *          that is the first line for positive strides and the last one for
+ *          negative strides.
+ */
+uint8_t *GetMinImageBufferBase(const MinImg *p_image);
+
+/**
+ * @brief   Drops a reference to a buffer allocated with @c AllocMinImage().
+ * @returns @c true if that was the last reference and the buffer should be
+ *          deallocated, @c false if the buffer is still shared.
+ *
+ * Only the reference count is tracked, not the writes: the API functions
+ * modify shared data in place, so callers holding a reference made with
+ * @c RetainMinImage() must unshare it before writing. The call takes no lock
+ * while no buffer is shared.
+ */
+bool ReleaseMinImageBuffer(const uint8_t *p_buffer);
+
+#endif // MINIMGAPI_SHARED_H_INCLUDED
@@ -1,8 +1,17 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
 #include <minimgapi/minimgapi.h>
 #include <minimgapi/minimgapi-inl.h>
 #include <minimgapi/imgguard.hpp>
+#include <minimgapi/minimgapi-pipeline.hpp>
+#include <minimgapi/minimgapi-bands.hpp>
+#include <minimgapi/minimgapi-view.hpp>
 #include "vector/transpose-inl.h"
+#include "vector/arithmetic-inl.h"
+#include "hash.h"
 
 TEST(TransposeTest, Transpose16x16) {
   uint8_t pool0[16 * 17] = {0};
@@ -132,6 +141,50 @@ TEST(TransposeTest, Transpose8x8BitsInternal) {
   }
 }
 
+TEST(TransposeTest, BitImageWithoutPartialBytes) {
+  // Destination lines are packed without padding, so with sizes which are
+  // multiples of 8 any byte written past a line lands in the next line or
+  // past the buffer (which the address sanitizer reports).
+  const int sizes[][2] = {{3, 16}, {13, 8}, {16, 24}, {19, 16}, {24, 5}};
+  for (int n = 0; n < 5; ++n) {
+    const int width = sizes[n][0], height = sizes[n][1];
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 1,
+                                              TYP_UINT1));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < (width + 7) / 8; ++x)
+        src.pScan0[y * src.stride + x] = static_cast<uint8_t>(x * 97 + y * 29);
+    MinImg dst = {0};
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst, height, width, 1,
+                                              TYP_UINT1, 0, AO_EMPTY));
+    dst.stride = (height + 7) / 8;
+    std::vector<uint8_t> buffer(static_cast<size_t>(width) * dst.stride, 0xA5);
+    dst.pScan0 = &buffer[0];
+    ASSERT_EQ(NO_ERRORS, TransposeMinImage(&dst, &src));
+    for (int y = 0; y < width; ++y)
+      for (int x = 0; x < height; ++x)
+        ASSERT_EQ((src.pScan0[x * src.stride + y / 8] >> (7 - y % 8)) & 1,
+                  (dst.pScan0[y * dst.stride + x / 8] >> (7 - x % 8)) & 1)
+            << "case " << n << " at " << x << ", " << y;
+  }
+}
+
+TEST(FillTest, FillsPartialBytesOfAllLines) {
+  DECLARE_GUARDED_MINIMG(bits);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bits, 13, 4, 1, TYP_UINT1));
+  const uint8_t values[] = {0xFF, 0x00};
+  for (int v = 0; v < 2; ++v) {
+    memset(bits.pScan0, ~values[v], bits.stride * bits.height);
+    ASSERT_EQ(NO_ERRORS, FillMinImage(&bits, &values[v], 1));
+    for (int y = 0; y < bits.height; ++y) {
+      const uint8_t *p_line = bits.pScan0 + y * bits.stride;
+      EXPECT_EQ(values[v], p_line[0]) << y;
+      EXPECT_EQ(values[v] & 0xF8, p_line[1] & 0xF8) << y;
+      EXPECT_EQ(~values[v] & 0x07, p_line[1] & 0x07) << y;
+    }
+  }
+}
+
 TEST(TestMinimgapi, TestCopyMinImageFragment) {
   DECLARE_GUARDED_MINIMG(dst_image);
   DECLARE_GUARDED_MINIMG(src_image);
@@ -141,6 +194,1931 @@ TEST(TestMinimgapi, TestCopyMinImageFragment) {
                                                          7, 23, 55, 14, 3, 18));
 }
 
+template<typename T, int op> static void CheckVectorBiOp() {
+  const int len = 77;
+  T a[len], b[len], dst[len];
+  for (int i = 0; i < len; ++i) {
+    a[i] = static_cast<T>(i * 0x9E3779B1U + 0x7F4A7C15U);
+    b[i] = static_cast<T>(i * 0x85EBCA77U + 0xC2B2AE3DU);
+  }
+  a[0] = std::numeric_limits<T>::max();
+  b[0] = std::numeric_limits<T>::max();
+  a[1] = std::numeric_limits<T>::min();
+  b[1] = std::numeric_limits<T>::max();
+  vector_biop<T, op>(dst, a, b, len);
+  for (int i = 0; i < len; ++i)
+    ASSERT_EQ((BiOpScalar<T, op>::apply(a[i], b[i])), dst[i]) << "op " << op
+        << ", element " << i;
+}
+
+template<typename T> static void CheckVectorBiOps() {
+  CheckVectorBiOp<T, OP_MIN>();
+  CheckVectorBiOp<T, OP_MAX>();
+  CheckVectorBiOp<T, OP_ADD>();
+  CheckVectorBiOp<T, OP_DIF>();
+  CheckVectorBiOp<T, OP_ADF>();
+  CheckVectorBiOp<T, OP_MUL>();
+  CheckVectorBiOp<T, OP_AVE>();
+  CheckVectorBiOp<T, OP_EUC>();
+  CheckVectorBiOp<T, OP_DIV>();
+  CheckVectorBiOp<T, OP_SSQ>();
+}
+
+TEST(ArithmeticTest, VectorMatchesScalar) {
+  CheckVectorBiOps<uint8_t>();
+  CheckVectorBiOps<int8_t>();
+  CheckVectorBiOps<uint16_t>();
+  CheckVectorBiOps<int16_t>();
+  CheckVectorBiOps<uint32_t>();
+  CheckVectorBiOps<int32_t>();
+  CheckVectorBiOps<uint64_t>();
+  CheckVectorBiOps<int64_t>();
+}
+
+TEST(ArithmeticTest, BinaryOperationMinImage) {
+  uint8_t a[2][5] = {{10, 200, 30, 255, 0}, {1, 2, 3, 4, 5}};
+  uint8_t b[2][5] = {{20, 100, 30, 1, 0}, {5, 4, 3, 2, 1}};
+  uint8_t dst[2][5] = {{0}};
+  MinImg a_image = {0}, b_image = {0}, dst_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&a_image, a, 5, 2, 1,
+                                                   TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&b_image, b, 5, 2, 1,
+                                                   TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&dst_image, dst, 5, 2, 1,
+                                                   TYP_UINT8));
+
+  ASSERT_EQ(NO_ERRORS, BinaryOperationMinImage(&dst_image, &a_image, &b_image,
+                                               BIOP_ADD));
+  EXPECT_EQ(30, dst[0][0]);
+  EXPECT_EQ(255, dst[0][1]);
+  EXPECT_EQ(255, dst[0][3]);
+  EXPECT_EQ(6, dst[1][4]);
+
+  ASSERT_EQ(NO_ERRORS, BinaryOperationMinImage(&dst_image, &a_image, &b_image,
+                                               BIOP_DIF));
+  EXPECT_EQ(0, dst[0][0]);
+  EXPECT_EQ(100, dst[0][1]);
+  EXPECT_EQ(0, dst[1][0]);
+
+  // In-place operation with a broadcasted pixel.
+  uint8_t scalar = 3;
+  MinImg scalar_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapScalarWithMinImage(&scalar_image, &scalar,
+                                              TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, BinaryOperationMinImage(&a_image, &a_image,
+                                               &scalar_image, BIOP_MUL));
+  EXPECT_EQ(30, a[0][0]);
+  EXPECT_EQ(255, a[0][1]);
+  EXPECT_EQ(15, a[1][4]);
+
+  ASSERT_EQ(NO_ERRORS, BinaryOperationMinImageWithScalar(&dst_image, &b_image,
+                                                         2.0, BIOP_DIV));
+  EXPECT_EQ(10, dst[0][0]);
+  EXPECT_EQ(0, dst[1][4]);
+
+  real32_t real_pixel[2] = {3.f, 4.f};
+  real32_t real_dst[3][2] = {{0}};
+  MinImg real_pixel_image = {0}, real_dst_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapPixelWithMinImage(&real_pixel_image, real_pixel, 2,
+                                             TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&real_dst_image, real_dst,
+                                                   3, 1, 2, TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, BinaryOperationMinImage(&real_dst_image,
+                                   &real_pixel_image, &real_pixel_image,
+                                   BIOP_EUC));
+  EXPECT_FLOAT_EQ(3.f * std::sqrt(2.f), real_dst[2][0]);
+  EXPECT_FLOAT_EQ(4.f * std::sqrt(2.f), real_dst[2][1]);
+
+  EXPECT_EQ(BAD_ARGS, BinaryOperationMinImage(&dst_image, &a_image,
+                                              &real_dst_image, BIOP_ADD));
+}
+
+TEST(ReduceTest, ProjectionProfiles) {
+  const int width = 701, height = 300, channels = 2;
+  DECLARE_GUARDED_MINIMG(src_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height,
+                                            channels, TYP_UINT8));
+  for (int y = 0; y < height; ++y) {
+    uint8_t *p_line = src_image.pScan0 + y * src_image.stride;
+    for (int x = 0; x < width * channels; ++x)
+      p_line[x] = static_cast<uint8_t>((x * 7 + y * 13) ^ (x >> 3));
+  }
+
+  DECLARE_GUARDED_MINIMG(rows_image);
+  DECLARE_GUARDED_MINIMG(cols_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&rows_image, 1, height, 1,
+                                            TYP_INT32));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&cols_image, width, 1, channels,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, ReduceMinImage(&rows_image, &src_image, DO_HORIZONTAL,
+                                      ASCOOP_ADD));
+  ASSERT_EQ(NO_ERRORS, ReduceMinImage(&cols_image, &src_image, DO_VERTICAL,
+                                      ASCOOP_MAX));
+
+  int64_t total = 0;
+  for (int y = 0; y < height; ++y) {
+    const uint8_t *p_line = src_image.pScan0 + y * src_image.stride;
+    int32_t sum = 0;
+    for (int x = 0; x < width * channels; ++x)
+      sum += p_line[x];
+    total += sum;
+    ASSERT_EQ(sum, reinterpret_cast<int32_t *>(
+                       rows_image.pScan0 + y * rows_image.stride)[0]);
+  }
+  for (int x = 0; x < width * channels; ++x) {
+    uint8_t max = 0;
+    for (int y = 0; y < height; ++y)
+      max = std::max(max, src_image.pScan0[y * src_image.stride + x]);
+    ASSERT_EQ(max, cols_image.pScan0[x]);
+  }
+
+  int64_t sum = 0;
+  MinImg sum_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapScalarWithMinImage(&sum_image, &sum, TYP_INT64));
+  ASSERT_EQ(NO_ERRORS, ReduceMinImage(&sum_image, &src_image, DO_BOTH,
+                                      ASCOOP_ADD));
+  EXPECT_EQ(total, sum);
+
+  real64_t norms[channels] = {0};
+  MinImg norms_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapPixelWithMinImage(&norms_image, norms, channels,
+                                             TYP_REAL64));
+  ASSERT_EQ(NO_ERRORS, ReduceMinImage(&norms_image, &src_image, DO_BOTH,
+                                      ASCOOP_EUC));
+  for (int c = 0; c < channels; ++c) {
+    real64_t ssq = 0;
+    for (int y = 0; y < height; ++y)
+      for (int x = c; x < width * channels; x += channels) {
+        real64_t v = src_image.pScan0[y * src_image.stride + x];
+        ssq += v * v;
+      }
+    EXPECT_DOUBLE_EQ(std::sqrt(ssq), norms[c]);
+  }
+
+  EXPECT_EQ(BAD_ARGS, ReduceMinImage(&cols_image, &src_image, DO_HORIZONTAL,
+                                     ASCOOP_ADD));
+}
+
+TEST(ReduceTest, BitImage) {
+  uint8_t bits[3][2] = {{0xF0, 0x00}, {0x81, 0x80}, {0xFF, 0xC0}};
+  MinImg bit_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapAlignedBufferWithMinImage(&bit_image, bits, 10, 3, 1,
+                                                     TYP_UINT1, 2));
+  uint16_t counts[3] = {0};
+  MinImg counts_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&counts_image, counts,
+                                                   1, 3, 1, TYP_UINT16));
+  ASSERT_EQ(NO_ERRORS, ReduceMinImage(&counts_image, &bit_image, DO_HORIZONTAL,
+                                      ASCOOP_ADD));
+  EXPECT_EQ(4, counts[0]);
+  EXPECT_EQ(3, counts[1]);
+  EXPECT_EQ(10, counts[2]);
+}
+
+static int ReflectIndex(int i, int n, BorderOption border) {
+  if (i >= 0 && i < n)
+    return i;
+  switch (border) {
+  case BO_CYCLIC:
+    return (i % n + n) % n;
+  case BO_SYMMETRIC:
+    i = (i % (2 * n) + 2 * n) % (2 * n);
+    return std::min(i, 2 * n - 1 - i);
+  case BO_CONSTANT:
+    return -1;
+  default:
+    return std::min(std::max(i, 0), n - 1);
+  }
+}
+
+template<typename T>
+static void CheckMinMaxFilter(MinTyp type, int width, int height, int channels,
+                              int filter_width, int filter_height, IdOp op,
+                              BorderOption border) {
+  DECLARE_GUARDED_MINIMG(src_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height,
+                                            channels, type));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &src_image));
+  for (int y = 0; y < height; ++y) {
+    T *p_line = reinterpret_cast<T *>(src_image.pScan0 + y * src_image.stride);
+    for (int x = 0; x < width * channels; ++x)
+      p_line[x] = static_cast<T>((x * 37 + y * 101) % 251 - 60);
+  }
+  T canvas[4] = {static_cast<T>(7), static_cast<T>(8), static_cast<T>(9),
+                 static_cast<T>(10)};
+  ASSERT_EQ(NO_ERRORS, MinMaxFilterMinImage(&dst_image, &src_image,
+                       filter_width, filter_height, op, border, canvas));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      for (int c = 0; c < channels; ++c) {
+        T expected = 0;
+        bool first = true;
+        for (int dy = -(filter_height - 1) / 2; dy <= filter_height / 2; ++dy)
+          for (int dx = -(filter_width - 1) / 2; dx <= filter_width / 2; ++dx) {
+            int sy = ReflectIndex(y + dy, height, border);
+            int sx = ReflectIndex(x + dx, width, border);
+            T v = sy < 0 || sx < 0 ? canvas[c] :
+                  reinterpret_cast<T *>(src_image.pScan0 +
+                                        sy * src_image.stride)[sx * channels + c];
+            if (first || (op == IDOP_MIN ? v < expected : v > expected))
+              expected = v;
+            first = false;
+          }
+        ASSERT_EQ(expected, reinterpret_cast<T *>(dst_image.pScan0 +
+                  y * dst_image.stride)[x * channels + c]) << x << ", " << y;
+      }
+}
+
+TEST(MinMaxFilterTest, MatchesBruteForce) {
+  CheckMinMaxFilter<uint8_t>(TYP_UINT8, 45, 37, 3, 5, 7, IDOP_MIN, BO_REPEAT);
+  CheckMinMaxFilter<uint8_t>(TYP_UINT8, 45, 37, 1, 6, 4, IDOP_MAX,
+                             BO_SYMMETRIC);
+  CheckMinMaxFilter<int16_t>(TYP_INT16, 20, 70, 1, 1, 9, IDOP_MAX, BO_CYCLIC);
+  CheckMinMaxFilter<real32_t>(TYP_REAL32, 33, 17, 2, 51, 3, IDOP_MIN,
+                              BO_CONSTANT);
+}
+
+TEST(MinMaxFilterTest, BitImage) {
+  uint8_t bits[3][2] = {{0x10, 0x00}, {0x00, 0x00}, {0x00, 0x40}};
+  uint8_t dilated[3][2] = {{0}};
+  MinImg src_image = {0}, dst_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&src_image, bits, 16, 3, 1,
+                                                   TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&dst_image, dilated, 16, 3,
+                                                   1, TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, MinMaxFilterMinImage(&dst_image, &src_image, 3, 3,
+                                            IDOP_MAX));
+  EXPECT_EQ(0x38, dilated[0][0]);
+  EXPECT_EQ(0x38, dilated[1][0]);
+  EXPECT_EQ(0xE0, dilated[1][1]);
+  EXPECT_EQ(0x00, dilated[2][0]);
+}
+
+TEST(HistogramTest, MaskedChannels) {
+  DECLARE_GUARDED_MINIMG(src_image);
+  DECLARE_GUARDED_MINIMG(mask_image);
+  const int width = 57, height = 31;
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height, 2,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&mask_image, width, height, 1,
+                                            TYP_UINT1));
+  std::vector<uint32_t> expected(2 * 256);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      uint8_t *p_pixel = src_image.pScan0 + y * src_image.stride + 2 * x;
+      p_pixel[0] = static_cast<uint8_t>(x * y % 7);
+      p_pixel[1] = static_cast<uint8_t>(200 + x % 3);
+      bool set = (x + y) % 3 != 0;
+      if (set)
+        SET_IMAGE_LINE_BIT(mask_image.pScan0 + y * mask_image.stride, x);
+      else
+        CLEAR_IMAGE_LINE_BIT(mask_image.pScan0 + y * mask_image.stride, x);
+      if (set) {
+        ++expected[p_pixel[0]];
+        ++expected[256 + p_pixel[1]];
+      }
+    }
+  std::vector<uint32_t> histogram(2 * 256);
+  ASSERT_EQ(NO_ERRORS, ComputeMinImageHistogram(&histogram[0], &src_image,
+                                                &mask_image));
+  EXPECT_TRUE(expected == histogram);
+
+  double min[2], max[2], mean[2], stddev[2];
+  ASSERT_EQ(NO_ERRORS, ComputeMinImageStats(min, max, mean, stddev,
+                                            &src_image));
+  EXPECT_EQ(0, min[0]);
+  EXPECT_EQ(6, max[0]);
+  EXPECT_EQ(200, min[1]);
+  EXPECT_EQ(202, max[1]);
+}
+
+TEST(HistogramTest, StatsMatchAcrossTypes) {
+  DECLARE_GUARDED_MINIMG(u16_image);
+  DECLARE_GUARDED_MINIMG(r32_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&u16_image, 300, 40, 1,
+                                            TYP_UINT16));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&r32_image, 300, 40, 1,
+                                            TYP_REAL32));
+  for (int y = 0; y < 40; ++y)
+    for (int x = 0; x < 300; ++x) {
+      int v = 30000 + (x * 131 + y * 17) % 1000;
+      reinterpret_cast<uint16_t *>(u16_image.pScan0 +
+                                   y * u16_image.stride)[x] = v;
+      reinterpret_cast<real32_t *>(r32_image.pScan0 +
+                                   y * r32_image.stride)[x] = v;
+    }
+  double stats_u16[4], stats_r32[4];
+  ASSERT_EQ(NO_ERRORS, ComputeMinImageStats(stats_u16, stats_u16 + 1,
+            stats_u16 + 2, stats_u16 + 3, &u16_image));
+  ASSERT_EQ(NO_ERRORS, ComputeMinImageStats(stats_r32, stats_r32 + 1,
+            stats_r32 + 2, stats_r32 + 3, &r32_image));
+  for (int i = 0; i < 4; ++i)
+    EXPECT_NEAR(stats_u16[i], stats_r32[i], 1e-6) << i;
+  EXPECT_GT(stats_u16[3], 250.);
+}
+
+TEST(CompareTest, DifferenceMetrics) {
+  DECLARE_GUARDED_MINIMG(image_a);
+  DECLARE_GUARDED_MINIMG(image_b);
+  const int width = 101, height = 23, channels = 3;
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image_a, width, height, channels,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image_b, width, height, channels,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * channels; ++x)
+      image_a.pScan0[y * image_a.stride + x] =
+          static_cast<uint8_t>((x * 7 + y * 13) % 256);
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&image_b, &image_a));
+
+  MinImgComparison result = {0};
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&result, &image_a, &image_b,
+                                               CO_SSIM));
+  EXPECT_EQ(0, result.mismatch_count);
+  EXPECT_EQ(0., result.max_abs_diff);
+  EXPECT_TRUE(result.psnr > 1e300);
+  EXPECT_DOUBLE_EQ(1., result.ssim);
+
+  int64_t mismatches = 0;
+  double sse = 0;
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * channels; x += 5) {
+      uint8_t &v = image_b.pScan0[y * image_b.stride + x];
+      int diff = (x + y) % 9 - 4;
+      v = static_cast<uint8_t>(std::min(255, std::max(0, v + diff)));
+      int actual = v - image_a.pScan0[y * image_a.stride + x];
+      mismatches += actual != 0;
+      sse += actual * actual;
+    }
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&result, &image_a, &image_b,
+                                               CO_EXACT));
+  EXPECT_NE(0, result.mismatch_count);
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&result, &image_a, &image_b,
+                                               CO_SSIM, 7));
+  EXPECT_EQ(mismatches, result.mismatch_count);
+  EXPECT_EQ(4., result.max_abs_diff);
+  EXPECT_NEAR(10. * std::log10(255. * 255. * width * height * channels / sse),
+              result.psnr, 1e-9);
+  EXPECT_GT(result.ssim, 0.5);
+  EXPECT_LT(result.ssim, 1.);
+}
+
+TEST(CompareTest, BitTailIgnored) {
+  uint8_t bits_a[2][2] = {{0xA5, 0xF0}, {0x0F, 0x80}};
+  uint8_t bits_b[2][2] = {{0xA5, 0xFF}, {0x0F, 0x8F}};
+  MinImg image_a = {0}, image_b = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&image_a, bits_a, 12, 2, 1,
+                                                   TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&image_b, bits_b, 12, 2, 1,
+                                                   TYP_UINT1));
+  MinImgComparison result = {0};
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&result, &image_a, &image_b,
+                                               CO_EXACT));
+  EXPECT_EQ(0, result.mismatch_count);
+  bits_b[1][1] = 0xC0;
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&result, &image_a, &image_b));
+  EXPECT_EQ(1, result.mismatch_count);
+  EXPECT_EQ(1., result.max_abs_diff);
+}
+
+TEST(PipelineTest, MatchesSequentialCalls) {
+  DECLARE_GUARDED_MINIMG(src_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, 37, 29, 3, TYP_UINT8));
+  for (int y = 0; y < src_image.height; ++y)
+    for (int x = 0; x < src_image.width * 3; ++x)
+      src_image.pScan0[y * src_image.stride + x] =
+          static_cast<uint8_t>(x * 5 + y * 17);
+
+  MinImgPipeline pipeline(src_image);
+  ASSERT_EQ(NO_ERRORS, pipeline.Crop(3, 2, 30, 25));
+  ASSERT_EQ(NO_ERRORS, pipeline.Flip(DO_VERTICAL));
+  ASSERT_EQ(NO_ERRORS, pipeline.Transpose());
+  ASSERT_EQ(NO_ERRORS, pipeline.Retype(TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, pipeline.Resample(40, 13));
+  DECLARE_GUARDED_MINIMG(result_image);
+  ASSERT_EQ(NO_ERRORS, pipeline.CloneResultPrototype(&result_image));
+  ASSERT_EQ(40, result_image.width);
+  ASSERT_EQ(13, result_image.height);
+  ASSERT_EQ(TYP_REAL32, GetMinImageType(&result_image));
+  ASSERT_EQ(NO_ERRORS, pipeline.Execute(&result_image));
+
+  MinImg region_image = {0};
+  DECLARE_GUARDED_MINIMG(flipped_image);
+  DECLARE_GUARDED_MINIMG(transposed_image);
+  DECLARE_GUARDED_MINIMG(resampled_image);
+  ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&region_image, &src_image,
+                                         3, 2, 30, 25));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&flipped_image, &region_image));
+  ASSERT_EQ(NO_ERRORS, FlipMinImage(&flipped_image, &region_image,
+                                    DO_VERTICAL));
+  ASSERT_EQ(NO_ERRORS, CloneTransposedMinImagePrototype(&transposed_image,
+                                                        &flipped_image));
+  ASSERT_EQ(NO_ERRORS, TransposeMinImage(&transposed_image, &flipped_image));
+  ASSERT_EQ(NO_ERRORS, CloneResizedMinImagePrototype(&resampled_image,
+                                                     &transposed_image, 40, 13));
+  ASSERT_EQ(NO_ERRORS, ResampleMinImage(&resampled_image, &transposed_image));
+  for (int y = 0; y < 13; ++y)
+    for (int x = 0; x < 40 * 3; ++x)
+      ASSERT_EQ(resampled_image.pScan0[y * resampled_image.stride + x],
+                reinterpret_cast<real32_t *>(result_image.pScan0 +
+                                             y * result_image.stride)[x])
+          << x << ", " << y;
+}
+
+TEST(PipelineTest, RotationsAndBits) {
+  DECLARE_GUARDED_MINIMG(src_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, 150, 70, 1,
+                                            TYP_UINT16));
+  for (int y = 0; y < src_image.height; ++y)
+    for (int x = 0; x < src_image.width; ++x)
+      reinterpret_cast<uint16_t *>(src_image.pScan0 +
+                                   y * src_image.stride)[x] = x * 1000 + y;
+  for (int rotations = 1; rotations < 4; ++rotations) {
+    DECLARE_GUARDED_MINIMG(expected_image);
+    DECLARE_GUARDED_MINIMG(result_image);
+    if (rotations == 2)
+      ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&expected_image, &src_image));
+    else
+      ASSERT_EQ(NO_ERRORS, CloneTransposedMinImagePrototype(&expected_image,
+                                                            &src_image));
+    ASSERT_EQ(NO_ERRORS, RotateMinImageBy90(&expected_image, &src_image,
+                                            rotations));
+    MinImgPipeline pipeline(src_image);
+    ASSERT_EQ(NO_ERRORS, pipeline.RotateBy90(rotations));
+    ASSERT_EQ(NO_ERRORS, pipeline.CloneResultPrototype(&result_image));
+    ASSERT_EQ(NO_ERRORS, pipeline.Execute(&result_image));
+    MinImgComparison comparison = {0};
+    ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&comparison, &expected_image,
+                                                 &result_image, CO_EXACT));
+    EXPECT_EQ(0, comparison.mismatch_count) << rotations;
+  }
+
+  uint8_t bits[3][2] = {{0xC0, 0x00}, {0x20, 0x00}, {0x01, 0x80}};
+  MinImg bit_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&bit_image, bits, 10, 3, 1,
+                                                   TYP_UINT1));
+  MinImgPipeline bit_pipeline(bit_image);
+  ASSERT_EQ(NO_ERRORS, bit_pipeline.Slice(0, 2));
+  ASSERT_EQ(NO_ERRORS, bit_pipeline.Transpose());
+  ASSERT_EQ(NOT_IMPLEMENTED, bit_pipeline.Retype(TYP_UINT8));
+  DECLARE_GUARDED_MINIMG(bit_result);
+  ASSERT_EQ(NO_ERRORS, bit_pipeline.CloneResultPrototype(&bit_result));
+  ASSERT_EQ(NO_ERRORS, bit_pipeline.Execute(&bit_result));
+  ASSERT_EQ(2, bit_result.width);
+  ASSERT_EQ(10, bit_result.height);
+  EXPECT_EQ(0x80, bit_result.pScan0[0] & 0xC0);
+  EXPECT_EQ(0x80, bit_result.pScan0[bit_result.stride] & 0xC0);
+  EXPECT_EQ(0x40, bit_result.pScan0[7 * bit_result.stride] & 0xC0);
+  EXPECT_EQ(0x40, bit_result.pScan0[8 * bit_result.stride] & 0xC0);
+  EXPECT_EQ(0x00, bit_result.pScan0[2 * bit_result.stride] & 0xC0);
+}
+
+TEST(BandsTest, BoxFilterThenResample) {
+  const int width = 37, height = 29, channels = 3;
+  const int filter_width = 5, filter_height = 4;
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, channels,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * channels; ++x)
+      src.pScan0[y * src.stride + x] = static_cast<uint8_t>((x * 37 + y * 91) ^
+                                                            (x * y));
+
+  DECLARE_GUARDED_MINIMG(filtered);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&filtered, &src));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      for (int c = 0; c < channels; ++c) {
+        double sum = 0;
+        for (int dy = -(filter_height - 1) / 2; dy <= filter_height / 2; ++dy)
+          for (int dx = -(filter_width - 1) / 2; dx <= filter_width / 2; ++dx) {
+            int sy = std::min(std::max(y + dy, 0), height - 1);
+            int sx = std::min(std::max(x + dx, 0), width - 1);
+            sum += src.pScan0[sy * src.stride + sx * channels + c];
+          }
+        filtered.pScan0[y * filtered.stride + x * channels + c] =
+            round_cast<uint8_t>(sum / (filter_width * filter_height));
+      }
+  DECLARE_GUARDED_MINIMG(expected);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&expected, 23, 41, channels,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, ResampleMinImage(&expected, &filtered));
+
+  DECLARE_GUARDED_MINIMG(result);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&result, &expected));
+  ImageBandSource source(src);
+  BandBoxFilter box_filter(&source, filter_width, filter_height);
+  BandResampler resampler(&box_filter, 23, 41);
+  ImageBandSink sink(result);
+  ASSERT_EQ(NO_ERRORS, PumpMinImageBands(&sink, &resampler, 7));
+
+  for (int y = 0; y < expected.height; ++y)
+    ASSERT_EQ(0, ::memcmp(expected.pScan0 + y * expected.stride,
+                          result.pScan0 + y * result.stride,
+                          expected.width * channels)) << "row " << y;
+}
+
+TEST(BandsTest, SinkRejectsIncompleteImage) {
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, 8, 6, 1, TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&src));
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst, &src));
+
+  ImageBandSink sink(dst);
+  MinImg band = {0};
+  ASSERT_EQ(NO_ERRORS, _GetMinImageRegion(&band, &src, 0, 0, 8, 4));
+  ASSERT_EQ(NO_ERRORS, sink.Begin(&src));
+  ASSERT_EQ(NO_ERRORS, sink.WriteRows(&band));
+  EXPECT_EQ(BAD_STATE, sink.End());
+  EXPECT_EQ(BAD_STATE, sink.WriteRows(&band));
+}
+
+struct ScaleBy3 {
+  uint16_t operator ()(uint8_t value) const { return value * 3; }
+};
+
+struct SumElements {
+  SumElements() : sum(0) {}
+  void operator ()(uint16_t value) { sum += value; }
+  long long sum;
+};
+
+TEST(ViewTest, TransformAndAccumulate) {
+  const int width = 5, height = 4;
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width + 3, height, 3,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < (width + 3) * 3; ++x)
+      src.pScan0[y * src.stride + x] = static_cast<uint8_t>(x + 10 * y);
+  MinImg src_region = {0};
+  ASSERT_EQ(NO_ERRORS, _GetMinImageRegion(&src_region, &src, 1, 0, width,
+                                          height));
+
+  EXPECT_FALSE((MinImgView<uint16_t, 3>(&src_region).IsValid()));
+  EXPECT_FALSE((MinImgView<uint8_t, 1>(&src_region).IsValid()));
+  MinImgView<const uint8_t, 3> src_view(&src_region);
+  ASSERT_TRUE(src_view.IsValid());
+  EXPECT_FALSE(src_view.IsContinuous());
+  EXPECT_EQ(src_region.pScan0[src_region.stride + 3 * 2 + 1],
+            src_view(2, 1, 1));
+
+  DECLARE_GUARDED_MINIMG(dst);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst, width, height, 3,
+                                            TYP_UINT16));
+  MinImgView<uint16_t, 3> dst_view(&dst);
+  ASSERT_TRUE(dst_view.IsValid());
+  ASSERT_EQ(NO_ERRORS, Transform(dst_view, src_view, ScaleBy3()));
+
+  long long expected_sum = 0;
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * 3; ++x) {
+      int value = src_region.pScan0[y * src_region.stride + x] * 3;
+      expected_sum += value;
+      ASSERT_EQ(value, dst_view.Row(y)[x]) << x << ", " << y;
+    }
+  EXPECT_EQ(expected_sum, ForEachElement(dst_view, SumElements()).sum);
+
+  int rows = 0;
+  for (MinImgView<uint16_t, 3>::RowIterator it = dst_view.RowsBegin();
+       it != dst_view.RowsEnd(); ++it, ++rows)
+    EXPECT_EQ(dst_view.Row(rows), *it);
+  EXPECT_EQ(height, rows);
+
+  MinImgView<uint16_t, 3> small_view;
+  MinImg small_region = {0};
+  ASSERT_EQ(NO_ERRORS, _GetMinImageRegion(&small_region, &dst, 0, 0, 2, 2));
+  ASSERT_EQ(NO_ERRORS, small_view.Assign(&small_region));
+  EXPECT_EQ(BAD_ARGS, Transform(small_view, src_view, ScaleBy3()));
+}
+
+TEST(LutTest, PerChannelAndShared) {
+  const int width = 13, height = 5;
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 3,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * 3; ++x)
+      src.pScan0[y * src.stride + x] = static_cast<uint8_t>(x * 29 + y * 7);
+
+  std::vector<uint16_t> luts(3 * 256);
+  for (int i = 0; i < 3 * 256; ++i)
+    luts[i] = static_cast<uint16_t>(i * 37 + 1);
+  DECLARE_GUARDED_MINIMG(wide);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&wide, width, height, 3,
+                                            TYP_UINT16));
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&wide, &src, &luts[0], 3));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * 3; ++x)
+      ASSERT_EQ(luts[(x % 3) * 256 + src.pScan0[y * src.stride + x]],
+                reinterpret_cast<uint16_t *>(wide.pScan0 +
+                                             y * wide.stride)[x]);
+
+  std::vector<uint8_t> narrow_lut(65536);
+  for (int i = 0; i < 65536; ++i)
+    narrow_lut[i] = static_cast<uint8_t>(i >> 8);
+  DECLARE_GUARDED_MINIMG(narrow);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&narrow, &src));
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&narrow, &wide, &narrow_lut[0]));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * 3; ++x)
+      ASSERT_EQ(narrow_lut[reinterpret_cast<uint16_t *>(wide.pScan0 +
+                                                        y * wide.stride)[x]],
+                narrow.pScan0[y * narrow.stride + x]);
+
+  std::vector<uint8_t> invert(256);
+  for (int i = 0; i < 256; ++i)
+    invert[i] = static_cast<uint8_t>(255 - i);
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&narrow, &src, &invert[0]));
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&narrow, &narrow, &invert[0]));
+  MinImgComparison comparison = {0};
+  ASSERT_EQ(NO_ERRORS, CompareMinImageContents(&comparison, &src, &narrow,
+                                               CO_EXACT));
+  EXPECT_EQ(0, comparison.mismatch_count);
+
+  EXPECT_EQ(BAD_ARGS, ApplyLutMinImage(&narrow, &src, &invert[0], 2));
+  EXPECT_EQ(BAD_ARGS, ApplyLutMinImage(&narrow, &src, NULL));
+  DECLARE_GUARDED_MINIMG(real);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&real, width, height, 3,
+                                            TYP_REAL32));
+  EXPECT_EQ(NOT_IMPLEMENTED, ApplyLutMinImage(&narrow, &real, &invert[0]));
+}
+
+// Makes an image of the type over the memory of p_base_image at line y0.
+static void ViewMinImageAs(MinImg *p_view, const MinImg *p_base_image,
+                           MinTyp type, int y0, int height) {
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(p_view, p_base_image->width,
+                                            height, p_base_image->channels,
+                                            type, 0, AO_EMPTY));
+  p_view->stride = p_base_image->stride;
+  p_view->pScan0 = p_base_image->pScan0 + y0 * p_base_image->stride;
+}
+
+TEST(LutTest, OverlappingImages) {
+  const int width = 301, height = 257;
+  std::vector<uint16_t> widen(256);
+  for (int i = 0; i < 256; ++i)
+    widen[i] = static_cast<uint16_t>(i * 251 + 3);
+  std::vector<uint8_t> narrow(65536);
+  for (int i = 0; i < 65536; ++i)
+    narrow[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+  std::vector<uint8_t> invert(256);
+  for (int i = 0; i < 256; ++i)
+    invert[i] = static_cast<uint8_t>(255 - i);
+
+  // The byte source is widened into 16-bit elements over it and narrowed
+  // back, which moves every element but the first one.
+  DECLARE_GUARDED_MINIMG(base);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&base, width, height + 3, 1,
+                                            TYP_UINT16));
+  std::vector<uint8_t> orig(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      orig[y * width + x] = static_cast<uint8_t>(x * 13 + y * 5);
+      base.pScan0[y * base.stride + x] = orig[y * width + x];
+    }
+  MinImg bytes = {0}, words = {0};
+  ViewMinImageAs(&bytes, &base, TYP_UINT8, 0, height);
+  ViewMinImageAs(&words, &base, TYP_UINT16, 0, height);
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&words, &bytes, &widen[0]));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      ASSERT_EQ(widen[orig[y * width + x]], reinterpret_cast<uint16_t *>(
+                    words.pScan0 + y * words.stride)[x]) << x << ", " << y;
+  ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&bytes, &words, &narrow[0]));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      ASSERT_EQ(narrow[widen[orig[y * width + x]]],
+                bytes.pScan0[y * bytes.stride + x]) << x << ", " << y;
+
+  // Lines shifted by a few lines either way.
+  for (int shift = -3; shift <= 3; shift += 6) {
+    for (int y = 0; y < height + 3; ++y)
+      for (int x = 0; x < width; ++x)
+        base.pScan0[y * base.stride + x] =
+            y < height ? orig[y * width + x] : 0;
+    MinImg src = {0}, dst = {0};
+    ViewMinImageAs(&src, &base, TYP_UINT8, shift < 0 ? -shift : 0, height - 3);
+    ViewMinImageAs(&dst, &base, TYP_UINT8, shift < 0 ? 0 : shift, height - 3);
+    ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&dst, &src, &invert[0]));
+    const int src_y0 = shift < 0 ? -shift : 0;
+    for (int y = 0; y < height - 3; ++y)
+      for (int x = 0; x < width; ++x)
+        ASSERT_EQ(invert[orig[(src_y0 + y) * width + x]],
+                  dst.pScan0[y * dst.stride + x])
+            << "shift " << shift << " at " << x << ", " << y;
+  }
+}
+
+static uint8_t ReferenceMedian(const MinImg &src, int x, int y, int c,
+                               int radius, BorderOption border,
+                               uint8_t canvas) {
+  std::vector<uint8_t> window;
+  for (int dy = -radius; dy <= radius; ++dy)
+    for (int dx = -radius; dx <= radius; ++dx) {
+      int sx = x + dx, sy = y + dy;
+      if (sx < 0 || sx >= src.width || sy < 0 || sy >= src.height) {
+        if (border == BO_CONSTANT) {
+          window.push_back(canvas);
+          continue;
+        }
+        if (border == BO_REPEAT) {
+          sx = std::min(std::max(sx, 0), src.width - 1);
+          sy = std::min(std::max(sy, 0), src.height - 1);
+        } else {
+          sx = (sx + 2 * src.width) % (2 * src.width);
+          sx = std::min(sx, 2 * src.width - 1 - sx);
+          sy = (sy + 2 * src.height) % (2 * src.height);
+          sy = std::min(sy, 2 * src.height - 1 - sy);
+        }
+      }
+      window.push_back(src.pScan0[sy * src.stride + sx * src.channels + c]);
+    }
+  std::nth_element(window.begin(), window.begin() + window.size() / 2,
+                   window.end());
+  return window[window.size() / 2];
+}
+
+TEST(MedianTest, MatchesSorting) {
+  const int sizes[][3] = {{23, 17, 3}, {19, 9, 4}, {600, 24, 1}};
+  const BorderOption borders[] = {BO_REPEAT, BO_SYMMETRIC, BO_CONSTANT};
+  // The larger radii reach across the strip boundaries of the histogram path
+  // and past the image edges.
+  const int radii[] = {1, 2, 3, 6, 9, 15};
+  for (int n = 0; n < 3; ++n) {
+    const int width = sizes[n][0], height = sizes[n][1];
+    const int channels = sizes[n][2];
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, channels,
+                                              TYP_UINT8));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width * channels; ++x)
+        src.pScan0[y * src.stride + x] =
+            static_cast<uint8_t>((x * 73 + y * 151 + x * y * 7) % 251);
+    DECLARE_GUARDED_MINIMG(dst);
+    ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst, &src));
+    const uint8_t canvas[4] = {200, 10, 128, 0};
+    for (int b = 0; b < 3; ++b)
+      for (int r = 0; r < 6; ++r) {
+        if (n == 2 && radii[r] < 3)
+          continue;
+        ASSERT_EQ(NO_ERRORS, MedianFilterMinImage(&dst, &src, radii[r],
+                                                  borders[b], canvas));
+        for (int y = 0; y < height; ++y)
+          for (int x = 0; x < width; ++x)
+            for (int c = 0; c < channels; ++c)
+              ASSERT_EQ(ReferenceMedian(src, x, y, c, radii[r], borders[b],
+                                        canvas[c]),
+                        dst.pScan0[y * dst.stride + x * channels + c])
+                  << "radius " << radii[r] << " border " << borders[b]
+                  << " at " << x << ", " << y << ", " << c;
+      }
+  }
+
+  DECLARE_GUARDED_MINIMG(inplace);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&inplace, 9, 9, 1, TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&inplace));
+  inplace.pScan0[4 * inplace.stride + 4] = 255;
+  ASSERT_EQ(NO_ERRORS, MedianFilterMinImage(&inplace, &inplace, 1));
+  EXPECT_EQ(0, inplace.pScan0[4 * inplace.stride + 4]);
+  EXPECT_EQ(NOT_SUPPORTED, MedianFilterMinImage(&inplace, &inplace, 1,
+                                                BO_IGNORE));
+  EXPECT_EQ(BAD_ARGS, MedianFilterMinImage(&inplace, &inplace, 1,
+                                           BO_CONSTANT));
+}
+
+static int ReferenceLabels(std::vector<int> *p_labels, const MinImg &src,
+                           int reach) {
+  const int width = src.width, height = src.height;
+  p_labels->assign(width * height, 0);
+  int num_labels = 0;
+  std::vector<int> stack;
+  for (int y0 = 0; y0 < height; ++y0)
+    for (int x0 = 0; x0 < width; ++x0) {
+      if (!GET_IMAGE_LINE_BIT(src.pScan0 + y0 * src.stride, x0) ||
+          (*p_labels)[y0 * width + x0])
+        continue;
+      (*p_labels)[y0 * width + x0] = ++num_labels;
+      stack.push_back(y0 * width + x0);
+      while (!stack.empty()) {
+        const int x = stack.back() % width, y = stack.back() / width;
+        stack.pop_back();
+        for (int dy = -1; dy <= 1; ++dy)
+          for (int dx = -1; dx <= 1; ++dx) {
+            const int nx = x + dx, ny = y + dy;
+            if ((dx && dy && !reach) || nx < 0 || ny < 0 || nx >= width ||
+                ny >= height || (*p_labels)[ny * width + nx] ||
+                !GET_IMAGE_LINE_BIT(src.pScan0 + ny * src.stride, nx))
+              continue;
+            (*p_labels)[ny * width + nx] = num_labels;
+            stack.push_back(ny * width + nx);
+          }
+      }
+    }
+  return num_labels;
+}
+
+TEST(LabelTest, MatchesFloodFill) {
+  const int sizes[][2] = {{1, 1}, {13, 7}, {64, 5}, {130, 41}, {1500, 800}};
+  uint32_t seed = 12345;
+  for (int n = 0; n < 5; ++n) {
+    const int width = sizes[n][0], height = sizes[n][1];
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 1,
+                                              TYP_UINT1));
+    for (int y = 0; y < height; ++y)
+      for (int i = 0; i < (width + 7) / 8; ++i) {
+        seed = seed * 1103515245 + 12345;
+        src.pScan0[y * src.stride + i] = static_cast<uint8_t>(seed >> 16) |
+                                         static_cast<uint8_t>(seed >> 24);
+      }
+    DECLARE_GUARDED_MINIMG(labels);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&labels, width, height, 1,
+                                              TYP_INT32));
+    for (int reach = 0; reach <= 1; ++reach) {
+      std::vector<int> expected;
+      const int num_expected = ReferenceLabels(&expected, src, reach);
+      std::vector<MinImgComponent> components(num_expected + 1);
+      int num_components = -1;
+      ASSERT_EQ(NO_ERRORS, LabelMinImageComponents(&labels, &components[0],
+                   num_expected, &num_components, &src, reach ? CN_8 : CN_4));
+      ASSERT_EQ(num_expected, num_components);
+      std::vector<int> area(num_expected + 1, 0);
+      std::vector<double> sum_x(num_expected + 1, 0), sum_y(num_expected + 1);
+      std::vector<int> x_min(num_expected + 1, width), x_max(num_expected + 1);
+      std::vector<int> y_min(num_expected + 1, height), y_max(num_expected + 1);
+      for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x) {
+          const int label = expected[y * width + x];
+          ASSERT_EQ(label, reinterpret_cast<int32_t *>(
+                               labels.pScan0 + y * labels.stride)[x])
+              << "reach " << reach << " at " << x << ", " << y;
+          ++area[label];
+          sum_x[label] += x;
+          sum_y[label] += y;
+          x_min[label] = std::min(x_min[label], x);
+          x_max[label] = std::max(x_max[label], x + 1);
+          y_min[label] = std::min(y_min[label], y);
+          y_max[label] = std::max(y_max[label], y + 1);
+        }
+      for (int i = 1; i <= num_expected; ++i) {
+        const MinImgComponent &component = components[i - 1];
+        ASSERT_EQ(area[i], component.area);
+        EXPECT_DOUBLE_EQ(sum_x[i] / area[i], component.centroid_x);
+        EXPECT_DOUBLE_EQ(sum_y[i] / area[i], component.centroid_y);
+        EXPECT_EQ(x_min[i], component.bounds.x);
+        EXPECT_EQ(y_min[i], component.bounds.y);
+        EXPECT_EQ(x_max[i] - x_min[i], component.bounds.width);
+        EXPECT_EQ(y_max[i] - y_min[i], component.bounds.height);
+      }
+    }
+  }
+
+  DECLARE_GUARDED_MINIMG(empty);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&empty, 8, 8, 1, TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&empty));
+  int num_components = -1;
+  EXPECT_EQ(NO_ERRORS, LabelMinImageComponents(NULL, NULL, 0, &num_components,
+                                               &empty));
+  EXPECT_EQ(0, num_components);
+  EXPECT_EQ(BAD_ARGS, LabelMinImageComponents(&empty, NULL, 0,
+                                              &num_components, &empty));
+}
+
+TEST(DistanceTest, MatchesBruteForce) {
+  const int sizes[][2] = {{1, 1}, {17, 9}, {40, 33}};
+  uint32_t seed = 777;
+  for (int n = 0; n < 3; ++n) {
+    const int width = sizes[n][0], height = sizes[n][1];
+    DECLARE_GUARDED_MINIMG(bits);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bits, width, height, 1,
+                                              TYP_UINT1));
+    DECLARE_GUARDED_MINIMG(bytes);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bytes, width, height, 1,
+                                              TYP_UINT8));
+    ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&bits));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x) {
+        seed = seed * 1103515245 + 12345;
+        const bool set = (seed >> 16) % 23 != 0;
+        bytes.pScan0[y * bytes.stride + x] = set ? 7 : 0;
+        if (set)
+          bits.pScan0[y * bits.stride + x / 8] |= 0x80 >> (x % 8);
+      }
+    DECLARE_GUARDED_MINIMG(real_dist);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&real_dist, width, height, 1,
+                                              TYP_REAL32));
+    DECLARE_GUARDED_MINIMG(int_dist);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&int_dist, width, height, 1,
+                                              TYP_UINT16));
+    ASSERT_EQ(NO_ERRORS, DistanceTransformMinImage(&real_dist, &bits));
+    ASSERT_EQ(NO_ERRORS, DistanceTransformMinImage(&int_dist, &bytes));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x) {
+        int best = -1;
+        for (int v = 0; v < height; ++v)
+          for (int u = 0; u < width; ++u)
+            if (!bytes.pScan0[v * bytes.stride + u]) {
+              const int d = (u - x) * (u - x) + (v - y) * (v - y);
+              if (best < 0 || d < best)
+                best = d;
+            }
+        const float real = reinterpret_cast<float *>(
+                               real_dist.pScan0 + y * real_dist.stride)[x];
+        const uint16_t integer = reinterpret_cast<uint16_t *>(
+                                     int_dist.pScan0 + y * int_dist.stride)[x];
+        if (best < 0) {
+          EXPECT_TRUE(real > 1e30f);
+          EXPECT_EQ(65535, integer);
+        } else {
+          EXPECT_FLOAT_EQ(std::sqrt(static_cast<float>(best)), real)
+              << "at " << x << ", " << y;
+          EXPECT_EQ(static_cast<int>(std::floor(std::sqrt(best) + 0.5)),
+                    integer);
+        }
+      }
+  }
+}
+
+static int MapGradientCoordinate(int x, int size, BorderOption border) {
+  if (x >= 0 && x < size)
+    return x;
+  if (border == BO_CYCLIC)
+    return (x + size) % size;
+  if (border == BO_CONSTANT)
+    return -1;
+  return x < 0 ? 0 : size - 1;
+}
+
+static void ReferenceGradient(int *p_dx, int *p_dy, const MinImg &src, int x,
+                              int y, int side, int center, BorderOption border,
+                              uint8_t canvas) {
+  int v[3][3];
+  for (int j = 0; j < 3; ++j)
+    for (int i = 0; i < 3; ++i) {
+      const int u = MapGradientCoordinate(x + i - 1, src.width, border);
+      const int w = MapGradientCoordinate(y + j - 1, src.height, border);
+      v[j][i] = u < 0 || w < 0 ? canvas : src.pScan0[w * src.stride + u];
+    }
+  *p_dx = side * (v[0][2] - v[0][0] + v[2][2] - v[2][0]) +
+          center * (v[1][2] - v[1][0]);
+  *p_dy = side * (v[2][0] - v[0][0] + v[2][2] - v[0][2]) +
+          center * (v[2][1] - v[0][1]);
+}
+
+TEST(GradientTest, MatchesReference) {
+  const int sizes[][2] = {{1, 1}, {5, 3}, {37, 11}};
+  const BorderOption borders[] = {BO_REPEAT, BO_SYMMETRIC, BO_CYCLIC,
+                                  BO_CONSTANT};
+  for (int n = 0; n < 3; ++n) {
+    const int width = sizes[n][0], height = sizes[n][1];
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 1,
+                                              TYP_UINT8));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+        src.pScan0[y * src.stride + x] =
+            static_cast<uint8_t>((x * 97 + y * 31 + x * y * 13) % 256);
+    DECLARE_GUARDED_MINIMG(dx);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dx, width, height, 1,
+                                              TYP_INT16));
+    DECLARE_GUARDED_MINIMG(dy);
+    ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dy, &dx));
+    const uint8_t canvas = 200;
+    for (int k = 0; k < 2; ++k)
+      for (int b = 0; b < 4; ++b) {
+        const GradientOption kernel = k ? GO_SCHARR : GO_SOBEL;
+        ASSERT_EQ(NO_ERRORS, GradientMinImage(&dx, &dy, &src, kernel,
+                                              borders[b], &canvas));
+        for (int y = 0; y < height; ++y)
+          for (int x = 0; x < width; ++x) {
+            int ref_dx = 0, ref_dy = 0;
+            ReferenceGradient(&ref_dx, &ref_dy, src, x, y, k ? 3 : 1,
+                              k ? 10 : 2, borders[b], canvas);
+            ASSERT_EQ(ref_dx, reinterpret_cast<int16_t *>(
+                                  dx.pScan0 + y * dx.stride)[x])
+                << "kernel " << k << " border " << borders[b] << " at " << x
+                << ", " << y;
+            ASSERT_EQ(ref_dy, reinterpret_cast<int16_t *>(
+                                  dy.pScan0 + y * dy.stride)[x]);
+          }
+      }
+
+    DECLARE_GUARDED_MINIMG(magnitude);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&magnitude, width, height, 1,
+                                              TYP_REAL32));
+    DECLARE_GUARDED_MINIMG(direction);
+    ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&direction, &magnitude));
+    ASSERT_EQ(NO_ERRORS, GradientMagnitudeMinImage(&magnitude, &direction,
+                                                   &dx, &dy));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x) {
+        const double gx = reinterpret_cast<int16_t *>(
+                              dx.pScan0 + y * dx.stride)[x];
+        const double gy = reinterpret_cast<int16_t *>(
+                              dy.pScan0 + y * dy.stride)[x];
+        EXPECT_FLOAT_EQ(static_cast<float>(std::sqrt(gx * gx + gy * gy)),
+            reinterpret_cast<float *>(magnitude.pScan0 +
+                                      y * magnitude.stride)[x]);
+        EXPECT_FLOAT_EQ(static_cast<float>(std::atan2(gy, gx)),
+            reinterpret_cast<float *>(direction.pScan0 +
+                                      y * direction.stride)[x]);
+      }
+  }
+}
+
+TEST(CannyTest, MatchesReference) {
+  const int width = 301, height = 203;
+  DECLARE_GUARDED_MINIMG(src);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 1,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const double r = std::sqrt((x - 150.0) * (x - 150.0) +
+                                 (y - 100.0) * (y - 100.0));
+      src.pScan0[y * src.stride + x] = static_cast<uint8_t>(
+          (r < 70 ? 180 : 60) + 40 * std::sin(x * 0.2) * std::cos(y * 0.15) +
+          (x * 7 + y * 3) % 9);
+    }
+  DECLARE_GUARDED_MINIMG(dx);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dx, width, height, 1,
+                                            TYP_INT16));
+  DECLARE_GUARDED_MINIMG(dy);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dy, &dx));
+  ASSERT_EQ(NO_ERRORS, GradientMinImage(&dx, &dy, &src));
+  std::vector<double> m((width + 2) * (height + 2), 0);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const double gx = reinterpret_cast<int16_t *>(
+                            dx.pScan0 + y * dx.stride)[x];
+      const double gy = reinterpret_cast<int16_t *>(
+                            dy.pScan0 + y * dy.stride)[x];
+      m[(y + 1) * (width + 2) + x + 1] = std::sqrt(gx * gx + gy * gy);
+    }
+
+  const double low = 60, high = 150;
+  std::vector<int> state((width + 2) * (height + 2), 0);
+  std::vector<int> stack;
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const int i = (y + 1) * (width + 2) + x + 1;
+      const double gx = reinterpret_cast<int16_t *>(
+                            dx.pScan0 + y * dx.stride)[x];
+      const double gy = reinterpret_cast<int16_t *>(
+                            dy.pScan0 + y * dy.stride)[x];
+      if (m[i] <= low)
+        continue;
+      const double angle = std::atan2(std::fabs(gy), std::fabs(gx));
+      int a = 1, b = -1;
+      if (angle > 3 * M_PI / 8) {
+        a = width + 2;
+        b = -(width + 2);
+      } else if (angle >= M_PI / 8) {
+        a = gx * gy < 0 ? width + 1 : width + 3;
+        b = -a;
+      }
+      const bool diagonal = angle >= M_PI / 8 && angle <= 3 * M_PI / 8;
+      const bool maximum = diagonal ? m[i] > m[i + a] && m[i] > m[i + b] :
+                                      m[i] > m[i + b] && m[i] >= m[i + a];
+      if (!maximum)
+        continue;
+      state[i] = m[i] > high ? 2 : 1;
+      if (state[i] == 2)
+        stack.push_back(i);
+    }
+  while (!stack.empty()) {
+    const int i = stack.back();
+    stack.pop_back();
+    for (int dy_ = -1; dy_ <= 1; ++dy_)
+      for (int dx_ = -1; dx_ <= 1; ++dx_) {
+        const int j = i + dy_ * (width + 2) + dx_;
+        if (state[j] == 1) {
+          state[j] = 2;
+          stack.push_back(j);
+        }
+      }
+  }
+
+  DECLARE_GUARDED_MINIMG(bytes);
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&bytes, &src));
+  ASSERT_EQ(NO_ERRORS, CannyMinImage(&bytes, &src, low, high));
+  DECLARE_GUARDED_MINIMG(bits);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bits, width, height, 1,
+                                            TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, CannyMinImage(&bits, &src, low, high));
+  int num_edges = 0, num_mismatches = 0;
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const bool edge = state[(y + 1) * (width + 2) + x + 1] == 2;
+      num_edges += edge;
+      num_mismatches += edge != (bytes.pScan0[y * bytes.stride + x] == 255);
+      ASSERT_EQ(bytes.pScan0[y * bytes.stride + x] == 255,
+                GET_IMAGE_LINE_BIT(bits.pScan0 + y * bits.stride, x) != 0);
+    }
+  EXPECT_GT(num_edges, 400);
+  // The angle sectors of the integer test differ from the exact ones by
+  // rounding of tan(22.5), which may flip a few pixels.
+  EXPECT_LE(num_mismatches, num_edges / 100);
+  EXPECT_EQ(BAD_ARGS, CannyMinImage(&bytes, &src, high, low));
+}
+
+static bool SegmentEndsNear(const MinPoint &u, const MinPoint &v, int x0,
+                            int y0, int x1, int y1, int tolerance) {
+  const bool direct = std::abs(u.x - x0) <= tolerance &&
+                      std::abs(u.y - y0) <= tolerance &&
+                      std::abs(v.x - x1) <= tolerance &&
+                      std::abs(v.y - y1) <= tolerance;
+  const bool reverse = std::abs(v.x - x0) <= tolerance &&
+                       std::abs(v.y - y0) <= tolerance &&
+                       std::abs(u.x - x1) <= tolerance &&
+                       std::abs(u.y - y1) <= tolerance;
+  return direct || reverse;
+}
+
+TEST(HoughTest, FindsLinesAndSegments) {
+  const int width = 200, height = 150;
+  DECLARE_GUARDED_MINIMG(bytes);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bytes, width, height, 1,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&bytes));
+  for (int x = 20; x <= 180; ++x)
+    bytes.pScan0[40 * bytes.stride + x] = 1;
+  for (int y = 10; y <= 140; ++y)
+    bytes.pScan0[y * bytes.stride + 100] = 1;
+  for (int i = 0; i <= 100; ++i)
+    bytes.pScan0[(130 - i) * bytes.stride + 20 + i] = 1;
+  DECLARE_GUARDED_MINIMG(bits);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bits, width, height, 1,
+                                            TYP_UINT1));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&bits));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      if (bytes.pScan0[y * bytes.stride + x])
+        bits.pScan0[y * bits.stride + x / 8] |= 0x80 >> (x % 8);
+
+  MinBand lines[8], bit_lines[8];
+  int num_lines = 0, num_bit_lines = 0;
+  ASSERT_EQ(NO_ERRORS, HoughLinesMinImage(lines, 8, &num_lines, &bytes, 1,
+                                          M_PI / 180, 90));
+  ASSERT_EQ(NO_ERRORS, HoughLinesMinImage(bit_lines, 8, &num_bit_lines,
+                                          &bits, 1, M_PI / 180, 90));
+  ASSERT_EQ(3, num_lines);
+  ASSERT_EQ(num_lines, num_bit_lines);
+  for (int i = 0; i < num_lines; ++i) {
+    EXPECT_EQ(lines[i].u.x, bit_lines[i].u.x);
+    EXPECT_EQ(lines[i].v.y, bit_lines[i].v.y);
+    EXPECT_EQ(1, lines[i].w);
+  }
+  // The longest line comes first.
+  EXPECT_TRUE(SegmentEndsNear(lines[0].u, lines[0].v, 0, 40, width - 1, 40,
+                              0));
+  EXPECT_TRUE(SegmentEndsNear(lines[1].u, lines[1].v, 100, 0, 100,
+                              height - 1, 0));
+  EXPECT_TRUE(SegmentEndsNear(lines[2].u, lines[2].v, 0, 150, 149, 1, 1));
+  int num_limited = 0;
+  ASSERT_EQ(NO_ERRORS, HoughLinesMinImage(NULL, 0, &num_limited, &bytes, 1,
+                                          M_PI / 180, 90));
+  EXPECT_EQ(3, num_limited);
+
+  MinLineSegment segments[8];
+  int num_segments = 0;
+  ASSERT_EQ(NO_ERRORS, HoughSegmentsMinImage(segments, 8, &num_segments,
+                                             &bits, 1, M_PI / 180, 20, 50,
+                                             3));
+  ASSERT_EQ(3, num_segments);
+  const int expected[3][4] = {{20, 40, 180, 40}, {100, 10, 100, 140},
+                              {20, 130, 120, 30}};
+  for (int e = 0; e < 3; ++e) {
+    bool found = false;
+    for (int i = 0; i < num_segments; ++i)
+      found = found || SegmentEndsNear(segments[i].u, segments[i].v,
+                                       expected[e][0], expected[e][1],
+                                       expected[e][2], expected[e][3], 2);
+    EXPECT_TRUE(found) << "segment " << e;
+  }
+}
+
+static double ReferenceCorrelation(const MinImg &src, const MinImg &templ,
+                                   int x0, int y0) {
+  const int n = templ.width * templ.height;
+  double src_mean = 0, templ_mean = 0;
+  for (int y = 0; y < templ.height; ++y)
+    for (int x = 0; x < templ.width; ++x) {
+      src_mean += src.pScan0[(y0 + y) * src.stride + x0 + x];
+      templ_mean += templ.pScan0[y * templ.stride + x];
+    }
+  src_mean /= n;
+  templ_mean /= n;
+  double product = 0, src_square = 0, templ_square = 0;
+  for (int y = 0; y < templ.height; ++y)
+    for (int x = 0; x < templ.width; ++x) {
+      const double a = src.pScan0[(y0 + y) * src.stride + x0 + x] - src_mean;
+      const double b = templ.pScan0[y * templ.stride + x] - templ_mean;
+      product += a * b;
+      src_square += a * a;
+      templ_square += b * b;
+    }
+  if (src_square == 0 || templ_square == 0)
+    return 0;
+  return product / std::sqrt(src_square * templ_square);
+}
+
+TEST(MatchTest, MatchesReference) {
+  // The first template is matched directly and the second by transforms.
+  const int cases[][6] = {{61, 43, 5, 4, 20, 10}, {200, 150, 40, 30, 97, 81}};
+  for (int n = 0; n < 2; ++n) {
+    const int width = cases[n][0], height = cases[n][1];
+    DECLARE_GUARDED_MINIMG(src);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, width, height, 1,
+                                              TYP_UINT8));
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x)
+        src.pScan0[y * src.stride + x] =
+            static_cast<uint8_t>((x * x * 3 + y * 7 + x * y) % 251);
+    MinImg templ = {};
+    ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&templ, &src, cases[n][4],
+                                           cases[n][5], cases[n][2],
+                                           cases[n][3]));
+    DECLARE_GUARDED_MINIMG(dst);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst, width - templ.width + 1,
+                                              height - templ.height + 1, 1,
+                                              TYP_REAL32));
+    ASSERT_EQ(NO_ERRORS, MatchTemplateMinImage(&dst, &src, &templ));
+    for (int y = 0; y < dst.height; ++y)
+      for (int x = 0; x < dst.width; ++x)
+        ASSERT_NEAR(ReferenceCorrelation(src, templ, x, y),
+                    reinterpret_cast<float *>(dst.pScan0 + y * dst.stride)[x],
+                    2e-4)
+            << "case " << n << " at " << x << ", " << y;
+    EXPECT_FLOAT_EQ(1.0f, reinterpret_cast<float *>(
+        dst.pScan0 + cases[n][5] * dst.stride)[cases[n][4]]);
+  }
+
+  // Single columns and lines, where the transforms are still chosen.
+  const int thin_cases[][4] = {{1, 100, 1, 5}, {100, 1, 5, 1}, {1, 300, 1, 40},
+                               {300, 1, 40, 1}};
+  for (int n = 0; n < 4; ++n) {
+    DECLARE_GUARDED_MINIMG(src);
+    DECLARE_GUARDED_MINIMG(templ);
+    DECLARE_GUARDED_MINIMG(dst);
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src, thin_cases[n][0],
+                                              thin_cases[n][1], 1, TYP_UINT8));
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&templ, thin_cases[n][2],
+                                              thin_cases[n][3], 1, TYP_UINT8));
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst,
+                                              src.width - templ.width + 1,
+                                              src.height - templ.height + 1, 1,
+                                              TYP_REAL32));
+    for (int i = 0; i < src.width * src.height; ++i)
+      src.pScan0[i / src.width * src.stride + i % src.width] =
+          static_cast<uint8_t>((i * i * 5 + i * 3) % 253);
+    for (int i = 0; i < templ.width * templ.height; ++i)
+      templ.pScan0[i / templ.width * templ.stride + i % templ.width] =
+          static_cast<uint8_t>((i * 37) % 101);
+    ASSERT_EQ(NO_ERRORS, MatchTemplateMinImage(&dst, &src, &templ));
+    for (int y = 0; y < dst.height; ++y)
+      for (int x = 0; x < dst.width; ++x)
+        ASSERT_NEAR(ReferenceCorrelation(src, templ, x, y),
+                    reinterpret_cast<float *>(dst.pScan0 + y * dst.stride)[x],
+                    2e-4)
+            << "thin case " << n << " at " << x << ", " << y;
+  }
+
+  DECLARE_GUARDED_MINIMG(flat);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&flat, 3, 3, 1, TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&flat));
+  DECLARE_GUARDED_MINIMG(image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, 8, 8, 1, TYP_UINT8));
+  for (int i = 0; i < 64; ++i)
+    image.pScan0[i / 8 * image.stride + i % 8] = static_cast<uint8_t>(i * 3);
+  DECLARE_GUARDED_MINIMG(response);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&response, 6, 6, 1, TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, MatchTemplateMinImage(&response, &image, &flat));
+  EXPECT_EQ(0.0f, reinterpret_cast<float *>(response.pScan0)[0]);
+  EXPECT_EQ(BAD_ARGS, MatchTemplateMinImage(&response, &flat, &image));
+}
+
+template<typename T>
+static void CheckCopyWithBorder(MinTyp type, int width, int height,
+                                int channels, int left, int top, int right,
+                                int bottom, BorderOption border) {
+  DECLARE_GUARDED_MINIMG(src_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height,
+                                            channels, type));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst_image, width + left + right,
+                                            height + top + bottom, channels,
+                                            type));
+  for (int y = 0; y < height; ++y) {
+    T *p_line = reinterpret_cast<T *>(src_image.pScan0 + y * src_image.stride);
+    for (int x = 0; x < width * channels; ++x)
+      p_line[x] = static_cast<T>((x * 37 + y * 101) % 251);
+  }
+  T canvas[4] = {static_cast<T>(7), static_cast<T>(8), static_cast<T>(9),
+                 static_cast<T>(10)};
+  ASSERT_EQ(NO_ERRORS, CopyMinImageWithBorder(&dst_image, &src_image, left,
+                                              top, right, bottom, border,
+                                              canvas));
+  for (int y = 0; y < dst_image.height; ++y)
+    for (int x = 0; x < dst_image.width; ++x)
+      for (int c = 0; c < channels; ++c) {
+        int sy = ReflectIndex(y - top, height, border);
+        int sx = ReflectIndex(x - left, width, border);
+        T expected = sy < 0 || sx < 0 ? canvas[c] :
+            reinterpret_cast<T *>(src_image.pScan0 +
+                                  sy * src_image.stride)[sx * channels + c];
+        ASSERT_EQ(expected, reinterpret_cast<T *>(dst_image.pScan0 +
+                  y * dst_image.stride)[x * channels + c]) << x << ", " << y;
+      }
+}
+
+TEST(BorderTest, MatchesReflection) {
+  const BorderOption borders[] = {BO_REPEAT, BO_SYMMETRIC, BO_CYCLIC,
+                                  BO_CONSTANT};
+  for (int i = 0; i < 4; ++i) {
+    CheckCopyWithBorder<uint8_t>(TYP_UINT8, 45, 37, 1, 20, 3, 17, 5,
+                                 borders[i]);
+    CheckCopyWithBorder<uint8_t>(TYP_UINT8, 7, 5, 3, 19, 11, 2, 0,
+                                 borders[i]);
+    CheckCopyWithBorder<int16_t>(TYP_INT16, 33, 9, 1, 9, 2, 33, 1,
+                                 borders[i]);
+    CheckCopyWithBorder<real32_t>(TYP_REAL32, 29, 4, 2, 6, 9, 8, 7,
+                                  borders[i]);
+    CheckCopyWithBorder<real64_t>(TYP_REAL64, 3, 2, 1, 4, 1, 7, 5,
+                                  borders[i]);
+  }
+}
+
+TEST(BorderTest, RefreshesPaddedInterior) {
+  uint8_t pixels[2][3] = {{1, 2, 3}, {4, 5, 6}};
+  MinImg src_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&src_image, pixels, 3, 2,
+                                                   1, TYP_UINT8));
+  DECLARE_GUARDED_MINIMG(padded_image);
+  MinImg interior_image = {0};
+  ASSERT_EQ(NO_ERRORS, ClonePaddedMinImage(&padded_image, &interior_image,
+                                           &src_image, 2, 1, 1, 1,
+                                           BO_SYMMETRIC));
+  EXPECT_EQ(6, padded_image.width);
+  EXPECT_EQ(4, padded_image.height);
+  EXPECT_EQ(padded_image.pScan0 + padded_image.stride + 2,
+            interior_image.pScan0);
+  EXPECT_EQ(2, padded_image.pScan0[0]);
+  EXPECT_EQ(6, padded_image.pScan0[padded_image.stride * 3 + 5]);
+
+  interior_image.pScan0[0] = 9;
+  interior_image.pScan0[interior_image.stride + 2] = 8;
+  ASSERT_EQ(NO_ERRORS, CopyMinImageWithBorder(&padded_image, &interior_image,
+                                              2, 1, 1, 1, BO_SYMMETRIC));
+  const uint8_t expected[4][6] = {{2, 9, 9, 2, 3, 3},
+                                  {2, 9, 9, 2, 3, 3},
+                                  {5, 4, 4, 5, 8, 8},
+                                  {5, 4, 4, 5, 8, 8}};
+  for (int y = 0; y < 4; ++y)
+    for (int x = 0; x < 6; ++x)
+      EXPECT_EQ(expected[y][x],
+                padded_image.pScan0[y * padded_image.stride + x]) << x << y;
+}
+
+TEST(BorderTest, HandlesOverlappingAndFlippedSources) {
+  const int width = 40, height = 30, pad = 3;
+  DECLARE_GUARDED_MINIMG(dst_image);
+  DECLARE_GUARDED_MINIMG(orig_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&dst_image, width + 2 * pad,
+                                            height + 2 * pad, 1, TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&orig_image, width, height, 1,
+                                            TYP_UINT8));
+  // Sources at the top left corner of the destination, a line below it and
+  // the latter seen upside down.
+  for (int n = 0; n < 3; ++n) {
+    for (int y = 0; y < dst_image.height; ++y)
+      for (int x = 0; x < dst_image.width; ++x)
+        dst_image.pScan0[y * dst_image.stride + x] =
+            static_cast<uint8_t>(x * 7 + y * 13);
+    MinImg src_image = {0}, region_image = {0};
+    ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&region_image, &dst_image, 0,
+                                           n ? 1 : 0, width, height));
+    if (n == 2)
+      ASSERT_EQ(NO_ERRORS, FlipMinImageVertically(&src_image, &region_image));
+    else
+      src_image = region_image;
+    ASSERT_EQ(NO_ERRORS, CopyMinImage(&orig_image, &src_image));
+    ASSERT_EQ(NO_ERRORS, CopyMinImageWithBorder(&dst_image, &src_image, pad,
+                                                pad, pad, pad, BO_REPEAT));
+    for (int y = 0; y < dst_image.height; ++y)
+      for (int x = 0; x < dst_image.width; ++x) {
+        int sy = std::min(std::max(y - pad, 0), height - 1);
+        int sx = std::min(std::max(x - pad, 0), width - 1);
+        ASSERT_EQ(orig_image.pScan0[sy * orig_image.stride + sx],
+                  dst_image.pScan0[y * dst_image.stride + x])
+            << "case " << n << " at " << x << ", " << y;
+      }
+  }
+}
+
+template<typename T>
+static void CheckBlend(MinTyp type, int width, int height, int channels,
+                       double alpha, bool in_place) {
+  const double max_value = type == TYP_UINT8 ? 255.0 : 65535.0;
+  DECLARE_GUARDED_MINIMG(a_image);
+  DECLARE_GUARDED_MINIMG(b_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  DECLARE_GUARDED_MINIMG(orig_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&a_image, width, height,
+                                            channels, type));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&b_image, &a_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &a_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&orig_image, &a_image));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * channels; ++x) {
+      reinterpret_cast<T *>(a_image.pScan0 + y * a_image.stride)[x] =
+          static_cast<T>((x * 7919 + y * 104729) % (int(max_value) + 1));
+      reinterpret_cast<T *>(b_image.pScan0 + y * b_image.stride)[x] =
+          static_cast<T>((x * 7907 + y * 65537) % (int(max_value) + 1));
+    }
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&orig_image, &a_image));
+  const MinImg *p_dst = in_place ? &a_image : &dst_image;
+  ASSERT_EQ(NO_ERRORS, BlendMinImages(p_dst, &a_image, &b_image, alpha));
+  const double weight = std::floor(alpha * max_value + 0.5);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width * channels; ++x) {
+      double a = reinterpret_cast<T *>(orig_image.pScan0 +
+                                       y * orig_image.stride)[x];
+      double b = reinterpret_cast<T *>(b_image.pScan0 + y * b_image.stride)[x];
+      T expected = static_cast<T>(std::floor(
+          (a * (max_value - weight) + b * weight) / max_value + 0.5));
+      ASSERT_EQ(expected, reinterpret_cast<T *>(p_dst->pScan0 +
+                y * p_dst->stride)[x]) << x << ", " << y;
+    }
+}
+
+TEST(BlendTest, MatchesRounding) {
+  CheckBlend<uint8_t>(TYP_UINT8, 45, 7, 3, 0.3, false);
+  CheckBlend<uint8_t>(TYP_UINT8, 37, 5, 1, 1.0, true);
+  CheckBlend<uint16_t>(TYP_UINT16, 21, 6, 2, 0.77, false);
+  CheckBlend<uint16_t>(TYP_UINT16, 9, 3, 1, 0.0, true);
+
+  real32_t a[3] = {1.0f, 2.0f, -4.0f}, b[3] = {3.0f, 2.0f, 4.0f};
+  MinImg a_image = {0}, b_image = {0};
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&a_image, a, 3, 1, 1,
+                                                   TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, WrapSolidBufferWithMinImage(&b_image, b, 3, 1, 1,
+                                                   TYP_REAL32));
+  ASSERT_EQ(NO_ERRORS, BlendMinImages(&a_image, &a_image, &b_image, 0.25));
+  EXPECT_FLOAT_EQ(1.5f, a[0]);
+  EXPECT_FLOAT_EQ(2.0f, a[1]);
+  EXPECT_FLOAT_EQ(-2.0f, a[2]);
+  EXPECT_EQ(BAD_ARGS, BlendMinImages(&a_image, &a_image, &b_image, 1.5));
+}
+
+template<typename T>
+static void CheckAlphaComposite(MinTyp type, int width, int height,
+                                int bg_channels, bool in_place) {
+  const uint32_t max_value = type == TYP_UINT8 ? 0xFF : 0xFFFF;
+  DECLARE_GUARDED_MINIMG(fg_image);
+  DECLARE_GUARDED_MINIMG(bg_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  DECLARE_GUARDED_MINIMG(orig_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&fg_image, width, height, 4,
+                                            type));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&bg_image, width, height,
+                                            bg_channels, type));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &bg_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&orig_image, &bg_image));
+  for (int y = 0; y < height; ++y) {
+    T *p_fg = reinterpret_cast<T *>(fg_image.pScan0 + y * fg_image.stride);
+    T *p_bg = reinterpret_cast<T *>(bg_image.pScan0 + y * bg_image.stride);
+    for (int x = 0; x < width * 4; ++x)
+      p_fg[x] = static_cast<T>((x * 7919 + y * 104729) % (max_value + 1));
+    for (int x = 0; x < width * bg_channels; ++x)
+      p_bg[x] = static_cast<T>((x * 7907 + y * 65537) %
+                               (max_value + 1));
+    p_fg[3] = 0;
+    p_fg[7] = static_cast<T>(max_value);
+  }
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&orig_image, &bg_image));
+  const MinImg *p_dst = in_place ? &bg_image : &dst_image;
+  ASSERT_EQ(NO_ERRORS, AlphaCompositeMinImages(p_dst, &fg_image, &bg_image));
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x) {
+      const T *p_f = reinterpret_cast<T *>(fg_image.pScan0 +
+                                           y * fg_image.stride) + x * 4;
+      const T *p_b = reinterpret_cast<T *>(orig_image.pScan0 +
+                                           y * orig_image.stride) +
+                     x * bg_channels;
+      const T *p_d = reinterpret_cast<T *>(p_dst->pScan0 + y * p_dst->stride) +
+                     x * bg_channels;
+      const uint64_t a = p_f[3];
+      for (int c = 0; c < bg_channels; ++c) {
+        uint64_t f = c < 3 ? p_f[c] : max_value;
+        uint64_t sum = f * a + p_b[c] * (max_value - a);
+        T expected = static_cast<T>((2 * sum + max_value) / (2 * max_value));
+        ASSERT_EQ(expected, p_d[c]) << x << ", " << y << ", " << c;
+      }
+    }
+}
+
+TEST(BlendTest, HandlesNegativeStrides) {
+  const int width = 37, height = 11;
+  DECLARE_GUARDED_MINIMG(a_image);
+  DECLARE_GUARDED_MINIMG(b_image);
+  DECLARE_GUARDED_MINIMG(mask_image);
+  DECLARE_GUARDED_MINIMG(upright_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&a_image, width, height, 4,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&b_image, &a_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&upright_image, &a_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &a_image));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&mask_image, width, height, 1,
+                                            TYP_UINT8));
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width * 4; ++x) {
+      a_image.pScan0[y * a_image.stride + x] = static_cast<uint8_t>(x * 3 + y);
+      b_image.pScan0[y * b_image.stride + x] =
+          static_cast<uint8_t>(x * 11 + y * 5);
+    }
+    for (int x = 0; x < width; ++x)
+      mask_image.pScan0[y * mask_image.stride + x] = (x + y) % 3 ? 1 : 0;
+  }
+  MinImg a_flipped = {0}, b_flipped = {0}, mask_flipped = {0};
+  MinImg dst_flipped = {0};
+  ASSERT_EQ(NO_ERRORS, FlipMinImageVertically(&a_flipped, &a_image));
+  ASSERT_EQ(NO_ERRORS, FlipMinImageVertically(&b_flipped, &b_image));
+  ASSERT_EQ(NO_ERRORS, FlipMinImageVertically(&mask_flipped, &mask_image));
+  ASSERT_EQ(NO_ERRORS, FlipMinImageVertically(&dst_flipped, &dst_image));
+
+  for (int op = 0; op < 3; ++op) {
+    ASSERT_EQ(NO_ERRORS, CopyMinImage(&upright_image, &b_image));
+    ASSERT_EQ(NO_ERRORS, CopyMinImage(&dst_image, &b_image));
+    switch (op) {
+    case 0:
+      ASSERT_EQ(NO_ERRORS, BlendMinImages(&upright_image, &a_image, &b_image,
+                                          0.3, &mask_image));
+      ASSERT_EQ(NO_ERRORS, BlendMinImages(&dst_flipped, &a_flipped,
+                                          &b_flipped, 0.3, &mask_flipped));
+      break;
+    case 1:
+      ASSERT_EQ(NO_ERRORS, AlphaCompositeMinImages(&upright_image, &a_image,
+                                                   &b_image));
+      ASSERT_EQ(NO_ERRORS, AlphaCompositeMinImages(&dst_flipped, &a_flipped,
+                                                   &b_flipped));
+      break;
+    default:
+      ASSERT_EQ(NO_ERRORS, CopyMinImageMasked(&upright_image, &a_image,
+                                              &mask_image));
+      ASSERT_EQ(NO_ERRORS, CopyMinImageMasked(&dst_flipped, &a_flipped,
+                                              &mask_flipped));
+      break;
+    }
+    for (int y = 0; y < height; ++y)
+      ASSERT_EQ(0, memcmp(upright_image.pScan0 + y * upright_image.stride,
+                          dst_image.pScan0 + y * dst_image.stride, width * 4))
+          << "operation " << op << " line " << y;
+  }
+}
+
+TEST(AlphaCompositeTest, MatchesRounding) {
+  CheckAlphaComposite<uint8_t>(TYP_UINT8, 37, 5, 4, false);
+  CheckAlphaComposite<uint8_t>(TYP_UINT8, 37, 5, 4, true);
+  CheckAlphaComposite<uint8_t>(TYP_UINT8, 41, 4, 3, false);
+  CheckAlphaComposite<uint8_t>(TYP_UINT8, 41, 4, 3, true);
+  CheckAlphaComposite<uint16_t>(TYP_UINT16, 19, 3, 4, true);
+  CheckAlphaComposite<uint16_t>(TYP_UINT16, 17, 3, 3, false);
+  CheckAlphaComposite<uint16_t>(TYP_UINT16, 17, 3, 3, true);
+}
+
+// Fills a byte or bit mask with alternating unset, set and mixed runs.
+static void FillTestMask(const MinImg *p_mask_image) {
+  const bool bit_mask = p_mask_image->channelDepth == 0;
+  for (int y = 0; y < p_mask_image->height; ++y) {
+    uint8_t *p_line = p_mask_image->pScan0 + y * p_mask_image->stride;
+    for (int x = 0; x < p_mask_image->width; ++x) {
+      int run = (x / 70 + y) % 3;
+      bool set = run == 1 || (run == 2 && (x * 7 + y * 3) % 5 == 0);
+      if (bit_mask) {
+        if (set)
+          p_line[x >> 3] |= 0x80 >> (x & 7);
+        else
+          p_line[x >> 3] &= ~(0x80 >> (x & 7));
+      } else {
+        p_line[x] = set ? static_cast<uint8_t>(x % 255 + 1) : 0;
+      }
+    }
+  }
+}
+
+static bool IsTestMaskSet(const MinImg *p_mask_image, int x, int y) {
+  const uint8_t *p_line = p_mask_image->pScan0 + y * p_mask_image->stride;
+  return p_mask_image->channelDepth == 0 ?
+         (p_line[x >> 3] & (0x80 >> (x & 7))) != 0 : p_line[x] != 0;
+}
+
+static void CheckCopyMasked(MinTyp type, int channels, MinTyp mask_type) {
+  const int width = 211, height = 9;
+  DECLARE_GUARDED_MINIMG(src_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  DECLARE_GUARDED_MINIMG(orig_image);
+  DECLARE_GUARDED_MINIMG(mask_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height,
+                                            channels, type));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &src_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&orig_image, &src_image));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&mask_image, width, height, 1,
+                                            mask_type));
+  FillTestMask(&mask_image);
+  const int line_size = GetMinImageBytesPerLine(&src_image);
+  for (int y = 0; y < height; ++y)
+    for (int i = 0; i < line_size; ++i) {
+      src_image.pScan0[y * src_image.stride + i] =
+          static_cast<uint8_t>(i * 31 + y);
+      dst_image.pScan0[y * dst_image.stride + i] =
+          static_cast<uint8_t>(i * 17 + y * 5 + 1);
+    }
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&orig_image, &dst_image));
+  ASSERT_EQ(NO_ERRORS, CopyMinImageMasked(&dst_image, &src_image,
+                                          &mask_image));
+  const int pixel_size = line_size / width;
+  for (int y = 0; y < height; ++y)
+    for (int i = 0; i < line_size; ++i) {
+      const MinImg &expected = IsTestMaskSet(&mask_image, i / pixel_size, y) ?
+                               src_image : orig_image;
+      ASSERT_EQ(expected.pScan0[y * expected.stride + i],
+                dst_image.pScan0[y * dst_image.stride + i]) << i << ", " << y;
+    }
+
+  uint8_t canvas[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  ASSERT_EQ(NO_ERRORS, CopyMinImage(&dst_image, &orig_image));
+  ASSERT_EQ(NO_ERRORS, FillMinImageMasked(&dst_image, canvas, &mask_image));
+  for (int y = 0; y < height; ++y)
+    for (int i = 0; i < line_size; ++i) {
+      uint8_t expected = IsTestMaskSet(&mask_image, i / pixel_size, y) ?
+          canvas[i % pixel_size] : orig_image.pScan0[y * orig_image.stride + i];
+      ASSERT_EQ(expected, dst_image.pScan0[y * dst_image.stride + i])
+          << i << ", " << y;
+    }
+}
+
+TEST(MaskTest, CopyAndFillMatchReference) {
+  const MinTyp mask_types[] = {TYP_UINT8, TYP_UINT1};
+  for (int i = 0; i < 2; ++i) {
+    CheckCopyMasked(TYP_UINT8, 1, mask_types[i]);
+    CheckCopyMasked(TYP_UINT8, 3, mask_types[i]);
+    CheckCopyMasked(TYP_UINT16, 1, mask_types[i]);
+    CheckCopyMasked(TYP_REAL32, 1, mask_types[i]);
+    CheckCopyMasked(TYP_REAL64, 2, mask_types[i]);
+  }
+}
+
+TEST(MaskTest, MaskedOperationsWriteMaskedPixelsOnly) {
+  const int width = 150, height = 5;
+  DECLARE_GUARDED_MINIMG(src_image);
+  DECLARE_GUARDED_MINIMG(dst_image);
+  DECLARE_GUARDED_MINIMG(full_image);
+  DECLARE_GUARDED_MINIMG(mask_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&src_image, width, height, 1,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&dst_image, &src_image));
+  ASSERT_EQ(NO_ERRORS, CloneMinImagePrototype(&full_image, &src_image));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&mask_image, width, height, 1,
+                                            TYP_UINT1));
+  FillTestMask(&mask_image);
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      src_image.pScan0[y * src_image.stride + x] =
+          static_cast<uint8_t>(x * 3 + y);
+  uint8_t lut[256];
+  for (int i = 0; i < 256; ++i)
+    lut[i] = static_cast<uint8_t>(255 - i);
+  const uint8_t background = 7;
+
+  for (int op = 0; op < 3; ++op) {
+    ASSERT_EQ(NO_ERRORS, FillMinImage(&dst_image, &background));
+    switch (op) {
+    case 0:
+      ASSERT_EQ(NO_ERRORS, BinaryOperationMinImageWithScalar(&dst_image,
+                &src_image, 40, BIOP_ADD, &mask_image));
+      ASSERT_EQ(NO_ERRORS, BinaryOperationMinImageWithScalar(&full_image,
+                &src_image, 40, BIOP_ADD));
+      break;
+    case 1:
+      ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&dst_image, &src_image, lut, 1,
+                                            &mask_image));
+      ASSERT_EQ(NO_ERRORS, ApplyLutMinImage(&full_image, &src_image, lut));
+      break;
+    default:
+      ASSERT_EQ(NO_ERRORS, BlendMinImages(&dst_image, &src_image, &dst_image,
+                                          0.25, &mask_image));
+      ASSERT_EQ(NO_ERRORS, FillMinImage(&full_image, &background));
+      ASSERT_EQ(NO_ERRORS, BlendMinImages(&full_image, &src_image,
+                                          &full_image, 0.25));
+      break;
+    }
+    for (int y = 0; y < height; ++y)
+      for (int x = 0; x < width; ++x) {
+        uint8_t expected = IsTestMaskSet(&mask_image, x, y) ?
+            full_image.pScan0[y * full_image.stride + x] : background;
+        ASSERT_EQ(expected, dst_image.pScan0[y * dst_image.stride + x])
+            << op << ": " << x << ", " << y;
+      }
+  }
+}
+
+TEST(HashTest, XxHash64MatchesReference) {
+  uint8_t data[101];
+  for (int i = 0; i < 101; ++i)
+    data[i] = static_cast<uint8_t>(i * 7 + 3);
+  EXPECT_EQ(0xEF46DB3751D8E999ULL, XxHash64().Digest());
+  XxHash64 abc;
+  abc.Update("abc", 3);
+  EXPECT_EQ(0x44BC2CF5AD770999ULL, abc.Digest());
+  XxHash64 whole;
+  whole.Update(data, sizeof(data));
+  EXPECT_EQ(0xBAD4D3BF033BDA4CULL, whole.Digest());
+  XxHash64 pieces(0x1234);
+  pieces.Update(data, 5);
+  pieces.Update(data + 5, 40);
+  pieces.Update(data + 45, 0);
+  pieces.Update(data + 45, 56);
+  EXPECT_EQ(0x3BDF580646A19B34ULL, pieces.Digest());
+}
+
+TEST(HashTest, IgnoresPaddingAndTailBits) {
+  const int width = 37, height = 6;
+  DECLARE_GUARDED_MINIMG(solid_image);
+  DECLARE_GUARDED_MINIMG(wide_image);
+  for (int bit = 0; bit < 2; ++bit) {
+    const MinTyp type = bit ? TYP_UINT1 : TYP_UINT16;
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&solid_image, width, height, 1,
+                                              type));
+    ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&wide_image, width + 16,
+                                              height + 1, 1, type));
+    const int line_size = GetMinImageBytesPerLine(&wide_image);
+    for (int y = 0; y < height + 1; ++y)
+      for (int i = 0; i < line_size; ++i)
+        wide_image.pScan0[y * wide_image.stride + i] =
+            static_cast<uint8_t>(i * 13 + y * 7);
+    MinImg region_image = {0};
+    ASSERT_EQ(NO_ERRORS, GetMinImageRegion(&region_image, &wide_image, 8, 1,
+                                           width, height));
+    ASSERT_EQ(NO_ERRORS, CopyMinImage(&solid_image, &region_image));
+    uint64_t region_hash = 0, solid_hash = 0;
+    ASSERT_EQ(NO_ERRORS, HashMinImage(&region_hash, &region_image));
+    ASSERT_EQ(NO_ERRORS, HashMinImage(&solid_hash, &solid_image));
+    EXPECT_EQ(region_hash, solid_hash);
+
+    uint8_t *p_last = solid_image.pScan0 + (height - 1) * solid_image.stride +
+                      GetMinImageBytesPerLine(&solid_image) - 1;
+    *p_last ^= bit ? 0x01 : 0x80;
+    uint64_t changed_hash = 0;
+    ASSERT_EQ(NO_ERRORS, HashMinImage(&changed_hash, &solid_image));
+    EXPECT_EQ(bit != 0, changed_hash == solid_hash);
+    ASSERT_EQ(NO_ERRORS, HashMinImage(&changed_hash, &region_image, 1));
+    EXPECT_NE(region_hash, changed_hash);
+    ASSERT_EQ(NO_ERRORS, FreeMinImage(&solid_image));
+    ASSERT_EQ(NO_ERRORS, FreeMinImage(&wide_image));
+  }
+
+  MinImg row_image = {0}, column_image = {0};
+  uint64_t row_hash = 0, column_hash = 0;
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&row_image, 0, 1, 1, TYP_UINT8,
+                                            0, AO_EMPTY));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&column_image, 1, 0, 1, TYP_UINT8,
+                                            0, AO_EMPTY));
+  ASSERT_EQ(NO_ERRORS, HashMinImage(&row_hash, &row_image));
+  ASSERT_EQ(NO_ERRORS, HashMinImage(&column_hash, &column_image));
+  EXPECT_NE(row_hash, column_hash);
+}
+
+static void FillSmoothTestImage(MinImg *p_image, double brightness) {
+  for (int y = 0; y < p_image->height; ++y) {
+    uint8_t *p_line = p_image->pScan0 + y * p_image->stride;
+    for (int x = 0; x < p_image->width; ++x) {
+      double u = static_cast<double>(x) / p_image->width;
+      double v = static_cast<double>(y) / p_image->height;
+      double value = 100 + 60 * std::sin(7 * u + 3 * v) +
+                     40 * std::cos(5 * v - 2 * u * v) + brightness;
+      for (int c = 0; c < p_image->channels; ++c)
+        p_line[x * p_image->channels + c] =
+            static_cast<uint8_t>(std::min(255.0, std::max(0.0, value)));
+    }
+  }
+}
+
+static int CountDifferentBits(uint64_t a, uint64_t b) {
+  int count = 0;
+  for (uint64_t diff = a ^ b; diff; diff &= diff - 1)
+    ++count;
+  return count;
+}
+
+TEST(HashTest, PerceptualHashIsStable) {
+  DECLARE_GUARDED_MINIMG(large_image);
+  DECLARE_GUARDED_MINIMG(small_image);
+  DECLARE_GUARDED_MINIMG(other_image);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&large_image, 320, 240, 3,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&small_image, 97, 61, 1,
+                                            TYP_UINT8));
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&other_image, 97, 61, 1,
+                                            TYP_UINT8));
+  FillSmoothTestImage(&large_image, 0);
+  FillSmoothTestImage(&small_image, 15);
+  for (int y = 0; y < other_image.height; ++y)
+    for (int x = 0; x < other_image.width; ++x)
+      other_image.pScan0[y * other_image.stride + x] =
+          static_cast<uint8_t>((x * 7907 + y * 65537) >> 3);
+
+  const PerceptualHashOption methods[] = {PH_DIFFERENCE, PH_DCT};
+  for (int i = 0; i < 2; ++i) {
+    uint64_t large_hash = 0, small_hash = 0, other_hash = 0;
+    ASSERT_EQ(NO_ERRORS, PerceptualHashMinImage(&large_hash, &large_image,
+                                                methods[i]));
+    ASSERT_EQ(NO_ERRORS, PerceptualHashMinImage(&small_hash, &small_image,
+                                                methods[i]));
+    ASSERT_EQ(NO_ERRORS, PerceptualHashMinImage(&other_hash, &other_image,
+                                                methods[i]));
+    EXPECT_LE(CountDifferentBits(large_hash, small_hash), 6) << i;
+    EXPECT_GE(CountDifferentBits(large_hash, other_hash), 16) << i;
+  }
+
+  MinImg empty_image = {0};
+  uint64_t hash = 0;
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&empty_image, 0, 5, 1, TYP_UINT8,
+                                            0, AO_EMPTY));
+  EXPECT_EQ(NO_SENSE, PerceptualHashMinImage(&hash, &empty_image));
+}
+
+TEST(SharedTest, RetainsAndUnsharesReferences) {
+  DECLARE_GUARDED_MINIMG(image);
+  DECLARE_GUARDED_MINIMG(reference);
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, 45, 7, 3, TYP_UINT8));
+  for (int y = 0; y < image.height; ++y)
+    for (int i = 0; i < image.width * image.channels; ++i)
+      image.pScan0[y * image.stride + i] = static_cast<uint8_t>(i + y);
+  EXPECT_EQ(1, GetMinImageReferenceCount(&image));
+  ASSERT_EQ(NO_ERRORS, RetainMinImage(&reference, &image));
+  EXPECT_EQ(image.pScan0, reference.pScan0);
+  EXPECT_EQ(2, GetMinImageReferenceCount(&image));
+  EXPECT_EQ(BAD_ARGS, RetainMinImage(&reference, &image));
+
+  uint8_t *p_shared = image.pScan0;
+  ASSERT_EQ(NO_ERRORS, UnshareMinImage(&reference));
+  EXPECT_NE(p_shared, reference.pScan0);
+  EXPECT_EQ(1, GetMinImageReferenceCount(&image));
+  EXPECT_EQ(1, GetMinImageReferenceCount(&reference));
+  uint64_t image_hash = 0, reference_hash = 0;
+  ASSERT_EQ(NO_ERRORS, HashMinImage(&image_hash, &image));
+  ASSERT_EQ(NO_ERRORS, HashMinImage(&reference_hash, &reference));
+  EXPECT_EQ(image_hash, reference_hash);
+  ASSERT_EQ(NO_ERRORS, UnshareMinImage(&image));
+  EXPECT_EQ(p_shared, image.pScan0);
+
+  // The data outlives the image it was allocated for.
+  ASSERT_EQ(NO_ERRORS, FreeMinImage(&reference));
+  ASSERT_EQ(NO_ERRORS, RetainMinImage(&reference, &image));
+  ASSERT_EQ(NO_ERRORS, FreeMinImage(&image));
+  EXPECT_EQ(1, GetMinImageReferenceCount(&reference));
+  EXPECT_EQ(p_shared, reference.pScan0);
+  EXPECT_EQ(static_cast<uint8_t>(134 + 6),
+            reference.pScan0[6 * reference.stride + 134]);
+}
+
+TEST(SharedTest, CopiesOnFirstWrite) {
+  MinImg image = {0};
+  ASSERT_EQ(NO_ERRORS, NewMinImagePrototype(&image, 19, 5, 1, TYP_UINT16));
+  ASSERT_EQ(NO_ERRORS, ZeroFillMinImage(&image));
+  SharedMinImage frame(&image);
+  EXPECT_EQ(NULL, image.pScan0);
+  EXPECT_TRUE(frame.IsUnique());
+
+  std::vector<SharedMinImage> consumers(4, frame);
+  EXPECT_FALSE(frame.IsUnique());
+  EXPECT_EQ(NO_ERRORS, consumers[3].GetStatus());
+  EXPECT_EQ(5, GetMinImageReferenceCount(frame.Get()));
+  for (size_t i = 0; i < consumers.size(); ++i)
+    EXPECT_EQ(frame.Get()->pScan0, consumers[i].Get()->pScan0);
+
+  MinImg *p_written = consumers[1].Mutable();
+  ASSERT_TRUE(p_written != NULL);
+  EXPECT_NE(frame.Get()->pScan0, p_written->pScan0);
+  p_written->pScan0[0] = 1;
+  EXPECT_EQ(0, frame.Get()->pScan0[0]);
+  EXPECT_EQ(0, consumers[2].Get()->pScan0[0]);
+  EXPECT_TRUE(consumers[1].IsUnique());
+
+  consumers[2] = consumers[1];
+  EXPECT_EQ(NO_ERRORS, consumers[2].GetStatus());
+  EXPECT_EQ(1, consumers[2].Get()->pScan0[0]);
+  EXPECT_EQ(3, GetMinImageReferenceCount(frame.Get()));
+  consumers.clear();
+  EXPECT_TRUE(frame.IsUnique());
+  const uint8_t *p_data = frame.Get()->pScan0;
+  EXPECT_EQ(p_data, frame.Mutable()->pScan0);
+}
+
 int main(int argc, char **argv) {
   // This will force Visual Studio to link against minimgapi library.
   MinImg dummy = {0};
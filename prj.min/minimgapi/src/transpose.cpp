@@ -59,7 +59,7 @@ static int Transpose1BitImage(
   int src_wd1 = src_width & 7;
   int src_ht1 = src_height & 7;
 
-  uint8_t mask_to_leave = 0xFFU >> src_wd1;
+  uint8_t mask_to_leave = 0xFFU >> src_ht1;
 
   for (int src_y = 0; src_y < src_ht32; src_y += 4)
     for (int src_x = 0; src_x < src_wd32; src_x += 4)
@@ -87,7 +87,10 @@ static int Transpose1BitImage(
   uint8_t *p_dst_t = NULL;
   const uint8_t *p_src_t = NULL;
 
-  for (int src_y = 0; src_y < src_ht8; ++src_y) {
+  // The partial bytes of the source lines and the partial lines at the
+  // bottom: neither exists when the size is a multiple of 8, and then the
+  // bytes they would touch lie beyond the lines of the images.
+  for (int src_y = 0; src_wd1 && src_y < src_ht8; ++src_y) {
     p_src_t = p_src_buffer + 8 * src_y * src_stride + src_wd8;
     for (int i = 0; i < 8; ++i)
       src_buf[i] = p_src_t[i * src_stride];
@@ -97,6 +100,9 @@ static int Transpose1BitImage(
       *(p_dst_buffer + (8 * src_wd8 + i) * dst_stride + src_y) = dst_buf[i];
   }
 
+  if (!src_ht1)
+    return NO_ERRORS;
+
   for (int src_x = 0; src_x < src_wd8; ++src_x) {
     *(reinterpret_cast<uint64_t *>(src_buf)) = 0;
     for (int i = 0; i < src_ht1; ++i)
@@ -109,7 +115,10 @@ static int Transpose1BitImage(
       p_dst_t[i * dst_stride] |= dst_buf[i];
     }
   }
-  
+
+  if (!src_wd1)
+    return NO_ERRORS;
+
   *(reinterpret_cast<uint64_t *>(src_buf)) = 0;
   p_src_t = p_src_buffer + 8 * src_ht8 * src_stride + src_wd8;
   p_dst_t = p_dst_buffer + 8 * src_wd8 * dst_stride + src_ht8;
@@ -0,0 +1,347 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_ARITHMETIC_INL_H_INCLUDED
+#define VECTOR_ARITHMETIC_INL_H_INCLUDED
+
+#include <cmath>
+#include <limits>
+#include <minutils/smartptr.h>
+#include <minutils/crossplat.h>
+#include <minutils/mathoper.h>
+
+template<typename T> static MUSTINLINE T saturate_cast(double value) {
+  if (!std::numeric_limits<T>::is_integer)
+    return static_cast<T>(value);
+  if (!(value > static_cast<double>(std::numeric_limits<T>::min())))
+    return std::numeric_limits<T>::min();
+  // For 64-bit types max() rounds up to 2^N, thus the non-strict comparison.
+  if (value >= static_cast<double>(std::numeric_limits<T>::max()))
+    return std::numeric_limits<T>::max();
+  return static_cast<T>(value);
+}
+
+template<typename T> static MUSTINLINE T saturate_cast(int64_t value) {
+  if (value < static_cast<int64_t>(std::numeric_limits<T>::min()))
+    return std::numeric_limits<T>::min();
+  if (value > static_cast<int64_t>(std::numeric_limits<T>::max()))
+    return std::numeric_limits<T>::max();
+  return static_cast<T>(value);
+}
+
+template<typename T> static MUSTINLINE T round_cast(double value) {
+  if (!std::numeric_limits<T>::is_integer)
+    return static_cast<T>(value);
+  return saturate_cast<T>(std::floor(value + 0.5));
+}
+
+/// Element-wise binary operations with saturation. The generic version
+/// serves all integer types up to 32 bits: sums are computed in 64-bit
+/// integers and products in doubles, which are exact in the range of @c T.
+template<typename T, int op> struct BiOpScalar;
+
+template<typename T> struct BiOpScalar<T, OP_MIN> {
+  static MUSTINLINE T apply(T a, T b) { return a < b ? a : b; }
+};
+
+template<typename T> struct BiOpScalar<T, OP_MAX> {
+  static MUSTINLINE T apply(T a, T b) { return a < b ? b : a; }
+};
+
+template<typename T> struct BiOpScalar<T, OP_ADD> {
+  static MUSTINLINE T apply(T a, T b) {
+    return saturate_cast<T>(static_cast<int64_t>(a) + b);
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_DIF> {
+  static MUSTINLINE T apply(T a, T b) {
+    return saturate_cast<T>(static_cast<int64_t>(a) - b);
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_ADF> {
+  static MUSTINLINE T apply(T a, T b) {
+    return saturate_cast<T>(a < b ? static_cast<int64_t>(b) - a :
+                                    static_cast<int64_t>(a) - b);
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_MUL> {
+  static MUSTINLINE T apply(T a, T b) {
+    return saturate_cast<T>(static_cast<double>(a) * b);
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_AVE> {
+  static MUSTINLINE T apply(T a, T b) {
+    return static_cast<T>((static_cast<int64_t>(a) + b + 1) >> 1);
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_EUC> {
+  static MUSTINLINE T apply(T a, T b) {
+    return round_cast<T>(std::sqrt(static_cast<double>(a) * a +
+                                   static_cast<double>(b) * b));
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_DIV> {
+  static MUSTINLINE T apply(T a, T b) {
+    return b ? saturate_cast<T>(static_cast<int64_t>(a) / b) : 0;
+  }
+};
+
+template<typename T> struct BiOpScalar<T, OP_SSQ> {
+  static MUSTINLINE T apply(T a, T b) {
+    return saturate_cast<T>(static_cast<double>(a) * a +
+                            static_cast<double>(b) * b);
+  }
+};
+
+#define DECLARE_REAL_BIOP_SCALAR(T)                                           \
+template<> struct BiOpScalar<T, OP_ADD> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return a + b; }                       \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_DIF> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return a - b; }                       \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_ADF> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return std::fabs(a - b); }            \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_MUL> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return a * b; }                       \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_AVE> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return (a + b) * static_cast<T>(0.5); }\
+};                                                                            \
+template<> struct BiOpScalar<T, OP_EUC> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return std::sqrt(a * a + b * b); }    \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_DIV> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return a / b; }                       \
+};                                                                            \
+template<> struct BiOpScalar<T, OP_SSQ> {                                     \
+  static MUSTINLINE T apply(T a, T b) { return a * a + b * b; }               \
+};
+
+DECLARE_REAL_BIOP_SCALAR(real32_t)
+DECLARE_REAL_BIOP_SCALAR(real64_t)
+
+#undef DECLARE_REAL_BIOP_SCALAR
+
+static MUSTINLINE uint64_t saturated_add_u64(uint64_t a, uint64_t b) {
+  uint64_t r = a + b;
+  return r < a ? std::numeric_limits<uint64_t>::max() : r;
+}
+
+static MUSTINLINE uint64_t saturated_mul_u64(uint64_t a, uint64_t b) {
+  if (a && b > std::numeric_limits<uint64_t>::max() / a)
+    return std::numeric_limits<uint64_t>::max();
+  return a * b;
+}
+
+static MUSTINLINE int64_t saturated_add_i64(int64_t a, int64_t b) {
+  if (b > 0 && a > std::numeric_limits<int64_t>::max() - b)
+    return std::numeric_limits<int64_t>::max();
+  if (b < 0 && a < std::numeric_limits<int64_t>::min() - b)
+    return std::numeric_limits<int64_t>::min();
+  return a + b;
+}
+
+static MUSTINLINE int64_t saturated_dif_i64(int64_t a, int64_t b) {
+  if (b < 0 && a > std::numeric_limits<int64_t>::max() + b)
+    return std::numeric_limits<int64_t>::max();
+  if (b > 0 && a < std::numeric_limits<int64_t>::min() + b)
+    return std::numeric_limits<int64_t>::min();
+  return a - b;
+}
+
+static MUSTINLINE int64_t saturated_mul_i64(int64_t a, int64_t b) {
+  const bool negative = (a < 0) != (b < 0);
+  const uint64_t ua = a < 0 ? 0 - static_cast<uint64_t>(a) : a;
+  const uint64_t ub = b < 0 ? 0 - static_cast<uint64_t>(b) : b;
+  const uint64_t limit =
+      static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + negative;
+  if (ua && ub > limit / ua)
+    return negative ? std::numeric_limits<int64_t>::min() :
+                      std::numeric_limits<int64_t>::max();
+  const uint64_t r = ua * ub;
+  return negative ? static_cast<int64_t>(0 - r) : static_cast<int64_t>(r);
+}
+
+template<> struct BiOpScalar<uint64_t, OP_ADD> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return saturated_add_u64(a, b);
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_DIF> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return a > b ? a - b : 0;
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_ADF> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_MUL> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return saturated_mul_u64(a, b);
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_AVE> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return (a >> 1) + (b >> 1) + ((a | b) & 1);
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_DIV> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return b ? a / b : 0;
+  }
+};
+
+template<> struct BiOpScalar<uint64_t, OP_SSQ> {
+  static MUSTINLINE uint64_t apply(uint64_t a, uint64_t b) {
+    return saturated_add_u64(saturated_mul_u64(a, a), saturated_mul_u64(b, b));
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_ADD> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    return saturated_add_i64(a, b);
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_DIF> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    return saturated_dif_i64(a, b);
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_ADF> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    const uint64_t r = a > b ? static_cast<uint64_t>(a) - b :
+                               static_cast<uint64_t>(b) - a;
+    return r > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) ?
+           std::numeric_limits<int64_t>::max() : static_cast<int64_t>(r);
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_MUL> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    return saturated_mul_i64(a, b);
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_AVE> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    return (a >> 1) + (b >> 1) + ((a | b) & 1);
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_DIV> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    if (!b)
+      return 0;
+    if (b == -1 && a == std::numeric_limits<int64_t>::min())
+      return std::numeric_limits<int64_t>::max();
+    return a / b;
+  }
+};
+
+template<> struct BiOpScalar<int64_t, OP_SSQ> {
+  static MUSTINLINE int64_t apply(int64_t a, int64_t b) {
+    return saturated_add_i64(saturated_mul_i64(a, a), saturated_mul_i64(b, b));
+  }
+};
+
+/// Processes the longest prefix of a line the vector unit is able to handle
+/// and returns its length. The generic version handles nothing.
+template<typename T, int op> struct BiOpVector {
+  static MUSTINLINE int apply(T *, const T *, const T *, int) {
+    return 0;
+  }
+};
+
+template<typename T, int op> static MUSTINLINE void vector_biop(
+    T       *p_dst,
+    const T *p_src_a,
+    const T *p_src_b,
+    int      len) {
+  int i = BiOpVector<T, op>::apply(p_dst, p_src_a, p_src_b, len);
+  for (; i < len; ++i)
+    p_dst[i] = BiOpScalar<T, op>::apply(p_src_a[i], p_src_b[i]);
+}
+
+/// Applies the operation to bit lines. On the set {0, 1} saturated arithmetic
+/// degenerates into logical functions.
+template<int op> static MUSTINLINE uint8_t bit_biop(uint8_t a, uint8_t b) {
+  switch (op) {
+  case OP_MIN: case OP_MUL: case OP_DIV:
+    return a & b;
+  case OP_DIF:
+    return a & ~b;
+  case OP_ADF:
+    return a ^ b;
+  default:
+    return a | b;
+  }
+}
+
+template<int op> static MUSTINLINE void vector_bit_biop(
+    uint8_t       *p_dst,
+    const uint8_t *p_src_a,
+    const uint8_t *p_src_b,
+    int            len_bits) {
+  const int len = len_bits >> 3;
+  for (int i = 0; i < len; ++i)
+    p_dst[i] = bit_biop<op>(p_src_a[i], p_src_b[i]);
+  if (len_bits & 0x07) {
+    const uint8_t mask = static_cast<uint8_t>(0xFF00U >> (len_bits & 0x07));
+    p_dst[len] = static_cast<uint8_t>((p_dst[len] & ~mask) |
+                         (bit_biop<op>(p_src_a[len], p_src_b[len]) & mask));
+  }
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/arithmetic-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/arithmetic-inl.h"
+#endif
+
+#endif // VECTOR_ARITHMETIC_INL_H_INCLUDED
@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_BLEND_INL_H_INCLUDED
+#define VECTOR_BLEND_INL_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// Fixed-point arithmetic of blending: the weights are integers in
+/// [0, @c MAX_VALUE] and weighted sums are divided by @c MAX_VALUE with exact
+/// rounding to the nearest integer.
+template<typename T> struct BlendTraits;
+
+template<> struct BlendTraits<uint8_t> {
+  static const uint32_t MAX_VALUE = 0xFF;
+  /// Returns round(x / 255) for x in [0, 255 * 255].
+  static MUSTINLINE uint8_t Divide(uint32_t x) {
+    x += 0x80;
+    return static_cast<uint8_t>((x + (x >> 8)) >> 8);
+  }
+};
+
+template<> struct BlendTraits<uint16_t> {
+  static const uint32_t MAX_VALUE = 0xFFFF;
+  /// Returns round(x / 65535) for x in [0, 65535 * 65535].
+  static MUSTINLINE uint16_t Divide(uint32_t x) {
+    x += 0x8000;
+    return static_cast<uint16_t>((x + (x >> 16)) >> 16);
+  }
+};
+
+/// Blends the longest prefix of the lines the vector unit is able to handle
+/// and returns its length. The generic version handles nothing.
+template<typename T> struct BlendLineVector {
+  static MUSTINLINE int run(T *, const T *, const T *, int, uint32_t) {
+    return 0;
+  }
+};
+
+/// Computes <tt>p_dst[i] = (p_a[i] * (MAX - weight) + p_b[i] * weight) / MAX
+/// </tt> with rounding, where @c MAX is @c BlendTraits<T>::MAX_VALUE.
+template<typename T>
+static MUSTINLINE void BlendLine(
+    T        *p_dst,
+    const T  *p_a,
+    const T  *p_b,
+    int       len,
+    uint32_t  weight) {
+  typedef BlendTraits<T> Traits;
+  const uint32_t inverse = Traits::MAX_VALUE - weight;
+  int i = BlendLineVector<T>::run(p_dst, p_a, p_b, len, weight);
+  for (; i < len; ++i)
+    p_dst[i] = Traits::Divide(p_a[i] * inverse + p_b[i] * weight);
+}
+
+/// Composites the longest prefix of the pixels the vector unit is able to
+/// handle and returns its length in pixels. The generic version handles
+/// nothing.
+template<typename T, int BgChannels> struct CompositeLineVector {
+  static MUSTINLINE int run(T *, const T *, const T *, int) {
+    return 0;
+  }
+};
+
+/// Composites a line of 4-channel pixels with straight alpha in the last
+/// channel over a line of @c BgChannels-channel pixels. Colours are mixed by
+/// the foreground alpha, the alpha of a 4-channel background becomes
+/// <tt>a + bg_a * (MAX - a) / MAX</tt>.
+template<typename T, int BgChannels>
+static MUSTINLINE void CompositeLine(
+    T        *p_dst,
+    const T  *p_fg,
+    const T  *p_bg,
+    int       num_pixels) {
+  typedef BlendTraits<T> Traits;
+  int i = CompositeLineVector<T, BgChannels>::run(p_dst, p_fg, p_bg,
+                                                   num_pixels);
+  for (; i < num_pixels; ++i) {
+    const T *p_f = p_fg + i * 4;
+    const T *p_b = p_bg + i * BgChannels;
+    T *p_d = p_dst + i * BgChannels;
+    const uint32_t alpha = p_f[3];
+    const uint32_t inverse = Traits::MAX_VALUE - alpha;
+    for (int c = 0; c < 3; ++c)
+      p_d[c] = Traits::Divide(p_f[c] * alpha + p_b[c] * inverse);
+    if (BgChannels == 4)
+      p_d[3] = Traits::Divide(Traits::MAX_VALUE * alpha + p_b[3] * inverse);
+  }
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/blend-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/blend-inl.h"
+#endif
+
+#endif // VECTOR_BLEND_INL_H_INCLUDED
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_COMPARE_INL_H_INCLUDED
+#define VECTOR_COMPARE_INL_H_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+#include <minutils/smartptr.h>
+#include <minutils/crossplat.h>
+
+/// Accumulated difference between corresponding elements of two lines.
+struct DiffStats {
+  int64_t mismatches;     ///< The number of unequal elements.
+  double  max_abs_diff;   ///< The maximal absolute difference.
+  double  sse;            ///< The sum of squared differences.
+};
+
+/// Accumulates the longest prefix of the lines the vector unit is able to
+/// handle into the statistics and returns its length. The generic version
+/// handles nothing.
+template<typename T> struct DiffVector {
+  static MUSTINLINE int accumulate(DiffStats *, const T *, const T *, int) {
+    return 0;
+  }
+};
+
+template<typename T>
+static void AccumulateLineDiff(
+    DiffStats *p_stats,
+    const T   *p_a,
+    const T   *p_b,
+    int        len) {
+  int i = DiffVector<T>::accumulate(p_stats, p_a, p_b, len);
+  int64_t mismatches = 0;
+  double max_abs_diff = p_stats->max_abs_diff, sse = 0;
+  for (; i < len; ++i) {
+    if (p_a[i] == p_b[i])
+      continue;
+    double diff = std::fabs(static_cast<double>(p_a[i]) -
+                            static_cast<double>(p_b[i]));
+    ++mismatches;
+    max_abs_diff = std::max(max_abs_diff, diff);
+    sse += diff * diff;
+  }
+  p_stats->mismatches += mismatches;
+  p_stats->max_abs_diff = max_abs_diff;
+  p_stats->sse += sse;
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/compare-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/compare-inl.h"
+#endif
+
+#endif // VECTOR_COMPARE_INL_H_INCLUDED
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_GRADIENT_INL_H_INCLUDED
+#define VECTOR_GRADIENT_INL_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// Computes the vertical parts of a 3x3 gradient operator with weights
+/// (side, center, side) for the longest prefix of a line the vector unit is
+/// able to handle and returns its length. The generic version handles
+/// nothing.
+template<typename TSrc> struct GradientColumnsVector {
+  static MUSTINLINE int run(int16_t *, int16_t *, const TSrc *, const TSrc *,
+                            const TSrc *, int, int, int) {
+    return 0;
+  }
+};
+
+/// Computes the smoothed sums <tt>side * (above + below) + center * line</tt>
+/// and the differences <tt>below - above</tt> of three lines.
+template<typename TSrc>
+static MUSTINLINE void ComputeGradientColumns(
+    int16_t    *p_smooth,
+    int16_t    *p_diff,
+    const TSrc *p_above,
+    const TSrc *p_line,
+    const TSrc *p_below,
+    int         side,
+    int         center,
+    int         len) {
+  int x = GradientColumnsVector<TSrc>::run(p_smooth, p_diff, p_above, p_line,
+                                           p_below, side, center, len);
+  for (; x < len; ++x) {
+    p_smooth[x] = static_cast<int16_t>(side * (p_above[x] + p_below[x]) +
+                                       center * p_line[x]);
+    p_diff[x] = static_cast<int16_t>(p_below[x] - p_above[x]);
+  }
+}
+
+/// Computes the horizontal parts of a 3x3 gradient operator for the longest
+/// prefix of a line the vector unit is able to handle and returns its length.
+/// The generic version handles nothing.
+template<typename TDst> struct GradientRowsVector {
+  static MUSTINLINE int run(TDst *, TDst *, const int16_t *, const int16_t *,
+                            int, int, int) {
+    return 0;
+  }
+};
+
+/// Computes the derivatives from the vertical parts. Elements -1 and @c len of
+/// @c p_smooth and @c p_diff must hold the border values.
+template<typename TDst>
+static MUSTINLINE void ComputeGradientRows(
+    TDst          *p_dx,
+    TDst          *p_dy,
+    const int16_t *p_smooth,
+    const int16_t *p_diff,
+    int            side,
+    int            center,
+    int            len) {
+  int x = GradientRowsVector<TDst>::run(p_dx, p_dy, p_smooth, p_diff, side,
+                                        center, len);
+  for (; x < len; ++x) {
+    p_dx[x] = static_cast<TDst>(p_smooth[x + 1] - p_smooth[x - 1]);
+    p_dy[x] = static_cast<TDst>(side * (p_diff[x - 1] + p_diff[x + 1]) +
+                                center * p_diff[x]);
+  }
+}
+
+/// Computes squared magnitudes for the longest prefix of a line the vector
+/// unit is able to handle and returns its length. The generic version
+/// handles nothing.
+template<typename TSrc> struct SquaredMagnitudeVector {
+  static MUSTINLINE int run(int32_t *, const TSrc *, const TSrc *, int) {
+    return 0;
+  }
+};
+
+/// Computes <tt>dx^2 + dy^2</tt> for @c len elements.
+template<typename TSrc>
+static MUSTINLINE void ComputeSquaredMagnitudes(
+    int32_t    *p_magnitude,
+    const TSrc *p_dx,
+    const TSrc *p_dy,
+    int         len) {
+  int x = SquaredMagnitudeVector<TSrc>::run(p_magnitude, p_dx, p_dy, len);
+  for (; x < len; ++x)
+    p_magnitude[x] = p_dx[x] * p_dx[x] + p_dy[x] * p_dy[x];
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/gradient-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/gradient-inl.h"
+#endif
+
+#endif // VECTOR_GRADIENT_INL_H_INCLUDED
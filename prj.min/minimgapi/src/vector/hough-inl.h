@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_HOUGH_INL_H_INCLUDED
+#define VECTOR_HOUGH_INL_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// Computes accumulator indices of a point for the longest prefix of angles
+/// the vector unit is able to handle and returns its length. The generic
+/// version handles nothing.
+template<typename TIndex> struct HoughIndexVector {
+  static MUSTINLINE int run(TIndex *, const real32_t *, const real32_t *,
+                            const TIndex *, real32_t, real32_t, real32_t,
+                            int) {
+    return 0;
+  }
+};
+
+/// Computes <tt>p_bases[t] + (int)(x * p_cos[t] + y * p_sin[t] + offset)</tt>
+/// for @c len angles. The sum before truncation must be nonnegative, so that
+/// truncation is the same in all code paths.
+template<typename TIndex>
+static MUSTINLINE void ComputeHoughIndices(
+    TIndex         *p_indices,
+    const real32_t *p_cos,
+    const real32_t *p_sin,
+    const TIndex   *p_bases,
+    real32_t        x,
+    real32_t        y,
+    real32_t        offset,
+    int             len) {
+  int t = HoughIndexVector<TIndex>::run(p_indices, p_cos, p_sin, p_bases, x,
+                                        y, offset, len);
+  for (; t < len; ++t)
+    p_indices[t] = p_bases[t] +
+                   static_cast<TIndex>(x * p_cos[t] + y * p_sin[t] + offset);
+}
+
+/// Adds one accumulator to another for the longest prefix the vector unit is
+/// able to handle and returns its length. The generic version handles
+/// nothing.
+template<typename TCount> struct AccumulatorSumVector {
+  static MUSTINLINE int run(TCount *, const TCount *, int) {
+    return 0;
+  }
+};
+
+/// Computes <tt>p_dst[i] += p_src[i]</tt> for @c len elements.
+template<typename TCount>
+static MUSTINLINE void AddAccumulator(
+    TCount       *p_dst,
+    const TCount *p_src,
+    int           len) {
+  int i = AccumulatorSumVector<TCount>::run(p_dst, p_src, len);
+  for (; i < len; ++i)
+    p_dst[i] += p_src[i];
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/hough-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/hough-inl.h"
+#endif
+
+#endif // VECTOR_HOUGH_INL_H_INCLUDED
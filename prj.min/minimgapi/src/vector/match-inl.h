@@ -0,0 +1,66 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_MATCH_INL_H_INCLUDED
+#define VECTOR_MATCH_INL_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// Adds a scaled line to an accumulator line for the longest prefix the
+/// vector unit is able to handle and returns its length. The generic version
+/// handles nothing.
+template<typename TReal> struct MultiplyAddVector {
+  static MUSTINLINE int run(TReal *, const TReal *, TReal, int) {
+    return 0;
+  }
+};
+
+/// Computes <tt>p_sum[x] += p_line[x] * weight</tt> for @c len elements.
+template<typename TReal>
+static MUSTINLINE void MultiplyAddLine(
+    TReal       *p_sum,
+    const TReal *p_line,
+    TReal        weight,
+    int          len) {
+  int x = MultiplyAddVector<TReal>::run(p_sum, p_line, weight, len);
+  for (; x < len; ++x)
+    p_sum[x] += p_line[x] * weight;
+}
+
+#if defined(USE_SSE_SIMD)
+#include "sse/match-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/match-inl.h"
+#endif
+
+#endif // VECTOR_MATCH_INL_H_INCLUDED
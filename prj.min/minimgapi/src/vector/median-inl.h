@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_MEDIAN_INL_H_INCLUDED
+#define VECTOR_MEDIAN_INL_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/mintyp.h>
+
+/// Adds one histogram to and subtracts another from the longest prefix of a
+/// histogram the vector unit is able to handle and returns its length. The
+/// generic version handles nothing.
+template<typename TCount> struct HistogramUpdateVector {
+  static MUSTINLINE int update(TCount *, const TCount *, const TCount *, int) {
+    return 0;
+  }
+};
+
+/// Computes <tt>p_hist[i] += p_add[i] - p_sub[i]</tt> for @c len bins.
+template<typename TCount>
+static MUSTINLINE void UpdateHistogram(
+    TCount       *p_hist,
+    const TCount *p_add,
+    const TCount *p_sub,
+    int           len) {
+  int i = HistogramUpdateVector<TCount>::update(p_hist, p_add, p_sub, len);
+  for (; i < len; ++i)
+    p_hist[i] = static_cast<TCount>(p_hist[i] + p_add[i] - p_sub[i]);
+}
+
+/// Finds the first of 16 bins at which the running total, starting from
+/// @c *p_count, exceeds @c half, and adds the bins before it to @c *p_count.
+/// The bins must hold more than <tt>half - *p_count</tt> in total.
+template<typename TCount> struct HistogramSearchVector {
+  static MUSTINLINE int find(const TCount *p_bins, int *p_count, int half) {
+    int k = 0;
+    while (*p_count + p_bins[k] <= half)
+      *p_count += p_bins[k++];
+    return k;
+  }
+};
+
+#if defined(USE_SSE_SIMD)
+#include "sse/median-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/median-inl.h"
+#endif
+
+#endif // VECTOR_MEDIAN_INL_H_INCLUDED
@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_NEON_BLEND_INL_H_INCLUDED
+#define VECTOR_NEON_BLEND_INL_H_INCLUDED
+
+#include <arm_neon.h>
+#include <minutils/crossplat.h>
+
+// Returns round(x / 255) for x not exceeding 255 * 255.
+static MUSTINLINE uint8x8_t DivideBy255U16(uint16x8_t x) {
+  return vrshrn_n_u16(vaddq_u16(x, vrshrq_n_u16(x, 8)), 8);
+}
+
+// Returns round(x / 65535) for x not exceeding 65535 * 65535.
+static MUSTINLINE uint16x4_t DivideBy65535U32(uint32x4_t x) {
+  return vrshrn_n_u32(vaddq_u32(x, vrshrq_n_u32(x, 16)), 16);
+}
+
+static MUSTINLINE uint8x8_t BlendU8(
+    uint8x8_t a,
+    uint8x8_t wa,
+    uint8x8_t b,
+    uint8x8_t wb) {
+  return DivideBy255U16(vmlal_u8(vmull_u8(a, wa), b, wb));
+}
+
+static MUSTINLINE uint16x8_t BlendU16(
+    uint16x8_t a,
+    uint16x8_t wa,
+    uint16x8_t b,
+    uint16x8_t wb) {
+  uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(a), vget_low_u16(wa)),
+                            vget_low_u16(b), vget_low_u16(wb));
+  uint32x4_t hi = vmlal_u16(vmull_u16(vget_high_u16(a), vget_high_u16(wa)),
+                            vget_high_u16(b), vget_high_u16(wb));
+  return vcombine_u16(DivideBy65535U32(lo), DivideBy65535U32(hi));
+}
+
+template<> struct BlendLineVector<uint8_t> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_a,
+                            const uint8_t *p_b, int len, uint32_t weight) {
+    const uint8x8_t wa = vdup_n_u8(static_cast<uint8_t>(0xFF - weight));
+    const uint8x8_t wb = vdup_n_u8(static_cast<uint8_t>(weight));
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      uint8x16_t a = vld1q_u8(p_a + i);
+      uint8x16_t b = vld1q_u8(p_b + i);
+      vst1q_u8(p_dst + i,
+               vcombine_u8(BlendU8(vget_low_u8(a), wa, vget_low_u8(b), wb),
+                           BlendU8(vget_high_u8(a), wa, vget_high_u8(b), wb)));
+    }
+    return i;
+  }
+};
+
+template<> struct BlendLineVector<uint16_t> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_a,
+                            const uint16_t *p_b, int len, uint32_t weight) {
+    const uint16x8_t wa = vdupq_n_u16(static_cast<uint16_t>(0xFFFF - weight));
+    const uint16x8_t wb = vdupq_n_u16(static_cast<uint16_t>(weight));
+    int i = 0;
+    for (; i + 8 <= len; i += 8)
+      vst1q_u16(p_dst + i, BlendU16(vld1q_u16(p_a + i), wa,
+                                    vld1q_u16(p_b + i), wb));
+    return i;
+  }
+};
+
+// The structure loads deinterleave the channels, so that the alpha of eight
+// pixels is a single register.
+template<> struct CompositeLineVector<uint8_t, 4> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_fg,
+                            const uint8_t *p_bg, int num_pixels) {
+    const uint8x8_t max_value = vdup_n_u8(0xFF);
+    int i = 0;
+    for (; i + 8 <= num_pixels; i += 8) {
+      uint8x8x4_t fg = vld4_u8(p_fg + i * 4);
+      uint8x8x4_t bg = vld4_u8(p_bg + i * 4);
+      uint8x8_t inverse = vsub_u8(max_value, fg.val[3]);
+      uint8x8x4_t out;
+      for (int c = 0; c < 3; ++c)
+        out.val[c] = BlendU8(fg.val[c], fg.val[3], bg.val[c], inverse);
+      out.val[3] = BlendU8(max_value, fg.val[3], bg.val[3], inverse);
+      vst4_u8(p_dst + i * 4, out);
+    }
+    return i;
+  }
+};
+
+template<> struct CompositeLineVector<uint8_t, 3> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_fg,
+                            const uint8_t *p_bg, int num_pixels) {
+    const uint8x8_t max_value = vdup_n_u8(0xFF);
+    int i = 0;
+    for (; i + 8 <= num_pixels; i += 8) {
+      uint8x8x4_t fg = vld4_u8(p_fg + i * 4);
+      uint8x8x3_t bg = vld3_u8(p_bg + i * 3);
+      uint8x8_t inverse = vsub_u8(max_value, fg.val[3]);
+      uint8x8x3_t out;
+      for (int c = 0; c < 3; ++c)
+        out.val[c] = BlendU8(fg.val[c], fg.val[3], bg.val[c], inverse);
+      vst3_u8(p_dst + i * 3, out);
+    }
+    return i;
+  }
+};
+
+template<> struct CompositeLineVector<uint16_t, 4> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_fg,
+                            const uint16_t *p_bg, int num_pixels) {
+    const uint16x8_t max_value = vdupq_n_u16(0xFFFF);
+    int i = 0;
+    for (; i + 8 <= num_pixels; i += 8) {
+      uint16x8x4_t fg = vld4q_u16(p_fg + i * 4);
+      uint16x8x4_t bg = vld4q_u16(p_bg + i * 4);
+      uint16x8_t inverse = vsubq_u16(max_value, fg.val[3]);
+      uint16x8x4_t out;
+      for (int c = 0; c < 3; ++c)
+        out.val[c] = BlendU16(fg.val[c], fg.val[3], bg.val[c], inverse);
+      out.val[3] = BlendU16(max_value, fg.val[3], bg.val[3], inverse);
+      vst4q_u16(p_dst + i * 4, out);
+    }
+    return i;
+  }
+};
+
+template<> struct CompositeLineVector<uint16_t, 3> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_fg,
+                            const uint16_t *p_bg, int num_pixels) {
+    const uint16x8_t max_value = vdupq_n_u16(0xFFFF);
+    int i = 0;
+    for (; i + 8 <= num_pixels; i += 8) {
+      uint16x8x4_t fg = vld4q_u16(p_fg + i * 4);
+      uint16x8x3_t bg = vld3q_u16(p_bg + i * 3);
+      uint16x8_t inverse = vsubq_u16(max_value, fg.val[3]);
+      uint16x8x3_t out;
+      for (int c = 0; c < 3; ++c)
+        out.val[c] = BlendU16(fg.val[c], fg.val[3], bg.val[c], inverse);
+      vst3q_u16(p_dst + i * 3, out);
+    }
+    return i;
+  }
+};
+
+#endif // VECTOR_NEON_BLEND_INL_H_INCLUDED
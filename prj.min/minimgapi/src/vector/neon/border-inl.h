@@ -0,0 +1,76 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_NEON_BORDER_INL_H_INCLUDED
+#define VECTOR_NEON_BORDER_INL_H_INCLUDED
+
+#include <arm_neon.h>
+#include <minutils/crossplat.h>
+
+template<> struct ReversePixelsVector<1> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src, int len) {
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      uint8x16_t v = vrev64q_u8(vld1q_u8(p_src + len - i - 16));
+      vst1q_u8(p_dst + i, vcombine_u8(vget_high_u8(v), vget_low_u8(v)));
+    }
+    return i;
+  }
+};
+
+template<> struct ReversePixelsVector<2> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src, int len) {
+    const uint16_t *p_s = reinterpret_cast<const uint16_t *>(p_src);
+    uint16_t *p_d = reinterpret_cast<uint16_t *>(p_dst);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      uint16x8_t v = vrev64q_u16(vld1q_u16(p_s + len - i - 8));
+      vst1q_u16(p_d + i, vcombine_u16(vget_high_u16(v), vget_low_u16(v)));
+    }
+    return i;
+  }
+};
+
+template<> struct ReversePixelsVector<4> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src, int len) {
+    const uint32_t *p_s = reinterpret_cast<const uint32_t *>(p_src);
+    uint32_t *p_d = reinterpret_cast<uint32_t *>(p_dst);
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      uint32x4_t v = vrev64q_u32(vld1q_u32(p_s + len - i - 4));
+      vst1q_u32(p_d + i, vcombine_u32(vget_high_u32(v), vget_low_u32(v)));
+    }
+    return i;
+  }
+};
+
+#endif // VECTOR_NEON_BORDER_INL_H_INCLUDED
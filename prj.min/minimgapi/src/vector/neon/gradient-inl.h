@@ -0,0 +1,91 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_NEON_GRADIENT_INL_H_INCLUDED
+#define VECTOR_NEON_GRADIENT_INL_H_INCLUDED
+
+#include <arm_neon.h>
+#include <minutils/crossplat.h>
+
+template<> struct GradientColumnsVector<uint8_t> {
+  static MUSTINLINE int run(int16_t *p_smooth, int16_t *p_diff,
+                            const uint8_t *p_above, const uint8_t *p_line,
+                            const uint8_t *p_below, int side, int center,
+                            int len) {
+    const int16x8_t side_v = vdupq_n_s16(static_cast<int16_t>(side));
+    const int16x8_t center_v = vdupq_n_s16(static_cast<int16_t>(center));
+    int x = 0;
+    for (; x + 8 <= len; x += 8) {
+      int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p_above + x)));
+      int16x8_t l = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p_line + x)));
+      int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p_below + x)));
+      vst1q_s16(p_smooth + x, vmlaq_s16(vmulq_s16(l, center_v),
+                                        vaddq_s16(a, b), side_v));
+      vst1q_s16(p_diff + x, vsubq_s16(b, a));
+    }
+    return x;
+  }
+};
+
+template<> struct GradientRowsVector<int16_t> {
+  static MUSTINLINE int run(int16_t *p_dx, int16_t *p_dy,
+                            const int16_t *p_smooth, const int16_t *p_diff,
+                            int side, int center, int len) {
+    const int16x8_t side_v = vdupq_n_s16(static_cast<int16_t>(side));
+    const int16x8_t center_v = vdupq_n_s16(static_cast<int16_t>(center));
+    int x = 0;
+    for (; x + 8 <= len; x += 8) {
+      vst1q_s16(p_dx + x, vsubq_s16(vld1q_s16(p_smooth + x + 1),
+                                    vld1q_s16(p_smooth + x - 1)));
+      int16x8_t sides = vaddq_s16(vld1q_s16(p_diff + x - 1),
+                                  vld1q_s16(p_diff + x + 1));
+      vst1q_s16(p_dy + x, vmlaq_s16(vmulq_s16(vld1q_s16(p_diff + x),
+                                              center_v), sides, side_v));
+    }
+    return x;
+  }
+};
+
+template<> struct SquaredMagnitudeVector<int16_t> {
+  static MUSTINLINE int run(int32_t *p_magnitude, const int16_t *p_dx,
+                            const int16_t *p_dy, int len) {
+    int x = 0;
+    for (; x + 4 <= len; x += 4) {
+      int16x4_t dx = vld1_s16(p_dx + x);
+      int16x4_t dy = vld1_s16(p_dy + x);
+      vst1q_s32(p_magnitude + x, vmlal_s16(vmull_s16(dx, dx), dy, dy));
+    }
+    return x;
+  }
+};
+
+#endif // VECTOR_NEON_GRADIENT_INL_H_INCLUDED
@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_NEON_HOUGH_INL_H_INCLUDED
+#define VECTOR_NEON_HOUGH_INL_H_INCLUDED
+
+#include <arm_neon.h>
+#include <minutils/crossplat.h>
+
+template<> struct HoughIndexVector<int32_t> {
+  static MUSTINLINE int run(int32_t *p_indices, const real32_t *p_cos,
+                            const real32_t *p_sin, const int32_t *p_bases,
+                            real32_t x, real32_t y, real32_t offset,
+                            int len) {
+    const float32x4_t offset_v = vdupq_n_f32(offset);
+    int t = 0;
+    for (; t + 4 <= len; t += 4) {
+      float32x4_t r = vmlaq_n_f32(vmlaq_n_f32(offset_v, vld1q_f32(p_cos + t),
+                                              x),
+                                  vld1q_f32(p_sin + t), y);
+      vst1q_s32(p_indices + t, vaddq_s32(vld1q_s32(p_bases + t),
+                                         vcvtq_s32_f32(r)));
+    }
+    return t;
+  }
+};
+
+template<> struct AccumulatorSumVector<int32_t> {
+  static MUSTINLINE int run(int32_t *p_dst, const int32_t *p_src, int len) {
+    int i = 0;
+    for (; i + 4 <= len; i += 4)
+      vst1q_s32(p_dst + i, vaddq_s32(vld1q_s32(p_dst + i),
+                                     vld1q_s32(p_src + i)));
+    return i;
+  }
+};
+
+#endif // VECTOR_NEON_HOUGH_INL_H_INCLUDED
@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_NEON_MASK_INL_H_INCLUDED
+#define VECTOR_NEON_MASK_INL_H_INCLUDED
+
+#include <arm_neon.h>
+#include <minutils/crossplat.h>
+
+// Replaces the bytes of 16 destination bytes whose keep mask is zero with the
+// source ones.
+static MUSTINLINE void MergeBytes(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    uint8x16_t     keep) {
+  vst1q_u8(p_dst, vbslq_u8(keep, vld1q_u8(p_dst), vld1q_u8(p_src)));
+}
+
+// Processes 16 pixels at once. Blocks with unset mask are skipped, blocks
+// with set mask are copied, and mixed ones are merged with the keep mask
+// (the bytes of pixels with zero mask) widened to the pixel size.
+template<int PixelSize>
+struct CopyMaskedNeon {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src,
+                            const uint8_t *p_mask, int len) {
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      uint8x16_t keep = vceqq_u8(vld1q_u8(p_mask + i), vdupq_n_u8(0));
+      uint64x2_t halves = vreinterpretq_u64_u8(keep);
+      uint64_t all = vgetq_lane_u64(halves, 0) & vgetq_lane_u64(halves, 1);
+      uint64_t any = vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1);
+      if (all == ~static_cast<uint64_t>(0))
+        continue;
+      uint8_t *p_d = p_dst + i * PixelSize;
+      const uint8_t *p_s = p_src + i * PixelSize;
+      if (any == 0) {
+        for (int k = 0; k < PixelSize; ++k)
+          vst1q_u8(p_d + 16 * k, vld1q_u8(p_s + 16 * k));
+        continue;
+      }
+      if (PixelSize == 1) {
+        MergeBytes(p_d, p_s, keep);
+      } else if (PixelSize == 2) {
+        uint8x16x2_t wide = vzipq_u8(keep, keep);
+        MergeBytes(p_d, p_s, wide.val[0]);
+        MergeBytes(p_d + 16, p_s + 16, wide.val[1]);
+      } else {
+        uint8x16x2_t wide = vzipq_u8(keep, keep);
+        uint16x8x2_t lo = vzipq_u16(vreinterpretq_u16_u8(wide.val[0]),
+                                    vreinterpretq_u16_u8(wide.val[0]));
+        uint16x8x2_t hi = vzipq_u16(vreinterpretq_u16_u8(wide.val[1]),
+                                    vreinterpretq_u16_u8(wide.val[1]));
+        MergeBytes(p_d, p_s, vreinterpretq_u8_u16(lo.val[0]));
+        MergeBytes(p_d + 16, p_s + 16, vreinterpretq_u8_u16(lo.val[1]));
+        MergeBytes(p_d + 32, p_s + 32, vreinterpretq_u8_u16(hi.val[0]));
+        MergeBytes(p_d + 48, p_s + 48, vreinterpretq_u8_u16(hi.val[1]));
+      }
+    }
+    return i;
+  }
+};
+
+template<> struct CopyMaskedVector<1> : CopyMaskedNeon<1> {};
+template<> struct CopyMaskedVector<2> : CopyMaskedNeon<2> {};
+template<> struct CopyMaskedVector<4> : CopyMaskedNeon<4> {};
+
+#endif // VECTOR_NEON_MASK_INL_H_INCLUDED
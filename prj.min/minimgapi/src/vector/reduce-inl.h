@@ -0,0 +1,219 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_REDUCE_INL_H_INCLUDED
+#define VECTOR_REDUCE_INL_H_INCLUDED
+
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <minutils/smartptr.h>
+#include <minutils/crossplat.h>
+#include <minutils/mathoper.h>
+#include "arithmetic-inl.h"
+
+/// Accumulates the longest prefix of a line the vector unit is able to handle
+/// into the partial accumulators and returns its length. The generic version
+/// handles nothing.
+template<typename T, typename TPart, int op> struct ReduceVector {
+  static MUSTINLINE int accumulate(TPart *, const T *, int) {
+    return 0;
+  }
+};
+
+/// Types of the accumulators used by summation. Narrow types are summed into
+/// 32-bit partial accumulators which are flushed into 64-bit ones every
+/// @c period lines, before they could overflow.
+template<typename T> struct ReduceAddTypes {
+  typedef int64_t part_t;
+  typedef int64_t acc_t;
+  static const int period = INT_MAX;
+};
+
+template<> struct ReduceAddTypes<uint8_t> {
+  typedef uint32_t part_t;
+  typedef int64_t  acc_t;
+  static const int period = 1 << 24;
+};
+
+template<> struct ReduceAddTypes<int8_t> {
+  typedef int32_t part_t;
+  typedef int64_t acc_t;
+  static const int period = 1 << 23;
+};
+
+template<> struct ReduceAddTypes<uint16_t> {
+  typedef uint32_t part_t;
+  typedef int64_t  acc_t;
+  static const int period = 1 << 16;
+};
+
+template<> struct ReduceAddTypes<int16_t> {
+  typedef int32_t part_t;
+  typedef int64_t acc_t;
+  static const int period = 1 << 15;
+};
+
+template<> struct ReduceAddTypes<uint64_t> {
+  typedef uint64_t part_t;
+  typedef uint64_t acc_t;
+  static const int period = INT_MAX;
+};
+
+template<> struct ReduceAddTypes<real32_t> {
+  typedef real64_t part_t;
+  typedef real64_t acc_t;
+  static const int period = INT_MAX;
+};
+
+template<> struct ReduceAddTypes<real64_t> {
+  typedef real64_t part_t;
+  typedef real64_t acc_t;
+  static const int period = INT_MAX;
+};
+
+/// Describes a reduction by an associative-commutative operation. Lines are
+/// accumulated element-wise into partial accumulators (@c accumulate), those
+/// are merged into total ones (@c merge), the totals of different parts of
+/// an image are combined (@c combine and @c fold), and the final value is
+/// obtained by @c finalize.
+template<typename T, int op> struct Reducer;
+
+template<typename T> struct Reducer<T, OP_ADD> {
+  typedef typename ReduceAddTypes<T>::part_t part_t;
+  typedef typename ReduceAddTypes<T>::acc_t  acc_t;
+  static const int period = ReduceAddTypes<T>::period;
+
+  static MUSTINLINE part_t part_identity() { return 0; }
+  static MUSTINLINE acc_t identity() { return 0; }
+  static MUSTINLINE acc_t fold(acc_t a, acc_t b) {
+    return BiOpScalar<acc_t, OP_ADD>::apply(a, b);
+  }
+  static MUSTINLINE acc_t finalize(acc_t a) { return a; }
+
+  static MUSTINLINE void accumulate(part_t *p_part, const T *p_src, int len) {
+    int i = ReduceVector<T, part_t, OP_ADD>::accumulate(p_part, p_src, len);
+    for (; i < len; ++i)
+      p_part[i] = BiOpScalar<part_t, OP_ADD>::apply(p_part[i], p_src[i]);
+  }
+  static MUSTINLINE void merge(acc_t *p_acc, const part_t *p_part, int len) {
+    for (int i = 0; i < len; ++i)
+      p_acc[i] = fold(p_acc[i], p_part[i]);
+  }
+  static MUSTINLINE void combine(acc_t *p_acc, const acc_t *p_other, int len) {
+    vector_biop<acc_t, OP_ADD>(p_acc, p_acc, p_other, len);
+  }
+};
+
+template<typename T, int op> struct ReduceIdempotent {
+  typedef T part_t;
+  typedef T acc_t;
+  static const int period = INT_MAX;
+
+  static MUSTINLINE T identity() {
+    if (std::numeric_limits<T>::has_infinity)
+      return op == OP_MIN ? std::numeric_limits<T>::infinity() :
+                           -std::numeric_limits<T>::infinity();
+    return op == OP_MIN ? std::numeric_limits<T>::max() :
+                          std::numeric_limits<T>::min();
+  }
+  static MUSTINLINE T part_identity() { return identity(); }
+  static MUSTINLINE T fold(T a, T b) { return BiOpScalar<T, op>::apply(a, b); }
+  static MUSTINLINE T finalize(T a) { return a; }
+
+  static MUSTINLINE void accumulate(T *p_part, const T *p_src, int len) {
+    vector_biop<T, op>(p_part, p_part, p_src, len);
+  }
+  static MUSTINLINE void merge(T *p_acc, const T *p_part, int len) {
+    vector_biop<T, op>(p_acc, p_acc, p_part, len);
+  }
+  static MUSTINLINE void combine(T *p_acc, const T *p_other, int len) {
+    vector_biop<T, op>(p_acc, p_acc, p_other, len);
+  }
+};
+
+template<typename T> struct Reducer<T, OP_MIN> : ReduceIdempotent<T, OP_MIN> {
+};
+
+template<typename T> struct Reducer<T, OP_MAX> : ReduceIdempotent<T, OP_MAX> {
+};
+
+/// Products and Euclidean norms are accumulated in doubles: the former
+/// overflow any integer type quickly, the latter need a square root anyway.
+template<typename T, int op> struct ReduceInReals {
+  typedef real64_t part_t;
+  typedef real64_t acc_t;
+  static const int period = INT_MAX;
+
+  static MUSTINLINE real64_t identity() { return op == OP_MUL ? 1. : 0.; }
+  static MUSTINLINE real64_t part_identity() { return identity(); }
+  static MUSTINLINE real64_t fold(real64_t a, real64_t b) {
+    return op == OP_MUL ? a * b : a + b;
+  }
+  static MUSTINLINE real64_t finalize(real64_t a) {
+    return op == OP_EUC ? std::sqrt(a) : a;
+  }
+
+  static MUSTINLINE void accumulate(real64_t *p_part, const T *p_src,
+                                    int len) {
+    int i = ReduceVector<T, real64_t, op>::accumulate(p_part, p_src, len);
+    for (; i < len; ++i) {
+      real64_t v = static_cast<real64_t>(p_src[i]);
+      p_part[i] = op == OP_MUL ? p_part[i] * v : p_part[i] + v * v;
+    }
+  }
+  static MUSTINLINE void merge(real64_t *p_acc, const real64_t *p_part,
+                               int len) {
+    combine(p_acc, p_part, len);
+  }
+  static MUSTINLINE void combine(real64_t *p_acc, const real64_t *p_other,
+                                 int len) {
+    if (op == OP_MUL)
+      vector_biop<real64_t, OP_MUL>(p_acc, p_acc, p_other, len);
+    else
+      vector_biop<real64_t, OP_ADD>(p_acc, p_acc, p_other, len);
+  }
+};
+
+template<typename T> struct Reducer<T, OP_MUL> : ReduceInReals<T, OP_MUL> {
+};
+
+template<typename T> struct Reducer<T, OP_EUC> : ReduceInReals<T, OP_EUC> {
+};
+
+#if defined(USE_SSE_SIMD)
+#include "sse/reduce-inl.h"
+#elif defined(USE_NEON_SIMD)
+#include "neon/reduce-inl.h"
+#endif
+
+#endif // VECTOR_REDUCE_INL_H_INCLUDED
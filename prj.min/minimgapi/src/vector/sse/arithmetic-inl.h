@@ -0,0 +1,381 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_ARITHMETIC_INL_H_INCLUDED
+#define VECTOR_SSE_ARITHMETIC_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+
+static MUSTINLINE __m128i sse_min_epi8(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_min_epi8(a, b);
+#else
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  return _mm_xor_si128(_mm_min_epu8(_mm_xor_si128(a, bias),
+                                    _mm_xor_si128(b, bias)), bias);
+#endif
+}
+
+static MUSTINLINE __m128i sse_max_epi8(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_max_epi8(a, b);
+#else
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  return _mm_xor_si128(_mm_max_epu8(_mm_xor_si128(a, bias),
+                                    _mm_xor_si128(b, bias)), bias);
+#endif
+}
+
+static MUSTINLINE __m128i sse_min_epu16(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_min_epu16(a, b);
+#else
+  const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+  return _mm_xor_si128(_mm_min_epi16(_mm_xor_si128(a, bias),
+                                     _mm_xor_si128(b, bias)), bias);
+#endif
+}
+
+static MUSTINLINE __m128i sse_max_epu16(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_max_epu16(a, b);
+#else
+  const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+  return _mm_xor_si128(_mm_max_epi16(_mm_xor_si128(a, bias),
+                                     _mm_xor_si128(b, bias)), bias);
+#endif
+}
+
+static MUSTINLINE __m128i sse_select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static MUSTINLINE __m128i sse_min_epi32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_min_epi32(a, b);
+#else
+  return sse_select(_mm_cmplt_epi32(a, b), a, b);
+#endif
+}
+
+static MUSTINLINE __m128i sse_max_epi32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_max_epi32(a, b);
+#else
+  return sse_select(_mm_cmpgt_epi32(a, b), a, b);
+#endif
+}
+
+static MUSTINLINE __m128i sse_cmplt_epu32(__m128i a, __m128i b) {
+  const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000U));
+  return _mm_cmplt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+
+static MUSTINLINE __m128i sse_min_epu32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_min_epu32(a, b);
+#else
+  return sse_select(sse_cmplt_epu32(a, b), a, b);
+#endif
+}
+
+static MUSTINLINE __m128i sse_max_epu32(__m128i a, __m128i b) {
+#if defined(__SSE4_1__)
+  return _mm_max_epu32(a, b);
+#else
+  return sse_select(sse_cmplt_epu32(a, b), b, a);
+#endif
+}
+
+// Clamps unsigned 16-bit values to 255 and packs them into bytes.
+static MUSTINLINE __m128i sse_packus_epu16(__m128i lo, __m128i hi) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(0xFF);
+  __m128i lo_fits = _mm_cmpeq_epi16(_mm_srli_epi16(lo, 8), zero);
+  __m128i hi_fits = _mm_cmpeq_epi16(_mm_srli_epi16(hi, 8), zero);
+  return _mm_packus_epi16(sse_select(lo_fits, lo, full),
+                          sse_select(hi_fits, hi, full));
+}
+
+static MUSTINLINE __m128i sse_mul_epu8(__m128i a, __m128i b) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+                               _mm_unpacklo_epi8(b, zero));
+  __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+                               _mm_unpackhi_epi8(b, zero));
+  return sse_packus_epu16(lo, hi);
+}
+
+static MUSTINLINE __m128i sse_ssq_epu8(__m128i a, __m128i b) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+  __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+  __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+  __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+  __m128i lo = _mm_adds_epu16(_mm_mullo_epi16(a_lo, a_lo),
+                              _mm_mullo_epi16(b_lo, b_lo));
+  __m128i hi = _mm_adds_epu16(_mm_mullo_epi16(a_hi, a_hi),
+                              _mm_mullo_epi16(b_hi, b_hi));
+  return sse_packus_epu16(lo, hi);
+}
+
+static MUSTINLINE __m128i sse_mul_epi8(__m128i a, __m128i b) {
+  __m128i lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8),
+                               _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8));
+  __m128i hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8),
+                               _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8));
+  return _mm_packs_epi16(lo, hi);
+}
+
+static MUSTINLINE __m128i sse_ssq_epi8(__m128i a, __m128i b) {
+  __m128i a_lo = _mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8);
+  __m128i a_hi = _mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8);
+  __m128i b_lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+  __m128i b_hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+  __m128i lo = _mm_adds_epi16(_mm_mullo_epi16(a_lo, a_lo),
+                              _mm_mullo_epi16(b_lo, b_lo));
+  __m128i hi = _mm_adds_epi16(_mm_mullo_epi16(a_hi, a_hi),
+                              _mm_mullo_epi16(b_hi, b_hi));
+  return _mm_packs_epi16(lo, hi);
+}
+
+static MUSTINLINE __m128i sse_avg_epi8(__m128i a, __m128i b) {
+  const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+  return _mm_xor_si128(_mm_avg_epu8(_mm_xor_si128(a, bias),
+                                    _mm_xor_si128(b, bias)), bias);
+}
+
+static MUSTINLINE __m128i sse_mul_epu16(__m128i a, __m128i b) {
+  __m128i hi = _mm_mulhi_epu16(a, b);
+  __m128i overflow = _mm_cmpeq_epi16(hi, _mm_setzero_si128());
+  return _mm_or_si128(_mm_mullo_epi16(a, b),
+                      _mm_xor_si128(overflow, _mm_set1_epi32(-1)));
+}
+
+static MUSTINLINE __m128i sse_mul_epi16(__m128i a, __m128i b) {
+  __m128i lo = _mm_mullo_epi16(a, b);
+  __m128i hi = _mm_mulhi_epi16(a, b);
+  return _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi),
+                         _mm_unpackhi_epi16(lo, hi));
+}
+
+static MUSTINLINE __m128i sse_ssq_epi16(__m128i a, __m128i b) {
+  // Squares are non-negative, so saturating each of them first is exact.
+  return _mm_adds_epi16(sse_mul_epi16(a, a), sse_mul_epi16(b, b));
+}
+
+static MUSTINLINE __m128i sse_avg_epi16(__m128i a, __m128i b) {
+  const __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+  return _mm_xor_si128(_mm_avg_epu16(_mm_xor_si128(a, bias),
+                                     _mm_xor_si128(b, bias)), bias);
+}
+
+static MUSTINLINE __m128i sse_adds_epi32(__m128i a, __m128i b) {
+  __m128i r = _mm_add_epi32(a, b);
+  __m128i overflow = _mm_srai_epi32(
+      _mm_and_si128(_mm_xor_si128(a, r), _mm_xor_si128(b, r)), 31);
+  __m128i limit = _mm_xor_si128(_mm_srai_epi32(a, 31),
+                                _mm_set1_epi32(0x7FFFFFFF));
+  return sse_select(overflow, limit, r);
+}
+
+static MUSTINLINE __m128i sse_subs_epi32(__m128i a, __m128i b) {
+  __m128i r = _mm_sub_epi32(a, b);
+  __m128i overflow = _mm_srai_epi32(
+      _mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, r)), 31);
+  __m128i limit = _mm_xor_si128(_mm_srai_epi32(a, 31),
+                                _mm_set1_epi32(0x7FFFFFFF));
+  return sse_select(overflow, limit, r);
+}
+
+static MUSTINLINE __m128i sse_adf_epi32(__m128i a, __m128i b) {
+  __m128i r = _mm_sub_epi32(sse_max_epi32(a, b), sse_min_epi32(a, b));
+  // The true difference is non-negative; a negative one means wrap-around.
+  __m128i overflow = _mm_srai_epi32(r, 31);
+  return sse_select(overflow, _mm_set1_epi32(0x7FFFFFFF), r);
+}
+
+static MUSTINLINE __m128i sse_avg_epi32(__m128i a, __m128i b) {
+  __m128i odd = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi32(1));
+  return _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(a, 1),
+                                     _mm_srai_epi32(b, 1)), odd);
+}
+
+static MUSTINLINE __m128i sse_adds_epu32(__m128i a, __m128i b) {
+  __m128i r = _mm_add_epi32(a, b);
+  return _mm_or_si128(r, sse_cmplt_epu32(r, a));
+}
+
+static MUSTINLINE __m128i sse_subs_epu32(__m128i a, __m128i b) {
+  return _mm_andnot_si128(sse_cmplt_epu32(a, b), _mm_sub_epi32(a, b));
+}
+
+static MUSTINLINE __m128i sse_avg_epu32(__m128i a, __m128i b) {
+  __m128i odd = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi32(1));
+  return _mm_add_epi32(_mm_add_epi32(_mm_srli_epi32(a, 1),
+                                     _mm_srli_epi32(b, 1)), odd);
+}
+
+#define DEFINE_SSE_BIOP(T, op, vec_t, load, store, expr)                      \
+template<> struct BiOpVector<T, op> {                                         \
+  static MUSTINLINE int apply(                                                \
+      T       *p_dst,                                                         \
+      const T *p_src_a,                                                       \
+      const T *p_src_b,                                                       \
+      int      len) {                                                         \
+    const int step = static_cast<int>(sizeof(vec_t) / sizeof(T));             \
+    int i = 0;                                                                \
+    for (; i + step <= len; i += step) {                                      \
+      vec_t a = load(reinterpret_cast<const vec_t *>(p_src_a + i));           \
+      vec_t b = load(reinterpret_cast<const vec_t *>(p_src_b + i));           \
+      store(reinterpret_cast<vec_t *>(p_dst + i), expr);                      \
+    }                                                                         \
+    return i;                                                                 \
+  }                                                                           \
+};
+
+#define DEFINE_SSE_BIOP_SI(T, op, expr) \
+    DEFINE_SSE_BIOP(T, op, __m128i, _mm_loadu_si128, _mm_storeu_si128, expr)
+
+static MUSTINLINE __m128 sse_loadu_ps(const __m128 *p) {
+  return _mm_loadu_ps(reinterpret_cast<const float *>(p));
+}
+
+static MUSTINLINE void sse_storeu_ps(__m128 *p, __m128 v) {
+  _mm_storeu_ps(reinterpret_cast<float *>(p), v);
+}
+
+static MUSTINLINE __m128d sse_loadu_pd(const __m128d *p) {
+  return _mm_loadu_pd(reinterpret_cast<const double *>(p));
+}
+
+static MUSTINLINE void sse_storeu_pd(__m128d *p, __m128d v) {
+  _mm_storeu_pd(reinterpret_cast<double *>(p), v);
+}
+
+#define DEFINE_SSE_BIOP_PS(op, expr) \
+    DEFINE_SSE_BIOP(real32_t, op, __m128, sse_loadu_ps, sse_storeu_ps, expr)
+#define DEFINE_SSE_BIOP_PD(op, expr) \
+    DEFINE_SSE_BIOP(real64_t, op, __m128d, sse_loadu_pd, sse_storeu_pd, expr)
+
+DEFINE_SSE_BIOP_SI(uint8_t, OP_MIN, _mm_min_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_MAX, _mm_max_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_ADD, _mm_adds_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_DIF, _mm_subs_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_ADF, _mm_or_si128(_mm_subs_epu8(a, b),
+                                                 _mm_subs_epu8(b, a)))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_MUL, sse_mul_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_AVE, _mm_avg_epu8(a, b))
+DEFINE_SSE_BIOP_SI(uint8_t, OP_SSQ, sse_ssq_epu8(a, b))
+
+DEFINE_SSE_BIOP_SI(int8_t, OP_MIN, sse_min_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_MAX, sse_max_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_ADD, _mm_adds_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_DIF, _mm_subs_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_ADF, _mm_subs_epi8(sse_max_epi8(a, b),
+                                                 sse_min_epi8(a, b)))
+DEFINE_SSE_BIOP_SI(int8_t, OP_MUL, sse_mul_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_AVE, sse_avg_epi8(a, b))
+DEFINE_SSE_BIOP_SI(int8_t, OP_SSQ, sse_ssq_epi8(a, b))
+
+DEFINE_SSE_BIOP_SI(uint16_t, OP_MIN, sse_min_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_MAX, sse_max_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_ADD, _mm_adds_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_DIF, _mm_subs_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_ADF, _mm_or_si128(_mm_subs_epu16(a, b),
+                                                  _mm_subs_epu16(b, a)))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_MUL, sse_mul_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_AVE, _mm_avg_epu16(a, b))
+DEFINE_SSE_BIOP_SI(uint16_t, OP_SSQ, _mm_adds_epu16(sse_mul_epu16(a, a),
+                                                    sse_mul_epu16(b, b)))
+
+DEFINE_SSE_BIOP_SI(int16_t, OP_MIN, _mm_min_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_MAX, _mm_max_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_ADD, _mm_adds_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_DIF, _mm_subs_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_ADF, _mm_subs_epi16(_mm_max_epi16(a, b),
+                                                   _mm_min_epi16(a, b)))
+DEFINE_SSE_BIOP_SI(int16_t, OP_MUL, sse_mul_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_AVE, sse_avg_epi16(a, b))
+DEFINE_SSE_BIOP_SI(int16_t, OP_SSQ, sse_ssq_epi16(a, b))
+
+DEFINE_SSE_BIOP_SI(uint32_t, OP_MIN, sse_min_epu32(a, b))
+DEFINE_SSE_BIOP_SI(uint32_t, OP_MAX, sse_max_epu32(a, b))
+DEFINE_SSE_BIOP_SI(uint32_t, OP_ADD, sse_adds_epu32(a, b))
+DEFINE_SSE_BIOP_SI(uint32_t, OP_DIF, sse_subs_epu32(a, b))
+DEFINE_SSE_BIOP_SI(uint32_t, OP_ADF, _mm_sub_epi32(sse_max_epu32(a, b),
+                                                   sse_min_epu32(a, b)))
+DEFINE_SSE_BIOP_SI(uint32_t, OP_AVE, sse_avg_epu32(a, b))
+
+DEFINE_SSE_BIOP_SI(int32_t, OP_MIN, sse_min_epi32(a, b))
+DEFINE_SSE_BIOP_SI(int32_t, OP_MAX, sse_max_epi32(a, b))
+DEFINE_SSE_BIOP_SI(int32_t, OP_ADD, sse_adds_epi32(a, b))
+DEFINE_SSE_BIOP_SI(int32_t, OP_DIF, sse_subs_epi32(a, b))
+DEFINE_SSE_BIOP_SI(int32_t, OP_ADF, sse_adf_epi32(a, b))
+DEFINE_SSE_BIOP_SI(int32_t, OP_AVE, sse_avg_epi32(a, b))
+
+DEFINE_SSE_BIOP_PS(OP_MIN, _mm_min_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_MAX, _mm_max_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_ADD, _mm_add_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_DIF, _mm_sub_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_ADF, _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(a, b)))
+DEFINE_SSE_BIOP_PS(OP_MUL, _mm_mul_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_AVE, _mm_mul_ps(_mm_add_ps(a, b), _mm_set1_ps(0.5f)))
+DEFINE_SSE_BIOP_PS(OP_EUC, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, a),
+                                                  _mm_mul_ps(b, b))))
+DEFINE_SSE_BIOP_PS(OP_DIV, _mm_div_ps(a, b))
+DEFINE_SSE_BIOP_PS(OP_SSQ, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)))
+
+DEFINE_SSE_BIOP_PD(OP_MIN, _mm_min_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_MAX, _mm_max_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_ADD, _mm_add_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_DIF, _mm_sub_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_ADF, _mm_andnot_pd(_mm_set1_pd(-0.0), _mm_sub_pd(a, b)))
+DEFINE_SSE_BIOP_PD(OP_MUL, _mm_mul_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_AVE, _mm_mul_pd(_mm_add_pd(a, b), _mm_set1_pd(0.5)))
+DEFINE_SSE_BIOP_PD(OP_EUC, _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(a, a),
+                                                  _mm_mul_pd(b, b))))
+DEFINE_SSE_BIOP_PD(OP_DIV, _mm_div_pd(a, b))
+DEFINE_SSE_BIOP_PD(OP_SSQ, _mm_add_pd(_mm_mul_pd(a, a), _mm_mul_pd(b, b)))
+
+#undef DEFINE_SSE_BIOP_PD
+#undef DEFINE_SSE_BIOP_PS
+#undef DEFINE_SSE_BIOP_SI
+#undef DEFINE_SSE_BIOP
+
+#endif // VECTOR_SSE_ARITHMETIC_INL_H_INCLUDED
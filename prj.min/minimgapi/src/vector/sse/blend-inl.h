@@ -0,0 +1,255 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_BLEND_INL_H_INCLUDED
+#define VECTOR_SSE_BLEND_INL_H_INCLUDED
+
+#include <cstring>
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+// Returns round(x / 255) for unsigned 16-bit lanes not exceeding 255 * 255.
+static MUSTINLINE __m128i DivideBy255Epu16(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Returns round(x / 65535) for unsigned 32-bit lanes not exceeding
+// 65535 * 65535.
+static MUSTINLINE __m128i DivideBy65535Epu32(__m128i x) {
+  x = _mm_add_epi32(x, _mm_set1_epi32(0x8000));
+  return _mm_srli_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 16)), 16);
+}
+
+// Packs unsigned 32-bit lanes not exceeding 0xFFFF to 16 bits. SSE2 has only
+// the signed saturating pack, so the lanes are sign-extended from 16 bits
+// first.
+static MUSTINLINE __m128i PackEpu32(__m128i lo, __m128i hi) {
+  lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+  hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+// Computes a * wa + b * wb for unsigned 16-bit lanes, the products of the
+// four lower lanes go to p_lo and the ones of the upper lanes go to p_hi.
+static MUSTINLINE void MultiplyAddEpu16(
+    __m128i  a,
+    __m128i  wa,
+    __m128i  b,
+    __m128i  wb,
+    __m128i *p_lo,
+    __m128i *p_hi) {
+  __m128i a_lo = _mm_mullo_epi16(a, wa);
+  __m128i a_hi = _mm_mulhi_epu16(a, wa);
+  __m128i b_lo = _mm_mullo_epi16(b, wb);
+  __m128i b_hi = _mm_mulhi_epu16(b, wb);
+  *p_lo = _mm_add_epi32(_mm_unpacklo_epi16(a_lo, a_hi),
+                        _mm_unpacklo_epi16(b_lo, b_hi));
+  *p_hi = _mm_add_epi32(_mm_unpackhi_epi16(a_lo, a_hi),
+                        _mm_unpackhi_epi16(b_lo, b_hi));
+}
+
+// Computes round((a * wa + b * wb) / 65535) for unsigned 16-bit lanes.
+static MUSTINLINE __m128i BlendEpu16(
+    __m128i a,
+    __m128i wa,
+    __m128i b,
+    __m128i wb) {
+  __m128i lo, hi;
+  MultiplyAddEpu16(a, wa, b, wb, &lo, &hi);
+  return PackEpu32(DivideBy65535Epu32(lo), DivideBy65535Epu32(hi));
+}
+
+// Broadcasts the last lane of each 4-lane pixel of 16-bit lanes.
+static MUSTINLINE __m128i BroadcastAlphaEpi16(__m128i v) {
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF);
+}
+
+template<> struct BlendLineVector<uint8_t> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_a,
+                            const uint8_t *p_b, int len, uint32_t weight) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16(static_cast<int16_t>(0xFF - weight));
+    const __m128i wb = _mm_set1_epi16(static_cast<int16_t>(weight));
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_a + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_b + i));
+      __m128i lo = DivideBy255Epu16(_mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), wa),
+          _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wb)));
+      __m128i hi = DivideBy255Epu16(_mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), wa),
+          _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wb)));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i),
+                       _mm_packus_epi16(lo, hi));
+    }
+    return i;
+  }
+};
+
+template<> struct BlendLineVector<uint16_t> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_a,
+                            const uint16_t *p_b, int len, uint32_t weight) {
+    const __m128i wa = _mm_set1_epi16(static_cast<int16_t>(0xFFFF - weight));
+    const __m128i wb = _mm_set1_epi16(static_cast<int16_t>(weight));
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_a + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_b + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i),
+                       BlendEpu16(a, wa, b, wb));
+    }
+    return i;
+  }
+};
+
+// Composites two pixels of unsigned 8-bit channels widened to 16-bit lanes.
+static MUSTINLINE __m128i CompositeEpu8Pixels(__m128i fg, __m128i bg) {
+  const __m128i max_alpha = _mm_setr_epi16(0, 0, 0, 0xFF, 0, 0, 0, 0xFF);
+  __m128i alpha = BroadcastAlphaEpi16(fg);
+  __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(0xFF), alpha);
+  fg = _mm_or_si128(fg, max_alpha);
+  return DivideBy255Epu16(_mm_add_epi16(_mm_mullo_epi16(fg, alpha),
+                                        _mm_mullo_epi16(bg, inverse)));
+}
+
+// Composites four 8-bit pixels whose background and destination are laid out
+// as 4-channel ones; the last channel of a 3-channel background is ignored.
+static MUSTINLINE __m128i CompositeEpu8Quad(__m128i fg, __m128i bg) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = CompositeEpu8Pixels(_mm_unpacklo_epi8(fg, zero),
+                                   _mm_unpacklo_epi8(bg, zero));
+  __m128i hi = CompositeEpu8Pixels(_mm_unpackhi_epi8(fg, zero),
+                                   _mm_unpackhi_epi8(bg, zero));
+  return _mm_packus_epi16(lo, hi);
+}
+
+static MUSTINLINE int32_t LoadInt32(const void *p) {
+  int32_t value;
+  ::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+template<> struct CompositeLineVector<uint8_t, 4> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_fg,
+                            const uint8_t *p_bg, int num_pixels) {
+    int i = 0;
+    for (; i + 4 <= num_pixels; i += 4) {
+      __m128i fg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_fg + i * 4));
+      __m128i bg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_bg + i * 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i * 4),
+                       CompositeEpu8Quad(fg, bg));
+    }
+    return i;
+  }
+};
+
+// SSE2 has no byte shuffle, so 3-channel pixels are gathered and scattered by
+// overlapping 4-byte accesses. The gather reads the first byte of the pixel
+// following the quad, hence the one pixel reserve; the last pixel of a quad is
+// stored without its fourth byte, since it may be an unprocessed background
+// pixel when compositing in place.
+template<> struct CompositeLineVector<uint8_t, 3> {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_fg,
+                            const uint8_t *p_bg, int num_pixels) {
+    int i = 0;
+    for (; i + 5 <= num_pixels; i += 4) {
+      const uint8_t *p_b = p_bg + i * 3;
+      uint8_t *p_d = p_dst + i * 3;
+      __m128i fg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_fg + i * 4));
+      __m128i bg = _mm_setr_epi32(LoadInt32(p_b), LoadInt32(p_b + 3),
+                                  LoadInt32(p_b + 6), LoadInt32(p_b + 9));
+      __m128i out = CompositeEpu8Quad(fg, bg);
+      int32_t pixels[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels), out);
+      ::memcpy(p_d, &pixels[0], 4);
+      ::memcpy(p_d + 3, &pixels[1], 4);
+      ::memcpy(p_d + 6, &pixels[2], 4);
+      ::memcpy(p_d + 9, &pixels[3], 3);
+    }
+    return i;
+  }
+};
+
+// Composites two pixels of unsigned 16-bit channels.
+static MUSTINLINE __m128i CompositeEpu16Pixels(__m128i fg, __m128i bg) {
+  const __m128i max_alpha = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+  __m128i alpha = BroadcastAlphaEpi16(fg);
+  __m128i inverse = _mm_xor_si128(alpha, _mm_set1_epi16(-1));
+  return BlendEpu16(_mm_or_si128(fg, max_alpha), alpha, bg, inverse);
+}
+
+template<> struct CompositeLineVector<uint16_t, 4> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_fg,
+                            const uint16_t *p_bg, int num_pixels) {
+    int i = 0;
+    for (; i + 2 <= num_pixels; i += 2) {
+      __m128i fg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_fg + i * 4));
+      __m128i bg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_bg + i * 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i * 4),
+                       CompositeEpu16Pixels(fg, bg));
+    }
+    return i;
+  }
+};
+
+// The same overlapping gather and scatter as for 8-bit pixels, with 8-byte
+// accesses.
+template<> struct CompositeLineVector<uint16_t, 3> {
+  static MUSTINLINE int run(uint16_t *p_dst, const uint16_t *p_fg,
+                            const uint16_t *p_bg, int num_pixels) {
+    int i = 0;
+    for (; i + 3 <= num_pixels; i += 2) {
+      const uint16_t *p_b = p_bg + i * 3;
+      uint16_t *p_d = p_dst + i * 3;
+      __m128i fg = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_fg + i * 4));
+      __m128i bg = _mm_unpacklo_epi64(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p_b)),
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p_b + 3)));
+      __m128i out = CompositeEpu16Pixels(fg, bg);
+      uint16_t pixels[8];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels), out);
+      ::memcpy(p_d, &pixels[0], 8);
+      ::memcpy(p_d + 3, &pixels[4], 6);
+    }
+    return i;
+  }
+};
+
+#endif // VECTOR_SSE_BLEND_INL_H_INCLUDED
@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_BORDER_INL_H_INCLUDED
+#define VECTOR_SSE_BORDER_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+// Reverses 32-bit lanes, then 16-bit halves and then bytes, since SSE2 has no
+// byte shuffle.
+static MUSTINLINE __m128i ReverseDwords(__m128i v) {
+  return _mm_shuffle_epi32(v, 0x1B);
+}
+
+static MUSTINLINE __m128i ReverseWords(__m128i v) {
+  v = ReverseDwords(v);
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+}
+
+static MUSTINLINE __m128i ReverseBytes(__m128i v) {
+  v = ReverseWords(v);
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+#define DEFINE_REVERSE_PIXELS_VECTOR(pixel_size, reverse)                  \
+template<> struct ReversePixelsVector<pixel_size> {                         \
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src,           \
+                            int len) {                                      \
+    const int step = 16 / pixel_size;                                       \
+    int i = 0;                                                              \
+    for (; i + step <= len; i += step) {                                    \
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(        \
+          p_src + (len - i - step) * pixel_size));                          \
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst + i * pixel_size), \
+                       reverse(v));                                         \
+    }                                                                       \
+    return i;                                                               \
+  }                                                                         \
+};
+
+DEFINE_REVERSE_PIXELS_VECTOR(1, ReverseBytes)
+DEFINE_REVERSE_PIXELS_VECTOR(2, ReverseWords)
+DEFINE_REVERSE_PIXELS_VECTOR(4, ReverseDwords)
+
+#undef DEFINE_REVERSE_PIXELS_VECTOR
+
+#endif // VECTOR_SSE_BORDER_INL_H_INCLUDED
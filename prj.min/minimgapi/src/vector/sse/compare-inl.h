@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_COMPARE_INL_H_INCLUDED
+#define VECTOR_SSE_COMPARE_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+
+template<> struct DiffVector<uint8_t> {
+  static MUSTINLINE int accumulate(DiffStats *p_stats, const uint8_t *p_a,
+                                   const uint8_t *p_b, int len) {
+    // Squares of byte differences are summed into 32-bit lanes, which are
+    // flushed every 4096 iterations before they could overflow.
+    const int flush_period = 16 << 12;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i max = zero, equal = zero, sse = zero;
+    const int vec_len = len & ~15;
+    int i = 0;
+    while (i < vec_len) {
+      const int chunk_end = std::min(vec_len, i + flush_period);
+      __m128i part = zero;
+      for (; i < chunk_end; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_a + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_b + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        max = _mm_max_epu8(max, diff);
+        equal = _mm_add_epi64(equal, _mm_sad_epu8(
+                    _mm_and_si128(_mm_cmpeq_epi8(diff, zero), one), zero));
+        __m128i lo = _mm_unpacklo_epi8(diff, zero);
+        __m128i hi = _mm_unpackhi_epi8(diff, zero);
+        part = _mm_add_epi32(part, _mm_add_epi32(_mm_madd_epi16(lo, lo),
+                                                 _mm_madd_epi16(hi, hi)));
+      }
+      sse = _mm_add_epi64(sse, _mm_add_epi64(_mm_unpacklo_epi32(part, zero),
+                                             _mm_unpackhi_epi32(part, zero)));
+    }
+    if (!i)
+      return 0;
+
+    uint8_t max_bytes[16];
+    int64_t equal_sums[2], sse_sums[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(max_bytes), max);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(equal_sums), equal);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sse_sums), sse);
+    uint8_t max_diff = *std::max_element(max_bytes, max_bytes + 16);
+    p_stats->mismatches += i - equal_sums[0] - equal_sums[1];
+    p_stats->max_abs_diff = std::max(p_stats->max_abs_diff,
+                                     static_cast<double>(max_diff));
+    p_stats->sse += static_cast<double>(sse_sums[0] + sse_sums[1]);
+    return i;
+  }
+};
+
+#endif // VECTOR_SSE_COMPARE_INL_H_INCLUDED
@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_GRADIENT_INL_H_INCLUDED
+#define VECTOR_SSE_GRADIENT_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+template<> struct GradientColumnsVector<uint8_t> {
+  static MUSTINLINE int run(int16_t *p_smooth, int16_t *p_diff,
+                            const uint8_t *p_above, const uint8_t *p_line,
+                            const uint8_t *p_below, int side, int center,
+                            int len) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i side_v = _mm_set1_epi16(static_cast<int16_t>(side));
+    const __m128i center_v = _mm_set1_epi16(static_cast<int16_t>(center));
+    int x = 0;
+    for (; x + 16 <= len; x += 16) {
+      __m128i a = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_above + x));
+      __m128i l = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_line + x));
+      __m128i b = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_below + x));
+      __m128i a_lo = _mm_unpacklo_epi8(a, zero);
+      __m128i a_hi = _mm_unpackhi_epi8(a, zero);
+      __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+      __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+      __m128i s_lo = _mm_add_epi16(
+          _mm_mullo_epi16(_mm_add_epi16(a_lo, b_lo), side_v),
+          _mm_mullo_epi16(_mm_unpacklo_epi8(l, zero), center_v));
+      __m128i s_hi = _mm_add_epi16(
+          _mm_mullo_epi16(_mm_add_epi16(a_hi, b_hi), side_v),
+          _mm_mullo_epi16(_mm_unpackhi_epi8(l, zero), center_v));
+      __m128i *p_s = reinterpret_cast<__m128i *>(p_smooth + x);
+      __m128i *p_d = reinterpret_cast<__m128i *>(p_diff + x);
+      _mm_storeu_si128(p_s, s_lo);
+      _mm_storeu_si128(p_s + 1, s_hi);
+      _mm_storeu_si128(p_d, _mm_sub_epi16(b_lo, a_lo));
+      _mm_storeu_si128(p_d + 1, _mm_sub_epi16(b_hi, a_hi));
+    }
+    return x;
+  }
+};
+
+template<> struct GradientRowsVector<int16_t> {
+  static MUSTINLINE int run(int16_t *p_dx, int16_t *p_dy,
+                            const int16_t *p_smooth, const int16_t *p_diff,
+                            int side, int center, int len) {
+    const __m128i side_v = _mm_set1_epi16(static_cast<int16_t>(side));
+    const __m128i center_v = _mm_set1_epi16(static_cast<int16_t>(center));
+    int x = 0;
+    for (; x + 8 <= len; x += 8) {
+      __m128i s_l = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_smooth + x - 1));
+      __m128i s_r = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_smooth + x + 1));
+      __m128i d_l = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_diff + x - 1));
+      __m128i d_c = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_diff + x));
+      __m128i d_r = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_diff + x + 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dx + x),
+                       _mm_sub_epi16(s_r, s_l));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dy + x), _mm_add_epi16(
+          _mm_mullo_epi16(_mm_add_epi16(d_l, d_r), side_v),
+          _mm_mullo_epi16(d_c, center_v)));
+    }
+    return x;
+  }
+};
+
+// Interleaving dx and dy lets pmaddwd square and add them at once.
+template<> struct SquaredMagnitudeVector<int16_t> {
+  static MUSTINLINE int run(int32_t *p_magnitude, const int16_t *p_dx,
+                            const int16_t *p_dy, int len) {
+    int x = 0;
+    for (; x + 8 <= len; x += 8) {
+      __m128i dx = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_dx + x));
+      __m128i dy = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_dy + x));
+      __m128i lo = _mm_unpacklo_epi16(dx, dy);
+      __m128i hi = _mm_unpackhi_epi16(dx, dy);
+      __m128i *p = reinterpret_cast<__m128i *>(p_magnitude + x);
+      _mm_storeu_si128(p, _mm_madd_epi16(lo, lo));
+      _mm_storeu_si128(p + 1, _mm_madd_epi16(hi, hi));
+    }
+    return x;
+  }
+};
+
+#endif // VECTOR_SSE_GRADIENT_INL_H_INCLUDED
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_HOUGH_INL_H_INCLUDED
+#define VECTOR_SSE_HOUGH_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+template<> struct HoughIndexVector<int32_t> {
+  static MUSTINLINE int run(int32_t *p_indices, const real32_t *p_cos,
+                            const real32_t *p_sin, const int32_t *p_bases,
+                            real32_t x, real32_t y, real32_t offset,
+                            int len) {
+    const __m128 x_v = _mm_set1_ps(x);
+    const __m128 y_v = _mm_set1_ps(y);
+    const __m128 offset_v = _mm_set1_ps(offset);
+    int t = 0;
+    for (; t + 4 <= len; t += 4) {
+      __m128 r = _mm_add_ps(_mm_add_ps(
+          _mm_mul_ps(x_v, _mm_loadu_ps(p_cos + t)),
+          _mm_mul_ps(y_v, _mm_loadu_ps(p_sin + t))), offset_v);
+      __m128i base = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_bases + t));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(p_indices + t),
+                       _mm_add_epi32(base, _mm_cvttps_epi32(r)));
+    }
+    return t;
+  }
+};
+
+template<> struct AccumulatorSumVector<int32_t> {
+  static MUSTINLINE int run(int32_t *p_dst, const int32_t *p_src, int len) {
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      __m128i *p = reinterpret_cast<__m128i *>(p_dst + i);
+      _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(p_src + i))));
+    }
+    return i;
+  }
+};
+
+#endif // VECTOR_SSE_HOUGH_INL_H_INCLUDED
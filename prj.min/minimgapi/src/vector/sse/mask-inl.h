@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_MASK_INL_H_INCLUDED
+#define VECTOR_SSE_MASK_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+// Replaces the bytes of 16 destination bytes whose keep mask is zero with the
+// source ones.
+static MUSTINLINE void MergeBytes(
+    uint8_t       *p_dst,
+    const uint8_t *p_src,
+    __m128i        keep) {
+  __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src));
+  __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_dst));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p_dst),
+                   _mm_or_si128(_mm_and_si128(keep, d),
+                                _mm_andnot_si128(keep, s)));
+}
+
+// Processes 16 pixels at once. Blocks with unset mask are skipped, blocks
+// with set mask are copied, and mixed ones are merged with the keep mask
+// (the bytes of pixels with zero mask) widened to the pixel size.
+template<int PixelSize>
+struct CopyMaskedSse {
+  static MUSTINLINE int run(uint8_t *p_dst, const uint8_t *p_src,
+                            const uint8_t *p_mask, int len) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      __m128i keep = _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_mask + i)),
+          zero);
+      int bits = _mm_movemask_epi8(keep);
+      if (bits == 0xFFFF)
+        continue;
+      uint8_t *p_d = p_dst + i * PixelSize;
+      const uint8_t *p_s = p_src + i * PixelSize;
+      if (bits == 0) {
+        for (int k = 0; k < PixelSize; ++k)
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(p_d + 16 * k),
+              _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_s + 16 * k)));
+        continue;
+      }
+      if (PixelSize == 1) {
+        MergeBytes(p_d, p_s, keep);
+      } else if (PixelSize == 2) {
+        MergeBytes(p_d, p_s, _mm_unpacklo_epi8(keep, keep));
+        MergeBytes(p_d + 16, p_s + 16, _mm_unpackhi_epi8(keep, keep));
+      } else {
+        __m128i lo = _mm_unpacklo_epi8(keep, keep);
+        __m128i hi = _mm_unpackhi_epi8(keep, keep);
+        MergeBytes(p_d, p_s, _mm_unpacklo_epi16(lo, lo));
+        MergeBytes(p_d + 16, p_s + 16, _mm_unpackhi_epi16(lo, lo));
+        MergeBytes(p_d + 32, p_s + 32, _mm_unpacklo_epi16(hi, hi));
+        MergeBytes(p_d + 48, p_s + 48, _mm_unpackhi_epi16(hi, hi));
+      }
+    }
+    return i;
+  }
+};
+
+template<> struct CopyMaskedVector<1> : CopyMaskedSse<1> {};
+template<> struct CopyMaskedVector<2> : CopyMaskedSse<2> {};
+template<> struct CopyMaskedVector<4> : CopyMaskedSse<4> {};
+
+#endif // VECTOR_SSE_MASK_INL_H_INCLUDED
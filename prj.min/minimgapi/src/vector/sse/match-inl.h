@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_MATCH_INL_H_INCLUDED
+#define VECTOR_SSE_MATCH_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+template<> struct MultiplyAddVector<real32_t> {
+  static MUSTINLINE int run(real32_t *p_sum, const real32_t *p_line,
+                            real32_t weight, int len) {
+    const __m128 weight_v = _mm_set1_ps(weight);
+    int x = 0;
+    for (; x + 8 <= len; x += 8) {
+      __m128 s0 = _mm_loadu_ps(p_sum + x);
+      __m128 s1 = _mm_loadu_ps(p_sum + x + 4);
+      s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(p_line + x), weight_v));
+      s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(p_line + x + 4), weight_v));
+      _mm_storeu_ps(p_sum + x, s0);
+      _mm_storeu_ps(p_sum + x + 4, s1);
+    }
+    return x;
+  }
+};
+
+#endif // VECTOR_SSE_MATCH_INL_H_INCLUDED
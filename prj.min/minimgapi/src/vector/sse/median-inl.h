@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_MEDIAN_INL_H_INCLUDED
+#define VECTOR_SSE_MEDIAN_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <minutils/crossplat.h>
+
+template<> struct HistogramUpdateVector<uint16_t> {
+  static MUSTINLINE int update(uint16_t *p_hist, const uint16_t *p_add,
+                               const uint16_t *p_sub, int len) {
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      __m128i *p = reinterpret_cast<__m128i *>(p_hist + i);
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_add + i));
+      __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_sub + i));
+      _mm_storeu_si128(p, _mm_sub_epi16(_mm_add_epi16(_mm_loadu_si128(p), a),
+                                        s));
+    }
+    return i;
+  }
+};
+
+// Searches by prefix sums, so the search takes no data-dependent branches.
+template<> struct HistogramSearchVector<uint16_t> {
+  static MUSTINLINE int find(const uint16_t *p_bins, int *p_count, int half) {
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_bins));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_bins + 8));
+    lo = _mm_add_epi16(lo, _mm_slli_si128(lo, 2));
+    hi = _mm_add_epi16(hi, _mm_slli_si128(hi, 2));
+    lo = _mm_add_epi16(lo, _mm_slli_si128(lo, 4));
+    hi = _mm_add_epi16(hi, _mm_slli_si128(hi, 4));
+    lo = _mm_add_epi16(lo, _mm_slli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_slli_si128(hi, 8));
+    __m128i last = _mm_shufflehi_epi16(lo, 0xFF);
+    hi = _mm_add_epi16(hi, _mm_unpackhi_epi64(last, last));
+
+    // The prefix sums do not decrease, so the bins with sums not above the
+    // threshold form a prefix, and unsigned saturated subtraction gives zero
+    // exactly for them.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i threshold = _mm_set1_epi16(
+        static_cast<short>(half - *p_count));
+    __m128i below = _mm_packs_epi16(
+        _mm_cmpeq_epi16(_mm_subs_epu16(lo, threshold), zero),
+        _mm_cmpeq_epi16(_mm_subs_epu16(hi, threshold), zero));
+    __m128i sad = _mm_sad_epu8(_mm_and_si128(below, _mm_set1_epi8(1)), zero);
+    int k = _mm_cvtsi128_si32(_mm_add_epi32(sad, _mm_unpackhi_epi64(sad, sad)));
+    if (k > 0) {
+      uint16_t sums[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), lo);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + 8), hi);
+      *p_count += sums[k - 1];
+    }
+    return k;
+  }
+};
+
+#endif // VECTOR_SSE_MEDIAN_INL_H_INCLUDED
@@ -0,0 +1,226 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#pragma once
+#ifndef VECTOR_SSE_REDUCE_INL_H_INCLUDED
+#define VECTOR_SSE_REDUCE_INL_H_INCLUDED
+
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#include <minutils/crossplat.h>
+#include <minutils/smartptr.h>
+
+static MUSTINLINE void sse_accumulate_epi32(int32_t *p_part, __m128i v) {
+  __m128i *p = reinterpret_cast<__m128i *>(p_part);
+  _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), v));
+}
+
+static MUSTINLINE void sse_accumulate_epi64(int64_t *p_part, __m128i v) {
+  __m128i *p = reinterpret_cast<__m128i *>(p_part);
+  _mm_storeu_si128(p, _mm_add_epi64(_mm_loadu_si128(p), v));
+}
+
+static MUSTINLINE void sse_accumulate_pd(real64_t *p_part, __m128d v) {
+  _mm_storeu_pd(p_part, _mm_add_pd(_mm_loadu_pd(p_part), v));
+}
+
+template<> struct ReduceVector<uint8_t, uint32_t, OP_ADD> {
+  static MUSTINLINE int accumulate(uint32_t *p_part, const uint8_t *p_src,
+                                   int len) {
+    const __m128i zero = _mm_setzero_si128();
+    int32_t *p = reinterpret_cast<int32_t *>(p_part);
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+      sse_accumulate_epi32(p + i, _mm_unpacklo_epi16(lo, zero));
+      sse_accumulate_epi32(p + i + 4, _mm_unpackhi_epi16(lo, zero));
+      sse_accumulate_epi32(p + i + 8, _mm_unpacklo_epi16(hi, zero));
+      sse_accumulate_epi32(p + i + 12, _mm_unpackhi_epi16(hi, zero));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<int8_t, int32_t, OP_ADD> {
+  static MUSTINLINE int accumulate(int32_t *p_part, const int8_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 16 <= len; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+      __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+      sse_accumulate_epi32(p_part + i,
+                           _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16));
+      sse_accumulate_epi32(p_part + i + 4,
+                           _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16));
+      sse_accumulate_epi32(p_part + i + 8,
+                           _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16));
+      sse_accumulate_epi32(p_part + i + 12,
+                           _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<uint16_t, uint32_t, OP_ADD> {
+  static MUSTINLINE int accumulate(uint32_t *p_part, const uint16_t *p_src,
+                                   int len) {
+    const __m128i zero = _mm_setzero_si128();
+    int32_t *p = reinterpret_cast<int32_t *>(p_part);
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      sse_accumulate_epi32(p + i, _mm_unpacklo_epi16(v, zero));
+      sse_accumulate_epi32(p + i + 4, _mm_unpackhi_epi16(v, zero));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<int16_t, int32_t, OP_ADD> {
+  static MUSTINLINE int accumulate(int32_t *p_part, const int16_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      sse_accumulate_epi32(p_part + i,
+                           _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+      sse_accumulate_epi32(p_part + i + 4,
+                           _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<uint32_t, int64_t, OP_ADD> {
+  static MUSTINLINE int accumulate(int64_t *p_part, const uint32_t *p_src,
+                                   int len) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      sse_accumulate_epi64(p_part + i, _mm_unpacklo_epi32(v, zero));
+      sse_accumulate_epi64(p_part + i + 2, _mm_unpackhi_epi32(v, zero));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<int32_t, int64_t, OP_ADD> {
+  static MUSTINLINE int accumulate(int64_t *p_part, const int32_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_src + i));
+      __m128i sign = _mm_srai_epi32(v, 31);
+      sse_accumulate_epi64(p_part + i, _mm_unpacklo_epi32(v, sign));
+      sse_accumulate_epi64(p_part + i + 2, _mm_unpackhi_epi32(v, sign));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<real32_t, real64_t, OP_ADD> {
+  static MUSTINLINE int accumulate(real64_t *p_part, const real32_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      __m128 v = _mm_loadu_ps(p_src + i);
+      sse_accumulate_pd(p_part + i, _mm_cvtps_pd(v));
+      sse_accumulate_pd(p_part + i + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<real64_t, real64_t, OP_ADD> {
+  static MUSTINLINE int accumulate(real64_t *p_part, const real64_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 2 <= len; i += 2)
+      sse_accumulate_pd(p_part + i, _mm_loadu_pd(p_src + i));
+    return i;
+  }
+};
+
+template<> struct ReduceVector<uint8_t, real64_t, OP_EUC> {
+  static MUSTINLINE int accumulate(real64_t *p_part, const uint8_t *p_src,
+                                   int len) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= len; i += 8) {
+      __m128i v = _mm_unpacklo_epi8(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p_src + i)), zero);
+      // Squares of bytes fit 16 bits, widen them to doubles by pairs.
+      __m128i sq = _mm_mullo_epi16(v, v);
+      __m128i lo = _mm_unpacklo_epi16(sq, zero);
+      __m128i hi = _mm_unpackhi_epi16(sq, zero);
+      sse_accumulate_pd(p_part + i, _mm_cvtepi32_pd(lo));
+      sse_accumulate_pd(p_part + i + 2,
+                        _mm_cvtepi32_pd(_mm_unpackhi_epi64(lo, lo)));
+      sse_accumulate_pd(p_part + i + 4, _mm_cvtepi32_pd(hi));
+      sse_accumulate_pd(p_part + i + 6,
+                        _mm_cvtepi32_pd(_mm_unpackhi_epi64(hi, hi)));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<real32_t, real64_t, OP_EUC> {
+  static MUSTINLINE int accumulate(real64_t *p_part, const real32_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 4 <= len; i += 4) {
+      __m128 v = _mm_loadu_ps(p_src + i);
+      __m128d lo = _mm_cvtps_pd(v);
+      __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+      sse_accumulate_pd(p_part + i, _mm_mul_pd(lo, lo));
+      sse_accumulate_pd(p_part + i + 2, _mm_mul_pd(hi, hi));
+    }
+    return i;
+  }
+};
+
+template<> struct ReduceVector<real64_t, real64_t, OP_EUC> {
+  static MUSTINLINE int accumulate(real64_t *p_part, const real64_t *p_src,
+                                   int len) {
+    int i = 0;
+    for (; i + 2 <= len; i += 2) {
+      __m128d v = _mm_loadu_pd(p_src + i);
+      sse_accumulate_pd(p_part + i, _mm_mul_pd(v, v));
+    }
+    return i;
+  }
+};
+
+#endif // VECTOR_SSE_REDUCE_INL_H_INCLUDED
@@ -0,0 +1,87 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   bandio.h
+ * @brief  MinImgIO library row band streaming interface.
+ */
+
+#pragma once
+#ifndef MINIMGIO_BANDIO_H_INCLUDED
+#define MINIMGIO_BANDIO_H_INCLUDED
+
+#include <minutils/crossplat.h>
+#include <minutils/bandstream.h>
+#include <minimgio/define.h>
+#include <minimgio/minimgio.h>
+
+/**
+ * @brief   Opens an image file for reading row by row.
+ * @param   ppSource  The pointer to the created source.
+ * @param   pFileName The path to the file or the @c mem:// location.
+ * @param   page      The page number (TIFF only).
+ * @returns @c NO_ERRORS on success or an error code otherwise.
+ * @ingroup MinImgIOAPI
+ *
+ * The function creates a source which decodes the file incrementally, so only
+ * the rows requested by the consumer are held in memory. JPEG, PNG (not
+ * interlaced) and TIFF files are supported. The source must be deleted by the
+ * caller.
+ */
+MINIMGIO_API int OpenMinImageBandSource
+(
+  MinImgBandSource **ppSource,
+  const char        *pFileName,
+  int                page = 0
+);
+
+/**
+ * @brief   Creates an image file for writing row by row.
+ * @param   ppSink    The pointer to the created sink.
+ * @param   pFileName The path to the file.
+ * @param   pProps    Extended image properties (may be @c NULL).
+ * @returns @c NO_ERRORS on success or an error code otherwise.
+ * @ingroup MinImgIOAPI
+ *
+ * The function creates a sink which encodes rows as soon as they are written.
+ * The format is taken from @c pProps or deduced from the file extension; JPEG,
+ * PNG and single-page TIFF files are supported. The sink must be deleted by
+ * the caller; the file is complete only after @c MinImgBandSink::End()
+ * succeeds.
+ */
+MINIMGIO_API int OpenMinImageBandSink
+(
+  MinImgBandSink    **ppSink,
+  const char         *pFileName,
+  const ExtImgProps  *pProps = NULL
+);
+
+#endif // MINIMGIO_BANDIO_H_INCLUDED
@@ -0,0 +1,447 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <dirent.h>
+#  include <time.h>
+#  include <sys/resource.h>
+#endif
+
+#include <minutils/minerr.h>
+#include <minimgapi/minimgapi.h>
+#include <minimgapi/imgguard.hpp>
+#include <minimgio/minimgio.h>
+
+// Benchmark of the MinImgIO codecs. Synthetic images (or the files of a user
+// corpus) are encoded with every supported format and compression and decoded
+// back from the file system and from memory. Header probing and full decoding
+// are timed separately. The results are printed as a single JSON document.
+//
+// Usage: bench_minimgio [--corpus=<dir>] [--work-dir=<dir>] [--min-time=<sec>]
+//                       [--output=<path>]
+
+static double GetSeconds()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#endif
+}
+
+// Returns the peak resident set size of the process so far, in kilobytes.
+static long GetPeakRssKb()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters = {0};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+  return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#  if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;
+#  else
+  return usage.ru_maxrss;
+#  endif
+#endif
+}
+
+static int ListDirectory(std::vector<std::string> &files, const std::string &dir)
+{
+#if defined(_WIN32)
+  WIN32_FIND_DATAA data;
+  HANDLE hFind = FindFirstFileA((dir + "\\*").c_str(), &data);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return FILE_ERROR;
+  do
+  {
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+      files.push_back(dir + "\\" + data.cFileName);
+  } while (FindNextFileA(hFind, &data));
+  FindClose(hFind);
+#else
+  DIR *pDir = opendir(dir.c_str());
+  if (!pDir)
+    return FILE_ERROR;
+  while (dirent *pEntry = readdir(pDir))
+  {
+    if (pEntry->d_name[0] != '.')
+      files.push_back(dir + "/" + pEntry->d_name);
+  }
+  closedir(pDir);
+#endif
+  return NO_ERRORS;
+}
+
+static long GetFileSize(const char *pFileName)
+{
+  FILE *pF = fopen(pFileName, "rb");
+  if (!pF)
+    return FILE_ERROR;
+  fseek(pF, 0, SEEK_END);
+  long size = ftell(pF);
+  fclose(pF);
+  return size;
+}
+
+static int ReadFile(std::vector<uint8_t> &bytes, const char *pFileName)
+{
+  long size = GetFileSize(pFileName);
+  if (size <= 0)
+    return FILE_ERROR;
+  bytes.resize(size);
+  FILE *pF = fopen(pFileName, "rb");
+  if (!pF)
+    return FILE_ERROR;
+  size_t read = fread(&bytes[0], 1, size, pF);
+  fclose(pF);
+  return read == static_cast<size_t>(size) ? NO_ERRORS : FILE_ERROR;
+}
+
+// Fills the image with smooth gradients and some noise, which gives lossless
+// codecs a compression ratio close to the one of photographs.
+static void DrawSyntheticImage(const MinImg *pImg)
+{
+  uint32_t seed = 12345;
+  for (int y = 0; y < pImg->height; y++)
+  {
+    uint8_t *pLine = pImg->pScan0 + pImg->stride * y;
+    if (pImg->channelDepth == 0)
+    {
+      memset(pLine, 0, (pImg->width + 7) / 8);
+      for (int x = 0; x < pImg->width; x++)
+        if (((x / 16) ^ (y / 16)) & 1)
+          pLine[x >> 3] |= 0x80 >> (x & 7);
+      continue;
+    }
+    for (int x = 0; x < pImg->width; x++)
+      for (int c = 0; c < pImg->channels; c++)
+      {
+        seed = seed * 1664525 + 1013904223;
+        int value = (x * (c + 1) + y * (3 - c)) / 4 + ((seed >> 24) & 15);
+        pLine[x * pImg->channels + c] = static_cast<uint8_t>(value);
+      }
+  }
+}
+
+struct Encoding
+{
+  const char   *pName;
+  const char   *pExtension;
+  ImgFileFormat iff;
+  ImgFileComp   comp;
+};
+
+static const Encoding ENCODINGS[] =
+{
+  {"jpeg",          "jpg",  IFF_JPEG, IFC_NONE},
+  {"png",           "png",  IFF_PNG,  IFC_NONE},
+  {"tiff/none",     "tif",  IFF_TIFF, IFC_NONE},
+  {"tiff/lzw",      "tif",  IFF_TIFF, IFC_LZW},
+  {"tiff/deflate",  "tif",  IFF_TIFF, IFC_DEFLATE},
+  {"tiff/packbits", "tif",  IFF_TIFF, IFC_PACKBITS},
+  {"tiff/jpeg",     "tif",  IFF_TIFF, IFC_JPEG},
+  {"tiff/rle",      "tif",  IFF_TIFF, IFC_RLE},
+  {"tiff/group3",   "tif",  IFF_TIFF, IFC_GROUP3},
+  {"tiff/group4",   "tif",  IFF_TIFF, IFC_GROUP4},
+  {"webp",          "webp", IFF_WEBP, IFC_NONE}
+};
+
+struct Stats
+{
+  int    result;
+  long   iterations;
+  double seconds;  // Time of a single iteration.
+};
+
+// The operations timed by the benchmark. Each one returns an error code.
+class Operation
+{
+public:
+  virtual ~Operation() {}
+  virtual int Run() = 0;
+};
+
+class EncodeOperation : public Operation
+{
+public:
+  EncodeOperation(const char *pFileName, const MinImg *pImg, const ExtImgProps *pProps):
+    pFileName(pFileName), pImg(pImg), pProps(pProps) {}
+
+  int Run()
+  {
+    remove(pFileName);
+    return SaveMinImageEx(pFileName, pImg, pProps, 0);
+  }
+
+private:
+  const char        *pFileName;
+  const MinImg      *pImg;
+  const ExtImgProps *pProps;
+};
+
+class ProbeOperation : public Operation
+{
+public:
+  ProbeOperation(const char *pFileName): pFileName(pFileName) {}
+
+  int Run()
+  {
+    MinImg image = {0};
+    ExtImgProps props = {IFF_UNKNOWN};
+    return GetMinImageFilePropsEx(&image, &props, pFileName, 0);
+  }
+
+private:
+  const char *pFileName;
+};
+
+class DecodeOperation : public Operation
+{
+public:
+  DecodeOperation(const char *pFileName, const MinImg *pImg):
+    pFileName(pFileName), pImg(pImg) {}
+
+  int Run()
+  {
+    return LoadMinImage(pImg, pFileName, 0);
+  }
+
+private:
+  const char   *pFileName;
+  const MinImg *pImg;
+};
+
+// Runs the operation in batches of growing size until a batch lasts at least
+// minTime, and takes the time of a single run from that batch.
+static Stats Measure(Operation &op, double minTime)
+{
+  Stats stats = {op.Run(), 0, 0.};
+  if (stats.result < 0)
+    return stats;
+  for (long n = 1; ; n *= 2)
+  {
+    double start = GetSeconds();
+    for (long i = 0; i < n; i++)
+    {
+      stats.result = op.Run();
+      if (stats.result < 0)
+        return stats;
+    }
+    double elapsed = GetSeconds() - start;
+    if (elapsed >= minTime || n >= (1L << 20))
+    {
+      stats.iterations = n;
+      stats.seconds = elapsed / n;
+      return stats;
+    }
+  }
+}
+
+class JsonReport
+{
+public:
+  JsonReport(FILE *pF): pF(pF), first(true) {}
+
+  void Add(const char *pStage, const char *pSource, const char *pEncoding,
+           const MinImg &img, long fileSize, const Stats &stats)
+  {
+    fprintf(pF, "%s\n    {\"stage\": \"%s\", \"source\": \"%s\", "
+            "\"encoding\": \"%s\", \"width\": %d, \"height\": %d, "
+            "\"channels\": %d, \"file_bytes\": %ld, ",
+            first ? "" : ",", pStage, pSource, pEncoding,
+            img.width, img.height, img.channels, fileSize);
+    if (stats.result < 0)
+      fprintf(pF, "\"error\": %d, ", stats.result);
+    else
+    {
+      double rawBytes = static_cast<double>(img.width) * img.height *
+                        img.channels * (img.channelDepth ? img.channelDepth : 0.125);
+      fprintf(pF, "\"iterations\": %ld, \"images_per_s\": %.3f, "
+              "\"file_mb_per_s\": %.3f, \"raw_mb_per_s\": %.3f, ",
+              stats.iterations, 1. / stats.seconds,
+              fileSize / stats.seconds * 1e-6, rawBytes / stats.seconds * 1e-6);
+    }
+    fprintf(pF, "\"peak_rss_kb\": %ld}", GetPeakRssKb());
+    first = false;
+    fflush(pF);
+  }
+
+private:
+  FILE *pF;
+  bool  first;
+};
+
+// Probes and decodes the file from the file system and from memory.
+static void BenchDecode(JsonReport &report, const char *pSource,
+                        const char *pEncoding, const char *pFileName, double minTime)
+{
+  long fileSize = GetFileSize(pFileName);
+  DECLARE_GUARDED_MINIMG(image);
+  Stats failed = {GetMinImageFileProps(&image, pFileName, 0), 0, 0.};
+  if (failed.result >= 0)
+    failed.result = AllocMinImage(&image);
+  if (failed.result < 0)
+  {
+    report.Add("decode", pSource, pEncoding, image, fileSize, failed);
+    return;
+  }
+
+  ProbeOperation probe(pFileName);
+  report.Add("probe", pSource, pEncoding, image, fileSize, Measure(probe, minTime));
+  DecodeOperation decode(pFileName, &image);
+  report.Add("decode", pSource, pEncoding, image, fileSize, Measure(decode, minTime));
+
+  std::vector<uint8_t> bytes;
+  if (ReadFile(bytes, pFileName) < 0)
+    return;
+  char memName[64] = {0};
+  sprintf(memName, "mem://%p.%lu", &bytes[0], static_cast<unsigned long>(bytes.size()));
+  ProbeOperation memProbe(memName);
+  report.Add("probe_mem", pSource, pEncoding, image, fileSize, Measure(memProbe, minTime));
+  DecodeOperation memDecode(memName, &image);
+  report.Add("decode_mem", pSource, pEncoding, image, fileSize, Measure(memDecode, minTime));
+}
+
+int main(int argc, char **argv)
+{
+  const char *pCorpus = NULL;
+  std::string workDir = ".";
+  double minTime = 0.2;
+  const char *pOutput = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strncmp(argv[i], "--corpus=", 9))
+      pCorpus = argv[i] + 9;
+    else if (!strncmp(argv[i], "--work-dir=", 11))
+      workDir = argv[i] + 11;
+    else if (!strncmp(argv[i], "--min-time=", 11))
+      minTime = atof(argv[i] + 11);
+    else if (!strncmp(argv[i], "--output=", 9))
+      pOutput = argv[i] + 9;
+    else
+    {
+      fprintf(stderr, "Usage: %s [--corpus=<dir>] [--work-dir=<dir>] "
+              "[--min-time=<sec>] [--output=<path>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  FILE *pF = pOutput ? fopen(pOutput, "w") : stdout;
+  if (!pF)
+  {
+    fprintf(stderr, "Cannot open %s\n", pOutput);
+    return 1;
+  }
+  fprintf(pF, "{\n  \"benchmark\": \"minimgio\",\n  \"results\": [");
+  JsonReport report(pF);
+
+  // Synthetic images: every encoding is written and read back.
+  static const struct { const char *pName; int channels; int depth; } SYNTHETIC[] =
+  {
+    {"synthetic/gray", 1, 1},
+    {"synthetic/rgb",  3, 1},
+    {"synthetic/bits", 1, 0}
+  };
+  for (size_t s = 0; s < sizeof(SYNTHETIC) / sizeof(SYNTHETIC[0]); s++)
+  {
+    DECLARE_GUARDED_MINIMG(image);
+    image.width = 1600;
+    image.height = 1200;
+    image.channels = SYNTHETIC[s].channels;
+    image.channelDepth = SYNTHETIC[s].depth;
+    image.format = FMT_UINT;
+    if (AllocMinImage(&image) < 0)
+      return 1;
+    DrawSyntheticImage(&image);
+
+    for (size_t e = 0; e < sizeof(ENCODINGS) / sizeof(ENCODINGS[0]); e++)
+    {
+      const Encoding &enc = ENCODINGS[e];
+      std::string fileName = workDir + "/bench_minimgio." + enc.pExtension;
+      ExtImgProps props = {enc.iff, enc.comp, 300.f, 300.f, 90};
+      EncodeOperation encode(fileName.c_str(), &image, &props);
+      Stats stats = Measure(encode, minTime);
+      report.Add("encode", SYNTHETIC[s].pName, enc.pName, image,
+                 stats.result < 0 ? 0 : GetFileSize(fileName.c_str()), stats);
+      if (stats.result >= 0)
+        BenchDecode(report, SYNTHETIC[s].pName, enc.pName, fileName.c_str(), minTime);
+      remove(fileName.c_str());
+    }
+  }
+
+  // User corpus: every file is read as is.
+  if (pCorpus)
+  {
+    std::vector<std::string> files;
+    if (ListDirectory(files, pCorpus) < 0)
+      fprintf(stderr, "Cannot list %s\n", pCorpus);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+      const char *pEncoding = "unknown";
+      switch (GuessImageFileFormat(files[i].c_str()))
+      {
+        case IFF_TIFF: pEncoding = "tiff"; break;
+        case IFF_JPEG: pEncoding = "jpeg"; break;
+        case IFF_PNG:  pEncoding = "png";  break;
+        case IFF_WEBP: pEncoding = "webp"; break;
+        default: continue;
+      }
+      BenchDecode(report, files[i].c_str(), pEncoding, files[i].c_str(), minTime);
+    }
+  }
+
+  fprintf(pF, "\n  ]\n}\n");
+  if (pOutput)
+    fclose(pF);
+  return 0;
+}
@@ -23,6 +23,11 @@
 # include <webp/encode.h>
 #endif // WITH_WEBP
 
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_EncodeImage, "EncodeImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
 namespace se { namespace image_io {
 
 
@@ -412,6 +417,9 @@ static int EncodeImageToWebp(
 int EncodeImage(const MinImg            &image,
                 ImageFormat             format,
                 OutputStreamInterface   &output) {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_EncodeImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   switch (format) {
     case FORMAT_TIFF:
       return EncodeImageToTiff(image, output);
@@ -41,6 +41,15 @@ either expressed or implied, of copyright holders.
 #include "subsystem.h"
 #include "stream.h"
 
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_GetDeviceList, "GetDeviceList");
+DECLARE_MINSTOPWATCH(gsw_OpenStream, "OpenStream");
+DECLARE_MINSTOPWATCH(gsw_CloseStream, "CloseStream");
+DECLARE_MINSTOPWATCH(gsw_GetStreamProperty, "GetStreamProperty");
+DECLARE_MINSTOPWATCH(gsw_SetStreamProperty, "SetStreamProperty");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
 MINIMGIO_API int GetDeviceList
 (
   const char *pSubSystemName,
@@ -48,6 +57,9 @@ MINIMGIO_API int GetDeviceList
   int         size
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetDeviceList);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pSubSystemName == NULL || pDeviceNames == NULL)
     return BAD_ARGS;
 
@@ -66,6 +78,9 @@ MINIMGIO_API int OpenStream
   int         size
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_OpenStream);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pSubSystemName == NULL || pDeviceName == NULL)
     return BAD_ARGS;
 
@@ -81,6 +96,9 @@ MINIMGIO_API int CloseStream
   const char *pURI
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_CloseStream);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pURI == NULL)
     return BAD_ARGS;
   
@@ -101,6 +119,9 @@ MINIMGIO_API int GetStreamProperty
   int         size
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetStreamProperty);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pURI == NULL || pPropertyKey == NULL || pPropertyValue == NULL)
     return BAD_ARGS;
 
@@ -119,6 +140,9 @@ MINIMGIO_API int SetStreamProperty
   const char *pPropertyValue
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_SetStreamProperty);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pURI == NULL || pPropertyKey == NULL || pPropertyValue == NULL)
     return BAD_ARGS;
 
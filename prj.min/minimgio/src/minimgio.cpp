@@ -40,6 +40,7 @@ either expressed or implied, of copyright holders.
 #include <cstring>
 
 #include <minutils/minerr.h>
+#include <minimgio/bandio.h>
 #include "minimgiodevice.h"
 #include "minimgiotiff.h"
 #include "minimgiojpeg.h"
@@ -49,6 +50,22 @@ either expressed or implied, of copyright holders.
 #include "utils.h"
 #include "pack.h"
 
+#if defined(MINSTOPWATCH_ENABLED)
+#  include <minstopwatch/stopwatch.hpp>
+DECLARE_MINSTOPWATCH(gsw_GuessImageFileFormat, "GuessImageFileFormat");
+DECLARE_MINSTOPWATCH(gsw_GetMinImageFilePages, "GetMinImageFilePages");
+DECLARE_MINSTOPWATCH(gsw_GetMinImagePageName, "GetMinImagePageName");
+DECLARE_MINSTOPWATCH(gsw_GetMinImageFileProps, "GetMinImageFileProps");
+DECLARE_MINSTOPWATCH(gsw_GetMinImageFilePropsEx, "GetMinImageFilePropsEx");
+DECLARE_MINSTOPWATCH(gsw_LoadMinImage, "LoadMinImage");
+DECLARE_MINSTOPWATCH(gsw_SaveMinImage, "SaveMinImage");
+DECLARE_MINSTOPWATCH(gsw_SaveMinImageEx, "SaveMinImageEx");
+DECLARE_MINSTOPWATCH(gsw_OpenMinImageBandSource, "OpenMinImageBandSource");
+DECLARE_MINSTOPWATCH(gsw_OpenMinImageBandSink, "OpenMinImageBandSink");
+DECLARE_MINSTOPWATCH(gsw_PackMinImage, "PackMinImage");
+DECLARE_MINSTOPWATCH(gsw_UnpackMinImage, "UnpackMinImage");
+#endif // defined(MINSTOPWATCH_ENABLED)
+
 static inline
 int ExtractBytes_FileSystem(const char *fileName, int count, uint8_t *bytes)
 {
@@ -164,6 +181,9 @@ MINIMGIO_API int GuessImageFileFormat
   const char *fileName
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GuessImageFileFormat);
+#endif // defined(MINSTOPWATCH_ENABLED)
   // Guess by tag.
   int iff = GuessImageFileFormatByTag(fileName);
   if (iff != IFF_UNKNOWN)
@@ -182,6 +202,9 @@ MINIMGIO_API int GetMinImageFilePages
   const char *pFileName
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetMinImageFilePages);
+#endif // defined(MINSTOPWATCH_ENABLED)
   int fileLocation = DeduceFileLocation(pFileName);
   if (fileLocation == inDevice)
     return GetDevicePages(pFileName);
@@ -211,6 +234,9 @@ MINIMGIO_API int GetMinImageFilePages
 
 MINIMGIO_API int GetMinImagePageName(char *pPageName, int pageNameSize, const char *pFileName, int page)
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetMinImagePageName);
+#endif // defined(MINSTOPWATCH_ENABLED)
   int fileLocation = DeduceFileLocation(pFileName);
   if (fileLocation == inDevice)
     return GetDevicePageName(pPageName, pageNameSize, pFileName, page);
@@ -245,6 +271,9 @@ MINIMGIO_API int GetMinImageFileProps
   int         page
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetMinImageFileProps);
+#endif // defined(MINSTOPWATCH_ENABLED)
   return GetMinImageFilePropsEx(pImg, NULL, pFileName, page);
 }
 
@@ -256,6 +285,9 @@ MINIMGIO_API int GetMinImageFilePropsEx
   int          page
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_GetMinImageFilePropsEx);
+#endif // defined(MINSTOPWATCH_ENABLED)
   int fileLocation = DeduceFileLocation(pFileName);
   if (fileLocation == inDevice)
     return GetDevicePropsEx(pImg, pProps, pFileName);
@@ -289,6 +321,9 @@ MINIMGIO_API int LoadMinImage
   int          page
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_LoadMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   int fileLocation = DeduceFileLocation(pFileName);
   if (fileLocation == inDevice)
     return LoadDevice(pImg, pFileName);
@@ -322,6 +357,9 @@ MINIMGIO_API int SaveMinImage
   int           page
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_SaveMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   return SaveMinImageEx(pFileName, pImg, NULL, page);
 }
 
@@ -333,6 +371,9 @@ MINIMGIO_API int SaveMinImageEx
   int                page
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_SaveMinImageEx);
+#endif // defined(MINSTOPWATCH_ENABLED)
   int fileLocation = DeduceFileLocation(pFileName);
   if (fileLocation == inDevice)
     return SaveDeviceEx(pFileName, pImg, pProps);
@@ -364,6 +405,79 @@ MINIMGIO_API int SaveMinImageEx
   return INTERNAL_ERROR;
 }
 
+MINIMGIO_API int OpenMinImageBandSource
+(
+  MinImgBandSource **ppSource,
+  const char        *pFileName,
+  int                page
+)
+{
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_OpenMinImageBandSource);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!ppSource || !pFileName)
+    return BAD_ARGS;
+
+  int iff = GuessImageFileFormat(pFileName);
+  if (iff < 0)
+    return iff;
+
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return OpenTiffBandSource(ppSource, pFileName, page);
+  case IFF_JPEG:
+    return OpenJpegBandSource(ppSource, pFileName);
+  case IFF_PNG:
+    return OpenPngBandSource(ppSource, pFileName);
+  case IFF_WEBP:
+  case IFF_LST:
+    return NOT_IMPLEMENTED;
+  default:
+    return FILE_ERROR;
+  }
+  return INTERNAL_ERROR;
+}
+
+MINIMGIO_API int OpenMinImageBandSink
+(
+  MinImgBandSink    **ppSink,
+  const char         *pFileName,
+  const ExtImgProps  *pProps
+)
+{
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_OpenMinImageBandSink);
+#endif // defined(MINSTOPWATCH_ENABLED)
+  if (!ppSink || !pFileName)
+    return BAD_ARGS;
+
+  int iff = IFF_UNKNOWN;
+  if (pProps)
+    iff = pProps->iff;
+
+  if (iff == IFF_UNKNOWN)
+    iff = GuessImageFileFormatByExtension(pFileName);
+  if (iff < 0)
+    return iff;
+
+  switch (iff)
+  {
+  case IFF_TIFF:
+    return OpenTiffBandSink(ppSink, pFileName, pProps);
+  case IFF_JPEG:
+    return OpenJpegBandSink(ppSink, pFileName, pProps);
+  case IFF_PNG:
+    return OpenPngBandSink(ppSink, pFileName, pProps);
+  case IFF_WEBP:
+  case IFF_LST:
+    return NOT_IMPLEMENTED;
+  default:
+    return FILE_ERROR;
+  }
+  return INTERNAL_ERROR;
+}
+
 MINIMGIO_API int PackMinImage
 (
   const MinImg *pDst,
@@ -371,6 +485,9 @@ MINIMGIO_API int PackMinImage
   uint8_t       level
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_PackMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pSrc == NULL || pDst == NULL)
     return BAD_ARGS;
   if (pSrc->pScan0 == NULL || pDst->pScan0 == NULL)
@@ -400,6 +517,9 @@ MINIMGIO_API int UnpackMinImage
   const MinImg *pSrc
 )
 {
+#if defined(MINSTOPWATCH_ENABLED)
+  DECLARE_MINSTOPWATCH_CTL(gsw_UnpackMinImage);
+#endif // defined(MINSTOPWATCH_ENABLED)
   if (pSrc == NULL || pDst == NULL)
     return BAD_ARGS;
   if (pSrc->pScan0 == NULL || pDst->pScan0 == NULL)
@@ -476,6 +476,267 @@ int SaveJpegEx
   return NO_ERRORS;
 }
 
+// Implementation of OpenJpegBandSource() and OpenJpegBandSink()
+
+class JpegBandSource : public MinImgBandSource
+{
+public:
+  JpegBandSource(): pF(NULL), created(false)
+  {
+    ::memset(&cinfo, 0, sizeof(cinfo));
+    ::memset(&jerr, 0, sizeof(jerr));
+  }
+
+  ~JpegBandSource()
+  {
+    if (created)
+      jpeg_destroy_decompress(&cinfo);
+    _FClose(pF);
+  }
+
+  int Open(const char *pFileName)
+  {
+    uint8_t *ptr = NULL;
+    size_t size = 0;
+    switch (DeduceFileLocation(pFileName))
+    {
+      case inFileSystem:
+        pF = fopen(pFileName, "rb");
+        if (!pF)
+          return FILE_ERROR;
+        break;
+      case inMemory:
+        PROPAGATE_ERROR(ExtractMemoryLocation(pFileName, &ptr, &size));
+        if (!ptr || size == 0)
+          return BAD_ARGS;
+        break;
+      default:
+        return NOT_IMPLEMENTED;
+    }
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jee;
+    jerr.pub.output_message = jom;
+    if (setjmp(jerr.buf))
+      return FILE_ERROR;
+
+    jpeg_create_decompress(&cinfo);
+    created = true;
+    if (pF)
+      jpeg_stdio_src(&cinfo, pF);
+    else
+      jpeg_mem_src(&cinfo, ptr, size);
+    jpeg_read_header(&cinfo, true);
+    jpeg_start_decompress(&cinfo);
+    return NO_ERRORS;
+  }
+
+  int GetPrototype(MinImg *pPrototype)
+  {
+    if (!pPrototype || pPrototype->pScan0)
+      return BAD_ARGS;
+    ::memset(pPrototype, 0, sizeof(*pPrototype));
+    return decodeImgProps(pPrototype, &cinfo);
+  }
+
+  int ReadRows(const MinImg *pBand)
+  {
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != 1 || pBand->format != FMT_UINT ||
+        pBand->channels != cinfo.output_components ||
+        pBand->width != (int)cinfo.output_width)
+      return BAD_ARGS;
+    if (cinfo.output_scanline + pBand->height > cinfo.output_height)
+      return BAD_STATE;
+
+    if (setjmp(jerr.buf))
+      return FILE_ERROR;
+
+    JSAMPROW ppBuf[1] = {NULL};
+    for (int y = 0; y < pBand->height; y++)
+    {
+      ppBuf[0] = (JSAMPROW)(pBand->pScan0 + pBand->stride * y);
+      jpeg_read_scanlines(&cinfo, ppBuf, 1);
+    }
+    if (cinfo.output_scanline == cinfo.output_height)
+      jpeg_finish_decompress(&cinfo);
+
+    return NO_ERRORS;
+  }
+
+private:
+  jpeg_decompress_struct cinfo;
+  jem                    jerr;
+  FILE                  *pF;
+  bool                   created;
+};
+
+class JpegBandSink : public MinImgBandSink
+{
+public:
+  JpegBandSink(const ExtImgProps *pProps): pF(NULL), created(false)
+  {
+    ::memset(&cinfo, 0, sizeof(cinfo));
+    ::memset(&jerr, 0, sizeof(jerr));
+    ::memset(&props, 0, sizeof(props));
+    hasProps = pProps != NULL;
+    if (pProps)
+      props = *pProps;
+  }
+
+  ~JpegBandSink()
+  {
+    if (created)
+      jpeg_destroy_compress(&cinfo);
+    _FClose(pF);
+  }
+
+  int Open(const char *pFileName)
+  {
+    if (DeduceFileLocation(pFileName) != inFileSystem)
+      return NOT_IMPLEMENTED;
+    pF = fopen(pFileName, "wb");
+    if (!pF)
+      return FILE_ERROR;
+    return NO_ERRORS;
+  }
+
+  int Begin(const MinImg *pPrototype)
+  {
+    if (!pPrototype || created)
+      return BAD_ARGS;
+    if (pPrototype->channelDepth != 1 || pPrototype->format != FMT_UINT)
+      return NOT_IMPLEMENTED;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jee;
+    jerr.pub.output_message = jom;
+    if (setjmp(jerr.buf))
+      return FILE_ERROR;
+
+    jpeg_create_compress(&cinfo);
+    created = true;
+    jpeg_stdio_dest(&cinfo, pF);
+
+    cinfo.image_width = pPrototype->width;
+    cinfo.image_height = pPrototype->height;
+    cinfo.input_components = pPrototype->channels;
+    switch (cinfo.input_components)
+    {
+    case 1:
+      cinfo.in_color_space = JCS_GRAYSCALE;
+      break;
+    case 3:
+      cinfo.in_color_space = JCS_RGB;
+      break;
+    default:
+      cinfo.in_color_space = JCS_UNKNOWN;
+    }
+    jpeg_set_defaults(&cinfo);
+    if (hasProps)
+    {
+      cinfo.density_unit = 1;
+      cinfo.X_density = (short)(props.xDPI + .5);
+      cinfo.Y_density = (short)(props.yDPI + .5);
+    }
+    int quality = 90;
+    if (hasProps && props.qty)
+      quality = props.qty;
+    jpeg_set_quality(&cinfo, quality, true);
+    jpeg_start_compress(&cinfo, true);
+    return NO_ERRORS;
+  }
+
+  int WriteRows(const MinImg *pBand)
+  {
+    if (!created)
+      return BAD_STATE;
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != 1 || pBand->format != FMT_UINT ||
+        pBand->channels != cinfo.input_components ||
+        pBand->width != (int)cinfo.image_width)
+      return BAD_ARGS;
+    if (cinfo.next_scanline + pBand->height > cinfo.image_height)
+      return BAD_STATE;
+
+    if (setjmp(jerr.buf))
+      return FILE_ERROR;
+
+    JSAMPROW ppBuf[1] = {NULL};
+    for (int y = 0; y < pBand->height; y++)
+    {
+      ppBuf[0] = (JSAMPROW)(pBand->pScan0 + pBand->stride * y);
+      jpeg_write_scanlines(&cinfo, ppBuf, 1);
+    }
+
+    return NO_ERRORS;
+  }
+
+  int End()
+  {
+    if (!created || cinfo.next_scanline != cinfo.image_height)
+      return BAD_STATE;
+
+    if (setjmp(jerr.buf))
+      return FILE_ERROR;
+
+    jpeg_finish_compress(&cinfo);
+    _FClose(pF);
+    return NO_ERRORS;
+  }
+
+private:
+  jpeg_compress_struct cinfo;
+  jem                  jerr;
+  FILE                *pF;
+  bool                 created;
+  ExtImgProps          props;
+  bool                 hasProps;
+};
+
+int OpenJpegBandSource
+(
+  MinImgBandSource **ppSource,
+  const char        *pFileName
+)
+{
+  if (!ppSource || !pFileName)
+    return BAD_ARGS;
+
+  JpegBandSource *pSource = new JpegBandSource();
+  int res = pSource->Open(pFileName);
+  if (res < 0)
+  {
+    delete pSource;
+    return res;
+  }
+  *ppSource = pSource;
+  return NO_ERRORS;
+}
+
+int OpenJpegBandSink
+(
+  MinImgBandSink    **ppSink,
+  const char         *pFileName,
+  const ExtImgProps  *pProps
+)
+{
+  if (!ppSink || !pFileName)
+    return BAD_ARGS;
+
+  JpegBandSink *pSink = new JpegBandSink(pProps);
+  int res = pSink->Open(pFileName);
+  if (res < 0)
+  {
+    delete pSink;
+    return res;
+  }
+  *ppSink = pSink;
+  return NO_ERRORS;
+}
+
 #else // WITH_JPEG
 
 int GetJpegPages(const char *pFileName)
@@ -503,4 +764,14 @@ int SaveJpegEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPr
   return NOT_SUPPORTED;
 }
 
+int OpenJpegBandSource(MinImgBandSource **ppSource, const char *pFileName)
+{
+  return NOT_SUPPORTED;
+}
+
+int OpenJpegBandSink(MinImgBandSink **ppSink, const char *pFileName, const ExtImgProps *pProps)
+{
+  return NOT_SUPPORTED;
+}
+
 #endif // WITH_JPEG
@@ -36,6 +36,7 @@ either expressed or implied, of copyright holders.
 #ifndef MINIMGIO_MINIMGIOJPEG_INCLUDED
 #define MINIMGIO_MINIMGIOJPEG_INCLUDED
 
+#include <minutils/bandstream.h>
 #include <minimgio/minimgio.h>
 
 int GetJpegPages
@@ -71,4 +72,17 @@ int SaveJpegEx
   const ExtImgProps *pProps
 );
 
+int OpenJpegBandSource
+(
+  MinImgBandSource **ppSource,
+  const char *pFileName
+);
+
+int OpenJpegBandSink
+(
+  MinImgBandSink **ppSink,
+  const char *pFileName,
+  const ExtImgProps *pProps
+);
+
 #endif // MINIMGIO_MINIMGIOJPEG_INCLUDED
@@ -42,6 +42,7 @@ either expressed or implied, of copyright holders.
 #include <minutils/smartptr.h>
 
 #include "minimgiojpeg.h"
+#include "minimgiopng.h"
 #include "utils.h"
 
 #ifdef WITH_PNG
@@ -415,6 +416,286 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
   return NO_ERRORS;
 }
 
+// Implementation of OpenPngBandSource() and OpenPngBandSink()
+
+class PngBandSource : public MinImgBandSource
+{
+public:
+  PngBandSource(): pFile(NULL), pPng(NULL), pInfo(NULL), nextRow(0)
+  {
+    ::memset(&prototype, 0, sizeof(prototype));
+  }
+
+  ~PngBandSource()
+  {
+    if (pPng)
+      png_destroy_read_struct(&pPng, pInfo ? &pInfo : 0, 0);
+    delete pFile;
+  }
+
+  int Open(const char *pFileName)
+  {
+    switch (DeduceFileLocation(pFileName)) {
+    case inFileSystem:
+      pFile = new FileInFileSystem(pFileName);
+      break;
+    case inMemory:
+      pFile = new FileInMemory(pFileName);
+      break;
+    default:
+      return BAD_ARGS;
+    }
+    if (!pFile->IsGood())
+      return BAD_ARGS;
+
+    png_byte header[8] = {0};
+    pFile->ReadBytes(header, 8);
+    if (png_sig_cmp(header, 0, 8) != 0)
+      return INTERNAL_ERROR;
+
+    pPng = png_create_read_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+    if (!pPng)
+      return INTERNAL_ERROR;
+    pInfo = png_create_info_struct(pPng);
+    if (!pInfo)
+      return INTERNAL_ERROR;
+
+    png_set_read_fn(pPng, pFile, PngReadDataFromFile);
+
+    if (setjmp(png_jmpbuf(pPng)))
+      return INTERNAL_ERROR;
+
+    png_set_sig_bytes(pPng, 8);
+    png_read_info(pPng, pInfo);
+
+    uint32_t width = 0, height = 0;
+    int depth = 0, color_type = 0, interlace = 0;
+    png_get_IHDR(pPng, pInfo, &width, &height, &depth, &color_type, &interlace, 0, 0);
+
+    // Interlaced images are complete only after the last pass.
+    if (interlace != PNG_INTERLACE_NONE)
+      return NOT_SUPPORTED;
+
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+      png_set_palette_to_rgb(pPng);
+
+    if (color_type == PNG_COLOR_TYPE_GRAY && depth < 8)
+      png_set_expand_gray_1_2_4_to_8(pPng);
+
+    if (color_type & PNG_COLOR_MASK_ALPHA)
+      png_set_strip_alpha(pPng);
+
+    if (png_get_valid(pPng, pInfo, PNG_INFO_tRNS))
+      png_set_tRNS_to_alpha(pPng);
+
+    if (depth == 16)
+      png_set_strip_16(pPng);
+
+    if (depth < 8)
+      png_set_packing(pPng);
+
+    png_read_update_info(pPng, pInfo);
+    png_get_IHDR(pPng, pInfo, &width, &height, &depth, &color_type, &interlace, 0, 0);
+
+    if (depth % 8 != 0)
+      return NOT_SUPPORTED;
+
+    prototype.channelDepth = depth / 8;
+    prototype.channels = png_get_channels(pPng, pInfo);
+    prototype.format = FMT_UINT;
+    prototype.height = height;
+    prototype.width = width;
+    return NO_ERRORS;
+  }
+
+  int GetPrototype(MinImg *pPrototype)
+  {
+    if (!pPrototype || pPrototype->pScan0)
+      return BAD_ARGS;
+    *pPrototype = prototype;
+    return NO_ERRORS;
+  }
+
+  int ReadRows(const MinImg *pBand)
+  {
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != prototype.channelDepth ||
+        pBand->format != prototype.format ||
+        pBand->channels != prototype.channels ||
+        pBand->width != prototype.width)
+      return BAD_ARGS;
+    if (nextRow + pBand->height > prototype.height)
+      return BAD_STATE;
+
+    if (setjmp(png_jmpbuf(pPng)))
+      return INTERNAL_ERROR;
+
+    for (int y = 0; y < pBand->height; ++y, ++nextRow)
+      png_read_row(pPng, pBand->pScan0 + y * pBand->stride, 0);
+    if (nextRow == prototype.height)
+      png_read_end(pPng, 0);
+
+    return NO_ERRORS;
+  }
+
+private:
+  FileReaderInterface *pFile;
+  png_structp          pPng;
+  png_infop            pInfo;
+  MinImg               prototype;
+  int                  nextRow;
+};
+
+class PngBandSink : public MinImgBandSink
+{
+public:
+  PngBandSink(const ExtImgProps *pProps):
+    pFile(NULL), pPng(NULL), pInfo(NULL), nextRow(0)
+  {
+    ::memset(&prototype, 0, sizeof(prototype));
+    ::memset(&props, 0, sizeof(props));
+    hasProps = pProps != NULL;
+    if (pProps)
+      props = *pProps;
+  }
+
+  ~PngBandSink()
+  {
+    if (pPng)
+      png_destroy_write_struct(&pPng, pInfo ? &pInfo : 0);
+    _FClose(pFile);
+  }
+
+  int Open(const char *pFileName)
+  {
+    if (DeduceFileLocation(pFileName) != inFileSystem)
+      return NOT_IMPLEMENTED;
+    pFile = fopen(pFileName, "wb");
+    if (!pFile)
+      return BAD_ARGS;
+    return NO_ERRORS;
+  }
+
+  int Begin(const MinImg *pPrototype)
+  {
+    if (!pPrototype || pPng)
+      return BAD_ARGS;
+    if (pPrototype->channelDepth != 1 || pPrototype->format != FMT_UINT)
+      return NOT_IMPLEMENTED;
+    if (pPrototype->channels != 1 && pPrototype->channels != 3 && pPrototype->channels != 4)
+      return NOT_SUPPORTED;
+
+    pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, 0, 0, 0);
+    if (!pPng)
+      return INTERNAL_ERROR;
+    pInfo = png_create_info_struct(pPng);
+    if (!pInfo)
+      return INTERNAL_ERROR;
+
+    if (setjmp(png_jmpbuf(pPng)))
+      return INTERNAL_ERROR;
+
+    prototype = *pPrototype;
+    int colorType = PNG_COLOR_TYPE_GRAY;
+    if (prototype.channels == 3)
+      colorType = PNG_COLOR_TYPE_RGB;
+    else if (prototype.channels == 4)
+      colorType = PNG_COLOR_TYPE_RGBA;
+    png_set_IHDR(pPng, pInfo, prototype.width, prototype.height, 8, colorType, PNG_INTERLACE_NONE, 0, 0);
+
+    uint32_t xDPM = 0, yDPM = 0;
+    const double dpiFactor = 39.37007874015748;
+    if (hasProps)
+    {
+      xDPM = static_cast<uint32_t>(props.xDPI * dpiFactor + 0.5);
+      yDPM = static_cast<uint32_t>(props.yDPI * dpiFactor + 0.5);
+    }
+    png_set_pHYs(pPng, pInfo, xDPM , yDPM, PNG_OFFSET_PIXEL);
+
+    png_init_io(pPng, pFile);
+    png_write_info(pPng, pInfo);
+    return NO_ERRORS;
+  }
+
+  int WriteRows(const MinImg *pBand)
+  {
+    if (!pPng)
+      return BAD_STATE;
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != prototype.channelDepth ||
+        pBand->format != prototype.format ||
+        pBand->channels != prototype.channels ||
+        pBand->width != prototype.width)
+      return BAD_ARGS;
+    if (nextRow + pBand->height > prototype.height)
+      return BAD_STATE;
+
+    if (setjmp(png_jmpbuf(pPng)))
+      return INTERNAL_ERROR;
+
+    for (int y = 0; y < pBand->height; ++y, ++nextRow)
+      png_write_row(pPng, pBand->pScan0 + y * pBand->stride);
+
+    return NO_ERRORS;
+  }
+
+  int End()
+  {
+    if (!pPng || nextRow != prototype.height)
+      return BAD_STATE;
+
+    if (setjmp(png_jmpbuf(pPng)))
+      return INTERNAL_ERROR;
+
+    png_write_end(pPng, pInfo);
+    _FClose(pFile);
+    return NO_ERRORS;
+  }
+
+private:
+  FILE        *pFile;
+  png_structp  pPng;
+  png_infop    pInfo;
+  MinImg       prototype;
+  int          nextRow;
+  ExtImgProps  props;
+  bool         hasProps;
+};
+
+int OpenPngBandSource(MinImgBandSource **ppSource, const char *pFileName)
+{
+  if (!ppSource || !pFileName)
+    return BAD_ARGS;
+
+  PngBandSource *pSource = new PngBandSource();
+  int res = pSource->Open(pFileName);
+  if (res < 0)
+  {
+    delete pSource;
+    return res;
+  }
+  *ppSource = pSource;
+  return NO_ERRORS;
+}
+
+int OpenPngBandSink(MinImgBandSink **ppSink, const char *pFileName, const ExtImgProps *pProps)
+{
+  if (!ppSink || !pFileName)
+    return BAD_ARGS;
+
+  PngBandSink *pSink = new PngBandSink(pProps);
+  int res = pSink->Open(pFileName);
+  if (res < 0)
+  {
+    delete pSink;
+    return res;
+  }
+  *ppSink = pSink;
+  return NO_ERRORS;
+}
+
 #else // WITH_PNG
 
 int GetPngPages(const char *pFileName)
@@ -442,4 +723,14 @@ int SavePngEx(const char *pFileName, const MinImg *pImg, const ExtImgProps *pPro
   return NOT_SUPPORTED;
 }
 
+int OpenPngBandSource(MinImgBandSource **ppSource, const char *pFileName)
+{
+  return NOT_SUPPORTED;
+}
+
+int OpenPngBandSink(MinImgBandSink **ppSink, const char *pFileName, const ExtImgProps *pProps)
+{
+  return NOT_SUPPORTED;
+}
+
 #endif  // WITH_PNG
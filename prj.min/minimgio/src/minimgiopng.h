@@ -35,6 +35,7 @@ either expressed or implied, of copyright holders.
 #ifndef MINIMGIOPNG_H_INCLUDED
 #define MINIMGIOPNG_H_INCLUDED
 
+#include <minutils/bandstream.h>
 #include <minimgio/minimgio.h>
 
 int GetPngPages
@@ -70,4 +71,17 @@ int SavePngEx
   const ExtImgProps *pProps
 );
 
+int OpenPngBandSource
+(
+  MinImgBandSource **ppSource,
+  const char *pFileName
+);
+
+int OpenPngBandSink
+(
+  MinImgBandSink **ppSink,
+  const char *pFileName,
+  const ExtImgProps *pProps
+);
+
 #endif  // MINIMGIOPNG_H_INCLUDED
\ No newline at end of file
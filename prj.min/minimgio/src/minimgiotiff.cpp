@@ -370,14 +370,16 @@ struct TiffData
   }
 };
 
-static int AddPageToTiffExImpl
+static int SetTiffPageFields
   (
   TIFF * pTIF,
+  int *pBpp,
   const MinImg *pImg,
   const ExtImgProps *pProps
   )
 {
-  int bpp = std::max(1, (int)pImg->channelDepth * 8);
+  int &bpp = *pBpp;
+  bpp = std::max(1, (int)pImg->channelDepth * 8);
   if (pProps != NULL)
   {
     switch (pProps->comp)
@@ -448,7 +450,28 @@ static int AddPageToTiffExImpl
   {
     if (pImg->channelDepth > 1 || pImg->channels > 1 || pImg->format != FMT_UINT)
       return NOT_IMPLEMENTED;
+  }
+  else if (bpp == 8 && pImg->channelDepth == 0)
+  {
+    if (pImg->channels > 1 || pImg->format != FMT_UINT)
+      return NOT_IMPLEMENTED;
+  }
+
+  return NO_ERRORS;
+}
 
+// Writes rows starting from the given one, converting them to the sample
+// size chosen by SetTiffPageFields().
+static int WriteTiffRows
+  (
+  TIFF * pTIF,
+  int bpp,
+  const MinImg *pImg,
+  int firstRow
+  )
+{
+  if (bpp == 1 && pImg->channelDepth > 0)
+  {
     const uint8_t level = 128;
     size_t size = (pImg->width + 7) / 8;
     scoped_cpp_array<uint8_t> pBuf(new uint8_t[size]);
@@ -456,34 +479,43 @@ static int AddPageToTiffExImpl
     for (int y = 0; y < pImg->height; y++)
     {
       PackLine(pBuf, pImg->pScan0 + pImg->stride * y, level, pImg->width, false);
-      SHOULD_WORK(TIFFWriteScanline(pTIF, pBuf, y, 0));
+      SHOULD_WORK(TIFFWriteScanline(pTIF, pBuf, firstRow + y, 0));
     }
   }
   else if (bpp == 8 && pImg->channelDepth == 0)
   {
-    if (pImg->channels > 1 || pImg->format != FMT_UINT)
-      return NOT_IMPLEMENTED;
-
     const int size = pImg->width;
     scoped_cpp_array<uint8_t> pBuf(new uint8_t[size]);
 
     for (int y = 0; y < pImg->height; y++)
     {
       UnpackLine(pBuf, pImg->pScan0 + pImg->stride * y, pImg->width, false);
-      SHOULD_WORK(TIFFWriteScanline(pTIF, pBuf, y, 0));
+      SHOULD_WORK(TIFFWriteScanline(pTIF, pBuf, firstRow + y, 0));
     }
   }
   else
   {
     for (int y = 0; y < pImg->height; y++)
     {
-      SHOULD_WORK(TIFFWriteScanline(pTIF, pImg->pScan0 + pImg->stride * y, y, 0));
+      SHOULD_WORK(TIFFWriteScanline(pTIF, pImg->pScan0 + pImg->stride * y, firstRow + y, 0));
     }
   }
 
   return NO_ERRORS;
 }
 
+static int AddPageToTiffExImpl
+  (
+  TIFF * pTIF,
+  const MinImg *pImg,
+  const ExtImgProps *pProps
+  )
+{
+  int bpp = 0;
+  PROPAGATE_ERROR(SetTiffPageFields(pTIF, &bpp, pImg, pProps));
+  return WriteTiffRows(pTIF, bpp, pImg, 0);
+}
+
 int SaveTiffEx
 (
   const char *pFileName,
@@ -630,3 +662,217 @@ int SaveTiffEx
   return NO_ERRORS;
 #endif // WITH_TIFF
 }
+
+#ifdef WITH_TIFF
+
+class TiffBandSource : public MinImgBandSource
+{
+public:
+  TiffBandSource(): pTIF(NULL), pScanLine(NULL), invert(false), nextRow(0)
+  {
+    ::memset(&prototype, 0, sizeof(prototype));
+  }
+
+  ~TiffBandSource()
+  {
+    if (pScanLine)
+      _TIFFfree(pScanLine);
+    _TIFFClose(pTIF);
+  }
+
+  int Open(const char *pFileName, int page)
+  {
+    TIFFSetErrorHandler(NULL);
+    TIFFSetWarningHandler(NULL);
+
+    PROPAGATE_ERROR(GetTiffPropsEx(&prototype, NULL, pFileName, page));
+
+    pTIF = TIFFOpen(pFileName, "r");
+    if (!pTIF)
+      return FILE_ERROR;
+    TIFFSetDirectory(pTIF, page);
+
+    int metr = 0;
+    _TIFFGetField(pTIF, TIFFTAG_PHOTOMETRIC, &metr, PHOTOMETRIC_MINISWHITE);
+    if (metr == PHOTOMETRIC_MINISWHITE && prototype.channelDepth > 0)
+      return NOT_IMPLEMENTED;
+    invert = (metr == PHOTOMETRIC_MINISWHITE);
+
+    scanLen = TIFFScanlineSize(pTIF);
+    pScanLine = (uint8_t *)_TIFFmalloc(scanLen);
+    if (!pScanLine)
+      return NO_MEMORY;
+    return NO_ERRORS;
+  }
+
+  int GetPrototype(MinImg *pPrototype)
+  {
+    if (!pPrototype || pPrototype->pScan0)
+      return BAD_ARGS;
+    *pPrototype = prototype;
+    return NO_ERRORS;
+  }
+
+  int ReadRows(const MinImg *pBand)
+  {
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != prototype.channelDepth ||
+        pBand->format != prototype.format ||
+        pBand->channels != prototype.channels ||
+        pBand->width != prototype.width)
+      return BAD_ARGS;
+    if (nextRow + pBand->height > prototype.height)
+      return BAD_STATE;
+
+    for (int y = 0; y < pBand->height; ++y, ++nextRow)
+    {
+      SHOULD_WORK(TIFFReadScanline(pTIF, pScanLine, nextRow));
+
+      uint8_t *pLine = pBand->pScan0 + pBand->stride * y;
+      if (prototype.channelDepth == 0)
+        CopyBits(pLine, pScanLine, prototype.width * prototype.channels, invert);
+      else
+        memcpy(pLine, pScanLine, scanLen);
+    }
+
+    return NO_ERRORS;
+  }
+
+private:
+  TIFF     *pTIF;
+  uint8_t  *pScanLine;
+  tsize_t   scanLen;
+  bool      invert;
+  MinImg    prototype;
+  int       nextRow;
+};
+
+class TiffBandSink : public MinImgBandSink
+{
+public:
+  TiffBandSink(const ExtImgProps *pProps): pTIF(NULL), bpp(0), nextRow(0)
+  {
+    ::memset(&prototype, 0, sizeof(prototype));
+    ::memset(&props, 0, sizeof(props));
+    hasProps = pProps != NULL;
+    if (pProps)
+      props = *pProps;
+  }
+
+  ~TiffBandSink()
+  {
+    _TIFFClose(pTIF);
+  }
+
+  int Open(const char *pFileName)
+  {
+    TIFFSetErrorHandler(NULL);
+    TIFFSetWarningHandler(NULL);
+
+    pTIF = TIFFOpen(pFileName, "w");
+    if (!pTIF)
+      return FILE_ERROR;
+    return NO_ERRORS;
+  }
+
+  int Begin(const MinImg *pPrototype)
+  {
+    if (!pPrototype || bpp)
+      return BAD_ARGS;
+
+    prototype = *pPrototype;
+    TIFFSetField(pTIF, TIFFTAG_SUBFILETYPE, FILETYPE_PAGE);
+    TIFFSetField(pTIF, TIFFTAG_PAGENUMBER, 0, 1);
+    PROPAGATE_ERROR(SetTiffPageFields(pTIF, &bpp, &prototype, hasProps ? &props : NULL));
+    return NO_ERRORS;
+  }
+
+  int WriteRows(const MinImg *pBand)
+  {
+    if (!bpp)
+      return BAD_STATE;
+    if (!pBand || (pBand->height > 0 && !pBand->pScan0))
+      return BAD_ARGS;
+    if (pBand->channelDepth != prototype.channelDepth ||
+        pBand->format != prototype.format ||
+        pBand->channels != prototype.channels ||
+        pBand->width != prototype.width)
+      return BAD_ARGS;
+    if (nextRow + pBand->height > prototype.height)
+      return BAD_STATE;
+
+    PROPAGATE_ERROR(WriteTiffRows(pTIF, bpp, pBand, nextRow));
+    nextRow += pBand->height;
+    return NO_ERRORS;
+  }
+
+  int End()
+  {
+    if (!bpp || nextRow != prototype.height)
+      return BAD_STATE;
+    if (!TIFFWriteDirectory(pTIF))
+      return INTERNAL_ERROR;
+    return NO_ERRORS;
+  }
+
+private:
+  TIFF        *pTIF;
+  int          bpp;
+  MinImg       prototype;
+  int          nextRow;
+  ExtImgProps  props;
+  bool         hasProps;
+};
+
+#endif // WITH_TIFF
+
+int OpenTiffBandSource
+(
+  MinImgBandSource **ppSource,
+  const char *pFileName,
+  int page
+)
+{
+#ifndef WITH_TIFF
+  return NOT_IMPLEMENTED;
+#else
+  if (!ppSource || !pFileName || page < 0)
+    return BAD_ARGS;
+
+  TiffBandSource *pSource = new TiffBandSource();
+  int res = pSource->Open(pFileName, page);
+  if (res < 0)
+  {
+    delete pSource;
+    return res;
+  }
+  *ppSource = pSource;
+  return NO_ERRORS;
+#endif // WITH_TIFF
+}
+
+int OpenTiffBandSink
+(
+  MinImgBandSink **ppSink,
+  const char *pFileName,
+  const ExtImgProps *pProps
+)
+{
+#ifndef WITH_TIFF
+  return NOT_IMPLEMENTED;
+#else
+  if (!ppSink || !pFileName)
+    return BAD_ARGS;
+
+  TiffBandSink *pSink = new TiffBandSink(pProps);
+  int res = pSink->Open(pFileName);
+  if (res < 0)
+  {
+    delete pSink;
+    return res;
+  }
+  *ppSink = pSink;
+  return NO_ERRORS;
+#endif // WITH_TIFF
+}
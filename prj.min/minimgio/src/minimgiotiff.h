@@ -33,6 +33,7 @@ either expressed or implied, of copyright holders.
 
 #pragma once
 
+#include <minutils/bandstream.h>
 #include <minimgio/minimgio.h>
 
 int GetTiffPages
@@ -70,3 +71,17 @@ int SaveTiffEx
   const ExtImgProps *pProps,
   int page
 );
+
+int OpenTiffBandSource
+(
+  MinImgBandSource **ppSource,
+  const char *pFileName,
+  int page
+);
+
+int OpenTiffBandSink
+(
+  MinImgBandSink **ppSink,
+  const char *pFileName,
+  const ExtImgProps *pProps
+);
@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   hiresclock.h
+ * @brief  High resolution monotonic clock.
+ */
+
+#pragma once
+#ifndef MINSTOPWATCH_HIRESCLOCK_H_INCLUDED
+#define MINSTOPWATCH_HIRESCLOCK_H_INCLUDED
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+// The time stamp counter is cheaper to read than the system clock, but it is
+// only usable on processors where it ticks at a constant rate, so it is an
+// opt-in.
+#if defined(MINSTOPWATCH_USE_TSC) && \
+    (defined(__x86_64__) || defined(__i386__) || \
+     defined(_M_X64) || defined(_M_IX86))
+#  define MINSTOPWATCH_TSC_CLOCK
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+#endif
+
+inline long long systemHighResolutionClock()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return counter.QuadPart;
+#else
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+inline long long systemHighResolutionClocksPerSecond()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return frequency.QuadPart;
+#else
+  return 1000000000LL;
+#endif
+}
+
+#if defined(MINSTOPWATCH_TSC_CLOCK)
+// Measures the rate of the time stamp counter against the system clock over
+// 20 milliseconds.
+inline long long calibrateTimeStampCounter()
+{
+  const long long systemFrequency = systemHighResolutionClocksPerSecond();
+  const long long systemStart = systemHighResolutionClock();
+  const long long tscStart = static_cast<long long>(__rdtsc());
+  long long systemNow = systemStart;
+  while (systemNow - systemStart < systemFrequency / 50)
+    systemNow = systemHighResolutionClock();
+  const long long tscNow = static_cast<long long>(__rdtsc());
+  return (tscNow - tscStart) * systemFrequency / (systemNow - systemStart);
+}
+#endif
+
+/// Returns the current value of the clock in ticks.
+inline long long highResolutionClock()
+{
+#if defined(MINSTOPWATCH_TSC_CLOCK)
+  return static_cast<long long>(__rdtsc());
+#else
+  return systemHighResolutionClock();
+#endif
+}
+
+/// Returns the number of ticks of @c highResolutionClock() per second.
+inline long long highResolutionClocksPerSecond()
+{
+#if defined(MINSTOPWATCH_TSC_CLOCK)
+  static const long long frequency = calibrateTimeStampCounter();
+  return frequency;
+#else
+  return systemHighResolutionClocksPerSecond();
+#endif
+}
+
+#endif // MINSTOPWATCH_HIRESCLOCK_H_INCLUDED
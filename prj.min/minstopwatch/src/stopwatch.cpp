@@ -0,0 +1,388 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32)
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#  include <intrin.h>
+#  define MINSTOPWATCH_TLS __declspec(thread)
+#else
+#  include <pthread.h>
+#  define MINSTOPWATCH_TLS __thread
+#endif
+
+#include <minstopwatch/stopwatch.hpp>
+
+// Stopwatches declared beyond this number are not measured.
+static const int MAX_STOPWATCHES = 1024;
+
+namespace {
+
+class Mutex
+{
+public:
+#if defined(_WIN32)
+  Mutex() { InitializeCriticalSection(&section); }
+  ~Mutex() { DeleteCriticalSection(&section); }
+  void lock() { EnterCriticalSection(&section); }
+  void unlock() { LeaveCriticalSection(&section); }
+#else
+  Mutex() { pthread_mutex_init(&mutex, NULL); }
+  ~Mutex() { pthread_mutex_destroy(&mutex); }
+  void lock() { pthread_mutex_lock(&mutex); }
+  void unlock() { pthread_mutex_unlock(&mutex); }
+#endif
+
+private:
+  Mutex(const Mutex &);
+  void operator =(const Mutex &);
+
+#if defined(_WIN32)
+  CRITICAL_SECTION section;
+#else
+  pthread_mutex_t mutex;
+#endif
+};
+
+class ScopedLock
+{
+public:
+  explicit ScopedLock(Mutex &mutex) : mutex(mutex) { mutex.lock(); }
+  ~ScopedLock() { mutex.unlock(); }
+
+private:
+  ScopedLock(const ScopedLock &);
+  void operator =(const ScopedLock &);
+
+  Mutex &mutex;
+};
+
+struct Slot
+{
+  long long calls;
+  long long total;
+  long long min;
+  long long max;
+};
+
+void MergeSlot(Slot &total, const Slot &slot)
+{
+  if (!slot.calls)
+    return;
+  total.min = total.calls ? std::min(total.min, slot.min) : slot.min;
+  total.max = std::max(total.max, slot.max);
+  total.calls += slot.calls;
+  total.total += slot.total;
+}
+
+// Atomically adds the delta to the value and returns the previous value, with
+// a full memory barrier.
+long atomicAdd(volatile long &value, long delta)
+{
+#if defined(_MSC_VER)
+  return _InterlockedExchangeAdd(&value, delta);
+#else
+  return __sync_fetch_and_add(&value, delta);
+#endif
+}
+
+// Measurements of a single thread, written by that thread only and without
+// locks. The sequence number is odd while a measurement is being written, so
+// readers copy the slots and retry until the number is even and unchanged.
+// The registry cannot clear the slots of a running thread, so it discards
+// them by moving to the next epoch, and the thread clears its slots itself on
+// its next measurement. When the thread finishes, the registry merges the
+// slots into its own ones and frees the block.
+struct ThreadSlots
+{
+  volatile long sequence;
+  long          epoch;
+  Slot          slots[MAX_STOPWATCHES];
+};
+
+MINSTOPWATCH_TLS ThreadSlots *tls_pSlots = NULL;
+
+#if defined(_WIN32)
+void WINAPI RetireThreadSlots(void *pSlots);
+#else
+void RetireThreadSlots(void *pSlots);
+#endif
+
+bool IsLonger(const MinStopwatchStats &a, const MinStopwatchStats &b)
+{
+  return a.total > b.total;
+}
+
+void WriteReport(FILE *pFile, std::vector<MinStopwatchStats> stats)
+{
+  std::stable_sort(stats.begin(), stats.end(), IsLonger);
+
+  const double usPerTick = 1e6 / highResolutionClocksPerSecond();
+  fprintf(pFile, "%-40s %10s %14s %12s %12s %12s\n",
+          "stopwatch", "calls", "total, ms", "mean, us", "min, us", "max, us");
+  for (size_t i = 0; i < stats.size(); i++)
+  {
+    const MinStopwatchStats &s = stats[i];
+    if (!s.calls)
+      continue;
+    fprintf(pFile, "%-40s %10lld %14.3f %12.3f %12.3f %12.3f\n",
+            s.name, s.calls, s.total * usPerTick * 1e-3,
+            s.total * usPerTick / s.calls, s.min * usPerTick,
+            s.max * usPerTick);
+  }
+  fflush(pFile);
+}
+
+class Registry
+{
+public:
+  static Registry &instance()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  // Blocks of running threads are deliberately not freed: stopwatches of
+  // other static objects may still be running while the program terminates.
+  ~Registry()
+  {
+    alive = false;
+    const char *pReport = getenv("MINSTOPWATCH_REPORT");
+    if (!pReport || !*pReport)
+      return;
+
+    std::vector<MinStopwatchStats> stats;
+    collect(stats);
+    if (!strcmp(pReport, "stderr"))
+      WriteReport(stderr, stats);
+    else if (!strcmp(pReport, "stdout"))
+      WriteReport(stdout, stats);
+    else if (FILE *pFile = fopen(pReport, "w"))
+    {
+      WriteReport(pFile, stats);
+      fclose(pFile);
+    }
+  }
+
+  int add(const char *name)
+  {
+    ScopedLock lock(mutex);
+    names.push_back(name);
+    return static_cast<int>(names.size()) - 1;
+  }
+
+  static bool isAlive()
+  {
+    return alive;
+  }
+
+  static long currentEpoch()
+  {
+    return epoch;
+  }
+
+  ThreadSlots *newThreadSlots()
+  {
+    ThreadSlots *pSlots = new ThreadSlots;
+    memset(pSlots->slots, 0, sizeof(pSlots->slots));
+    pSlots->sequence = 0;
+    ScopedLock lock(mutex);
+    pSlots->epoch = epoch;
+    threads.push_back(pSlots);
+#if defined(_WIN32)
+    FlsSetValue(exitKey, pSlots);
+#else
+    pthread_setspecific(exitKey, pSlots);
+#endif
+    return pSlots;
+  }
+
+  // Called when the thread owning the block finishes.
+  void retire(ThreadSlots *pSlots)
+  {
+    ScopedLock lock(mutex);
+    threads.erase(std::remove(threads.begin(), threads.end(), pSlots),
+                  threads.end());
+    if (pSlots->epoch == epoch)
+      for (int id = 0; id < MAX_STOPWATCHES; id++)
+        MergeSlot(retired[id], pSlots->slots[id]);
+    delete pSlots;
+  }
+
+  void collect(std::vector<MinStopwatchStats> &stats)
+  {
+    ScopedLock lock(mutex);
+    const size_t count = std::min<size_t>(names.size(), MAX_STOPWATCHES);
+    std::vector<Slot> totals(retired, retired + count);
+    std::vector<Slot> snapshot(count);
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+      if (!count || !readSlots(*threads[t], &snapshot[0], count))
+        continue;
+      for (size_t id = 0; id < count; id++)
+        MergeSlot(totals[id], snapshot[id]);
+    }
+    stats.clear();
+    for (size_t id = 0; id < count; id++)
+    {
+      MinStopwatchStats entry = {names[id], totals[id].calls, totals[id].total,
+                                 totals[id].min, totals[id].max};
+      stats.push_back(entry);
+    }
+  }
+
+  void reset()
+  {
+    ScopedLock lock(mutex);
+    atomicAdd(epoch, 1);
+    memset(retired, 0, sizeof(retired));
+  }
+
+private:
+  Registry()
+  {
+    memset(retired, 0, sizeof(retired));
+#if defined(_WIN32)
+    exitKey = FlsAlloc(RetireThreadSlots);
+#else
+    pthread_key_create(&exitKey, RetireThreadSlots);
+#endif
+    alive = true;
+  }
+
+  // Copies a consistent state of the first slots of a running thread.
+  // Returns false if the slots belong to a discarded epoch.
+  bool readSlots(const ThreadSlots &thread, Slot *pSlots, size_t count)
+  {
+    for (;;)
+    {
+      const long sequence = atomicAdd(
+          const_cast<volatile long &>(thread.sequence), 0);
+      if (sequence & 1)
+        continue;
+      const bool current = thread.epoch == epoch;
+      memcpy(pSlots, thread.slots, count * sizeof(Slot));
+      if (atomicAdd(const_cast<volatile long &>(thread.sequence), 0) ==
+          sequence)
+        return current;
+    }
+  }
+
+  static bool               alive;
+  static volatile long      epoch; // Advanced by every reset.
+
+  Mutex                     mutex;
+  std::vector<const char *> names;
+  std::vector<ThreadSlots *> threads;
+  Slot                      retired[MAX_STOPWATCHES]; // Of finished threads.
+#if defined(_WIN32)
+  DWORD                     exitKey;
+#else
+  pthread_key_t             exitKey;
+#endif
+};
+
+bool Registry::alive = false;
+volatile long Registry::epoch = 0;
+
+// Threads finishing after the registry has been destroyed at exit keep their
+// blocks.
+#if defined(_WIN32)
+void WINAPI RetireThreadSlots(void *pSlots)
+#else
+void RetireThreadSlots(void *pSlots)
+#endif
+{
+  tls_pSlots = NULL;
+  if (pSlots && Registry::isAlive())
+    Registry::instance().retire(static_cast<ThreadSlots *>(pSlots));
+}
+
+} // namespace
+
+MinStopwatch::MinStopwatch(const char *name)
+  : id(Registry::instance().add(name))
+{
+}
+
+void MinStopwatch::add(long long ticks)
+{
+  if (id >= MAX_STOPWATCHES)
+    return;
+  if (!tls_pSlots)
+    tls_pSlots = Registry::instance().newThreadSlots();
+
+  ThreadSlots &thread = *tls_pSlots;
+  atomicAdd(thread.sequence, 1);
+  const long epoch = Registry::currentEpoch();
+  if (thread.epoch != epoch)
+  {
+    memset(thread.slots, 0, sizeof(thread.slots));
+    thread.epoch = epoch;
+  }
+  Slot &slot = thread.slots[id];
+  if (!slot.calls || ticks < slot.min)
+    slot.min = ticks;
+  if (ticks > slot.max)
+    slot.max = ticks;
+  slot.total += ticks;
+  slot.calls++;
+  atomicAdd(thread.sequence, 1);
+}
+
+MINSTOPWATCH_API void CollectMinStopwatches(
+    std::vector<MinStopwatchStats> &stats)
+{
+  Registry::instance().collect(stats);
+}
+
+MINSTOPWATCH_API void ReportMinStopwatches(FILE *pFile)
+{
+  if (!pFile)
+    return;
+
+  std::vector<MinStopwatchStats> stats;
+  CollectMinStopwatches(stats);
+  WriteReport(pFile, stats);
+}
+
+MINSTOPWATCH_API void ResetMinStopwatches()
+{
+  Registry::instance().reset();
+}
@@ -0,0 +1,135 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   stopwatch.hpp
+ * @brief  Accumulating stopwatches for profiling of library functions.
+ *
+ * A stopwatch is declared once per measured function at namespace scope and
+ * started by a scoped control object at the beginning of the function:
+ *
+ * @code
+ * DECLARE_MINSTOPWATCH(gsw_CopyMinImage, "CopyMinImage");
+ *
+ * int CopyMinImage(...) {
+ *   DECLARE_MINSTOPWATCH_CTL(gsw_CopyMinImage);
+ *   ...
+ * }
+ * @endcode
+ *
+ * Every thread accumulates the number of calls and the total, minimal and
+ * maximal duration of a call into its own slots without locks, so measuring
+ * threads do not wait for each other or for reporting threads, which retry
+ * reading the slots of a thread caught in the middle of a measurement. The
+ * slots of a finished thread are merged into common ones and freed.
+ * @c ReportMinStopwatches() merges the slots of all threads. If the
+ * @c MINSTOPWATCH_REPORT environment variable is set, the report is also
+ * written at exit to the file it names, or to the standard error or output
+ * stream for @c stderr or @c stdout.
+ */
+
+#pragma once
+#ifndef MINSTOPWATCH_STOPWATCH_HPP_INCLUDED
+#define MINSTOPWATCH_STOPWATCH_HPP_INCLUDED
+
+#include <cstdio>
+#include <vector>
+#include <minstopwatch/hiresclock.h>
+
+#if defined _MSC_VER && defined MINSTOPWATCH_EXPORTS
+#  define MINSTOPWATCH_API __declspec(dllexport)
+#else
+#  define MINSTOPWATCH_API
+#endif
+
+/// Accumulated measurements of a stopwatch.
+struct MinStopwatchStats
+{
+  const char *name;   ///< The name of the stopwatch.
+  long long   calls;  ///< The number of measured calls.
+  long long   total;  ///< The total duration of the calls, in clock ticks.
+  long long   min;    ///< The shortest call, in clock ticks.
+  long long   max;    ///< The longest call, in clock ticks.
+};
+
+/// A named stopwatch accumulating durations per thread.
+class MINSTOPWATCH_API MinStopwatch
+{
+public:
+  /// Registers the stopwatch. The name must outlive the stopwatch.
+  explicit MinStopwatch(const char *name);
+
+  /// Accumulates a single call of the given duration in the calling thread.
+  void add(long long ticks);
+
+private:
+  MinStopwatch(const MinStopwatch &);
+  void operator =(const MinStopwatch &);
+
+  int id;
+};
+
+/// Measures the duration of its own lifetime with a stopwatch.
+class MinStopwatchControl
+{
+public:
+  explicit MinStopwatchControl(MinStopwatch &stopwatch)
+    : stopwatch(stopwatch), start(highResolutionClock())
+  {
+  }
+
+  ~MinStopwatchControl()
+  {
+    stopwatch.add(highResolutionClock() - start);
+  }
+
+private:
+  MinStopwatchControl(const MinStopwatchControl &);
+  void operator =(const MinStopwatchControl &);
+
+  MinStopwatch &stopwatch;
+  long long     start;
+};
+
+#define DECLARE_MINSTOPWATCH(var, name) static MinStopwatch var(name)
+#define DECLARE_MINSTOPWATCH_CTL(var) MinStopwatchControl var##_ctl(var)
+
+/// Merges the measurements of all threads, one entry per stopwatch.
+MINSTOPWATCH_API void CollectMinStopwatches(
+    std::vector<MinStopwatchStats> &stats);
+
+/// Writes a table of all stopwatches which were called, the longest first.
+MINSTOPWATCH_API void ReportMinStopwatches(FILE *pFile);
+
+/// Discards the measurements of all threads.
+MINSTOPWATCH_API void ResetMinStopwatches();
+
+#endif // MINSTOPWATCH_STOPWATCH_HPP_INCLUDED
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2011-2013, Smart Engines Limited. All rights reserved.
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY COPYRIGHT HOLDERS "AS IS" AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+SHALL COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of copyright holders.
+*/
+
+/**
+ * @file   bandstream.h
+ * @brief  Row band streaming interfaces.
+ */
+
+#pragma once
+#ifndef MINUTILS_BANDSTREAM_H_INCLUDED
+#define MINUTILS_BANDSTREAM_H_INCLUDED
+
+#include <minutils/minimg.h>
+
+/**
+ * @brief   Specifies a producer of image rows.
+ * @details The class produces an image of a fixed size top to bottom, band by
+ *          band, so that neither the producer nor the consumer needs to hold
+ *          the whole image. Decoders, image processing operators and wrappers
+ *          of in-memory images implement this interface; operators take an
+ *          upstream source and keep only the rows they need.
+ * @ingroup MinUtils_MinImg
+ */
+class MinImgBandSource
+{
+public:
+  virtual ~MinImgBandSource() {}
+
+  /// Fills the header (size, channels and format) of the produced image,
+  /// leaving @c pScan0 empty.
+  virtual int GetPrototype(MinImg *pPrototype) = 0;
+
+  /// Writes the next @c pBand->height rows of the produced image to the band,
+  /// which must have the width, channels and format of the prototype.
+  virtual int ReadRows(const MinImg *pBand) = 0;
+};
+
+/**
+ * @brief   Specifies a consumer of image rows.
+ * @details The class consumes an image of a fixed size top to bottom, band by
+ *          band. Encoders and wrappers of in-memory images implement this
+ *          interface.
+ * @ingroup MinUtils_MinImg
+ */
+class MinImgBandSink
+{
+public:
+  virtual ~MinImgBandSink() {}
+
+  /// Starts consuming an image described by the prototype.
+  virtual int Begin(const MinImg *pPrototype) = 0;
+
+  /// Consumes the next @c pBand->height rows of the image.
+  virtual int WriteRows(const MinImg *pBand) = 0;
+
+  /// Finishes consuming after the last row has been written.
+  virtual int End() = 0;
+};
+
+#endif // MINUTILS_BANDSTREAM_H_INCLUDED
@@ -395,6 +395,32 @@ std::string writeHtml(const std::string& runFileName, const std::string& pattern
     out << "</tr>" << std::endl;
   }
   out << "</table>" << std::endl;
+
+  TimeProfile mergedProfile;
+  for (int i = 0; i < nResults; ++i)
+  {
+    mergedProfile.merge(results[i].timeProfile);
+  }
+  out << "<br><hr /><br>" << std::endl;
+  out << "<table border=\"1\" cellpadding=\"20\">" << std::endl;
+  out << "<tr> <th> Subsystem </th> <th> Samples </th> <th> p50 </th>"
+    " <th> p90 </th> <th> p99 </th> <th> Max </th> </tr>" << std::endl;
+  for (std::vector<std::pair<double, std::string> >::iterator it = avg_times.begin();
+      it != avg_times.end(); ++it)
+  {
+    const LatencyHistogram& hist = mergedProfile.getHistogram(it->second.c_str());
+    if (hist.count() == 0)
+      continue;
+    out << "<tr>" << std::endl;
+    out << "<td> " << it->second << " </td>" << std::endl;
+    out << "<td> " << hist.count() << " </td>" << std::endl;
+    out << "<td> " << hist.percentile(50) * 1e-9 << " </td>" << std::endl;
+    out << "<td> " << hist.percentile(90) * 1e-9 << " </td>" << std::endl;
+    out << "<td> " << hist.percentile(99) * 1e-9 << " </td>" << std::endl;
+    out << "<td> " << hist.maximum() * 1e-9 << " </td>" << std::endl;
+    out << "</tr>" << std::endl;
+  }
+  out << "</table>" << std::endl;
   out << "</body>" << std::endl;
   out << "</html>" << std::endl;
 
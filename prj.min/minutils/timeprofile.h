@@ -38,47 +38,383 @@ either expressed or implied, of copyright holders.
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 #include <fstream>
+#include <sstream>
 
-#include <minstopwatch/hiresclock.h>
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
 
+#include <minutils/timer.h>
+
+/**
+ * Interned name of a TimeProfile entry. Construct it once (e.g. as a static)
+ * and the profile accesses become a vector index instead of a string
+ * allocation and a map lookup. The TimeProfile methods taking a plain name
+ * take a global lock and look the name up on every call, so hot paths should
+ * use prebuilt keys.
+ */
+class TimeProfileKey
+{
+private:
+  int id;
+
+public:
+  explicit TimeProfileKey(const char* name) : id(intern(name)) {}
+
+  int index() const
+  {
+    return id;
+  }
+
+  std::string name() const
+  {
+    return nameOf(id);
+  }
+
+  static int intern(const char* name)
+  {
+    Lock lock;
+    std::map<std::string, int>::const_iterator it = ids().find(name);
+    if (it != ids().end())
+      return it->second;
+    const int id = static_cast<int>(names().size());
+    names().push_back(name);
+    ids()[name] = id;
+    return id;
+  }
+
+  /// Returns the id of an interned name or -1, without interning it.
+  static int lookup(const char* name)
+  {
+    Lock lock;
+    std::map<std::string, int>::const_iterator it = ids().find(name);
+    return it != ids().end() ? it->second : -1;
+  }
+
+  static std::string nameOf(int id)
+  {
+    Lock lock;
+    return names()[id];
+  }
+
+private:
+  static std::vector<std::string>& names()
+  {
+    static std::vector<std::string> table;
+    return table;
+  }
+
+  static std::map<std::string, int>& ids()
+  {
+    static std::map<std::string, int> table;
+    return table;
+  }
+
+  // Interning happens once per key, so a spin lock is enough.
+  class Lock
+  {
+  public:
+    Lock()
+    {
+#if defined(_MSC_VER)
+      while (_InterlockedExchange(flag(), 1))
+        ;
+#else
+      while (__sync_lock_test_and_set(flag(), 1))
+        ;
+#endif
+    }
+    ~Lock()
+    {
+#if defined(_MSC_VER)
+      _InterlockedExchange(flag(), 0);
+#else
+      __sync_lock_release(flag());
+#endif
+    }
+  private:
+    static volatile long* flag()
+    {
+      static volatile long value = 0;
+      return &value;
+    }
+  };
+};
+
+/**
+ * Log-linear histogram of durations in nanoseconds, in the spirit of
+ * HdrHistogram: values below 32 ns are exact, larger ones fall into 16
+ * buckets per power of two, so any reported percentile is within 6.25% of
+ * the recorded value.
+ */
+class LatencyHistogram
+{
+private:
+  static const int subBucketBits = 4;
+  static const int subBucketCount = 1 << subBucketBits;
+  static const int bucketCount = (65 - subBucketBits) * subBucketCount;
+
+  std::vector<unsigned long long> counts;
+  unsigned long long total;
+  unsigned long long minValue;
+  unsigned long long maxValue;
+
+public:
+  LatencyHistogram() : counts(), total(0), minValue(0), maxValue(0) {}
+
+  void record(unsigned long long nanoseconds)
+  {
+    if (counts.empty())
+      counts.resize(bucketCount);
+    ++counts[bucketOf(nanoseconds)];
+    if (total == 0 || nanoseconds < minValue)
+      minValue = nanoseconds;
+    if (nanoseconds > maxValue)
+      maxValue = nanoseconds;
+    ++total;
+  }
+
+  void merge(const LatencyHistogram& other)
+  {
+    if (other.total == 0)
+      return;
+    if (counts.empty())
+      counts.resize(bucketCount);
+    for (int i = 0; i < bucketCount; ++i)
+      counts[i] += other.counts[i];
+    if (total == 0 || other.minValue < minValue)
+      minValue = other.minValue;
+    if (other.maxValue > maxValue)
+      maxValue = other.maxValue;
+    total += other.total;
+  }
+
+  unsigned long long count() const
+  {
+    return total;
+  }
+
+  unsigned long long minimum() const
+  {
+    return minValue;
+  }
+
+  unsigned long long maximum() const
+  {
+    return maxValue;
+  }
+
+  /// Returns the smallest value not exceeded by @c percent % of the samples.
+  unsigned long long percentile(double percent) const
+  {
+    if (total == 0)
+      return 0;
+    unsigned long long rank =
+      static_cast<unsigned long long>(percent / 100.0 * total + 0.5);
+    if (rank < 1)
+      rank = 1;
+    if (rank > total)
+      rank = total;
+    unsigned long long seen = 0;
+    for (int i = 0; i < bucketCount; ++i)
+    {
+      seen += counts[i];
+      if (seen >= rank)
+      {
+        unsigned long long value = highestValueOf(i);
+        if (value > maxValue)
+          value = maxValue;
+        if (value < minValue)
+          value = minValue;
+        return value;
+      }
+    }
+    return maxValue;
+  }
+
+  /// Writes "count min max bucket:count ..." with the empty buckets skipped.
+  void write(std::ostream& out) const
+  {
+    out << total << ' ' << minValue << ' ' << maxValue;
+    for (int i = 0; i < static_cast<int>(counts.size()); ++i)
+      if (counts[i] != 0)
+        out << ' ' << i << ':' << counts[i];
+  }
+
+  bool read(std::istream& in)
+  {
+    *this = LatencyHistogram();
+    unsigned long long n = 0, lo = 0, hi = 0;
+    if (!(in >> n >> lo >> hi))
+      return false;
+    if (n == 0)
+      return true;
+    counts.resize(bucketCount);
+    unsigned long long seen = 0;
+    int bucket = 0;
+    char colon = 0;
+    unsigned long long c = 0;
+    while (in >> bucket >> colon >> c)
+    {
+      if (colon != ':' || bucket < 0 || bucket >= bucketCount)
+        return false;
+      counts[bucket] += c;
+      seen += c;
+    }
+    if (seen != n)
+    {
+      *this = LatencyHistogram();
+      return false;
+    }
+    total = n;
+    minValue = lo;
+    maxValue = hi;
+    return true;
+  }
+
+private:
+  static int highestBit(unsigned long long value)
+  {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#elif defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+      ++bit;
+    return bit;
+#endif
+  }
+
+  static int bucketOf(unsigned long long value)
+  {
+    if (value < 2 * subBucketCount)
+      return static_cast<int>(value);
+    const int shift = highestBit(value) - subBucketBits;
+    return shift * subBucketCount + static_cast<int>(value >> shift);
+  }
+
+  static unsigned long long highestValueOf(int bucket)
+  {
+    if (bucket < 2 * subBucketCount)
+      return bucket;
+    const int shift = bucket / subBucketCount - 1;
+    const unsigned long long sub = bucket % subBucketCount + subBucketCount;
+    return ((sub + 1) << shift) - 1;
+  }
+};
+
+/**
+ * Named timings of one run (typically one processed image). Each entry keeps
+ * a value in seconds and the distribution of the samples recorded into it.
+ * A profile is not synchronized: give every thread its own and merge() them
+ * afterwards.
+ */
 class TimeProfile
 {
 private:
-  static const int unknownValue = 0;
-  std::map<std::string, double> values;
+  struct Entry
+  {
+    bool used;
+    double value;
+    LatencyHistogram histogram;
+    Entry() : used(false), value(0.0), histogram() {}
+  };
+  std::vector<Entry> entries;
 
 public:
-  TimeProfile() : values() {}
-  TimeProfile(const TimeProfile& other) : values(other.values) {}
+  TimeProfile() : entries() {}
+  TimeProfile(const TimeProfile& other) : entries(other.entries) {}
   TimeProfile& operator=(const TimeProfile& other)
   {
     if (this != &other)
-      values = other.values;
+      entries = other.entries;
     return *this;
   }
 
 public:
+  void setValue(const TimeProfileKey& key, double value)
+  {
+    Entry& entry = at(key.index());
+    entry.used = true;
+    entry.value = value;
+  }
+
   void setValue(const char* key, double value)
   {
-    values[key] = value;
+    setValue(TimeProfileKey(key), value);
+  }
+
+  double getValue(const TimeProfileKey& key) const
+  {
+    const Entry* entry = find(key.index());
+    return entry ? entry->value : 0.0;
   }
 
   double getValue(const char* key) const
   {
-    std::map<std::string, double>::const_iterator it = values.find(key);
-    if (it == values.end())
-      return 0.0;
-    return it->second;
+    const Entry* entry = find(TimeProfileKey::lookup(key));
+    return entry ? entry->value : 0.0;
+  }
+
+  /// Adds a sample of @c seconds to both the value and the distribution.
+  void record(const TimeProfileKey& key, double seconds)
+  {
+    Entry& entry = at(key.index());
+    entry.used = true;
+    entry.value += seconds;
+    entry.histogram.record(
+      seconds > 0 ? static_cast<unsigned long long>(seconds * 1e9 + 0.5) : 0);
+  }
+
+  void record(const char* key, double seconds)
+  {
+    record(TimeProfileKey(key), seconds);
+  }
+
+  /// Returns an empty histogram if no samples were recorded under @c key.
+  const LatencyHistogram& getHistogram(const TimeProfileKey& key) const
+  {
+    static const LatencyHistogram empty;
+    const Entry* entry = find(key.index());
+    return entry ? entry->histogram : empty;
+  }
+
+  const LatencyHistogram& getHistogram(const char* key) const
+  {
+    static const LatencyHistogram empty;
+    const Entry* entry = find(TimeProfileKey::lookup(key));
+    return entry ? entry->histogram : empty;
+  }
+
+  /// Sums the values and distributions of @c other into this profile.
+  void merge(const TimeProfile& other)
+  {
+    for (int i = 0; i < static_cast<int>(other.entries.size()); ++i)
+    {
+      const Entry& src = other.entries[i];
+      if (!src.used)
+        continue;
+      Entry& dst = at(i);
+      dst.used = true;
+      dst.value += src.value;
+      dst.histogram.merge(src.histogram);
+    }
   }
 
   void updateSubsystems(std::set<std::string>& subsystems, 
                         const std::string& pattern = "") const
   {
-    std::map<std::string, double>::const_iterator it;
-    for(it = values.begin(); it != values.end(); ++it)
+    for (int i = 0; i < static_cast<int>(entries.size()); ++i)
     {
-      const std::string& cur = it->first;
+      if (!entries[i].used)
+        continue;
+      const std::string cur = TimeProfileKey::nameOf(i);
       if (cur.find(pattern) != cur.npos)
       {
         subsystems.insert(cur);
@@ -88,19 +424,38 @@ public:
 
   bool isEmpty() const
   {
-    return values.empty();
+    for (int i = 0; i < static_cast<int>(entries.size()); ++i)
+      if (entries[i].used)
+        return false;
+    return true;
   }
 
+  // Each entry is written as its name on one line and the value on the next,
+  // followed by the distribution if there is one. Readers that predate the
+  // distributions skip the rest of the value line, so old and new files stay
+  // mutually readable.
   bool write(std::fstream& out) const
   {
     if (out.fail())
       return false;
 
+    std::map<std::string, int> sorted;
+    for (int i = 0; i < static_cast<int>(entries.size()); ++i)
+      if (entries[i].used)
+        sorted[TimeProfileKey::nameOf(i)] = i;
+
     out << "TimeProfile" << std::endl;
-    std::map<std::string, double>::const_iterator it;
-    for(it = values.begin(); it != values.end(); ++it)
+    std::map<std::string, int>::const_iterator it;
+    for(it = sorted.begin(); it != sorted.end(); ++it)
     {
-      out << it->first << std::endl << it->second << std::endl;
+      const Entry& entry = entries[it->second];
+      out << it->first << std::endl << entry.value;
+      if (entry.histogram.count() > 0)
+      {
+        out << ' ';
+        entry.histogram.write(out);
+      }
+      out << std::endl;
     }
     out << std::endl;
     out.flush();
@@ -113,43 +468,73 @@ public:
       return false;
 
     std::string key;
+    std::string line;
     double value = 0;
     std::getline(in, key);
     while(key.size() > 0)
     {
       in >> value;
-      setValue(key.c_str(), value);
-      std::getline(in, key);
+      TimeProfileKey k(key.c_str());
+      setValue(k, value);
+      std::getline(in, line);
+      std::istringstream rest(line);
+      at(k.index()).histogram.read(rest);
       std::getline(in, key);
     }
     return true;
   }
+
+private:
+  Entry& at(int index)
+  {
+    if (index >= static_cast<int>(entries.size()))
+      entries.resize(index + 1);
+    return entries[index];
+  }
+
+  const Entry* find(int index) const
+  {
+    if (index < 0 || index >= static_cast<int>(entries.size()) ||
+        !entries[index].used)
+      return 0;
+    return &entries[index];
+  }
 };
 
-class Timer
+/**
+ * Records the time spent in its scope, in seconds, as a sample of the @c key
+ * entry of @c profile. Several scopes with the same key accumulate. Code
+ * written for the former profiling Timer of this header keeps compiling: the
+ * Timer of minutils/timer.h accepts the same name and profile arguments.
+ */
+class ScopedTimer
 {
-  std::string timerName;
-  long long t_start;
+  TimeProfileKey key;
   TimeProfile* profile;
+  Timer timer;
 
 public:
-  Timer(std::string name, TimeProfile* profile) :
-  timerName(name), profile(profile), t_start(highResolutionClock())  { }
+  ScopedTimer(const TimeProfileKey& key, TimeProfile* profile) :
+  key(key), profile(profile), timer()
+  {
+    timer.start();
+  }
+
+  ScopedTimer(const std::string& key, TimeProfile* profile) :
+  key(key.c_str()), profile(profile), timer()
+  {
+    timer.start();
+  }
 
-  virtual ~Timer()
+  ~ScopedTimer()
   {
     if (profile)
-    {
-      const double lastTime = profile->getValue(timerName.c_str());
-      const double currTime = (highResolutionClock() - t_start) /
-        static_cast<double>(highResolutionClocksPerSecond());
-      profile->setValue(timerName.c_str(), lastTime + currTime);
-    }
+      profile->record(key, timer.seconds());
   }
 
 private:
-  Timer(const Timer&);
-  Timer& operator=(const Timer&);
+  ScopedTimer(const ScopedTimer&);
+  ScopedTimer& operator=(const ScopedTimer&);
 };
 
-#endif //TIMEPROFILE_H_INCLUDED
\ No newline at end of file
+#endif //TIMEPROFILE_H_INCLUDED
@@ -1,45 +1,59 @@
 #ifndef MINUTILS_TIMER_H_INCLUDED
 #define MINUTILS_TIMER_H_INCLUDED
 
-#if defined _WINDOWS
-  #include <windows.h>
-#elif defined _IOS
-  #include <sys/time.h>
-#endif // _WINDOWS
+#include <string>
+
+#include <minstopwatch/hiresclock.h>
 
 
 /**
- * 
+ * Measures wall time with the monotonic clock from minstopwatch/hiresclock.h
+ * (clock_gettime(CLOCK_MONOTONIC) on POSIX, QueryPerformanceCounter on
+ * Windows, the calibrated time stamp counter if MINSTOPWATCH_USE_TSC is
+ * defined).
+ *
+ * For compatibility, a timer constructed with a name and a profile also works
+ * as the profiling timer formerly declared in minutils/timeprofile.h: it
+ * starts at once and records its lifetime into the profile on destruction.
  */
 class Timer
 {
 // Nested types
 private:
-
-#if defined _WINDOWS
-  typedef SYSTEMTIME Time;
-#elif defined _IOS
-  typedef timeval Time;
-#else
-  struct Time
-  {
-    int unused;
-  };
-#endif
+  typedef long long Time;
 
 // Fields
 private:
   Time m_start;
+  Time m_lap;
+  std::string m_name;
+  void* m_pProfile;
+  void (*m_record)(void* pProfile, const std::string& name, double seconds);
 
 // Constructors/destructor
 public:
-  Timer()
+  Timer() : m_start(0), m_lap(0), m_name(), m_pProfile(0), m_record(0)
+  {
+  }
+
+  /**
+   * Deprecated, use ScopedTimer from minutils/timeprofile.h instead. Starts
+   * the timer and records the time spent in its scope, in seconds, as a
+   * sample of the @c name entry of @c pProfile (a TimeProfile)
+   */
+  template <class Profile>
+  Timer(const std::string& name, Profile* pProfile) :
+  m_start(0), m_lap(0), m_name(name), m_pProfile(pProfile),
+  m_record(&recordInto<Profile>)
   {
-    Time zero = {0};
-    m_start = zero;
+    start();
+  }
+
+  ~Timer()
+  {
+    if (m_pProfile)
+      m_record(m_pProfile, m_name, seconds());
   }
-    
-//  ~Timer();
 
 private:
 	Timer(const Timer&);
@@ -52,49 +66,70 @@ private:
 public:
   void start()
   {
-    getCurrentTime(m_start);
+    m_start = getCurrentTime();
+    m_lap = m_start;
   }
 
   /**
    * Retrives time passed from start() in milliseconds
    */
-  long time()
+  long time() const
+  {
+    return long(split() / 1000000);
+  }
+
+  /**
+   * Retrives time passed from start() in nanoseconds
+   */
+  long long split() const
+  {
+    return getTimeDiff(m_start, getCurrentTime());
+  }
+
+  /**
+   * Retrives time passed from the previous lap() (or from start() for the
+   * first one) in nanoseconds and begins a new lap
+   */
+  long long lap()
   {
-    Time now = {0};
-    getCurrentTime(now);
-    return getTimeDiff(m_start, now);
+    Time now = getCurrentTime();
+    long long result = getTimeDiff(m_lap, now);
+    m_lap = now;
+    return result;
+  }
+
+  /**
+   * Retrives time passed from start() in seconds
+   */
+  double seconds() const
+  {
+    return (getCurrentTime() - m_start) /
+           static_cast<double>(highResolutionClocksPerSecond());
   }
 
 private:
-  void getCurrentTime(Time& t)
+  template <class Profile>
+  static void recordInto(void* pProfile, const std::string& name,
+                         double seconds)
   {
-#if defined _WINDOWS
-    GetSystemTime(&t);
-#elif defined _IOS
-    gettimeofday(&t, NULL);
-#else
-    Time zero = {0};
-    t = zero;
-#endif
+    static_cast<Profile*>(pProfile)->record(name.c_str(), seconds);
   }
 
-  long getTimeDiff(const Time& begin, const Time& end)
+  static Time getCurrentTime()
   {
-    long result = 0;
-
-#if defined _WINDOWS
-    result += long(end.wHour-begin.wHour)     * 1000 /*msec*/ * 60 /*sec*/ * 60 /*min*/;
-    result += long(end.wMinute-begin.wMinute) * 1000 /*msec*/ * 60 /*sec*/;
-    result += long(end.wSecond-begin.wSecond) * 1000 /*msec*/;
-    result += long(end.wMilliseconds-begin.wMilliseconds);
-#elif defined _IOS
-    Time sub = {0};
-    timersub(&end, &begin, &sub);
-    result += long(sub.tv_sec) * 1000 /*msec*/;
-    result += long(sub.tv_usec) / 1000 /*microsec*/;
-#endif
+    return highResolutionClock();
+  }
 
-    return result;
+  static long long getTimeDiff(const Time& begin, const Time& end)
+  {
+    const long long ticks = end - begin;
+    const long long frequency = highResolutionClocksPerSecond();
+    if (frequency == 1000000000LL)
+      return ticks;
+
+    // Split to avoid overflowing ticks * 10^9 on long intervals.
+    return ticks / frequency * 1000000000LL +
+           ticks % frequency * 1000000000LL / frequency;
   }
 };
 